@@ -0,0 +1,13 @@
+/*
+ * 主机上运行内核基准测试: nos-bench <name> [args]
+ * 与shell的bench命令相同, 只是跑在主机进程里, 可以直接用perf分析:
+ *   perf record -g host/build/nos-bench fs
+ */
+#include <kernel/bench.h>
+#include "host.h"
+
+int main(int argc, char **argv) {
+    host_kernel_init();
+    bench_main(argc, argv);
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * 文件系统模糊测试: 输入字节解释为对几个文件的创建、按偏移读写、截断、
+ * 整体写入、开关透明压缩和删除. 每个文件在内存里有一份模型,
+ * 每次读取都和模型比较; 结束时删除全部文件, 检查数据页和索引页都已释放.
+ */
+#include <kernel/fs.h>
+#include <kernel/mm.h>
+#include <kernel/string.h>
+#include "host.h"
+
+#define NR_FILES      4
+#define MAX_FILE_SIZE (64 * PAGE_SIZE)       /* 超过一页, 用到两层索引 */
+#define MAX_IO        (3 * PAGE_SIZE)
+
+/* 解压缓存 (fs.c的ZCACHE_ENTRIES) 的页在删除文件后仍保留 */
+#define ZCACHE_PAGES  16
+
+static const char *paths[NR_FILES] = { "/fz0", "/fz1", "/fz2", "/fz3" };
+
+typedef struct {
+    bool exists;
+    size_t size;
+    uint8_t data[MAX_FILE_SIZE];
+} model_t;
+
+static model_t models[NR_FILES];
+static uint8_t iobuf[MAX_FILE_SIZE];
+static uint8_t readbuf[MAX_FILE_SIZE];
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+} input_t;
+
+static uint32_t next_byte(input_t *in) {
+    return in->pos < in->size ? in->data[in->pos++] : 0;
+}
+
+static uint32_t next_u32(input_t *in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        v |= next_byte(in) << (8 * i);
+    }
+    return v;
+}
+
+/* 按输入生成len字节: 短周期的重复模式, 大多能被LZ4压缩 */
+static void fill_data(input_t *in, uint8_t *buf, size_t len) {
+    uint8_t pattern[64];
+    size_t period = 1 + next_byte(in) % sizeof(pattern);
+
+    for (size_t i = 0; i < period; i++) {
+        pattern[i] = next_byte(in);
+    }
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = pattern[i % period];
+    }
+}
+
+static void check_range(int f, size_t off, size_t len) {
+    model_t *m = &models[f];
+    file_t *file = fs_find(paths[f]);
+
+    if (!file) {
+        host_panic("fuzz_fs: %s disappeared", paths[f]);
+    }
+    if (file->size != m->size) {
+        host_panic("fuzz_fs: %s size %llu, expected %llu", paths[f],
+                   (uint64_t)file->size, (uint64_t)m->size);
+    }
+
+    size_t expect = off >= m->size ? 0 : (len < m->size - off ? len : m->size - off);
+    size_t got = fs_read_at(file, off, readbuf, len);
+    if (got != expect) {
+        host_panic("fuzz_fs: %s read %llu@%llu returned %llu, expected %llu", paths[f],
+                   (uint64_t)len, (uint64_t)off, (uint64_t)got, (uint64_t)expect);
+    }
+    for (size_t i = 0; i < got; i++) {
+        if (readbuf[i] != m->data[off + i]) {
+            host_panic("fuzz_fs: %s differs at %llu", paths[f], (uint64_t)(off + i));
+        }
+    }
+}
+
+static void do_op(input_t *in) {
+    uint32_t op = next_byte(in);
+    int f = next_byte(in) % NR_FILES;
+    model_t *m = &models[f];
+    file_t *file = fs_find(paths[f]);
+
+    if ((file != NULL) != m->exists) {
+        host_panic("fuzz_fs: %s exists=%d, expected %d", paths[f], file != NULL, m->exists);
+    }
+
+    if (!m->exists) {
+        if (fs_create(paths[f], FILE_TYPE_REGULAR) != 0) {
+            host_panic("fuzz_fs: cannot create %s", paths[f]);
+        }
+        m->exists = true;
+        m->size = 0;
+        return;
+    }
+
+    switch (op % 7) {
+        case 0: {                       /* 按偏移写 */
+            size_t off = next_u32(in) % MAX_FILE_SIZE;
+            size_t len = next_u32(in) % (MAX_IO + 1);
+            if (len > MAX_FILE_SIZE - off) {
+                len = MAX_FILE_SIZE - off;
+            }
+            fill_data(in, iobuf, len);
+            if (fs_write_at(file, off, iobuf, len) != len) {
+                host_panic("fuzz_fs: short write to %s", paths[f]);
+            }
+            /* 写入位置在文件末尾之后时, 中间是读出为0的空洞 */
+            if (off > m->size) {
+                memset(m->data + m->size, 0, off - m->size);
+            }
+            memcpy(m->data + off, iobuf, len);
+            if (off + len > m->size) {
+                m->size = off + len;
+            }
+            break;
+        }
+        case 1:                         /* 按偏移读 */
+            check_range(f, next_u32(in) % (MAX_FILE_SIZE + PAGE_SIZE),
+                        next_u32(in) % (MAX_IO + 1));
+            break;
+        case 2: {                       /* 截断或扩展 */
+            size_t size = next_u32(in) % (MAX_FILE_SIZE + 1);
+            fs_truncate(file, size);
+            if (size > m->size) {
+                memset(m->data + m->size, 0, size - m->size);
+            }
+            m->size = size;
+            break;
+        }
+        case 3: {                       /* 整体覆盖 */
+            size_t size = next_u32(in) % (MAX_FILE_SIZE + 1);
+            fill_data(in, iobuf, size);
+            if (fs_write(paths[f], iobuf, size) != (int)size) {
+                host_panic("fuzz_fs: fs_write %s failed", paths[f]);
+            }
+            memcpy(m->data, iobuf, size);
+            m->size = size;
+            break;
+        }
+        case 4:                         /* 透明压缩 */
+            if (fs_set_compress(paths[f], next_byte(in) & 1) != 0) {
+                host_panic("fuzz_fs: chattr %s failed", paths[f]);
+            }
+            break;
+        case 5:
+            if (fs_delete(paths[f]) != 0) {
+                host_panic("fuzz_fs: cannot delete %s", paths[f]);
+            }
+            m->exists = false;
+            break;
+        default:
+            check_range(f, 0, MAX_FILE_SIZE);
+            break;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    input_t in = { data, size, 0 };
+
+    host_kernel_init();
+
+    page_tag_stat_t before[NR_PAGE_TAGS];
+    page_tag_get_stats(before);
+
+    while (in.pos < in.size) {
+        do_op(&in);
+    }
+
+    for (int f = 0; f < NR_FILES; f++) {
+        if (models[f].exists) {
+            check_range(f, 0, MAX_FILE_SIZE);
+            if (fs_delete(paths[f]) != 0) {
+                host_panic("fuzz_fs: cannot delete %s", paths[f]);
+            }
+            models[f].exists = false;
+        }
+    }
+    /* 删除的文件和旧的哈希表在宽限期之后才释放 */
+    rcu_barrier();
+
+    page_tag_stat_t after[NR_PAGE_TAGS];
+    page_tag_get_stats(after);
+    if (after[PG_FSMETA].live != before[PG_FSMETA].live) {
+        host_panic("fuzz_fs: %lld index pages leaked",
+                   (int64_t)(after[PG_FSMETA].live - before[PG_FSMETA].live));
+    }
+    if (after[PG_PAGECACHE].live > ZCACHE_PAGES) {
+        host_panic("fuzz_fs: %llu data pages left after deleting every file",
+                   after[PG_PAGECACHE].live);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * 模糊测试的独立驱动 (没有libFuzzer时使用, 用主机libc编译):
+ *   fuzz-xx file...            逐个运行给定的输入 (复现崩溃)
+ *   fuzz-xx [-n runs] [-s seed] [-l maxlen]   运行随机输入
+ * 用clang构建时 (make host-fuzz HOST_FUZZ_CC=clang) 改为链接libFuzzer, 不用这个文件.
+ */
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern int host_printk_quiet;
+
+/* 随机输入导致崩溃时把它写到crash-input, 之后用 fuzz-xx crash-input 复现 */
+static const uint8_t *cur_data;
+static size_t cur_size;
+
+static void save_crash(int sig) {
+    int fd = open("crash-input", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        ssize_t n = write(fd, cur_data, cur_size);
+        (void)n;
+        close(fd);
+        static const char msg[] = "input saved to crash-input\n";
+        n = write(2, msg, sizeof(msg) - 1);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static int run_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    static uint8_t buf[1 << 20];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, n);
+    printf("%s: ok (%zu bytes)\n", path, n);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    unsigned long runs = 10000;
+    unsigned long seed = 1;
+    size_t maxlen = 1024;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (i + 1 >= argc) {
+            break;
+        }
+        if (strcmp(argv[i], "-n") == 0) {
+            runs = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            maxlen = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n runs] [-s seed] [-l maxlen] [file...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    host_printk_quiet = 1;
+    if (i < argc) {
+        int err = 0;
+        for (; i < argc; i++) {
+            err |= run_file(argv[i]);
+        }
+        return err;
+    }
+
+    uint8_t *buf = malloc(maxlen ? maxlen : 1);
+    cur_data = buf;
+    signal(SIGABRT, save_crash);
+    signal(SIGSEGV, save_crash);
+    srandom(seed);
+    for (unsigned long r = 0; r < runs; r++) {
+        size_t n = maxlen ? (size_t)random() % (maxlen + 1) : 0;
+        for (size_t j = 0; j < n; j++) {
+            buf[j] = (uint8_t)random();
+        }
+        cur_size = n;
+        LLVMFuzzerTestOneInput(buf, n);
+    }
+    printf("%lu random inputs (seed %lu, up to %zu bytes): ok\n", runs, seed, maxlen);
+    free(buf);
+    return 0;
+}
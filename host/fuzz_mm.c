@@ -0,0 +1,156 @@
+/*
+ * 分配器模糊测试: 输入字节解释为alloc_page/alloc_pages/kmalloc/释放的操作序列.
+ * 每块分配填上自己的字节, 释放前检查没有被别的分配覆盖;
+ * 结束时全部释放, 检查各tag的页数回到初始值, 在用页 + 空闲页始终等于总页数.
+ */
+#include <kernel/mm.h>
+#include <kernel/string.h>
+#include "host.h"
+
+#define MAX_OBJS      64
+#define MAX_RUN_PAGES 8
+#define MAX_KMALLOC   (3 * PAGE_SIZE)
+
+/* kmalloc的每个级别 (16B..2KB) 可能保留一个空slab */
+#define SLAB_CLASSES  8
+
+enum { OBJ_NONE, OBJ_PAGES, OBJ_KMALLOC };
+
+typedef struct {
+    uint8_t *p;
+    size_t size;
+    int kind;
+    uint8_t fill;
+} obj_t;
+
+static obj_t objs[MAX_OBJS];
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+} input_t;
+
+static uint32_t next_byte(input_t *in) {
+    return in->pos < in->size ? in->data[in->pos++] : 0;
+}
+
+static uint32_t next_u16(input_t *in) {
+    return next_byte(in) | (next_byte(in) << 8);
+}
+
+static uint64_t total_pages(void) {
+    page_tag_stat_t st[NR_PAGE_TAGS];
+    uint64_t used = 0;
+
+    page_tag_get_stats(st);
+    for (int i = 0; i < NR_PAGE_TAGS; i++) {
+        used += st[i].live;
+    }
+    return used + get_free_pages();
+}
+
+static void check_zero(const uint8_t *p, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (p[i]) {
+            host_panic("fuzz_mm: new page %p not zeroed at +%llu", (void *)p, (uint64_t)i);
+        }
+    }
+}
+
+static void obj_free(obj_t *o) {
+    for (size_t i = 0; i < o->size; i++) {
+        if (o->p[i] != o->fill) {
+            host_panic("fuzz_mm: %p (%llu bytes) overwritten at +%llu",
+                       (void *)o->p, (uint64_t)o->size, (uint64_t)i);
+        }
+    }
+    if (o->kind == OBJ_PAGES) {
+        free_pages(o->p, o->size / PAGE_SIZE);
+    } else {
+        kfree(o->p);
+    }
+    o->kind = OBJ_NONE;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    input_t in = { data, size, 0 };
+
+    host_kernel_init();
+
+    page_tag_stat_t before[NR_PAGE_TAGS];
+    page_tag_get_stats(before);
+    uint64_t total = total_pages();
+    uint8_t fill = 0;
+
+    while (in.pos < in.size) {
+        uint32_t op = next_byte(&in);
+        obj_t *o = &objs[next_byte(&in) % MAX_OBJS];
+
+        if (op % 4 == 3) {
+            if (o->kind != OBJ_NONE) {
+                obj_free(o);
+            }
+            continue;
+        }
+        if (o->kind != OBJ_NONE) {
+            obj_free(o);
+        }
+
+        switch (op % 4) {
+            case 0:
+                o->p = alloc_page();
+                o->size = PAGE_SIZE;
+                o->kind = OBJ_PAGES;
+                break;
+            case 1: {
+                size_t n = 1 + next_byte(&in) % MAX_RUN_PAGES;
+                o->p = alloc_pages(n);
+                o->size = n * PAGE_SIZE;
+                o->kind = OBJ_PAGES;
+                break;
+            }
+            default:
+                o->size = 1 + next_u16(&in) % MAX_KMALLOC;
+                o->p = kmalloc(o->size);
+                o->kind = OBJ_KMALLOC;
+                if (o->p && ksize(o->p) < o->size) {
+                    host_panic("fuzz_mm: ksize %llu < requested %llu",
+                               (uint64_t)ksize(o->p), (uint64_t)o->size);
+                }
+                break;
+        }
+        if (!o->p) {
+            o->kind = OBJ_NONE;
+            continue;
+        }
+        if (o->kind == OBJ_PAGES) {
+            check_zero(o->p, o->size);
+        }
+        o->fill = ++fill;
+        memset(o->p, o->fill, o->size);
+
+        if (total_pages() != total) {
+            host_panic("fuzz_mm: tagged + free pages %llu != %llu",
+                       total_pages(), total);
+        }
+    }
+
+    for (int i = 0; i < MAX_OBJS; i++) {
+        if (objs[i].kind != OBJ_NONE) {
+            obj_free(&objs[i]);
+        }
+    }
+
+    page_tag_stat_t after[NR_PAGE_TAGS];
+    page_tag_get_stats(after);
+    if (after[PG_OTHER].live != before[PG_OTHER].live) {
+        host_panic("fuzz_mm: %lld pages leaked",
+                   (int64_t)(after[PG_OTHER].live - before[PG_OTHER].live));
+    }
+    if (after[PG_SLAB].live > before[PG_SLAB].live + SLAB_CLASSES) {
+        host_panic("fuzz_mm: slab kept %llu pages after freeing everything",
+                   after[PG_SLAB].live - before[PG_SLAB].live);
+    }
+    return 0;
+}
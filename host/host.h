@@ -0,0 +1,17 @@
+#ifndef _HOST_H
+#define _HOST_H
+
+#include <kernel/types.h>
+
+/* 主机构建: 内核代码 (基准测试和模糊测试) 可以使用的shim接口 */
+
+/* 非0时printk不输出 (模糊测试中屏蔽"文件不存在"之类的信息) */
+extern int host_printk_quiet;
+
+/* 打印到stderr并abort, 模糊测试据此报告失败的输入 */
+void host_panic(const char *fmt, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+/* 初始化物理内存和内存文件系统 (只执行一次) */
+void host_kernel_init(void);
+
+#endif
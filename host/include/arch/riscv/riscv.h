@@ -0,0 +1,57 @@
+#ifndef _ARCH_RISCV_H
+#define _ARCH_RISCV_H
+
+/*
+ * 主机构建用的riscv.h: 放在include路径的最前面, 代替真正的架构头文件.
+ * 单线程运行, 中断和屏障都是空操作, CSR写入被丢弃;
+ * rdtime由host/shim.c用clock_gettime模拟10MHz时基.
+ */
+
+#include <kernel/types.h>
+
+#define SATP_MODE_SV39 (8ULL << 60)
+#define PAGE_SIZE 4096
+
+#define read_csr(reg) ((uint64_t)0)
+#define write_csr(reg, val) ((void)(val))
+
+#define TIMEBASE_FREQ 10000000UL
+
+uint64_t rdtime(void);
+
+#define MAX_HARTS 1
+
+static inline uint64_t cpu_id(void) {
+    return 0;
+}
+
+#define SSTATUS_SIE (1UL << 1)
+#define SSTATUS_SPIE (1UL << 5)
+#define SIE_STIE (1UL << 5)
+#define SIE_SEIE (1UL << 9)
+
+static inline uint64_t local_irq_save(void) {
+    return 0;
+}
+
+static inline void local_irq_restore(uint64_t flags) {
+    (void)flags;
+}
+
+static inline void local_irq_enable(void) {
+}
+
+static inline void local_irq_disable(void) {
+}
+
+static inline void mb(void) {
+    asm volatile("" ::: "memory");
+}
+
+static inline void sfence_vma(void) {
+}
+
+static inline void wfi(void) {
+}
+
+#endif
@@ -0,0 +1,139 @@
+/* 主机构建: 用内核头文件编译的桩函数, 代替没有编进来的子系统 */
+#include <kernel/fs.h>
+#include <kernel/nosfs.h>
+#include <kernel/process.h>
+#include <kernel/bench.h>
+#include <kernel/printk.h>
+#include <kernel/mm.h>
+#include <kernel/rcu.h>
+#include "host.h"
+
+/*
+ * 主机上只有一个"进程" (调用者的线程), 没有磁盘也没有initramfs,
+ * 文件系统总是纯内存的. 依赖设备或调度器的基准测试只打印一行说明.
+ */
+
+static process_t host_proc = { .pid = 1, .name = "host", .state = PROC_RUNNING };
+
+process_t *current_process(void) {
+    return &host_proc;
+}
+
+/* 没有别的进程可以切换: 让出CPU只是一次静止状态 (RCU回调在这里运行) */
+void yield(void) {
+    rcu_qs();
+}
+
+int nosfs_mount(file_t *root) {
+    (void)root;
+    return -1;
+}
+
+bool nosfs_mounted(void) {
+    return false;
+}
+
+/* 文件的disk_ino总是0, 下面这些不会被调用 */
+int nosfs_dir_load(file_t *dir, nosfs_fill_t fill) {
+    (void)dir;
+    (void)fill;
+    return 0;
+}
+
+int nosfs_create(file_t *dir, const char *name, file_t *file, uint32_t *slot) {
+    (void)dir;
+    (void)name;
+    (void)file;
+    (void)slot;
+    return -1;
+}
+
+int nosfs_remove(file_t *dir, file_t *file, uint32_t slot) {
+    (void)dir;
+    (void)file;
+    (void)slot;
+    return -1;
+}
+
+size_t nosfs_read_at(file_t *file, size_t offset, void *buf, size_t len) {
+    (void)file;
+    (void)offset;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+size_t nosfs_write_at(file_t *file, size_t offset, const void *buf, size_t len) {
+    (void)file;
+    (void)offset;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+void nosfs_truncate(file_t *file, size_t size) {
+    (void)file;
+    (void)size;
+}
+
+void nosfs_sync(void) {
+}
+
+void journal_get_stats(journal_stats_t *stats) {
+    journal_stats_t zero = { 0 };
+    *stats = zero;
+}
+
+int journal_replay_test(uint32_t nblocks) {
+    (void)nblocks;
+    return -1;
+}
+
+/* ---------------- 主机上不可用的基准测试 ---------------- */
+
+static void host_unavailable(const char *name) {
+    printk("bench %s: needs the kernel running under QEMU, not available in the host build\n",
+           name);
+}
+
+void bench_printk(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    host_unavailable("printk");
+}
+
+void bench_blk(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    host_unavailable("blk");
+}
+
+void bench_pipe(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    host_unavailable("pipe");
+}
+
+void bench_uring(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    host_unavailable("uring");
+}
+
+void bench_rcu(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    host_unavailable("rcu");
+}
+
+/* ---------------- 初始化 ---------------- */
+
+void host_kernel_init(void) {
+    static bool done;
+
+    if (!done) {
+        done = true;
+        mm_init();
+        fs_init();
+    }
+}
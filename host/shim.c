@@ -0,0 +1,71 @@
+/*
+ * 主机构建的运行环境 (用主机libc编译, 不包含内核头文件):
+ *   - 在固定地址上映射128MB当作RAM, 由pmm.c照常管理
+ *   - printk输出到stdout
+ *   - rdtime用单调时钟模拟10MHz时基
+ */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/*
+ * KERNEL_BASE由Makefile传给pmm.c和这里. 不用内核的0x80200000:
+ * 那里在AddressSanitizer的影子内存里; 放在2GB以下, 非PIE代码可以直接引用kernel_end.
+ */
+#define HOST_RAM_SIZE (MEMORY_END - KERNEL_BASE)    /* pmm.c的MEMORY_SIZE */
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+/* 没有内核镜像占用RAM: 全部页都可以分配 */
+__asm__(".globl kernel_end\n.set kernel_end, " XSTR(KERNEL_BASE));
+
+int host_printk_quiet;
+
+__attribute__((constructor))
+static void host_ram_init(void) {
+    void *ram = mmap((void *)KERNEL_BASE, HOST_RAM_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+    if (ram != (void *)KERNEL_BASE) {
+        fprintf(stderr, "host: cannot map RAM at %#lx\n", (unsigned long)KERNEL_BASE);
+        exit(1);
+    }
+}
+
+void vprintk(const char *fmt, va_list ap) {
+    if (host_printk_quiet) {
+        return;
+    }
+    /* 去掉KERN_xxx级别前缀 */
+    if (fmt[0] == '\001' && fmt[1] != '\0') {
+        fmt += 2;
+    }
+    vprintf(fmt, ap);
+}
+
+void printk(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintk(fmt, ap);
+    va_end(ap);
+}
+
+uint64_t rdtime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 10000000 + (uint64_t)ts.tv_nsec / 100;
+}
+
+void host_panic(const char *fmt, ...) {
+    va_list ap;
+    fflush(stdout);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    abort();
+}
@@ -18,12 +18,64 @@
     asm volatile("csrw " #reg ", %0" :: "r"(val)); \
 })
 
+/* 时钟 (QEMU virt的time CSR频率为10MHz) */
+#define TIMEBASE_FREQ 10000000UL
+
+static inline uint64_t rdtime(void) {
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+/* 周期计数器 (OpenSBI通过mcounteren允许S态读取) */
+static inline uint64_t rdcycle(void) {
+    uint64_t c;
+    asm volatile("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+/* 当前hart编号 (start.S中保存在tp寄存器) */
+#define MAX_HARTS 8
+
+static inline uint64_t cpu_id(void) {
+    uint64_t id;
+    asm volatile("mv %0, tp" : "=r"(id));
+    return id;
+}
+
 /* 中断相关 */
 #define SSTATUS_SIE (1UL << 1)  /* Supervisor Interrupt Enable */
 #define SSTATUS_SPIE (1UL << 5) /* Previous SIE */
+#define SSTATUS_SPP (1UL << 8)  /* 陷入前的特权级: 0为用户态 */
 #define SIE_STIE (1UL << 5)     /* Timer Interrupt Enable */
+#define SIE_SEIE (1UL << 9)     /* External Interrupt Enable */
+
+/* 关闭本地中断并返回之前的状态 */
+static inline uint64_t local_irq_save(void) {
+    uint64_t flags;
+    asm volatile("csrrc %0, sstatus, %1" : "=r"(flags) : "r"(SSTATUS_SIE) : "memory");
+    return flags & SSTATUS_SIE;
+}
+
+static inline void local_irq_restore(uint64_t flags) {
+    if (flags & SSTATUS_SIE) {
+        asm volatile("csrs sstatus, %0" :: "r"(SSTATUS_SIE) : "memory");
+    }
+}
+
+static inline void local_irq_enable(void) {
+    asm volatile("csrs sstatus, %0" :: "r"(SSTATUS_SIE) : "memory");
+}
+
+static inline void local_irq_disable(void) {
+    asm volatile("csrc sstatus, %0" :: "r"(SSTATUS_SIE) : "memory");
+}
 
 /* 内存屏障 */
+static inline void mb(void) {
+    asm volatile("fence rw, rw" ::: "memory");
+}
+
 static inline void sfence_vma(void) {
     asm volatile("sfence.vma" ::: "memory");
 }
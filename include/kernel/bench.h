@@ -0,0 +1,33 @@
+#ifndef _KERNEL_BENCH_H
+#define _KERNEL_BENCH_H
+
+#include <kernel/types.h>
+
+/* 基准测试 (shell命令 bench <name>) */
+typedef struct {
+    const char *name;
+    const char *desc;
+    void (*run)(int argc, char **argv);
+} bench_t;
+
+void bench_main(int argc, char **argv);
+
+/* 打印一项结果: 每次操作耗时、每秒操作数, bytes非0时附带吞吐量 */
+void bench_report(const char *what, uint64_t ops, uint64_t ticks, uint64_t bytes);
+
+/* 各子系统的基准测试 */
+void bench_printk(int argc, char **argv);
+void bench_fs(int argc, char **argv);
+void bench_dcache(int argc, char **argv);
+void bench_fd(int argc, char **argv);
+void bench_blk(int argc, char **argv);
+void bench_nosfs(int argc, char **argv);
+void bench_compress(int argc, char **argv);
+void bench_pipe(int argc, char **argv);
+void bench_uring(int argc, char **argv);
+void bench_vm(int argc, char **argv);
+void bench_mm(int argc, char **argv);
+void bench_crc(int argc, char **argv);
+void bench_rcu(int argc, char **argv);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _KERNEL_BLK_H
+#define _KERNEL_BLK_H
+
+#include <kernel/types.h>
+
+#define SECTOR_SIZE  512
+#define SECTOR_SHIFT 9
+
+/*
+ * 块I/O请求. blk_submit只负责入队, 完成时设置done/status并调用end_io
+ * (在中断上下文中). 提交失败的请求立即标记为完成. 数据缓冲区必须物理连续.
+ */
+typedef struct blk_request {
+    uint64_t sector;
+    uint32_t nr_sectors;
+    bool write;
+    void *buf;
+    volatile bool done;
+    int status;                             /* 0成功, -1失败 */
+    void (*end_io)(struct blk_request *req);
+    void *private;
+    struct blk_request *next;               /* 驱动内部使用 */
+} blk_request_t;
+
+typedef struct {
+    uint64_t submitted;     /* blk_submit次数 */
+    uint64_t dispatched;    /* 发给设备的virtio请求数 */
+    uint64_t merged;        /* 被合并进相邻请求的blk请求数 */
+    uint64_t completed;
+    uint64_t errors;
+    uint64_t interrupts;
+    uint64_t sectors_read;
+    uint64_t sectors_written;
+    uint32_t max_inflight;  /* 同时在设备中的最大请求数 */
+} blk_stats_t;
+
+bool blk_present(void);
+uint64_t blk_capacity(void);    /* 扇区数 */
+
+/* 异步接口 */
+int blk_submit(blk_request_t *req);
+void blk_wait(blk_request_t *req);
+
+/*
+ * 蓄流: blk_plug之后提交的请求先留在队列中, 便于合并相邻扇区,
+ * blk_unplug时一次性发给设备
+ */
+void blk_plug(void);
+void blk_unplug(void);
+
+/* 同步接口 */
+int blk_read(uint64_t sector, void *buf, uint32_t count);
+int blk_write(uint64_t sector, const void *buf, uint32_t count);
+
+void blk_get_stats(blk_stats_t *stats);
+void blk_reset_stats(void);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _KERNEL_BUF_H
+#define _KERNEL_BUF_H
+
+#include <kernel/types.h>
+#include <kernel/blk.h>
+
+/* 块缓存: 以(设备, 块号)为键缓存4KB磁盘块 */
+#define BLOCK_SIZE    4096
+#define BLOCK_SECTORS (BLOCK_SIZE / SECTOR_SIZE)
+
+#define ROOT_DEV 0          /* 目前只有一个块设备 (virtio-blk) */
+
+#define NR_BUFFERS    1024  /* 最多缓存4MB */
+
+/* 缓冲区状态 */
+#define B_VALID     0x01    /* 数据与磁盘一致或更新 */
+#define B_DIRTY     0x02    /* 需要写回 */
+#define B_IO        0x04    /* I/O进行中 */
+#define B_ERROR     0x08
+#define B_READAHEAD 0x10    /* 由预读读入, 尚未被访问 */
+#define B_JOURNAL   0x20    /* 属于未提交的日志事务, 提交前不能写回原位 */
+
+typedef struct buf {
+    uint32_t dev;
+    uint64_t blockno;
+    uint8_t *data;
+    volatile uint32_t flags;
+    uint32_t refcnt;
+    uint64_t dirty_time;        /* 变脏的时刻 (rdtime) */
+    struct buf *hash_next;
+    struct buf *lru_prev;       /* 链表头为最近使用 */
+    struct buf *lru_next;
+    blk_request_t req;
+} buf_t;
+
+typedef struct {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t readahead;         /* 预读发出的块数 */
+    uint64_t readahead_hits;    /* 预读块随后被访问 */
+    uint64_t writebacks;        /* 写回的块数 */
+    uint64_t flushes;           /* 写回批次数 */
+    uint64_t nr_buffers;
+    uint64_t nr_dirty;
+} bcache_stats_t;
+
+void bcache_init(void);
+
+/* 取得块并保证数据有效; 失败返回NULL. 用完必须brelse */
+buf_t *bread(uint32_t dev, uint64_t blockno);
+
+/* 取得块但不读盘 (调用者将覆盖整个块) */
+buf_t *bget(uint32_t dev, uint64_t blockno);
+
+/* 标记为脏, 由bflushd延迟写回 */
+void bdirty(buf_t *b);
+
+/* 立即同步写回 */
+int bwrite(buf_t *b);
+
+/* 批量同步写回: 按块号排序后一次提交, 返回失败的块数 */
+int bwrite_batch(buf_t **bufs, int n);
+
+/*
+ * 块已释放或将被重新用作元数据: 缓存中的旧内容不再写回 (只清除脏标志,
+ * 不影响B_JOURNAL). 块不在缓存中时什么也不做.
+ */
+void bdiscard(uint32_t dev, uint64_t blockno);
+
+void brelse(buf_t *b);
+
+/* 写回所有脏块 */
+void bsync(void);
+
+void bcache_get_stats(bcache_stats_t *stats);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _KERNEL_CRC32C_H
+#define _KERNEL_CRC32C_H
+
+#include <kernel/types.h>
+
+/*
+ * CRC32C (Castagnoli多项式0x1edc6f41, iSCSI/ext4/btrfs使用的校验和).
+ * crc是前面各段的结果, 第一段传0, 可以分段计算;
+ * 结果与标准CRC32C相同: crc32c(0, "123456789", 9) == 0xe3069283.
+ */
+#define CRC32C_CHECK 0xe3069283
+
+/* 编译时可用的最快实现 (-march带Zbc时用无进位乘法, 否则查表) */
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
+/* 查表, 每次处理1字节 (基准测试对比用) */
+uint32_t crc32c_byte(uint32_t crc, const void *buf, size_t len);
+
+/* slicing-by-8: 8张表, 每次处理8字节 */
+uint32_t crc32c_sw(uint32_t crc, const void *buf, size_t len);
+
+#ifdef __riscv_zbc
+/* Zbc的clmul/clmulr, 每8字节做一次Barrett约简 */
+uint32_t crc32c_clmul(uint32_t crc, const void *buf, size_t len);
+#endif
+
+#endif
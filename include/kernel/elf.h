@@ -0,0 +1,54 @@
+#ifndef _KERNEL_ELF_H
+#define _KERNEL_ELF_H
+
+#include <kernel/types.h>
+
+/* ELF64文件格式 (只包括加载可执行文件用到的部分) */
+
+#define ELF_MAGIC    0x464C457FU    /* "\177ELF" (小端) */
+#define ELFCLASS64   2
+#define ELFDATA2LSB  1
+#define ET_EXEC      2
+#define EM_RISCV     243
+
+/* ELF文件头 */
+typedef struct {
+    uint32_t e_magic;
+    uint8_t e_class;
+    uint8_t e_data;
+    uint8_t e_version_ident;
+    uint8_t e_pad[9];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} elf64_ehdr_t;
+
+/* 程序头 */
+#define PT_LOAD 1
+
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
+typedef struct {
+    uint32_t p_type;
+    uint32_t p_flags;
+    uint64_t p_offset;
+    uint64_t p_vaddr;
+    uint64_t p_paddr;
+    uint64_t p_filesz;
+    uint64_t p_memsz;
+    uint64_t p_align;
+} elf64_phdr_t;
+
+#endif
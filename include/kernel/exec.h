@@ -0,0 +1,27 @@
+#ifndef _KERNEL_EXEC_H
+#define _KERNEL_EXEC_H
+
+#include <kernel/types.h>
+#include <kernel/process.h>
+#include <kernel/trap.h>
+
+/*
+ * 用户程序: 从文件系统加载ELF64可执行文件 (RISC-V, ET_EXEC, 链接在用户空间
+ * USER_BASE之上), 在U态运行. 加载时只读文件头和程序头, 为每个PT_LOAD段建立
+ * 区域; 段的页在第一次访问时才从文件读入.
+ * 同一个程序的只读段 (代码、只读数据) 在各个实例间共享物理页:
+ * 程序映像缓存按文件记录解析好的段和已读入的只读页, initramfs中的程序
+ * 在最后一个实例退出后仍留在缓存里, 下次启动不用重新解析和读入.
+ */
+#define EXEC_MAX_ARGS 16
+
+/* 启动path处的程序, 返回新进程 (还没有运行), 失败返回NULL */
+process_t *exec(const char *path, int argc, char **argv);
+
+/* 用户进程退出时由process_exit调用: 报告加载和缺页统计, 释放地址空间 */
+void exec_exit_mm(void);
+
+/* 系统调用分发 (syscall.c), tf->a7为调用号 */
+void do_syscall(trapframe_t *tf);
+
+#endif
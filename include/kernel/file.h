@@ -0,0 +1,38 @@
+#ifndef _KERNEL_FILE_H
+#define _KERNEL_FILE_H
+
+#include <kernel/types.h>
+#include <kernel/fs.h>
+
+/* 打开标志 */
+#define O_RDONLY  0x000
+#define O_WRONLY  0x001
+#define O_RDWR    0x002
+#define O_ACCMODE 0x003
+#define O_CREAT   0x040
+#define O_TRUNC   0x200
+#define O_APPEND  0x400
+
+/* lseek */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+/* 打开的文件: 记录读写位置和打开方式, 持有文件的引用 */
+typedef struct open_file {
+    file_t *file;
+    size_t offset;
+    int flags;
+} open_file_t;
+
+/* 文件描述符接口, 失败返回-1 */
+int vfs_open(const char *path, int flags);
+int vfs_close(int fd);
+ssize_t vfs_read(int fd, void *buf, size_t len);
+ssize_t vfs_write(int fd, const void *buf, size_t len);
+ssize_t vfs_lseek(int fd, ssize_t offset, int whence);
+
+/* 关闭当前进程的所有文件描述符 (进程退出时) */
+void vfs_close_all(void);
+
+#endif
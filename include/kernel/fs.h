@@ -2,6 +2,7 @@
 #define _KERNEL_FS_H
 
 #include <kernel/types.h>
+#include <kernel/rcu.h>
 
 /* 文件类型 */
 typedef enum {
@@ -9,26 +10,160 @@ typedef enum {
     FILE_TYPE_DIRECTORY
 } file_type_t;
 
-/* 文件描述符 */
-#define MAX_FILES 32
 #define MAX_FILENAME 64
-#define MAX_FILESIZE (64 * 1024)  /* 64KB */
+#define MAX_PATH 256
 
-typedef struct {
-    char name[MAX_FILENAME];
+/*
+ * 文件数据按页存放, 页在写入时才从物理页分配器分配.
+ * 每个文件一棵基数树索引数据页:
+ *   height 0: 没有数据页
+ *   height 1: root直接是第0页 (不超过4KB的文件没有索引开销)
+ *   height n: root是索引页, 每个索引页512个指针, 可寻址 512^(n-1) 页
+ * 未分配的页是空洞, 读出为0.
+ */
+#define FS_RADIX_SHIFT 9
+#define FS_RADIX_SLOTS (1 << FS_RADIX_SHIFT)
+#define FS_MAX_HEIGHT 4                      /* 最大 512^3 页 = 512GB */
+
+struct dentry;
+
+/* 文件 (inode) */
+typedef struct file {
+    uint64_t ino;               /* 唯一编号, 不重复使用 */
     file_type_t type;
     size_t size;
-    uint8_t data[MAX_FILESIZE];
-    bool in_use;
+    void *root;                 /* 数据页索引树 */
+    int height;
+    uint64_t nr_pages;          /* 已分配的数据页数 */
+    int refs;                   /* 引用计数 (进程当前目录等), 非0时不能删除 */
+    struct dentry *dentry;      /* 文件名 */
+    uint32_t disk_ino;          /* 磁盘inode号, 0表示只在内存中 (数据在root树中) */
+    bool readonly;              /* initramfs中的文件和目录 */
+    const uint8_t *rodata;      /* 只读文件的数据, 直接指向内核镜像中的initramfs */
+
+    /* 透明压缩 (只用于内存中的文件) */
+    bool compress;              /* 数据页写回时压缩; 目录上设置时由新文件继承 */
+    uint64_t nr_zpages;         /* 压缩存放的页数 (nr_pages只计未压缩的页) */
+    uint64_t zbytes;            /* 压缩页在zpool中占用的字节 (对象所在级别的大小) */
+
+    /* 数据校验 (只用于内存中的文件): 每个数据页一个CRC32C */
+    uint32_t *csums;            /* csums[i]是第i页的校验和 */
+    uint64_t csum_cap;          /* csums的项数 */
+    uint64_t csum_pending;      /* 写了一部分、还没计算校验和的页号+1, 0表示没有 */
+
+    /* 目录 */
+    struct dentry *children;    /* 目录项链表 (按创建顺序) */
+    struct dentry *children_tail;
+    uint64_t nr_children;
+    bool loaded;                /* 磁盘目录的目录项已全部读入dcache */
+    uint32_t dir_hint;          /* 磁盘目录中第一个可能空闲的目录项 */
+
+    rcu_head_t rcu;             /* 删除后等无锁查找的读者离开再释放 */
 } file_t;
 
-/* 文件系统函数 */
+/*
+ * 目录项: 把(父目录, 名字)映射到文件.
+ * 所有目录项都在以(父目录编号, 名字)为键的哈希表(dcache)中;
+ * 查找失败的名字记为负缓存项(inode为NULL), 按LRU淘汰.
+ * 哈希链、inode和parent由RCU保护: fs_find不加锁地读, 名字和哈希键不会改变.
+ */
+typedef struct dentry {
+    struct dentry *hash_next;
+    struct dentry *lru_next;    /* 负缓存项LRU */
+    struct dentry *lru_prev;
+    struct dentry *sibling_next;
+    struct dentry *sibling_prev;
+    struct file *parent;        /* 父目录 (负缓存项不使用) */
+    uint64_t parent_ino;        /* 哈希键: 父目录编号 + 名字 */
+    struct file *inode;         /* NULL 表示负缓存项 */
+    uint32_t hash;
+    uint32_t slot;              /* 在磁盘目录中的目录项序号 */
+    bool referenced;            /* 负缓存项被再次查找过 (LRU的第二次机会) */
+    rcu_head_t rcu;
+    char name[MAX_FILENAME];
+} dentry_t;
+
+/* dcache统计 */
+typedef struct {
+    uint64_t lookups;
+    uint64_t hits;              /* 命中正缓存项 */
+    uint64_t negative_hits;     /* 命中负缓存项 */
+    uint64_t misses;            /* 哈希表中没有, 新建负缓存项 */
+    uint64_t evictions;         /* 淘汰的负缓存项 */
+    uint64_t nr_cached;         /* 哈希表中的目录项 */
+    uint64_t nr_negative;
+    uint64_t nr_buckets;
+    uint64_t rcu_walks;         /* fs_find不加锁完成的路径解析 */
+    uint64_t rcu_fallbacks;     /* 需要建立负缓存项或读磁盘目录, 改走普通路径 */
+} dcache_stats_t;
+
+/* fs_find先尝试不加锁的路径解析 (关掉用于基准测试对比) */
+extern bool fs_rcu_walk;
+
+/* 透明压缩统计 */
+typedef struct {
+    uint64_t compressed;        /* 压缩的字节数 (压缩前) */
+    uint64_t compress_ticks;
+    uint64_t incompressible;    /* 压缩效果不够而保持原样的页 */
+    uint64_t decompressed;      /* 解压的字节数 (解压后) */
+    uint64_t decompress_ticks;
+    uint64_t cache_hits;        /* 读取压缩页时命中解压缓存 */
+    uint64_t cache_misses;
+} fs_zstats_t;
+
+/* 数据页校验和统计 */
+typedef struct {
+    uint64_t summed;            /* 计算校验和的字节数 (写入) */
+    uint64_t sum_ticks;
+    uint64_t verified;          /* 验证的字节数 (读取) */
+    uint64_t verify_ticks;
+    uint64_t errors;            /* 校验和不一致的次数 */
+} fs_csum_stats_t;
+
+/* 文件系统函数 (路径可以是绝对路径或相对当前目录) */
 void fs_init(void);
-int fs_create(const char *name, file_type_t type);
-int fs_delete(const char *name);
-int fs_write(const char *name, const void *buf, size_t size);
-int fs_read(const char *name, void *buf, size_t size);
-void fs_list(void);
-file_t *fs_find(const char *name);
+int fs_create(const char *path, file_type_t type);
+int fs_mkdir(const char *path);
+int fs_delete(const char *path);
+int fs_write(const char *path, const void *buf, size_t size);
+int fs_read(const char *path, void *buf, size_t size);
+int fs_list(const char *path, bool detail);
+file_t *fs_find(const char *path);
+
+/* 打开/关闭透明压缩 (chattr +c / -c) */
+int fs_set_compress(const char *path, bool on);
+void fs_get_zstats(fs_zstats_t *stats);
+
+void fs_get_csum_stats(fs_csum_stats_t *stats);
+
+/* 把磁盘文件系统的修改写回磁盘 */
+void fs_sync(void);
+
+/*
+ * 创建只读文件或目录, 数据不拷贝, 直接引用data (必须在整个运行期间有效).
+ * 只在内存中, 不写入磁盘; 成功返回0.
+ */
+int fs_create_rodata(const char *path, file_type_t type, const void *data, size_t size);
+
+/* 把链接进内核镜像的initramfs (cpio newc) 展开到目录树 */
+void initramfs_init(void);
+
+/*
+ * 按偏移读写已找到的文件 (file.c的文件描述符接口基于这些函数).
+ * 读取在校验和不一致的页之前停止, 返回的字节数少于请求的.
+ */
+size_t fs_read_at(file_t *file, size_t offset, void *buf, size_t len);
+size_t fs_write_at(file_t *file, size_t offset, const void *buf, size_t len);
+void fs_truncate(file_t *file, size_t size);
+
+/* 当前目录 */
+int fs_chdir(const char *path);
+int fs_getcwd(char *buf, size_t size);
+
+/* 引用计数 */
+void fs_get(file_t *file);
+void fs_put(file_t *file);
+
+void dcache_get_stats(dcache_stats_t *stats);
 
 #endif
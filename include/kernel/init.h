@@ -0,0 +1,33 @@
+#ifndef _KERNEL_INIT_H
+#define _KERNEL_INIT_H
+
+#include <kernel/types.h>
+
+/*
+ * 启动计时: kernel_main用boot_phase运行每个初始化步骤并记录起止时间 (rdtime,
+ * 从复位开始计数), boot/start.S记录进入内核和BSS清零完成的时间.
+ * bootstat命令显示各阶段的耗时和shell可用 (第一次显示提示符) 的时间.
+ */
+void boot_phase(const char *name, void (*fn)(void));
+void boot_prompt_ready(void);
+
+/*
+ * 推迟的初始化: shell可用之前不需要的子系统 (initramfs中的演示文件和程序、
+ * 网卡的页池和协议栈等) 用deferred_initcall(fn)登记, 不在启动的关键路径上运行.
+ * shell出现后由kinit内核线程按链接顺序逐个调用, 每个之间让出CPU.
+ */
+typedef struct {
+    void (*fn)(void);
+    const char *name;
+} initcall_t;
+
+#define deferred_initcall(fn) \
+    static const initcall_t __initcall_##fn \
+    __attribute__((used, section(".initcall.deferred"), aligned(8))) = { fn, #fn }
+
+void initcalls_start(void);     /* 创建kinit线程 */
+void initcalls_wait(void);      /* 等待推迟的初始化全部完成, shell执行命令前调用 */
+
+void bootstat_show(void);
+
+#endif
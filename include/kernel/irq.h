@@ -0,0 +1,105 @@
+#ifndef _KERNEL_IRQ_H
+#define _KERNEL_IRQ_H
+
+#include <kernel/types.h>
+#include <kernel/plic.h>
+
+/*
+ * 中断子系统
+ *
+ * 上半部 (硬中断): 由request_irq注册, 在陷阱处理中关中断运行. 只做确认设备、
+ * 记录状态和调度下半部这样的少量工作.
+ * 下半部 (软中断/tasklet): 硬中断处理完、PLIC complete之后, 在中断返回前
+ * 打开中断运行. 一次最多重复SOFTIRQ_MAX_RESTART轮或运行SOFTIRQ_TIME_LIMIT,
+ * 剩下的交给ksoftirqd线程, 中断风暴不会让被打断的进程一直得不到运行.
+ * 下半部不能睡眠或让出CPU (sleep_on/yield/blk_wait).
+ *
+ * 进程上下文中与下半部共享的数据用local_bh_disable/local_bh_enable保护.
+ */
+
+/* 中断号: 0..PLIC_MAX_IRQ-1为PLIC外部中断源, 之后是hart本地中断 */
+#define IRQ_TIMER  PLIC_MAX_IRQ
+#define NR_IRQS    (PLIC_MAX_IRQ + 1)
+
+typedef void (*irq_handler_t)(void *arg);
+
+/* 注册中断处理函数; 外部中断同时在PLIC中使能. 已被占用时返回-1 */
+int request_irq(int irq, irq_handler_t handler, void *arg, const char *name);
+
+/* 陷阱入口 (trap_handler调用): 分发硬中断, 然后运行挂起的软中断 */
+void irq_entry(uint64_t cause);
+
+/* irq_entry内部使用: 进入硬中断; 退出时运行挂起的软中断 (在softirq.c中) */
+void irq_enter(void);
+void irq_exit(void);
+
+/* 处理时间统计: 次数、总时间、最大值和直方图 (rdtime计数, 0.1us) */
+#define IRQ_HIST_BUCKETS 10     /* <1us, <2us, <4us, ... <256us, >=256us */
+
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t hist[IRQ_HIST_BUCKETS];
+} irq_time_t;
+
+void irq_time_account(irq_time_t *t, uint64_t ticks);
+
+/* ---------------- 软中断 ---------------- */
+
+enum {
+    SOFTIRQ_NET_RX,
+    SOFTIRQ_TASKLET,
+    NR_SOFTIRQS
+};
+
+#define SOFTIRQ_MAX_RESTART 10
+#define SOFTIRQ_TIME_LIMIT  (TIMEBASE_FREQ / 500)   /* 2ms */
+
+typedef void (*softirq_handler_t)(void);
+
+void open_softirq(int nr, softirq_handler_t handler, const char *name);
+
+/* 标记软中断待处理, 可以在硬中断中调用 */
+void raise_softirq(int nr);
+
+bool softirq_pending(void);
+
+/* 是否在硬中断或下半部中 */
+bool in_interrupt(void);
+
+void local_bh_disable(void);
+void local_bh_enable(void);
+
+/* 启动ksoftirqd (process_init之后调用) */
+void softirq_init(void);
+
+/* tasklet: 挂在SOFTIRQ_TASKLET上的一次性回调, 重复调度只运行一次 */
+typedef struct tasklet {
+    struct tasklet *next;
+    void (*func)(void *arg);
+    void *arg;
+    bool scheduled;
+} tasklet_t;
+
+void tasklet_init(tasklet_t *t, void (*func)(void *arg), void *arg);
+void tasklet_schedule(tasklet_t *t);
+
+typedef struct {
+    const char *name;
+    uint64_t raised;
+    irq_time_t time;
+} softirq_stat_t;
+
+typedef struct {
+    uint64_t deferred;          /* 达到重复次数或时间上限, 剩余的交给ksoftirqd */
+    uint64_t ksoftirqd_runs;
+    uint64_t tasklets;
+} softirq_stats_t;
+
+void softirq_get_stats(softirq_stat_t vec[NR_SOFTIRQS], softirq_stats_t *stats);
+
+/* shell命令irqstat: 每个中断的次数和处理时间分布 */
+void irqstat_show(void);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef _KERNEL_KLOG_H
+#define _KERNEL_KLOG_H
+
+#include <kernel/types.h>
+#include <kernel/printk.h>
+
+/*
+ * 内核日志缓冲区 (dmesg)
+ * printk把每条消息作为一条记录追加到无锁环形缓冲区,
+ * 由klogd线程异步输出到控制台.
+ */
+
+/* 日志级别 */
+#define LOGLEVEL_EMERG   0
+#define LOGLEVEL_ALERT   1
+#define LOGLEVEL_CRIT    2
+#define LOGLEVEL_ERR     3
+#define LOGLEVEL_WARNING 4
+#define LOGLEVEL_NOTICE  5
+#define LOGLEVEL_INFO    6
+#define LOGLEVEL_DEBUG   7
+
+#define LOGLEVEL_DEFAULT LOGLEVEL_INFO  /* printk未指定级别时 */
+#define CONSOLE_LOGLEVEL_DEFAULT 7      /* 控制台只输出级别 < 7 的消息 */
+
+#define LOG_BUF_SIZE (64 * 1024)  /* 必须是2的幂 */
+
+/* 读出的一条记录 */
+typedef struct {
+    uint64_t ts;                    /* rdtime时间戳 */
+    int level;
+    size_t len;
+    char text[PRINTK_BUF_SIZE];
+} klog_record_t;
+
+/* 追加一条记录 (可在中断上下文和多个hart上并发调用) */
+void klog_store(int level, const char *text, size_t len);
+
+/*
+ * 从*pos开始读取下一条已提交的记录, 成功后推进*pos.
+ * 如果*pos处的记录已被覆盖, 跳到最老的记录并置*lost.
+ */
+bool klog_read(uint64_t *pos, klog_record_t *rec, bool *lost);
+
+/* 起始读位置 (最老的有效记录) */
+uint64_t klog_first(void);
+
+/* 把尚未输出的记录写到控制台 */
+void klog_console_flush(void);
+
+/* 控制台级别过滤 */
+void klog_set_console_level(int level);
+int klog_get_console_level(void);
+
+/* 启动klogd, 之后printk只写入缓冲区 */
+void klogd_start(void);
+
+/* 输出缓冲区内容 (dmesg), 只显示级别 <= max_level 的记录 */
+void klog_dump(int max_level);
+
+/* 丢弃当前所有记录 (dmesg -C) */
+void klog_clear(void);
+
+#endif
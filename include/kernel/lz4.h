@@ -0,0 +1,23 @@
+#ifndef _KERNEL_LZ4_H
+#define _KERNEL_LZ4_H
+
+#include <kernel/types.h>
+
+/*
+ * LZ4块格式的压缩/解压 (兼容标准LZ4 block format, 不含frame头部).
+ * 压缩器使用单个哈希表的贪心匹配, 追求速度而非压缩率.
+ */
+
+/* 最坏情况下压缩结果的大小 (不可压缩的数据) */
+#define LZ4_BOUND(n) ((n) + (n) / 255 + 16)
+
+/*
+ * 压缩src[0, len)到dst, 返回压缩后的字节数; 结果超过cap时返回0.
+ * 使用静态哈希表, 不可重入.
+ */
+size_t lz4_compress(const void *src, size_t len, void *dst, size_t cap);
+
+/* 解压到dst, 返回解压出的字节数; 数据损坏或超过cap时返回-1 */
+ssize_t lz4_decompress(const void *src, size_t len, void *dst, size_t cap);
+
+#endif
@@ -8,6 +8,19 @@
 #define PAGE_SHIFT 12
 #define PAGE_MASK (~(PAGE_SIZE - 1))
 
+/*
+ * 物理内存 (QEMU virt): RAM从RAM_BASE开始, 大小与QEMU的-m一致 (make RAM_MB=...).
+ * 前2MB是OpenSBI, 内核从0x80200000开始; 内核恒等映射覆盖整个RAM.
+ */
+#define RAM_BASE 0x80000000UL
+#ifndef RAM_SIZE_MB
+#define RAM_SIZE_MB 128
+#endif
+#if RAM_SIZE_MB % 2
+#error "RAM_SIZE_MB must be a multiple of 2 (the kernel maps RAM with 2MB pages)"
+#endif
+#define RAM_END (RAM_BASE + RAM_SIZE_MB * 1024UL * 1024)
+
 /* 页对齐 */
 #define PAGE_ALIGN_UP(addr) (((addr) + PAGE_SIZE - 1) & PAGE_MASK)
 #define PAGE_ALIGN_DOWN(addr) ((addr) & PAGE_MASK)
@@ -22,6 +35,9 @@
 #define PTE_A (1UL << 6)  /* Accessed */
 #define PTE_D (1UL << 7)  /* Dirty */
 
+/* 内核数据页: 预先置A/D位, 不依赖硬件更新 */
+#define PTE_KERNEL (PTE_R | PTE_W | PTE_G | PTE_A | PTE_D)
+
 /* 物理地址到页帧号 */
 #define PA_TO_PFN(pa) ((pa) >> PAGE_SHIFT)
 #define PFN_TO_PA(pfn) ((pfn) << PAGE_SHIFT)
@@ -32,12 +48,122 @@ void mm_init(void);
 /* 物理内存分配 */
 void *alloc_page(void);
 void free_page(void *page);
+void *alloc_pages(size_t n);              /* 物理连续的n页 */
+void free_pages(void *pages, size_t n);
+uint64_t get_free_pages(void);
+
+/*
+ * 页分配记账: 每个物理页记下分配它的子系统 (tag), 按tag统计在用页数和峰值.
+ * 不带tag的alloc_page/alloc_pages记到PG_OTHER. 页转交给别的子系统 (比如
+ * cat读出的页交给管道) 时tag不变, 仍算在分配者名下.
+ * 用PAGE_OWNER编译 (make PAGE_OWNER=1, 默认关闭) 时还记录分配点和分配序号,
+ * meminfo据此按分配点汇总, 并列出检查点之后分配、仍未释放的页.
+ */
+enum {
+    PG_OTHER,
+    PG_KERNEL,          /* 内核镜像 */
+    PG_PGTABLE,
+    PG_SLAB,            /* kmalloc */
+    PG_VMALLOC,
+    PG_KSTACK,
+    PG_PAGECACHE,       /* 文件数据页和解压缓存 */
+    PG_FSMETA,          /* 文件索引页和dentry哈希表 */
+    PG_BUFCACHE,
+    PG_PIPE,
+    PG_DRIVER,          /* virtqueue和设备缓冲区 */
+    PG_USER,            /* 用户程序的私有页 (数据段、bss、栈) */
+    PG_KSM,             /* 内容相同的用户页合并成的只读共享页 (ksm.c) */
+    PG_ZPOOL,           /* 压缩后的文件页 (zpool.c) */
+    NR_PAGE_TAGS
+};
+
+void *alloc_page_tag(int tag);
+void *alloc_pages_tag(size_t n, int tag);
+int page_tag(const void *page);         /* 页当前记在哪个tag下, 不是RAM中的页返回PG_OTHER */
+
+typedef struct {
+    const char *name;
+    uint64_t live;
+    uint64_t peak;
+    uint64_t allocs;
+    uint64_t frees;
+} page_tag_stat_t;
+
+void page_tag_get_stats(page_tag_stat_t stats[NR_PAGE_TAGS]);
+
+/* shell命令meminfo: 按tag和分配点的内存使用; meminfo checkpoint|leaks 查泄漏 */
+void meminfo_show(int argc, char **argv);
+
+/* 小对象分配 (kmalloc.c) */
+void *kmalloc(size_t size);
+void *kzalloc(size_t size);
+void kfree(void *ptr);
+size_t ksize(const void *ptr);   /* 对象实际占用的字节数 */
+
+/*
+ * 压缩数据池 (zpool.c): 放压缩后的文件页. 对象按32字节分级, 紧挨着放在
+ * 物理连续的几页中, 页里没有头部, 2KB以内的对象也能和别的对象共享页.
+ */
+#define ZPOOL_MAX_ALLOC (2048 - 8)      /* 对象连同记录所在span的8字节最多2KB */
+
+void *zpool_alloc(size_t size);
+void zpool_free(void *ptr);
+size_t zpool_size(const void *ptr);     /* 对象所在级别的大小 (含8字节) */
+
+typedef struct {
+    uint64_t nr_objs;
+    uint64_t nr_pages;          /* 池从页分配器拿到的页 */
+    uint64_t bytes;             /* 对象占用的字节 (按级别大小) */
+} zpool_stats_t;
+
+void zpool_get_stats(zpool_stats_t *stats);
 
 /* 虚拟内存管理 */
 typedef uint64_t *pagetable_t;
 
 pagetable_t create_pagetable(void);
-void map_page(pagetable_t pt, uint64_t va, uint64_t pa, uint64_t flags);
+int map_page(pagetable_t pt, uint64_t va, uint64_t pa, uint64_t flags);
 void switch_pagetable(pagetable_t pt);
 
+/*
+ * 按范围操作页表 (地址和大小按页对齐), 每张叶子页表只遍历一次, TLB只刷新一次.
+ * 失败返回-1; map_range失败时不留下部分映射.
+ */
+int map_range(pagetable_t pt, uint64_t va, uint64_t pa, size_t size, uint64_t flags);
+int unmap_range(pagetable_t pt, uint64_t va, size_t size);     /* 释放变空的中间页表 */
+int protect_range(pagetable_t pt, uint64_t va, size_t size, uint64_t flags);
+
+/* 查页表: va映射到的物理地址, 没有映射时返回0 */
+uint64_t walk_addr(pagetable_t pt, uint64_t va);
+
+/* va的叶子PTE (可能无效), 叶子页表不存在时返回NULL */
+uint64_t *walk_pte(pagetable_t pt, uint64_t va);
+
+extern pagetable_t kernel_pagetable;
+
+/*
+ * vmalloc区 (vmalloc.c): 由不连续的物理页拼成的虚拟连续内存.
+ * 每块分配的上下都是未映射的保护页, 越界访问触发缺页异常而不是踩坏相邻数据.
+ * 虚拟地址不等于物理地址, vmalloc内存 (包括内核栈) 不能交给设备做DMA.
+ */
+#define VMALLOC_START 0x2000000000UL    /* 128GB */
+#define VMALLOC_SIZE  (1UL << 30)
+#define VMALLOC_END   (VMALLOC_START + VMALLOC_SIZE)
+
+void vmalloc_init(void);
+void *vmalloc(size_t size);
+void *vmalloc_tag(size_t size, int tag);    /* 物理页记到tag而不是PG_VMALLOC */
+void vfree(void *addr);
+bool is_vmalloc_addr(const void *addr);
+
+typedef struct {
+    uint64_t nr_areas;
+    uint64_t nr_pages;          /* 已映射的物理页 */
+    uint64_t used;              /* 占用的虚拟空间 (含保护页) */
+    uint64_t largest_free;      /* 最大的空闲虚拟区间 */
+    uint64_t failures;
+} vmalloc_stats_t;
+
+void vmalloc_get_stats(vmalloc_stats_t *stats);
+
 #endif
@@ -0,0 +1,153 @@
+#ifndef _KERNEL_NET_H
+#define _KERNEL_NET_H
+
+#include <kernel/types.h>
+
+/*
+ * 最小网络协议栈: 以太网 + ARP + IPv4 + UDP, 一块网卡 (virtio-net), 静态地址.
+ * 收到的帧在接收页中原地处理, 回复 (ARP应答、UDP回显) 直接改写这一页再发送,
+ * 不拷贝数据. 帧所在的页来自网卡的页池, 发送完成后回到池中.
+ */
+
+/* 默认地址与QEMU用户模式网络 (slirp) 一致 */
+#define NET_IP_ADDR   NET_IP(10, 0, 2, 15)
+#define NET_GATEWAY   NET_IP(10, 0, 2, 2)
+#define NET_NETMASK   NET_IP(255, 255, 255, 0)
+
+#define NET_IP(a, b, c, d) \
+    (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+#define UDP_ECHO_PORT 7
+
+/* 字节序 (RISC-V是小端) */
+static inline uint16_t htons(uint16_t x) {
+    return (x << 8) | (x >> 8);
+}
+
+static inline uint32_t htonl(uint32_t x) {
+    return ((x & 0xff) << 24) | ((x & 0xff00) << 8) |
+           ((x >> 8) & 0xff00) | (x >> 24);
+}
+
+#define ntohs htons
+#define ntohl htonl
+
+#define ETH_ALEN      6
+#define ETH_HLEN      14
+#define ETH_MTU       1500
+#define ETH_FRAME_MAX (ETH_HLEN + ETH_MTU)
+
+#define ETH_P_IP   0x0800
+#define ETH_P_ARP  0x0806
+
+#define IP_PROTO_UDP 17
+
+typedef struct {
+    uint8_t dst[ETH_ALEN];
+    uint8_t src[ETH_ALEN];
+    uint16_t type;
+} __attribute__((packed)) eth_hdr_t;
+
+typedef struct {
+    uint16_t htype;
+    uint16_t ptype;
+    uint8_t hlen;
+    uint8_t plen;
+    uint16_t op;
+    uint8_t sha[ETH_ALEN];
+    uint32_t spa;
+    uint8_t tha[ETH_ALEN];
+    uint32_t tpa;
+} __attribute__((packed)) arp_hdr_t;
+
+#define ARP_REQUEST 1
+#define ARP_REPLY   2
+
+typedef struct {
+    uint8_t ver_ihl;
+    uint8_t tos;
+    uint16_t len;
+    uint16_t id;
+    uint16_t frag;
+    uint8_t ttl;
+    uint8_t proto;
+    uint16_t csum;
+    uint32_t src;
+    uint32_t dst;
+} __attribute__((packed)) ip_hdr_t;
+
+typedef struct {
+    uint16_t sport;
+    uint16_t dport;
+    uint16_t len;
+    uint16_t csum;
+} __attribute__((packed)) udp_hdr_t;
+
+#define UDP_HDRS (ETH_HLEN + sizeof(ip_hdr_t) + sizeof(udp_hdr_t))
+#define UDP_MAX_PAYLOAD (ETH_MTU - sizeof(ip_hdr_t) - sizeof(udp_hdr_t))
+
+/* ---------------- 网卡 ---------------- */
+
+/*
+ * 网卡驱动提供的接口 (virtio_net.c).
+ * 发送和接收的帧都在页池的页中 (不一定从页首开始, 页由帧地址向下对齐得到).
+ */
+bool netdev_present(void);
+const uint8_t *netdev_mac(void);
+
+/* 从页池取一页用于构造待发送的帧, 池空时返回NULL */
+void *netdev_alloc_frame(void);
+void netdev_free_frame(void *frame);
+
+/* 发送从frame开始的len字节, 之后页属于网卡 (发送完成后回到页池); 队列满时返回-1, 页仍属于调用者 */
+int netdev_xmit(void *frame, size_t len);
+
+typedef struct {
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t rx_dropped;        /* 协议栈不处理的帧 */
+    uint64_t tx_dropped;        /* 发送队列满或页池空 */
+    uint64_t interrupts;
+    uint64_t polls;             /* NET_RX软中断处理的批次 */
+    uint64_t budget_exhausted;  /* 一批用完预算, 继续轮询而不打开中断 */
+    uint64_t pool_free;
+    uint64_t pool_total;
+} netdev_stats_t;
+
+void netdev_get_stats(netdev_stats_t *stats);
+
+/* ---------------- 协议栈 (kernel/net/net.c) ---------------- */
+
+/* 网卡就绪后调用: 启动UDP回显服务 */
+void net_init(void);
+
+/* 处理一个收到的帧; 帧所在的页交给协议栈 (转发或释放) */
+void net_rx(void *frame, size_t len);
+
+/* UDP接收回调: 返回true表示已就地改写并发送了帧 (页不再属于调用者) */
+typedef bool (*udp_handler_t)(void *frame, ip_hdr_t *ip, udp_hdr_t *udp,
+                              uint8_t *data, size_t len);
+
+int udp_bind(uint16_t port, udp_handler_t handler);
+
+/* 发送一个UDP报文 (拷贝data); 目标MAC未知时发出ARP请求并返回-1, 之后重试 */
+int udp_send(uint32_t dst_ip, uint16_t dst_port, uint16_t src_port,
+             const void *data, size_t len);
+
+typedef struct {
+    uint64_t arp_requests;      /* 收到的请求 */
+    uint64_t arp_replies;       /* 发出的应答 */
+    uint64_t ip_bad;            /* 头部或校验和错误 */
+    uint64_t udp_rx;
+    uint64_t udp_no_port;
+    uint64_t udp_echoed;
+} net_stats_t;
+
+void net_get_stats(net_stats_t *stats);
+
+/* shell命令net: 地址和统计 */
+void net_show(void);
+
+#endif
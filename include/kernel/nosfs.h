@@ -0,0 +1,158 @@
+#ifndef _KERNEL_NOSFS_H
+#define _KERNEL_NOSFS_H
+
+/*
+ * nosfs 磁盘格式 (主机端的tools/mkfs.c也包含本文件, 编译时定义NOS_HOST_TOOL)
+ *
+ *   块0          超级块
+ *   journal      日志头 + 日志块
+ *   inode位图    每位一个inode
+ *   块位图       每位一个块 (包括元数据区, 全部标记为已用)
+ *   inode表      每块32个inode
+ *   数据区       文件数据、目录块、间接块
+ *   (交换区)     可选, 在文件系统的nr_blocks个块之后 (mkfs -w), 不属于文件系统
+ *
+ * 所有块大小为4KB, 块号和inode号都是32位. inode 0保留, 根目录是inode 1.
+ */
+#ifdef NOS_HOST_TOOL
+#include <stdint.h>
+#else
+#include <kernel/types.h>
+#endif
+
+#define NOSFS_MAGIC        0x4e4f5346   /* "NOSF" */
+#define NOSFS_VERSION      1
+#define NOSFS_BLOCK_SIZE   4096
+#define NOSFS_ROOT_INO     1
+
+#define NOSFS_BITS_PER_BLOCK (NOSFS_BLOCK_SIZE * 8)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t reserved;
+    uint64_t nr_blocks;
+    uint64_t nr_inodes;
+    uint64_t journal_start;
+    uint64_t journal_blocks;        /* 含日志头 */
+    uint64_t inode_bitmap_start;
+    uint64_t inode_bitmap_blocks;
+    uint64_t block_bitmap_start;
+    uint64_t block_bitmap_blocks;
+    uint64_t inode_table_start;
+    uint64_t inode_table_blocks;
+    uint64_t data_start;
+} nosfs_super_t;
+
+/* inode */
+#define NOSFS_T_FREE 0
+#define NOSFS_T_FILE 1
+#define NOSFS_T_DIR  2
+
+#define NOSFS_NDIRECT    12
+#define NOSFS_NINDIRECT  (NOSFS_BLOCK_SIZE / 4)    /* 每个间接块1024个块号 */
+#define NOSFS_INODE_SIZE 128
+#define NOSFS_INODES_PER_BLOCK (NOSFS_BLOCK_SIZE / NOSFS_INODE_SIZE)
+
+typedef struct {
+    uint16_t type;
+    uint16_t nlink;
+    uint32_t parent;                /* 所在目录的inode号 */
+    uint64_t size;
+    uint32_t direct[NOSFS_NDIRECT];
+    uint32_t indirect;              /* 一级间接块 */
+    uint32_t dindirect;             /* 二级间接块 */
+    uint8_t pad[NOSFS_INODE_SIZE - 72];
+} nosfs_inode_t;
+
+/* 目录块由定长目录项组成, ino为0的项是空位 */
+#define NOSFS_NAME_LEN 64           /* 含结尾的'\0', 与MAX_FILENAME一致 */
+
+typedef struct {
+    uint32_t ino;
+    uint8_t type;
+    uint8_t name_len;
+    uint16_t reserved;
+    char name[NOSFS_NAME_LEN];
+} nosfs_dirent_t;
+
+#define NOSFS_DIRENTS_PER_BLOCK (NOSFS_BLOCK_SIZE / sizeof(nosfs_dirent_t))
+
+/*
+ * 日志: 第一个块是日志头, 之后是日志块.
+ * nr非0表示已提交但可能尚未写回原位的事务: blocks[i]是第i个日志块的原位置.
+ */
+#define NOSFS_JOURNAL_MAGIC 0x4a524e4c  /* "JRNL" */
+#define NOSFS_JOURNAL_MAX   ((NOSFS_BLOCK_SIZE - 16) / 4)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t nr;
+    uint64_t seq;
+    uint32_t blocks[NOSFS_JOURNAL_MAX];
+} nosfs_journal_t;
+
+/* 交换区: 第一个块是头部, 之后每块是一个交换槽, 存放一个换出的页 */
+#define NOSFS_SWAP_MAGIC   0x53574150   /* "SWAP" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t nr_slots;
+} nosfs_swap_t;
+
+#ifndef NOS_HOST_TOOL
+
+#include <kernel/fs.h>
+
+/* 挂载根文件系统, 成功时填写根目录的磁盘信息 */
+int nosfs_mount(file_t *root);
+bool nosfs_mounted(void);
+uint64_t nosfs_nr_blocks(void);     /* 文件系统占用的块数 (交换区从这里开始), 未挂载时为0 */
+
+/* 目录: 读入目录项时对每一项调用fill */
+typedef int (*nosfs_fill_t)(file_t *dir, const char *name, uint32_t ino,
+                            file_type_t type, size_t size, uint32_t slot);
+int nosfs_dir_load(file_t *dir, nosfs_fill_t fill);
+int nosfs_create(file_t *dir, const char *name, file_t *file, uint32_t *slot);
+int nosfs_remove(file_t *dir, file_t *file, uint32_t slot);
+
+/* 文件数据 */
+size_t nosfs_read_at(file_t *file, size_t offset, void *buf, size_t len);
+size_t nosfs_write_at(file_t *file, size_t offset, const void *buf, size_t len);
+void nosfs_truncate(file_t *file, size_t size);
+
+/* 提交日志并写回所有脏块 */
+void nosfs_sync(void);
+
+/* ---------------- 日志 ---------------- */
+
+/* 每个文件系统操作最多修改的元数据块数 */
+#define JOURNAL_OP_BLOCKS 64
+
+typedef struct {
+    uint64_t commits;
+    uint64_t blocks_logged;     /* 写入日志的块数 */
+    uint64_t ops;
+    uint64_t replayed;          /* 挂载时重放的块数 */
+    uint64_t replay_ticks;
+    uint32_t running;           /* 当前事务中的块数 */
+    uint32_t capacity;
+} journal_stats_t;
+
+struct buf;
+
+int journal_init(uint64_t start, uint64_t nblocks);
+void journal_begin(void);
+void journal_end(void);
+void journal_log(struct buf *b);
+void journal_commit(void);
+void journal_get_stats(journal_stats_t *stats);
+
+/* 模拟提交后崩溃: 把日志区之后的nblocks个元数据块写入日志但不写回原位, 然后重放 */
+int journal_replay_test(uint32_t nblocks);
+
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _KERNEL_PIPE_H
+#define _KERNEL_PIPE_H
+
+#include <kernel/types.h>
+#include <kernel/process.h>
+
+/*
+ * 内核管道: 内核线程之间传递字节流.
+ * 缓冲区是PIPE_BUFS个页组成的环, 每个槽是一页和其中的有效区间.
+ * 除了拷贝式的pipe_read/pipe_write, 还可以用pipe_splice_write/pipe_splice_read
+ * 整页转交所有权, 数据不拷贝.
+ * 缓冲区满时写者睡眠, 空时读者睡眠; 所有写端关闭后读到EOF,
+ * 所有读端关闭后写入失败.
+ */
+#define PIPE_BUFS 16
+
+typedef struct {
+    uint8_t *page;
+    uint32_t offset;            /* 有效数据在页中的起点 */
+    uint32_t len;
+} pipe_buf_t;
+
+typedef struct pipe {
+    pipe_buf_t bufs[PIPE_BUFS];
+    uint32_t head;              /* 最早的槽 */
+    uint32_t nr_bufs;           /* 已用的槽数 */
+    int readers;
+    int writers;
+    wait_queue_t rd_wait;
+    wait_queue_t wr_wait;
+    uint8_t *spare;             /* 读空的页留一页给写者复用 */
+} pipe_t;
+
+#define PIPE_READ  0
+#define PIPE_WRITE 1
+
+/* 创建管道, 读写端各一个引用 */
+pipe_t *pipe_create(void);
+void pipe_close(pipe_t *pipe, int end);
+
+/* 增加一个读端或写端的引用 (用户程序继承shell管道), 用pipe_close释放 */
+void pipe_dup(pipe_t *pipe, int end);
+
+/* 写入全部len字节 (必要时睡眠), 读端全部关闭时返回-1 */
+ssize_t pipe_write(pipe_t *pipe, const void *buf, size_t len);
+
+/* 读取至多len字节, 没有数据时睡眠; 写端全部关闭且没有数据时返回0 */
+ssize_t pipe_read(pipe_t *pipe, void *buf, size_t len);
+
+/*
+ * 把page的[0, len)转交给管道, 之后page属于管道. 读端全部关闭时返回-1,
+ * page仍属于调用者.
+ */
+int pipe_splice_write(pipe_t *pipe, void *page, size_t len);
+
+/*
+ * 取走最早的一个槽: buf->page属于调用者, 用完后free_page.
+ * 有数据时返回1, EOF返回0.
+ */
+int pipe_splice_read(pipe_t *pipe, pipe_buf_t *buf);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _KERNEL_PLIC_H
+#define _KERNEL_PLIC_H
+
+#include <kernel/types.h>
+
+/* PLIC (QEMU virt) */
+#define PLIC_BASE 0x0c000000UL
+#define PLIC_SIZE 0x400000UL
+#define PLIC_MAX_IRQ 64
+
+/* virt机器上的中断号 */
+#define UART0_IRQ 10
+#define VIRTIO0_IRQ 1   /* virtio-mmio槽位i的中断号为 VIRTIO0_IRQ + i */
+
+/* 驱动通过request_irq (kernel/irq.h) 注册中断, 以下由中断子系统使用 */
+void plic_init(void);
+
+void plic_enable(int irq);
+void plic_disable(int irq);
+
+/* 取得一个待处理的中断号, 没有时返回0 */
+uint32_t plic_claim(void);
+void plic_complete(uint32_t irq);
+
+#endif
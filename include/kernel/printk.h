@@ -1,9 +1,48 @@
 #ifndef _KERNEL_PRINTK_H
 #define _KERNEL_PRINTK_H
 
+#include <kernel/types.h>
+#include <kernel/stdarg.h>
+
+/* 单行printk的最大长度 (超出部分被截断) */
+#define PRINTK_BUF_SIZE 512
+
+/* 日志级别前缀: printk(KERN_ERR "...") */
+#define KERN_SOH     "\001"
+#define KERN_EMERG   KERN_SOH "0"
+#define KERN_ALERT   KERN_SOH "1"
+#define KERN_CRIT    KERN_SOH "2"
+#define KERN_ERR     KERN_SOH "3"
+#define KERN_WARNING KERN_SOH "4"
+#define KERN_NOTICE  KERN_SOH "5"
+#define KERN_INFO    KERN_SOH "6"
+#define KERN_DEBUG   KERN_SOH "7"
+
 /* 内核打印函数 */
-void printk(const char *fmt, ...);
+void printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void vprintk(const char *fmt, va_list ap);
 void puts(const char *s);
 void putchar(char c);
 
+/* 格式化到缓冲区, 返回完整输出所需的长度 (不含'\0') */
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int snprintf(char *buf, size_t size, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/* 控制台初始化 (启用UART FIFO) */
+void console_init(void);
+
+/*
+ * 控制台输出 (一次写入一整段, '\n'转换为"\r\n").
+ * 有virtio-console时使用它, 否则使用UART.
+ */
+void console_write(const char *s, size_t len);
+
+/* 控制台输入: 没有输入时返回-1 */
+int console_getc(void);
+
+/* 蓄流: unplug之前的输出合并发送 (只对virtio-console有效, 可嵌套) */
+void console_plug(void);
+void console_unplug(void);
+
 #endif
@@ -3,6 +3,13 @@
 
 #include <kernel/types.h>
 
+struct file;
+struct open_file;
+struct pipe;
+struct mm;
+
+#define PROC_MAX_FDS 16
+
 /* 进程状态 */
 typedef enum {
     PROC_UNUSED = 0,  /* 未使用 */
@@ -19,6 +26,20 @@ typedef struct {
     uint64_t s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11;
 } context_t;
 
+/*
+ * 内核栈: 从vmalloc区分配, 栈底下方是未映射的保护页.
+ * 大小可以在编译时用 make KSTACK_SIZE=16384 调整 (8KB - 16KB).
+ */
+#ifndef KSTACK_SIZE
+#define KSTACK_SIZE 8192
+#endif
+#if KSTACK_SIZE < 8192 || KSTACK_SIZE > 16384 || KSTACK_SIZE % 4096
+#error "KSTACK_SIZE must be 8KB, 12KB or 16KB"
+#endif
+
+/* 当前进程内核栈的最低地址 (0表示不检查), trap_vector据此发现栈溢出 */
+extern uint64_t kstack_limit;
+
 /* 进程控制块 */
 #define MAX_PROCESSES 16
 #define PROC_NAME_LEN 32
@@ -30,18 +51,62 @@ typedef struct process {
 
     context_t context;          /* 上下文 */
     void *kstack;               /* 内核栈 */
+    void (*entry)(void);        /* 线程入口函数 */
+    struct file *cwd;           /* 当前目录, NULL表示根目录 */
+    struct open_file *fds[PROC_MAX_FDS];  /* 文件描述符表 */
+    struct pipe *pipe_in;       /* shell管道: 标准输入 (读端) */
+    struct pipe *pipe_out;      /* shell管道: 标准输出 (写端), 非空时printk写入管道 */
+    struct mm *mm;              /* 用户地址空间, 内核线程为NULL */
+    int exit_code;              /* 用户程序的退出码 */
 
     uint64_t runtime;           /* 运行时间 */
     int priority;               /* 优先级 */
+    uint64_t rcu_gp;            /* 回收后等到这个宽限期才能重用 (读者可能还在看) */
 
     struct process *next;       /* 下一个进程 */
+    struct process *wait_next;  /* 等待队列中的下一个进程 */
 } process_t;
 
+/*
+ * 等待队列: 条件不满足的进程睡眠在队列上, 条件改变的一方唤醒队列上的所有进程.
+ * 被唤醒后必须重新检查条件:
+ *     while (!cond) sleep_on(&wq);
+ * 没有其他可运行的进程时sleep_on立即返回, 调用者退化为轮询.
+ */
+typedef struct {
+    process_t *head;
+    process_t *tail;
+} wait_queue_t;
+
 /* 进程管理函数 */
 void process_init(void);
 process_t *create_process(const char *name, void (*entry)(void));
 void schedule(void);
 process_t *current_process(void);
 void yield(void);
+void process_exit(void);
+
+/* 等待进程退出 (pid用于识别PCB已被回收重用的情况) */
+void process_wait(process_t *proc, int pid);
+
+/*
+ * 按pid查找进程, 不加锁: 调用者在rcu_read_lock中, 返回的PCB在
+ * rcu_read_unlock之前不会被重用 (状态可能变成ZOMBIE). 找不到返回NULL.
+ */
+process_t *process_find(int pid);
+
+/* 进程表快照 (ps用): 在读临界区中复制, 打印时不再访问PCB */
+typedef struct {
+    int pid;
+    proc_state_t state;
+    bool user;                  /* 有用户地址空间 */
+    char name[PROC_NAME_LEN];
+} proc_info_t;
+
+int process_snapshot(proc_info_t *out, int max);
+
+void wait_queue_init(wait_queue_t *wq);
+void sleep_on(wait_queue_t *wq);
+void wake_up(wait_queue_t *wq);
 
 #endif
@@ -0,0 +1,78 @@
+#ifndef _KERNEL_RCU_H
+#define _KERNEL_RCU_H
+
+#include <kernel/types.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * RCU (read-copy-update): 读多写少的数据让读者不加锁也不写共享内存.
+ *   读者: rcu_read_lock(); p = rcu_dereference(ptr); ... rcu_read_unlock();
+ *         读临界区中不能睡眠或让出CPU.
+ *   写者: 新对象初始化完再用rcu_assign_pointer发布; 摘下的旧对象在
+ *         宽限期结束后才释放 (call_rcu, 或synchronize_rcu等待).
+ * 宽限期开始后每个hart都经过一次静止状态 (在读临界区之外调用schedule),
+ * 开始前进入读临界区的读者就都已离开, 它们可能还拿着的旧对象可以释放了.
+ * 写者之间仍然要互相排斥 (这里是协作式调度: 写操作中途不让出CPU).
+ */
+
+typedef struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+    uint64_t gp;                /* 等到宽限期序号到达这里 */
+} rcu_head_t;
+
+/* 由成员指针取得包含它的对象 (回调中由rcu_head找到要释放的对象) */
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+/* 每个hart的读临界区嵌套层数, 读者不睡眠, 所以不会换到别的hart */
+extern int rcu_nesting[MAX_HARTS];
+
+static inline void rcu_read_lock(void) {
+    rcu_nesting[cpu_id()]++;
+    asm volatile("" ::: "memory");
+}
+
+static inline void rcu_read_unlock(void) {
+    asm volatile("" ::: "memory");
+    rcu_nesting[cpu_id()]--;
+}
+
+/* 读取受RCU保护的指针 / 发布初始化好的对象 */
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/* 宽限期结束后在某次schedule中调用func (不能睡眠) */
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+/* 等待宽限期结束 (会让出CPU, 不能在读临界区中调用) */
+void synchronize_rcu(void);
+
+/* 等待当前hart上已经提交的回调全部运行完 (检查泄漏之前等用) */
+void rcu_barrier(void);
+
+/*
+ * 不等待的写法: 先取得状态, 之后poll为true时, 取状态之前开始的读者都已离开.
+ * 用来推迟重用而不是释放 (如进程表项).
+ */
+uint64_t get_state_synchronize_rcu(void);
+bool poll_state_synchronize_rcu(uint64_t state);
+
+/* schedule调用: 报告当前hart的静止状态, 运行到期的回调 */
+void rcu_qs(void);
+
+typedef struct {
+    uint64_t gp_seq;
+    uint64_t gps;               /* 完成的宽限期数 */
+    uint64_t gp_ticks;          /* 宽限期总时长 */
+    uint64_t gp_max_ticks;
+    uint64_t qs;                /* 报告的静止状态 */
+    uint64_t queued;            /* call_rcu次数 */
+    uint64_t invoked;           /* 已运行的回调 */
+    uint64_t bad_qs;            /* 在读临界区中调用schedule的次数 (是bug) */
+} rcu_stats_t;
+
+void rcu_get_stats(rcu_stats_t *stats);
+void rcu_show(void);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _KERNEL_STDARG_H
+#define _KERNEL_STDARG_H
+
+/* 可变参数 (-nostdinc下使用编译器内建实现) */
+typedef __builtin_va_list va_list;
+
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_arg(ap, type)   __builtin_va_arg(ap, type)
+#define va_end(ap)         __builtin_va_end(ap)
+#define va_copy(dst, src)  __builtin_va_copy(dst, src)
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _KERNEL_SYSCALL_H
+#define _KERNEL_SYSCALL_H
+
+/*
+ * 系统调用号 (与Linux RISC-V相同). 用户程序 (user/) 也包含这个头文件.
+ * ecall: a7为调用号, a0-a5为参数, 返回值在a0, 失败返回-1.
+ * 文件描述符0/1/2是标准输入/输出/错误: 在shell管道中连接到管道,
+ * 否则输出到控制台、输入为空; open返回的描述符从3开始.
+ */
+#define SYS_openat      56      /* openat(dirfd, path, flags), dirfd被忽略 */
+#define SYS_close       57
+#define SYS_lseek       62
+#define SYS_read        63
+#define SYS_write       64
+#define SYS_exit        93
+#define SYS_sched_yield 124
+#define SYS_getpid      172
+
+#define NR_SYSCALLS     173
+
+#endif
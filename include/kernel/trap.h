@@ -18,15 +18,33 @@ typedef struct {
     uint64_t sstatus; /* 状态寄存器 */
     uint64_t scause;  /* 异常原因 */
     uint64_t stval;   /* 附加信息 */
+    uint64_t kernel_tp; /* 返回用户态时保存内核的tp (hart编号), 下次陷入时取回 */
 } trapframe_t;
 
 /* 中断/异常原因 */
 #define CAUSE_INTERRUPT (1ULL << 63)
 #define CAUSE_SUPERVISOR_TIMER 5
+#define CAUSE_SUPERVISOR_EXTERNAL 9
+
+/* 异常原因 */
+#define CAUSE_ILLEGAL_INSTRUCTION 2
+#define CAUSE_USER_ECALL 8
+#define CAUSE_INST_PAGE_FAULT 12
+#define CAUSE_LOAD_PAGE_FAULT 13
+#define CAUSE_STORE_PAGE_FAULT 15
 
 /* 初始化中断系统 */
 void trap_init(void);
 
+/* 内核栈溢出 (trap_vector检测到后调用, 不返回) */
+void kernel_stack_overflow(uint64_t sp);
+
+/* 从用户态陷入的异常 (系统调用、缺页等), 在exec.c中处理 */
+void user_exception(trapframe_t *tf);
+
+/* 以tf中的寄存器进入用户态, 不返回 (trapentry.S) */
+void user_return(trapframe_t *tf) __attribute__((noreturn));
+
 /* 时钟中断处理 */
 void timer_tick(void);
 
@@ -0,0 +1,104 @@
+#ifndef _KERNEL_URING_H
+#define _KERNEL_URING_H
+
+#include <kernel/types.h>
+#include <kernel/fs.h>
+#include <kernel/process.h>
+
+/*
+ * 异步文件I/O环 (仿io_uring).
+ * 提交队列(SQ)和完成队列(CQ)是提交者和内核工作线程共享的内存:
+ *   提交者: uring_get_sqe填写若干请求, uring_submit一次发布并唤醒工作线程
+ *   工作线程: 依次执行请求, 把结果写入CQ, 每批唤醒一次等待者
+ *   提交者: uring_peek_cqe/uring_cq_advance直接从CQ取结果, 不需要每个请求一次调用
+ * 每个队列只有一个生产者和一个消费者, head和tail各由一方写入.
+ *
+ * 文件在环内打开 (类似io_uring的固定文件): OPEN的结果是环内的文件号,
+ * READ/WRITE按文件号和偏移访问 (pread/pwrite语义), 不经过进程的fd表和路径查找.
+ */
+#define URING_MAX_ENTRIES 256
+#define URING_MAX_FILES   64
+
+/* 操作码 */
+#define URING_OP_NOP   0
+#define URING_OP_OPEN  1    /* path, flags (O_CREAT/O_TRUNC/O_ACCMODE) -> 文件号 */
+#define URING_OP_READ  2    /* file, buf, len, offset -> 读取的字节数 */
+#define URING_OP_WRITE 3    /* file, buf, len, offset -> 写入的字节数 */
+#define URING_OP_CLOSE 4    /* file -> 0 */
+
+/* 提交项 */
+typedef struct {
+    uint8_t opcode;
+    uint8_t reserved;
+    uint16_t flags;             /* OPEN的打开标志 */
+    int32_t file;               /* 环内文件号 */
+    uint32_t len;
+    uint64_t offset;
+    union {
+        void *buf;
+        const char *path;       /* OPEN: 完成前必须保持有效 */
+    };
+    uint64_t user_data;         /* 原样带回完成项 */
+} uring_sqe_t;
+
+/* 完成项: res为结果, 失败时为-1 */
+typedef struct {
+    uint64_t user_data;
+    int64_t res;
+} uring_cqe_t;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t batches;           /* 工作线程被唤醒处理的批次 */
+    uint64_t cq_full;           /* CQ满时工作线程等待的次数 */
+} uring_stats_t;
+
+typedef struct uring {
+    uint32_t sq_entries;
+    uint32_t cq_entries;        /* 2倍于SQ, 提交满一轮SQ不会溢出 */
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+
+    /* 提交者写sq_tail和cq_head, 工作线程写sq_head和cq_tail */
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t sqe_tail;          /* 已取出但尚未提交的提交项 */
+    uint32_t cq_head;
+    uint32_t cq_tail;
+
+    file_t *files[URING_MAX_FILES];
+
+    process_t *worker;
+    int worker_pid;
+    bool stop;
+    wait_queue_t sq_wait;       /* 工作线程等待新请求 */
+    wait_queue_t cq_wait;       /* 提交者等待完成; 工作线程等待CQ空位 */
+
+    uring_stats_t stats;
+} uring_t;
+
+/* 创建环和它的工作线程, entries向上取整为2的幂 (最多URING_MAX_ENTRIES) */
+uring_t *uring_create(uint32_t entries);
+
+/* 停止工作线程 (先执行完已提交的请求), 关闭环内的文件并释放 */
+void uring_destroy(uring_t *ring);
+
+/* 取一个空闲提交项并清零, SQ满时返回NULL */
+uring_sqe_t *uring_get_sqe(uring_t *ring);
+
+/* 发布取出的提交项并唤醒工作线程, 返回发布的个数 */
+int uring_submit(uring_t *ring);
+
+/* 最早的完成项, 没有时返回NULL (不等待) */
+uring_cqe_t *uring_peek_cqe(uring_t *ring);
+
+/* 等待至少一个完成项 */
+uring_cqe_t *uring_wait_cqe(uring_t *ring);
+
+/* 消费n个完成项 */
+void uring_cq_advance(uring_t *ring, uint32_t n);
+
+void uring_get_stats(uring_t *ring, uring_stats_t *stats);
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef _KERNEL_UVM_H
+#define _KERNEL_UVM_H
+
+#include <kernel/types.h>
+#include <kernel/mm.h>
+
+struct file;
+
+/*
+ * 用户地址空间: 虚拟地址的第二个1GB (根页表第1项) 归用户程序,
+ * 其余根页表项从内核页表复制, 内核在任何进程的页表下都能运行.
+ * 用户页都是按需建立的: 进程第一次访问时缺页, 由mm_fault分配和填充.
+ * 读还没写过的匿名内存 (bss、栈) 或文件中全0的页时只映射只读的共享零页,
+ * 第一次写入时再换成私有页 (写时复制), 合并页 (ksm.c) 也是这样.
+ * 内存不足时私有页可以被换出到磁盘 (swap.c), 访问时缺页读回.
+ */
+#define USER_BASE       0x40000000UL
+#define USER_END        0x80000000UL
+#define USER_STACK_TOP  USER_END
+#define USER_STACK_SIZE (256 * 1024)
+
+/*
+ * 虚拟内存区域 [start, end), 按页对齐.
+ * 文件映射的区域中, [file_va, file_end) 的内容来自文件的file_off处,
+ * 区域内的其余部分读出为0 (如ELF段的bss部分); 匿名区域全部为0.
+ */
+typedef struct vma {
+    uint64_t start;
+    uint64_t end;
+    uint64_t prot;              /* PTE_R/W/X */
+    struct file *file;          /* 持有文件的引用, NULL为匿名 */
+    uint64_t file_va;
+    uint64_t file_end;
+    uint64_t file_off;
+    /*
+     * 只读区域可以共享页: shared[i]是第i页, 第一个缺页的进程分配并填充,
+     * 之后映射同一物理页. 数组和其中的页属于提供者 (exec.c的程序映像).
+     */
+    void **shared;
+    struct vma *next;
+} vma_t;
+
+typedef struct mm {
+    pagetable_t pagetable;
+    vma_t *vmas;                /* 按地址排序 */
+
+    /* 进入用户态时的寄存器和加载信息 (exec.c) */
+    uint64_t entry;
+    uint64_t start_stack;
+    uint64_t argc;
+    uint64_t arg_start;         /* argv数组的用户地址 */
+    uint64_t load_cycles;
+    void *exe;                  /* 程序映像, 地址空间销毁前由exec释放 */
+
+    /* 缺页统计 */
+    uint64_t faults;
+    uint64_t file_pages;        /* 从文件读入的私有页 */
+    uint64_t shared_pages;      /* 映射的共享页 */
+    uint64_t shared_hits;       /* 其中已由别的实例读入的 */
+    uint64_t anon_pages;        /* 全0的私有页 */
+    uint64_t zero_pages;        /* 映射共享零页的读缺页 */
+    uint64_t cow_faults;        /* 写零页或合并页时复制出私有页 */
+    uint64_t swap_ins;          /* 从交换区读回的页 */
+    uint64_t fault_ticks;       /* 处理缺页的总时间 (rdtime) */
+
+    /* 内核正通过物理地址使用这个地址空间的页 (可能睡眠), 期间ksm不合并它的页 */
+    int pinned;
+    struct mm *next;            /* 所有地址空间的链表 (mm_list) */
+} mm_t;
+
+extern mm_t *mm_list;
+
+/* 共享零页: 内核镜像中的一页, 只读映射给用户, 从不释放 */
+extern uint8_t zero_page[PAGE_SIZE];
+uint64_t zero_page_mappings(void);      /* 当前映射零页的PTE数 */
+
+mm_t *mm_create(void);
+void mm_destroy(mm_t *mm);      /* 释放私有页和页表, 不能是当前使用的页表 */
+
+/* 切换到mm的页表, NULL切换到内核页表 */
+void mm_activate(mm_t *mm);
+
+/* 添加区域, 与已有区域重叠或超出用户空间时返回-1. file的引用由mm持有 */
+int mm_map(mm_t *mm, const vma_t *area);
+
+/*
+ * 处理va处的缺页, access是这次访问需要的权限 (PTE_R/W/X).
+ * va不在任何区域中、区域不允许这种访问或内存不足时返回-1.
+ */
+int mm_fault(mm_t *mm, uint64_t va, uint64_t access);
+
+/*
+ * 内核访问用户内存: 按页补齐映射后通过恒等映射的物理地址拷贝,
+ * 不需要打开sstatus.SUM. 地址无效时返回-1.
+ */
+int copy_to_user(mm_t *mm, uint64_t dst, const void *src, size_t len);
+int copy_from_user(mm_t *mm, void *dst, uint64_t src, size_t len);
+/* 拷贝以'\0'结尾的字符串, 超过size-1字节时返回-1 */
+int strncpy_from_user(mm_t *mm, char *dst, uint64_t src, size_t size);
+
+/*
+ * [va, va+len)不跨页时返回它在内核中的地址 (必要时先缺页), 失败返回NULL.
+ * access含PTE_W时保证返回的是私有页 (零页、合并页先复制).
+ */
+void *user_page_ptr(mm_t *mm, uint64_t va, size_t len, uint64_t access);
+
+/*
+ * 把vma中va处已映射的私有页换成只读映射的page (零页或合并页), 释放原来的页.
+ * page是合并页时调用者已经为这次映射增加了引用.
+ */
+void mm_merge_page(mm_t *mm, vma_t *vma, uint64_t va, void *page);
+
+/*
+ * 交换 (swap.c): 磁盘上文件系统之后的交换区, 每个槽存一页.
+ * 换出的页的PTE无效 (V=0), 用RSW中的一位标记, PPN字段存槽号.
+ * kswapd在空闲页低于水位时按时钟算法扫描私有页: A位置位的清掉 (老化),
+ * 上次扫描以来没被访问过的写入交换区. 分配用户页时空闲页太少则直接回收.
+ */
+#define PTE_SWAP            (1UL << 8)
+#define PTE_IS_SWAP(pte)    (!((pte) & PTE_V) && ((pte) & PTE_SWAP))
+#define SWAP_PTE(slot)      (((uint64_t)(slot) << 10) | PTE_SWAP)
+#define PTE_SWAP_SLOT(pte)  ((pte) >> 10)
+
+#define SWAP_WMARK_MIN      256     /* 低于它时分配用户页前直接回收 */
+#define SWAP_WMARK_LOW      512     /* 低于它时kswapd开始回收 */
+#define SWAP_WMARK_HIGH     1024    /* kswapd回收到这里为止 */
+#define SWAP_CLUSTER        32      /* 每次回收的页数 */
+
+uint64_t swap_reclaim(uint64_t nr);     /* 换出至多nr页, 返回换出的页数 */
+int swap_read(uint64_t slot, void *page);
+void swap_free(uint64_t slot);
+void swap_forget_mm(mm_t *mm);          /* 地址空间销毁前调用 */
+void swap_show(void);
+
+/*
+ * 页合并 (ksm.c): ksmd线程周期性扫描所有地址空间的私有页, 全0的换成零页,
+ * 内容相同的合并成一个只读的PG_KSM页, 写入时mm_fault复制出私有页.
+ */
+void ksm_start(void);
+void ksm_stop(void);
+void ksm_scan(void);                    /* 立即完整扫描一轮 */
+void ksm_put(void *page);               /* 解除合并页的一个映射, 最后一个释放页 */
+void ksm_forget_mm(mm_t *mm);           /* 地址空间销毁前调用 */
+void ksm_show(void);
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef _KERNEL_VIRTIO_H
+#define _KERNEL_VIRTIO_H
+
+#include <kernel/types.h>
+
+/* virtio-mmio (QEMU virt: 8个槽位, 0x10001000起每0x1000一个) */
+#define VIRTIO_MMIO_BASE   0x10001000UL
+#define VIRTIO_MMIO_STRIDE 0x1000UL
+#define VIRTIO_MMIO_SLOTS  8
+
+/* mmio寄存器偏移 */
+#define VIRTIO_MMIO_MAGIC_VALUE         0x000   /* "virt" */
+#define VIRTIO_MMIO_VERSION             0x004   /* 1: legacy, 2: modern */
+#define VIRTIO_MMIO_DEVICE_ID           0x008
+#define VIRTIO_MMIO_VENDOR_ID           0x00c
+#define VIRTIO_MMIO_DEVICE_FEATURES     0x010
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL 0x014
+#define VIRTIO_MMIO_DRIVER_FEATURES     0x020
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL 0x024
+#define VIRTIO_MMIO_GUEST_PAGE_SIZE     0x028   /* legacy */
+#define VIRTIO_MMIO_QUEUE_SEL           0x030
+#define VIRTIO_MMIO_QUEUE_NUM_MAX       0x034
+#define VIRTIO_MMIO_QUEUE_NUM           0x038
+#define VIRTIO_MMIO_QUEUE_ALIGN         0x03c   /* legacy */
+#define VIRTIO_MMIO_QUEUE_PFN           0x040   /* legacy */
+#define VIRTIO_MMIO_QUEUE_READY         0x044
+#define VIRTIO_MMIO_QUEUE_NOTIFY        0x050
+#define VIRTIO_MMIO_INTERRUPT_STATUS    0x060
+#define VIRTIO_MMIO_INTERRUPT_ACK       0x064
+#define VIRTIO_MMIO_STATUS              0x070
+#define VIRTIO_MMIO_QUEUE_DESC_LOW      0x080
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH     0x084
+#define VIRTIO_MMIO_QUEUE_DRIVER_LOW    0x090
+#define VIRTIO_MMIO_QUEUE_DRIVER_HIGH   0x094
+#define VIRTIO_MMIO_QUEUE_DEVICE_LOW    0x0a0
+#define VIRTIO_MMIO_QUEUE_DEVICE_HIGH   0x0a4
+#define VIRTIO_MMIO_CONFIG              0x100
+
+#define VIRTIO_MAGIC 0x74726976
+
+/* 设备类型 */
+#define VIRTIO_ID_NET     1
+#define VIRTIO_ID_BLOCK   2
+#define VIRTIO_ID_CONSOLE 3
+
+/* 设备状态位 */
+#define VIRTIO_STATUS_ACKNOWLEDGE 1
+#define VIRTIO_STATUS_DRIVER      2
+#define VIRTIO_STATUS_DRIVER_OK   4
+#define VIRTIO_STATUS_FEATURES_OK 8
+#define VIRTIO_STATUS_FAILED      128
+
+#define VIRTIO_F_VERSION_1 32
+
+/* 中断状态位 */
+#define VIRTIO_INT_USED_RING 1
+#define VIRTIO_INT_CONFIG    2
+
+/* split virtqueue */
+#define VIRTQ_DESC_F_NEXT  1
+#define VIRTQ_DESC_F_WRITE 2    /* 设备写入 (读请求的数据缓冲区) */
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} virtq_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} virtq_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+/* 队列长度上限: 描述符表和avail环放在第一页, used环在第二页 (legacy布局) */
+#define VIRTQ_MAX_SIZE 128
+#define VIRTQ_RING_PAGES 2
+
+typedef struct virtio_dev {
+    uint64_t base;
+    int irq;
+    uint32_t version;
+    uint32_t device_id;
+} virtio_dev_t;
+
+typedef struct virtq {
+    virtio_dev_t *dev;
+    uint16_t index;
+    uint16_t size;
+    virtq_desc_t *desc;
+    virtq_avail_t *avail;
+    virtq_used_t *used;
+    uint16_t free_head;     /* 空闲描述符链表 */
+    uint16_t nr_free;
+    uint16_t last_used;     /* 已处理到的used环位置 */
+    uint16_t avail_idx;     /* 尚未通知设备的avail环位置 */
+    void *ring_mem;
+} virtq_t;
+
+/* 探测所有virtio-mmio槽位, 并为识别出的设备调用相应驱动 */
+void virtio_init(void);
+
+/* 设备初始化: 复位 -> 协商特性 -> 建立队列 -> virtio_driver_ok */
+int virtio_negotiate(virtio_dev_t *dev, uint64_t features, uint64_t *accepted);
+int virtq_init(virtio_dev_t *dev, virtq_t *vq, uint16_t index);
+void virtio_driver_ok(virtio_dev_t *dev);
+void virtio_fail(virtio_dev_t *dev);
+
+uint8_t virtio_config_read8(virtio_dev_t *dev, uint32_t offset);
+uint32_t virtio_config_read32(virtio_dev_t *dev, uint32_t offset);
+uint64_t virtio_config_read64(virtio_dev_t *dev, uint32_t offset);
+
+/* 读取并应答中断状态 */
+uint32_t virtio_irq_ack(virtio_dev_t *dev);
+
+/* 描述符管理 */
+int virtq_alloc_desc(virtq_t *vq);
+void virtq_free_chain(virtq_t *vq, uint16_t head);
+
+/* 把描述符链放入avail环; 多个请求入队后调用一次virtq_kick通知设备 */
+void virtq_push(virtq_t *vq, uint16_t head);
+void virtq_kick(virtq_t *vq);
+
+/* 取出一个已完成的请求, 没有时返回false */
+bool virtq_pop_used(virtq_t *vq, uint16_t *head, uint32_t *len);
+
+/* 各设备驱动 */
+void virtio_blk_init(virtio_dev_t *dev);
+void virtio_console_init(virtio_dev_t *dev);
+void virtio_net_init(virtio_dev_t *dev);
+
+/* virtio-console: 存在时printk和shell用它代替UART (见lib/printk.c) */
+typedef struct {
+    uint64_t tx_bytes;
+    uint64_t tx_kicks;          /* 通知设备的次数 (UART每字节一次MMIO写) */
+    uint64_t tx_stalls;         /* 发送页全部在途, 等待设备回收 */
+    uint64_t rx_bytes;
+} vcon_stats_t;
+
+bool vcon_present(void);
+void vcon_write(const char *s, size_t len);
+int vcon_getc(void);                /* 没有输入时返回-1 */
+void vcon_plug(void);               /* 蓄流: unplug之前的输出攒成整页再发送 */
+void vcon_unplug(void);
+void vcon_get_stats(vcon_stats_t *stats);
+
+#endif
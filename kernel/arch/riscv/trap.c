@@ -1,16 +1,26 @@
 #include <kernel/trap.h>
 #include <kernel/printk.h>
+#include <kernel/klog.h>
+#include <kernel/irq.h>
+#include <kernel/process.h>
 #include <arch/riscv/riscv.h>
 
 extern void trap_vector(void);
 
 static uint64_t ticks = 0;
 
+static void timer_irq(void *arg) {
+    (void)arg;
+    timer_tick();
+}
+
 void trap_init(void) {
-    /* 设置中断向量 */
+    /* 设置中断向量; sscratch为0表示在内核态 (见trapentry.S) */
+    write_csr(sscratch, 0);
     write_csr(stvec, (uint64_t)trap_vector);
 
     /* 启用时钟中断 */
+    request_irq(IRQ_TIMER, timer_irq, NULL, "timer");
     write_csr(sie, SIE_STIE);
 
     /* 启用全局中断 */
@@ -24,23 +34,18 @@ void trap_handler(trapframe_t *tf) {
     uint64_t stval = tf->stval;
 
     if (scause & CAUSE_INTERRUPT) {
-        /* 中断 */
-        uint64_t int_code = scause & ~CAUSE_INTERRUPT;
-
-        switch (int_code) {
-            case CAUSE_SUPERVISOR_TIMER:
-                timer_tick();
-                break;
-            default:
-                printk("[TRAP] Unknown interrupt: %x\n", int_code);
-                break;
-        }
+        /* 中断: 交给中断子系统分发 */
+        irq_entry(scause & ~CAUSE_INTERRUPT);
+    } else if (!(tf->sstatus & SSTATUS_SPP)) {
+        /* 用户程序的系统调用和异常, 最坏结束该进程, 不影响内核 */
+        user_exception(tf);
     } else {
         /* 异常 */
-        printk("[TRAP] Exception!\n");
-        printk("  scause: %x\n", scause);
-        printk("  stval: %x\n", stval);
-        printk("  sepc: %x\n", tf->sepc);
+        printk(KERN_EMERG "[TRAP] Exception!\n");
+        printk(KERN_EMERG "  scause: %llx\n", scause);
+        printk(KERN_EMERG "  stval: %llx\n", stval);
+        printk(KERN_EMERG "  sepc: %llx\n", tf->sepc);
+        klog_console_flush();
 
         /* 停机 */
         while (1) {
@@ -49,12 +54,31 @@ void trap_handler(trapframe_t *tf) {
     }
 }
 
+/* trap_vector发现内核栈溢出时在溢出栈上调用, 不返回 */
+void kernel_stack_overflow(uint64_t sp) {
+    process_t *proc = current_process();
+
+    printk(KERN_EMERG "[TRAP] Kernel stack overflow in %s (pid %d)!\n",
+           proc ? proc->name : "?", proc ? proc->pid : -1);
+    printk(KERN_EMERG "  sp: %llx, stack: %p - %p\n",
+           sp, proc ? proc->kstack : NULL,
+           proc && proc->kstack ? (uint8_t *)proc->kstack + KSTACK_SIZE : NULL);
+    printk(KERN_EMERG "  scause: %llx\n", read_csr(scause));
+    printk(KERN_EMERG "  stval: %llx\n", read_csr(stval));
+    printk(KERN_EMERG "  sepc: %llx\n", read_csr(sepc));
+    klog_console_flush();
+
+    while (1) {
+        wfi();
+    }
+}
+
 void timer_tick(void) {
     ticks++;
 
     /* 每1000个tick打印一次 */
     if (ticks % 1000 == 0) {
-        printk("[TIMER] Tick: %u\n", ticks);
+        printk(KERN_DEBUG "[TIMER] Tick: %llu\n", ticks);
     }
 
     /* 设置下一次时钟中断 (这需要SBI支持) */
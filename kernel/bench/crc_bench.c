@@ -0,0 +1,155 @@
+/* CRC32C基准测试: 各实现的吞吐量, 以及读文件时验证校验和的开销 */
+#include <kernel/bench.h>
+#include <kernel/crc32c.h>
+#include <kernel/fs.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+#define CRC_BENCH_SIZE  (1024 * 1024)
+#define CRC_BENCH_BYTES (64 * 1024 * 1024)     /* 每项大约处理这么多数据 */
+#define CRC_FILE_SIZE   (4 * 1024 * 1024)
+
+typedef struct {
+    const char *name;
+    uint32_t (*fn)(uint32_t crc, const void *buf, size_t len);
+} crc_impl_t;
+
+static const crc_impl_t crc_impls[] = {
+    { "byte table", crc32c_byte },
+    { "slicing-by-8", crc32c_sw },
+#ifdef __riscv_zbc
+    { "zbc clmul", crc32c_clmul },
+#endif
+};
+
+#define NR_CRC_IMPLS (sizeof(crc_impls) / sizeof(crc_impls[0]))
+
+static const size_t crc_bench_sizes[] = { 64, 4096, CRC_BENCH_SIZE };
+
+/* 吞吐量按GB/s打印, 保留两位小数 */
+static void crc_report(const char *name, size_t size, uint64_t bytes, uint64_t ticks) {
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    uint64_t mb_s = bytes * TIMEBASE_FREQ / ticks / (1024 * 1024);
+    uint64_t centi_gb_s = bytes * TIMEBASE_FREQ / ticks * 100 / (1024 * 1024 * 1024);
+    printk("  %-14s %8llu B  %8llu MB/s  %llu.%02llu GB/s\n",
+           name, (uint64_t)size, mb_s, centi_gb_s / 100, centi_gb_s % 100);
+}
+
+/* 各实现对标准测试串和随机数据 (不同对齐和长度) 的结果必须一致 */
+static bool crc_selftest(const uint8_t *data) {
+    bool ok = true;
+    for (size_t i = 0; i < NR_CRC_IMPLS; i++) {
+        if (crc_impls[i].fn(0, "123456789", 9) != CRC32C_CHECK) {
+            printk("  %s: wrong check value\n", crc_impls[i].name);
+            ok = false;
+        }
+        for (size_t off = 0; off < 8; off++) {
+            for (size_t len = 0; len < 200; len += 13) {
+                uint32_t ref = crc32c_byte(0, data + off, len);
+                uint32_t split = crc_impls[i].fn(crc_impls[i].fn(0, data + off, len / 3),
+                                                 data + off + len / 3, len - len / 3);
+                if (crc_impls[i].fn(0, data + off, len) != ref || split != ref) {
+                    printk("  %s: mismatch at offset %llu length %llu\n",
+                           crc_impls[i].name, (uint64_t)off, (uint64_t)len);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+/* 读4MB的内存文件, 报告验证校验和占读取时间的比例; 再改坏一页确认能发现 */
+static void crc_file_bench(const uint8_t *data, uint8_t *buf) {
+    const char *path = "/crcbench";
+    if (fs_create(path, FILE_TYPE_REGULAR) < 0) {
+        return;
+    }
+    file_t *file = fs_find(path);
+    if (file->disk_ino) {
+        printk("  file checksums need an in-memory directory (root is on disk)\n");
+        fs_delete(path);
+        return;
+    }
+    fs_write(path, data, CRC_FILE_SIZE);
+
+    fs_csum_stats_t before, after;
+    fs_get_csum_stats(&before);
+    uint64_t start = rdtime();
+    int n = fs_read(path, buf, CRC_FILE_SIZE);
+    uint64_t ticks = rdtime() - start;
+    fs_get_csum_stats(&after);
+
+    uint64_t verify = after.verify_ticks - before.verify_ticks;
+    bench_report("fs_read 4MB (verified)", 1, ticks, n > 0 ? n : 0);
+    printk("    verification: %llu us of %llu us (%llu%%)\n",
+           verify / (TIMEBASE_FREQ / 1000000), ticks / (TIMEBASE_FREQ / 1000000),
+           verify * 100 / (ticks ? ticks : 1));
+
+    /* 单页的文件的root就是数据页 */
+    fs_write(path, data, PAGE_SIZE);
+    if (file->height == 1) {
+        uint8_t *page = file->root;
+        page[100] ^= 1;
+        n = fs_read(path, buf, PAGE_SIZE);
+        page[100] ^= 1;
+        printk("    flipped one bit: %s\n", n < 0 ? "detected" : "NOT detected");
+    }
+    fs_delete(path);
+}
+
+void bench_crc(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    size_t npages = CRC_FILE_SIZE / PAGE_SIZE;
+    uint8_t *data = alloc_pages(npages);
+    uint8_t *buf = alloc_pages(npages);
+    if (!data || !buf) {
+        printk("bench crc: cannot allocate buffers\n");
+        goto out;
+    }
+    uint32_t seed = 1;
+    for (size_t i = 0; i < CRC_FILE_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+
+    if (!crc_selftest(data)) {
+        goto out;
+    }
+#ifndef __riscv_zbc
+    printk("  (zbc clmul not built: make ZBC=1 for -march with Zbc)\n");
+#endif
+
+    for (size_t i = 0; i < NR_CRC_IMPLS; i++) {
+        for (size_t s = 0; s < sizeof(crc_bench_sizes) / sizeof(crc_bench_sizes[0]); s++) {
+            size_t size = crc_bench_sizes[s];
+            uint64_t iters = CRC_BENCH_BYTES / size;
+            /* 按字节查表慢得多, 少做一些 */
+            if (crc_impls[i].fn == crc32c_byte) {
+                iters /= 8;
+            }
+            volatile uint32_t sink = 0;
+            uint64_t start = rdtime();
+            for (uint64_t n = 0; n < iters; n++) {
+                sink += crc_impls[i].fn(0, data, size);
+            }
+            crc_report(crc_impls[i].name, size, iters * size, rdtime() - start);
+        }
+    }
+
+    crc_file_bench(data, buf);
+
+out:
+    if (data) {
+        free_pages(data, npages);
+    }
+    if (buf) {
+        free_pages(buf, npages);
+    }
+}
@@ -0,0 +1,458 @@
+/* 文件系统基准测试: 不同文件大小的create/write/read/delete */
+#include <kernel/bench.h>
+#include <kernel/fs.h>
+#include <kernel/file.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <kernel/buf.h>
+#include <kernel/nosfs.h>
+#include <arch/riscv/riscv.h>
+
+#define FS_BENCH_MAX_SIZE   (4 * 1024 * 1024)
+#define FS_BENCH_BYTES      (16 * 1024 * 1024)  /* 每种大小大约写这么多数据 */
+#define FS_BENCH_MAX_ITERS  256
+
+static const size_t fs_bench_sizes[] = {
+    1, 512, 4096, 64 * 1024, 1024 * 1024, FS_BENCH_MAX_SIZE
+};
+
+static void size_label(char *buf, size_t len, size_t size, const char *op) {
+    if (size >= 1024 * 1024) {
+        snprintf(buf, len, "%lluMB %s", (uint64_t)size / (1024 * 1024), op);
+    } else if (size >= 1024) {
+        snprintf(buf, len, "%lluKB %s", (uint64_t)size / 1024, op);
+    } else {
+        snprintf(buf, len, "%lluB %s", (uint64_t)size, op);
+    }
+}
+
+/*
+ * kmalloc每个大小类保留一个空slab不还给pmm, 文件的校验和数组等释放后
+ * 空闲页数也回不到原值; 按tag比较, 除PG_SLAB之外的tag在用页数都应复原.
+ */
+static void fs_bench_check_leaks(const page_tag_stat_t before[NR_PAGE_TAGS]) {
+    page_tag_stat_t after[NR_PAGE_TAGS];
+    page_tag_get_stats(after);
+    for (int t = 0; t < NR_PAGE_TAGS; t++) {
+        if (t != PG_SLAB && after[t].live > before[t].live) {
+            printk("  WARNING: %llu %s pages leaked\n",
+                   after[t].live - before[t].live, after[t].name);
+        }
+    }
+}
+
+void bench_fs(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    size_t buf_pages = FS_BENCH_MAX_SIZE / PAGE_SIZE;
+    uint8_t *src = alloc_pages(buf_pages);
+    uint8_t *dst = alloc_pages(buf_pages);
+    if (!src || !dst) {
+        printk("bench fs: cannot allocate %llu KB buffers\n",
+               (uint64_t)FS_BENCH_MAX_SIZE / 1024);
+        if (src) {
+            free_pages(src, buf_pages);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < FS_BENCH_MAX_SIZE; i++) {
+        src[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    page_tag_stat_t tags_before[NR_PAGE_TAGS];
+    page_tag_get_stats(tags_before);
+
+    for (size_t s = 0; s < sizeof(fs_bench_sizes) / sizeof(fs_bench_sizes[0]); s++) {
+        size_t size = fs_bench_sizes[s];
+        int iters = FS_BENCH_BYTES / size;
+        if (iters > FS_BENCH_MAX_ITERS) {
+            iters = FS_BENCH_MAX_ITERS;
+        }
+        if (iters < 1) {
+            iters = 1;
+        }
+
+        uint64_t t_create = 0, t_write = 0, t_read = 0, t_delete = 0;
+        bool ok = true;
+
+        for (int i = 0; i < iters && ok; i++) {
+            uint64_t t0 = rdtime();
+            ok = fs_create("bench.dat", FILE_TYPE_REGULAR) == 0;
+            uint64_t t1 = rdtime();
+            ok = ok && fs_write("bench.dat", src, size) == (int)size;
+            uint64_t t2 = rdtime();
+            ok = ok && fs_read("bench.dat", dst, size) == (int)size;
+            uint64_t t3 = rdtime();
+            fs_delete("bench.dat");
+            uint64_t t4 = rdtime();
+
+            t_create += t1 - t0;
+            t_write += t2 - t1;
+            t_read += t3 - t2;
+            t_delete += t4 - t3;
+        }
+
+        if (!ok) {
+            printk("  %llu bytes: FAILED\n", (uint64_t)size);
+            fs_delete("bench.dat");
+            continue;
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (dst[i] != src[i]) {
+                printk("  %llu bytes: data mismatch at %llu\n", (uint64_t)size, (uint64_t)i);
+                break;
+            }
+        }
+
+        char label[32];
+        size_label(label, sizeof(label), size, "create");
+        bench_report(label, iters, t_create, 0);
+        size_label(label, sizeof(label), size, "write");
+        bench_report(label, iters, t_write, (uint64_t)size * iters);
+        size_label(label, sizeof(label), size, "read");
+        bench_report(label, iters, t_read, (uint64_t)size * iters);
+        size_label(label, sizeof(label), size, "delete");
+        bench_report(label, iters, t_delete, 0);
+    }
+
+    /* 删除的file_t在宽限期之后才释放 */
+    rcu_barrier();
+    fs_bench_check_leaks(tags_before);
+
+    free_pages(src, buf_pages);
+    free_pages(dst, buf_pages);
+}
+
+/* 目录项缓存: 目录规模增长时查找开销应保持不变 */
+#define DCACHE_BENCH_LOOKUPS 10000
+
+static const int dcache_bench_scales[] = { 1000, 10000, 30000 };
+
+void bench_dcache(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    char path[MAX_PATH];
+    int created = 0;
+
+    if (fs_mkdir("/dcbench") != 0) {
+        return;
+    }
+
+    for (size_t s = 0; s < sizeof(dcache_bench_scales) / sizeof(dcache_bench_scales[0]); s++) {
+        int scale = dcache_bench_scales[s];
+
+        uint64_t start = rdtime();
+        for (; created < scale; created++) {
+            snprintf(path, sizeof(path), "/dcbench/file%d", created);
+            if (fs_create(path, FILE_TYPE_REGULAR) != 0) {
+                printk("  create failed at %d files\n", created);
+                goto cleanup;
+            }
+        }
+        uint64_t create_ticks = rdtime() - start;
+
+        /* 命中: 按伪随机顺序查找已存在的文件 */
+        uint32_t x = 12345;
+        start = rdtime();
+        for (int i = 0; i < DCACHE_BENCH_LOOKUPS; i++) {
+            x = x * 1103515245 + 12345;
+            snprintf(path, sizeof(path), "/dcbench/file%d", (int)((x >> 8) % scale));
+            if (!fs_find(path)) {
+                printk("  lookup failed: %s\n", path);
+            }
+        }
+        uint64_t hit_ticks = rdtime() - start;
+
+        /* 未命中: 同一组不存在的名字, 之后都命中负缓存项 */
+        start = rdtime();
+        for (int i = 0; i < DCACHE_BENCH_LOOKUPS; i++) {
+            snprintf(path, sizeof(path), "/dcbench/missing%d", i & 63);
+            fs_find(path);
+        }
+        uint64_t miss_ticks = rdtime() - start;
+
+        char label[32];
+        printk("  %d files:\n", scale);
+        snprintf(label, sizeof(label), "create (%d)", scale);
+        bench_report(label, scale, create_ticks, 0);
+        bench_report("lookup hit", DCACHE_BENCH_LOOKUPS, hit_ticks, 0);
+        bench_report("lookup miss", DCACHE_BENCH_LOOKUPS, miss_ticks, 0);
+    }
+
+    dcache_stats_t dc;
+    dcache_get_stats(&dc);
+    printk("  dcache: %llu entries, %llu buckets, %llu negative hits\n",
+           dc.nr_cached, dc.nr_buckets, dc.negative_hits);
+
+cleanup:
+    while (created > 0) {
+        snprintf(path, sizeof(path), "/dcbench/file%d", --created);
+        fs_delete(path);
+    }
+    fs_delete("/dcbench");
+}
+
+/* 追加日志: 整个文件重写 (fs_write) 与 O_APPEND (vfs_write) 对比 */
+#define FD_BENCH_LINES 1000
+#define FD_BENCH_LINE  "2026-01-01 00:00:00 [info] benchmark log line payload\n"
+
+void bench_fd(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    size_t line_len = sizeof(FD_BENCH_LINE) - 1;
+    size_t total = line_len * FD_BENCH_LINES;
+    size_t buf_pages = PAGE_ALIGN_UP(total) / PAGE_SIZE;
+    uint8_t *buf = alloc_pages(buf_pages);
+    if (!buf) {
+        printk("bench fd: cannot allocate buffer\n");
+        return;
+    }
+
+    /* 旧方式: 每追加一行都重写整个文件, O(文件大小) */
+    fs_create("fdbench.log", FILE_TYPE_REGULAR);
+    uint64_t start = rdtime();
+    for (int i = 0; i < FD_BENCH_LINES; i++) {
+        memcpy(buf + i * line_len, FD_BENCH_LINE, line_len);
+        fs_write("fdbench.log", buf, (i + 1) * line_len);
+    }
+    uint64_t rewrite_ticks = rdtime() - start;
+    fs_delete("fdbench.log");
+
+    /* O_APPEND: 只写新增的字节 */
+    int fd = vfs_open("fdbench.log", O_WRONLY | O_CREAT | O_APPEND);
+    start = rdtime();
+    for (int i = 0; i < FD_BENCH_LINES; i++) {
+        vfs_write(fd, FD_BENCH_LINE, line_len);
+    }
+    uint64_t append_ticks = rdtime() - start;
+    vfs_close(fd);
+
+    /* 顺序读: 每次256字节 */
+    fd = vfs_open("fdbench.log", O_RDONLY);
+    start = rdtime();
+    size_t nread = 0;
+    ssize_t n;
+    while ((n = vfs_read(fd, buf, 256)) > 0) {
+        nread += n;
+    }
+    uint64_t read_ticks = rdtime() - start;
+    vfs_close(fd);
+    fs_delete("fdbench.log");
+
+    if (nread != total) {
+        printk("  read back %llu bytes, expected %llu\n", (uint64_t)nread, (uint64_t)total);
+    }
+
+    bench_report("append via fs_write rewrite", FD_BENCH_LINES, rewrite_ticks, total);
+    bench_report("append via O_APPEND", FD_BENCH_LINES, append_ticks, total);
+    bench_report("sequential read 256B", (total + 255) / 256, read_ticks, total);
+
+    free_pages(buf, buf_pages);
+}
+
+/* 磁盘文件系统: 大量小文件的创建/写入, 同步开销和日志恢复时间 */
+#define NOSFS_BENCH_FILES     10000
+#define NOSFS_BENCH_SMALL     256
+#define NOSFS_BENCH_BIG       (4 * 1024 * 1024)
+
+void bench_nosfs(int argc, char **argv) {
+    if (!nosfs_mounted()) {
+        printk("bench nosfs: no disk filesystem mounted\n");
+        return;
+    }
+
+    int nfiles = NOSFS_BENCH_FILES;
+    if (argc > 1) {
+        nfiles = 0;
+        for (const char *p = argv[1]; *p >= '0' && *p <= '9'; p++) {
+            nfiles = nfiles * 10 + (*p - '0');
+        }
+        if (nfiles <= 0) {
+            printk("Usage: bench nosfs [files]\n");
+            return;
+        }
+    }
+
+    size_t big_pages = NOSFS_BENCH_BIG / PAGE_SIZE;
+    uint8_t *buf = alloc_pages(big_pages);
+    if (!buf) {
+        printk("bench nosfs: cannot allocate buffer\n");
+        return;
+    }
+    memset(buf, 'n', NOSFS_BENCH_BIG);
+
+    if (fs_create("/nfbench", FILE_TYPE_DIRECTORY) < 0) {
+        free_pages(buf, big_pages);
+        return;
+    }
+
+    journal_stats_t js0, js1;
+    journal_get_stats(&js0);
+
+    char path[48];
+    int created = 0;
+    uint64_t start = rdtime();
+    for (; created < nfiles; created++) {
+        snprintf(path, sizeof(path), "/nfbench/f%d", created);
+        if (fs_create(path, FILE_TYPE_REGULAR) < 0) {
+            printk("  create failed after %d files\n", created);
+            goto cleanup;
+        }
+    }
+    uint64_t create_ticks = rdtime() - start;
+
+    start = rdtime();
+    for (int i = 0; i < nfiles; i++) {
+        snprintf(path, sizeof(path), "/nfbench/f%d", i);
+        fs_write(path, buf, NOSFS_BENCH_SMALL);
+    }
+    uint64_t write_ticks = rdtime() - start;
+
+    start = rdtime();
+    fs_sync();
+    uint64_t sync_ticks = rdtime() - start;
+
+    /* 大文件顺序写, 包含同步到磁盘的时间 */
+    fs_create("/nfbench/big", FILE_TYPE_REGULAR);
+    start = rdtime();
+    fs_write("/nfbench/big", buf, NOSFS_BENCH_BIG);
+    fs_sync();
+    uint64_t big_ticks = rdtime() - start;
+
+    journal_get_stats(&js1);
+
+    /* 日志写满后崩溃时的恢复时间 */
+    start = rdtime();
+    int replayed = journal_replay_test(js1.capacity);
+    uint64_t replay_ticks = rdtime() - start;
+
+    char label[32];
+    snprintf(label, sizeof(label), "create (%d)", nfiles);
+    bench_report(label, nfiles, create_ticks, 0);
+    bench_report("write 256B", nfiles, write_ticks, (uint64_t)nfiles * NOSFS_BENCH_SMALL);
+    bench_report("sync", 1, sync_ticks, 0);
+    bench_report("write 4MB + sync", 1, big_ticks, NOSFS_BENCH_BIG);
+    if (replayed >= 0) {
+        char rlabel[32];
+        snprintf(rlabel, sizeof(rlabel), "journal replay (%d blocks)", replayed);
+        bench_report(rlabel, 1, replay_ticks, (uint64_t)replayed * BLOCK_SIZE);
+    }
+    printk("  journal: %llu commits, %llu blocks logged, %llu ops\n",
+           js1.commits - js0.commits, js1.blocks_logged - js0.blocks_logged,
+           js1.ops - js0.ops);
+
+    fs_delete("/nfbench/big");
+
+cleanup:
+    start = rdtime();
+    int deleted = created;
+    while (created > 0) {
+        snprintf(path, sizeof(path), "/nfbench/f%d", --created);
+        fs_delete(path);
+    }
+    fs_delete("/nfbench");
+    fs_sync();
+    bench_report("delete + sync", deleted, rdtime() - start, 0);
+
+    free_pages(buf, big_pages);
+}
+
+/*
+ * 透明压缩: 日志文本写入/读取的吞吐量和内存占用, 与未压缩文件对比.
+ * 内存占用取写入前后空闲页数之差, 包括数据页、zpool的页和索引页.
+ */
+#define ZBENCH_SIZE  (4 * 1024 * 1024)
+#define ZBENCH_CHUNK 4096
+
+static void zbench_run(const char *path, bool compress, uint8_t *data, uint8_t *buf) {
+    if (fs_create(path, FILE_TYPE_REGULAR) < 0) {
+        return;
+    }
+    file_t *file = fs_find(path);
+    if (file->disk_ino) {
+        printk("  compression needs an in-memory directory (root is on disk)\n");
+        fs_delete(path);
+        return;
+    }
+    fs_set_compress(path, compress);
+
+    uint64_t free_before = get_free_pages();
+    int fd = vfs_open(path, O_WRONLY);
+    uint64_t start = rdtime();
+    for (size_t off = 0; off < ZBENCH_SIZE; off += ZBENCH_CHUNK) {
+        vfs_write(fd, data + off, ZBENCH_CHUNK);
+    }
+    vfs_close(fd);
+    uint64_t write_ticks = rdtime() - start;
+    uint64_t used = free_before - get_free_pages();
+
+    fd = vfs_open(path, O_RDONLY);
+    start = rdtime();
+    size_t nread = 0;
+    ssize_t n;
+    while ((n = vfs_read(fd, buf, ZBENCH_CHUNK)) > 0) {
+        if (memcmp(buf, data + nread, n) != 0) {
+            printk("  %s: data mismatch at %llu\n", path, (uint64_t)nread);
+            break;
+        }
+        nread += n;
+    }
+    uint64_t read_ticks = rdtime() - start;
+    vfs_close(fd);
+
+    uint64_t ratio = used ? (uint64_t)ZBENCH_SIZE / PAGE_SIZE * 100 / used : 0;
+    printk("  %s: %llu KB stored in %llu pages (%llu.%02llux)\n",
+           compress ? "compressed" : "plain", (uint64_t)ZBENCH_SIZE / 1024, used,
+           ratio / 100, ratio % 100);
+    bench_report(compress ? "write 4KB (compressed)" : "write 4KB (plain)",
+                 ZBENCH_SIZE / ZBENCH_CHUNK, write_ticks, ZBENCH_SIZE);
+    bench_report(compress ? "read 4KB (compressed)" : "read 4KB (plain)",
+                 ZBENCH_SIZE / ZBENCH_CHUNK, read_ticks, nread);
+    fs_delete(path);
+}
+
+void bench_compress(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    size_t npages = ZBENCH_SIZE / PAGE_SIZE;
+    uint8_t *data = alloc_pages(npages);
+    uint8_t *buf = alloc_page();
+    if (!data || !buf) {
+        printk("bench compress: cannot allocate buffer\n");
+        goto out;
+    }
+
+    /* 类似日志的文本: 固定的格式加上变化的数字 */
+    size_t len = 0;
+    uint32_t seed = 1;
+    while (len < ZBENCH_SIZE) {
+        char line[96];
+        seed = seed * 1103515245 + 12345;
+        int n = snprintf(line, sizeof(line),
+                         "2026-01-01 12:%02u:%02u [info] request %u served in %u us\n",
+                         (seed >> 8) % 60, (seed >> 16) % 60, (unsigned)(len / 64),
+                         (seed >> 4) % 1000);
+        if (len + n > ZBENCH_SIZE) {
+            n = ZBENCH_SIZE - len;
+        }
+        memcpy(data + len, line, n);
+        len += n;
+    }
+
+    zbench_run("zbench.plain", false, data, buf);
+    zbench_run("zbench.lz4", true, data, buf);
+
+out:
+    if (data) {
+        free_pages(data, npages);
+    }
+    if (buf) {
+        free_page(buf);
+    }
+}
@@ -0,0 +1,130 @@
+/* 内存分配器基准测试: 页分配器 (单页/连续多页/碎片化) 和kmalloc各级别 */
+#include <kernel/bench.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+#define MM_BENCH_PAGES   4096                   /* 16MB */
+#define MM_BENCH_OBJS    4096
+#define MM_BENCH_ROUNDS  16
+
+static void *bench_ptrs[MM_BENCH_PAGES];
+
+/* 先分配n页再全部释放 */
+static void bench_page_batch(void) {
+    uint64_t t_alloc = 0, t_free = 0;
+    int n = 0;
+
+    for (int r = 0; r < MM_BENCH_ROUNDS / 4; r++) {
+        uint64_t start = rdtime();
+        for (n = 0; n < MM_BENCH_PAGES; n++) {
+            if (!(bench_ptrs[n] = alloc_page())) {
+                break;
+            }
+        }
+        uint64_t mid = rdtime();
+        for (int i = 0; i < n; i++) {
+            free_page(bench_ptrs[i]);
+        }
+        t_alloc += mid - start;
+        t_free += rdtime() - mid;
+    }
+    bench_report("alloc_page x 4096", (uint64_t)n * (MM_BENCH_ROUNDS / 4), t_alloc, 0);
+    bench_report("free_page x 4096", (uint64_t)n * (MM_BENCH_ROUNDS / 4), t_free, 0);
+}
+
+/* 每隔一页释放一页, 然后分配连续多页: 查找要跨过碎片 */
+static void bench_fragmented(void) {
+    int n;
+    for (n = 0; n < MM_BENCH_PAGES; n++) {
+        if (!(bench_ptrs[n] = alloc_page())) {
+            break;
+        }
+    }
+    for (int i = 0; i < n; i += 2) {
+        free_page(bench_ptrs[i]);
+    }
+
+    static const size_t runs[] = { 1, 2, 8 };
+    for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+        void *got[64];
+        int m = 0;
+        uint64_t start = rdtime();
+        while (m < 64 && (got[m] = alloc_pages(runs[r]))) {
+            m++;
+        }
+        uint64_t ticks = rdtime() - start;
+        for (int i = 0; i < m; i++) {
+            free_pages(got[i], runs[r]);
+        }
+
+        char label[40];
+        snprintf(label, sizeof(label), "alloc_pages(%llu) fragmented", (uint64_t)runs[r]);
+        bench_report(label, m, ticks, 0);
+    }
+
+    for (int i = 1; i < n; i += 2) {
+        free_page(bench_ptrs[i]);
+    }
+}
+
+/* 每个kmalloc级别分配MM_BENCH_OBJS个对象再释放 */
+static void bench_kmalloc(void) {
+    static const size_t sizes[] = { 16, 64, 256, 1024, 2048, 8192 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        int nobjs = size > 2048 ? MM_BENCH_OBJS / 16 : MM_BENCH_OBJS;
+        uint64_t t_alloc = 0, t_free = 0;
+        int n = 0;
+
+        for (int r = 0; r < MM_BENCH_ROUNDS; r++) {
+            uint64_t start = rdtime();
+            for (n = 0; n < nobjs; n++) {
+                if (!(bench_ptrs[n] = kmalloc(size))) {
+                    break;
+                }
+            }
+            uint64_t mid = rdtime();
+            for (int i = 0; i < n; i++) {
+                kfree(bench_ptrs[i]);
+            }
+            t_alloc += mid - start;
+            t_free += rdtime() - mid;
+        }
+
+        char label[32];
+        snprintf(label, sizeof(label), "kmalloc(%llu)", (uint64_t)size);
+        bench_report(label, (uint64_t)n * MM_BENCH_ROUNDS, t_alloc, 0);
+        snprintf(label, sizeof(label), "kfree(%llu)", (uint64_t)size);
+        bench_report(label, (uint64_t)n * MM_BENCH_ROUNDS, t_free, 0);
+    }
+}
+
+void bench_mm(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uint64_t free_before = get_free_pages();
+
+    /* 分配后立即释放: search_hint命中, 主要是清零一页的开销 */
+    uint64_t start = rdtime();
+    int ops = 0;
+    for (; ops < MM_BENCH_PAGES * 4; ops++) {
+        void *p = alloc_page();
+        if (!p) {
+            break;
+        }
+        free_page(p);
+    }
+    bench_report("alloc_page+free_page", ops, rdtime() - start, 0);
+
+    bench_page_batch();
+    bench_fragmented();
+    bench_kmalloc();
+
+    /* kmalloc每级保留一个空slab, 不算泄漏 */
+    if (get_free_pages() + 8 < free_before) {
+        printk("  WARNING: %lld pages not returned\n",
+               (int64_t)(free_before - get_free_pages()));
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * 管道基准测试: 拷贝式读写与整页转交的吞吐量.
+ * 拷贝式写入和读出各拷贝一次; 转交时写者像cat一样把数据拷进新页 (一次),
+ * 之后整页经管道交给读者, 不再拷贝.
+ */
+#include <kernel/bench.h>
+#include <kernel/pipe.h>
+#include <kernel/process.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+#define PIPE_BENCH_BYTES  (16 * 1024 * 1024)
+#define PIPE_BENCH_CHUNK  (64 * 1024)
+
+/* 写者线程的参数: 内核线程入口没有参数, 通过静态变量传递 */
+static pipe_t *test_pipe;
+static uint8_t *bench_buf;
+static size_t bench_chunk;
+static bool bench_splice;
+
+static void pipe_bench_writer(void) {
+    for (size_t done = 0; done < PIPE_BENCH_BYTES; done += bench_chunk) {
+        if (bench_splice) {
+            uint8_t *page = alloc_page();
+            if (!page) {
+                break;
+            }
+            memcpy(page, bench_buf, PAGE_SIZE);
+            if (pipe_splice_write(test_pipe, page, PAGE_SIZE) < 0) {
+                free_page(page);
+                break;
+            }
+        } else if (pipe_write(test_pipe, bench_buf, bench_chunk) < 0) {
+            break;
+        }
+    }
+    pipe_close(test_pipe, PIPE_WRITE);
+}
+
+static void pipe_bench_run(const char *what, size_t chunk, bool splice) {
+    test_pipe = pipe_create();
+    if (!test_pipe) {
+        printk("bench pipe: cannot create pipe\n");
+        return;
+    }
+    bench_chunk = splice ? PAGE_SIZE : chunk;
+    bench_splice = splice;
+
+    uint64_t start = rdtime();
+    process_t *writer = create_process("pipe_bench", pipe_bench_writer);
+    if (!writer) {
+        printk("bench pipe: cannot create writer thread\n");
+        pipe_close(test_pipe, PIPE_READ);
+        pipe_close(test_pipe, PIPE_WRITE);
+        return;
+    }
+    int pid = writer->pid;
+
+    uint64_t bytes = 0, ops = 0;
+    if (splice) {
+        pipe_buf_t b;
+        while (pipe_splice_read(test_pipe, &b)) {
+            bytes += b.len;
+            ops++;
+            free_page(b.page);
+        }
+    } else {
+        ssize_t n;
+        uint8_t *rbuf = bench_buf + PIPE_BENCH_CHUNK;
+        while ((n = pipe_read(test_pipe, rbuf, chunk)) > 0) {
+            bytes += n;
+            ops++;
+        }
+    }
+    uint64_t ticks = rdtime() - start;
+
+    pipe_close(test_pipe, PIPE_READ);
+    process_wait(writer, pid);
+
+    bench_report(what, ops, ticks, bytes);
+    if (bytes != PIPE_BENCH_BYTES) {
+        printk("    short transfer: %llu of %u bytes\n", bytes, PIPE_BENCH_BYTES);
+    }
+}
+
+void bench_pipe(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    /* 写者和读者各用一个64KB缓冲区 */
+    size_t buf_pages = 2 * PIPE_BENCH_CHUNK / PAGE_SIZE;
+    bench_buf = alloc_pages(buf_pages);
+    if (!bench_buf) {
+        printk("bench pipe: cannot allocate buffers\n");
+        return;
+    }
+    memset(bench_buf, 'x', PIPE_BENCH_CHUNK);
+
+    printk("  %d MB through a %d-page pipe, writer in a separate thread\n",
+           PIPE_BENCH_BYTES >> 20, PIPE_BUFS);
+    pipe_bench_run("copy   4KB read/write", PAGE_SIZE, false);
+    pipe_bench_run("copy  64KB read/write", PIPE_BENCH_CHUNK, false);
+    pipe_bench_run("splice 4KB, 1 copy in", PAGE_SIZE, true);
+    printk("    splice: one copy in, zero copies through the pipe\n");
+
+    free_pages(bench_buf, buf_pages);
+}
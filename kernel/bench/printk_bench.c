@@ -0,0 +1,69 @@
+/* printk 基准测试: 格式化开销与整行输出吞吐量 */
+#include <kernel/bench.h>
+#include <kernel/printk.h>
+#include <kernel/klog.h>
+#include <kernel/virtio.h>
+#include <arch/riscv/riscv.h>
+
+#define PRINTK_BENCH_LINES 200
+
+/* 与内核日志相近的典型行 */
+#define BENCH_FMT "[BENCH] line %4d: pid=%-4d addr=%p size=%-10llu name=%-12s\n"
+
+void bench_printk(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    char buf[PRINTK_BUF_SIZE];
+    uint64_t bytes = 0;
+
+    /* 只格式化, 不输出 */
+    uint64_t start = rdtime();
+    for (int i = 0; i < PRINTK_BENCH_LINES; i++) {
+        bytes += snprintf(buf, sizeof(buf), BENCH_FMT,
+                          i, i & 15, (void *)buf, (uint64_t)i * 4096, "bench");
+    }
+    uint64_t fmt_ticks = rdtime() - start;
+
+    /* 逐字节输出 (旧printk的输出方式) */
+    start = rdtime();
+    for (int i = 0; i < PRINTK_BENCH_LINES; i++) {
+        int len = snprintf(buf, sizeof(buf), BENCH_FMT,
+                           i, i & 15, (void *)buf, (uint64_t)i * 4096, "bytewise");
+        for (int j = 0; j < len; j++) {
+            if (buf[j] == '\n') {
+                putchar('\r');
+            }
+            putchar(buf[j]);
+        }
+    }
+    uint64_t byte_ticks = rdtime() - start;
+
+    /* printk: 只追加到日志缓冲区, 控制台输出由klogd完成 */
+    klog_console_flush();
+    start = rdtime();
+    for (int i = 0; i < PRINTK_BENCH_LINES; i++) {
+        printk(BENCH_FMT, i, i & 15, (void *)buf, (uint64_t)i * 4096, "printk");
+    }
+    uint64_t line_ticks = rdtime() - start;
+
+    /* 控制台把积压的记录整段写出 */
+    start = rdtime();
+    klog_console_flush();
+    uint64_t drain_ticks = rdtime() - start;
+
+    printk("\nResults (%d lines):\n", PRINTK_BENCH_LINES);
+    bench_report("vsnprintf only", PRINTK_BENCH_LINES, fmt_ticks, bytes);
+    bench_report("per-byte putchar", PRINTK_BENCH_LINES, byte_ticks, bytes);
+    bench_report("printk (log buffer)", PRINTK_BENCH_LINES, line_ticks, bytes);
+    bench_report("console drain", PRINTK_BENCH_LINES, drain_ticks, bytes);
+
+    if (vcon_present()) {
+        vcon_stats_t vs;
+        vcon_get_stats(&vs);
+        printk("  console: virtio-console, %llu bytes in %llu kicks, %llu stalls\n",
+               vs.tx_bytes, vs.tx_kicks, vs.tx_stalls);
+    } else {
+        printk("  console: 16550 UART (one MMIO write per byte)\n");
+    }
+}
@@ -0,0 +1,184 @@
+/* RCU基准测试: 不加锁的路径/进程查找, 以及有写者时的宽限期和回调 */
+#include <kernel/bench.h>
+#include <kernel/fs.h>
+#include <kernel/process.h>
+#include <kernel/rcu.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+#define RCU_BENCH_FILES     256
+#define RCU_BENCH_LOOKUPS   20000       /* 每个读者线程的查找次数 */
+#define RCU_BENCH_READERS   3
+#define RCU_BENCH_BATCH     64          /* 读者每查找这么多次让出一次CPU */
+
+/* 读者线程的参数和结果: 内核线程入口没有参数, 通过静态变量传递 */
+static int writer_pid;
+static uint64_t reader_found;
+static uint64_t reader_errors;
+
+static void rcu_bench_path(char *buf, size_t size, uint32_t n) {
+    snprintf(buf, size, "/rcubench/file%u", n % RCU_BENCH_FILES);
+}
+
+/* 查找一个存在的文件, 核对名字 (释放过早的目录项会被改写) */
+static bool rcu_bench_lookup(uint32_t n) {
+    char path[MAX_PATH];
+    char name[MAX_FILENAME];
+    rcu_bench_path(path, sizeof(path), n);
+    snprintf(name, sizeof(name), "file%u", n % RCU_BENCH_FILES);
+    file_t *file = fs_find(path);
+    return file && strcmp(file->dentry->name, name) == 0;
+}
+
+static void rcu_bench_reader(void) {
+    uint32_t x = current_process()->pid;
+
+    for (int i = 0; i < RCU_BENCH_LOOKUPS; i++) {
+        x = x * 1103515245 + 12345;
+        if (rcu_bench_lookup(x >> 8)) {
+            reader_found++;
+        } else {
+            reader_errors++;
+        }
+
+        rcu_read_lock();
+        process_t *proc = process_find(writer_pid);
+        if (!proc || proc->pid != writer_pid) {
+            reader_errors++;
+        }
+        rcu_read_unlock();
+
+        if (i % RCU_BENCH_BATCH == RCU_BENCH_BATCH - 1) {
+            yield();
+        }
+    }
+}
+
+/* 只查找: 不加锁的路径解析与每一级都走path_walk的对比 */
+static void rcu_bench_single(const char *what, bool rcu) {
+    fs_rcu_walk = rcu;
+    uint32_t x = 1;
+    uint64_t errors = 0;
+    uint64_t start = rdtime();
+    for (int i = 0; i < RCU_BENCH_LOOKUPS; i++) {
+        x = x * 1103515245 + 12345;
+        if (!rcu_bench_lookup(x >> 8)) {
+            errors++;
+        }
+    }
+    bench_report(what, RCU_BENCH_LOOKUPS, rdtime() - start, 0);
+    if (errors) {
+        printk("    %llu lookups failed\n", errors);
+    }
+    fs_rcu_walk = true;
+}
+
+/*
+ * 读者线程查找的同时, 写者 (调用者) 反复创建、删除文件: 删除的file_t和
+ * 淘汰的目录项用call_rcu推迟释放, 读者在让出CPU时报告静止状态.
+ */
+static void rcu_bench_mixed(const char *what, bool rcu) {
+    process_t *readers[RCU_BENCH_READERS];
+    int pids[RCU_BENCH_READERS];
+    rcu_stats_t before, after;
+    char path[MAX_PATH];
+    uint64_t churn = 0;
+
+    fs_rcu_walk = rcu;
+    writer_pid = current_process()->pid;
+    reader_found = reader_errors = 0;
+    rcu_get_stats(&before);
+
+    uint64_t start = rdtime();
+    int nr = 0;
+    for (; nr < RCU_BENCH_READERS; nr++) {
+        readers[nr] = create_process("rcu_reader", rcu_bench_reader);
+        if (!readers[nr]) {
+            break;
+        }
+        pids[nr] = readers[nr]->pid;
+    }
+
+    /* 写者也用process_find看读者是否都已退出 */
+    bool running = true;
+    while (running) {
+        snprintf(path, sizeof(path), "/rcubench/tmp%llu", churn % 16);
+        if (fs_create(path, FILE_TYPE_REGULAR) == 0) {
+            fs_delete(path);
+            churn++;
+        }
+        yield();
+
+        running = false;
+        for (int i = 0; i < nr; i++) {
+            rcu_read_lock();
+            process_t *proc = process_find(pids[i]);
+            if (proc && proc->state != PROC_ZOMBIE) {
+                running = true;
+            }
+            rcu_read_unlock();
+        }
+    }
+    uint64_t ticks = rdtime() - start;
+    for (int i = 0; i < nr; i++) {
+        process_wait(readers[i], pids[i]);
+    }
+    rcu_barrier();
+    rcu_get_stats(&after);
+
+    bench_report(what, reader_found + reader_errors, ticks, 0);
+    uint64_t gps = after.gps - before.gps;
+    printk("    %d readers, %llu creates+deletes, %llu grace periods (avg %llu us), "
+           "%llu callbacks\n",
+           nr, churn, gps,
+           gps ? (after.gp_ticks - before.gp_ticks) / gps / (TIMEBASE_FREQ / 1000000) : 0,
+           after.invoked - before.invoked);
+    if (reader_errors) {
+        printk("    %llu lookups returned the wrong object\n", reader_errors);
+    }
+    fs_rcu_walk = true;
+}
+
+void bench_rcu(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    char path[MAX_PATH];
+    int created = 0;
+
+    if (fs_mkdir("/rcubench") != 0) {
+        return;
+    }
+    for (; created < RCU_BENCH_FILES; created++) {
+        rcu_bench_path(path, sizeof(path), created);
+        if (fs_create(path, FILE_TYPE_REGULAR) != 0) {
+            printk("  create failed at %d files\n", created);
+            goto cleanup;
+        }
+    }
+
+    dcache_stats_t dc_before, dc_after;
+    dcache_get_stats(&dc_before);
+
+    printk("  %d lookups of /rcubench/fileN (%d files):\n", RCU_BENCH_LOOKUPS, RCU_BENCH_FILES);
+    rcu_bench_single("fs_find rcu walk", true);
+    rcu_bench_single("fs_find path_walk", false);
+
+    /* 单hart: 读者和写者协作式地交替运行, 测的是开销而不是并行度 */
+    printk("  readers (fs_find + process_find) with a concurrent writer:\n");
+    rcu_bench_mixed("mixed, rcu walk", true);
+    rcu_bench_mixed("mixed, path_walk", false);
+
+    dcache_get_stats(&dc_after);
+    printk("  rcu walks: %llu, fallbacks: %llu\n",
+           dc_after.rcu_walks - dc_before.rcu_walks,
+           dc_after.rcu_fallbacks - dc_before.rcu_fallbacks);
+
+cleanup:
+    while (created > 0) {
+        rcu_bench_path(path, sizeof(path), --created);
+        fs_delete(path);
+    }
+    fs_delete("/rcubench");
+}
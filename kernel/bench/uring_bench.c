@@ -0,0 +1,143 @@
+/* 异步I/O环基准测试: 批量小读取与逐个调用fs_read对比 */
+#include <kernel/bench.h>
+#include <kernel/uring.h>
+#include <kernel/file.h>
+#include <kernel/fs.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+#define URING_BENCH_FILES  32
+#define URING_BENCH_FSIZE  4096
+#define URING_BENCH_READ   128
+#define URING_BENCH_OPS    8192
+#define URING_BENCH_PAGES  4        /* 一批最多128个读取的目标缓冲区 */
+
+static const uint32_t uring_bench_batches[] = { 1, 8, 32, 128 };
+
+static char ub_paths[URING_BENCH_FILES][32];
+
+/* 提交ops个读请求, 每批batch个, 每批结束后一次取完所有完成项 */
+static bool uring_bench_run(uring_t *ring, uint32_t batch, uint8_t *buf) {
+    uint32_t x = 12345;
+    uint64_t start = rdtime();
+
+    for (int done = 0; done < URING_BENCH_OPS; done += batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            x = x * 1103515245 + 12345;
+            uring_sqe_t *sqe = uring_get_sqe(ring);
+            sqe->opcode = URING_OP_READ;
+            sqe->file = (x >> 8) % URING_BENCH_FILES;
+            sqe->offset = ((x >> 16) % (URING_BENCH_FSIZE / URING_BENCH_READ)) * URING_BENCH_READ;
+            sqe->len = URING_BENCH_READ;
+            sqe->buf = buf + i * URING_BENCH_READ;
+            sqe->user_data = i;
+        }
+        uring_submit(ring);
+
+        for (uint32_t reaped = 0; reaped < batch;) {
+            uring_cqe_t *cqe = uring_wait_cqe(ring);
+            uint32_t n = 0;
+            for (; cqe; cqe = uring_peek_cqe(ring)) {
+                if (cqe->res != URING_BENCH_READ) {
+                    printk("  uring read failed (res %lld)\n", cqe->res);
+                    return false;
+                }
+                uring_cq_advance(ring, 1);
+                n++;
+            }
+            if (n == 0) {
+                printk("  uring: completions lost\n");
+                return false;
+            }
+            reaped += n;
+        }
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "uring read batch %u", batch);
+    bench_report(label, URING_BENCH_OPS, rdtime() - start,
+                 (uint64_t)URING_BENCH_OPS * URING_BENCH_READ);
+    return true;
+}
+
+void bench_uring(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    uint8_t *buf = alloc_pages(URING_BENCH_PAGES);
+    if (!buf) {
+        printk("bench uring: cannot allocate buffers\n");
+        return;
+    }
+    memset(buf, 'u', URING_BENCH_FSIZE);
+
+    int created = 0;
+    if (fs_mkdir("/urbench") != 0) {
+        free_pages(buf, URING_BENCH_PAGES);
+        return;
+    }
+    for (; created < URING_BENCH_FILES; created++) {
+        snprintf(ub_paths[created], sizeof(ub_paths[0]), "/urbench/f%d", created);
+        if (fs_create(ub_paths[created], FILE_TYPE_REGULAR) != 0 ||
+            fs_write(ub_paths[created], buf, URING_BENCH_FSIZE) != URING_BENCH_FSIZE) {
+            printk("  setup failed at file %d\n", created);
+            goto cleanup;
+        }
+    }
+
+    printk("  %d x %dB random reads over %d files of %dB\n",
+           URING_BENCH_OPS, URING_BENCH_READ, URING_BENCH_FILES, URING_BENCH_FSIZE);
+
+    /* 基线: 每次读取一次调用, 每次都按路径查找 */
+    uint32_t x = 12345;
+    uint64_t start = rdtime();
+    for (int i = 0; i < URING_BENCH_OPS; i++) {
+        x = x * 1103515245 + 12345;
+        fs_read(ub_paths[(x >> 8) % URING_BENCH_FILES], buf, URING_BENCH_READ);
+    }
+    bench_report("fs_read one at a time", URING_BENCH_OPS, rdtime() - start,
+                 (uint64_t)URING_BENCH_OPS * URING_BENCH_READ);
+
+    uring_t *ring = uring_create(URING_MAX_ENTRIES / 2);
+    if (!ring) {
+        printk("bench uring: cannot create ring\n");
+        goto cleanup;
+    }
+
+    /* 一批打开所有文件, 文件号即提交顺序 */
+    for (int i = 0; i < URING_BENCH_FILES; i++) {
+        uring_sqe_t *sqe = uring_get_sqe(ring);
+        sqe->opcode = URING_OP_OPEN;
+        sqe->path = ub_paths[i];
+        sqe->flags = O_RDONLY;
+        sqe->user_data = i;
+    }
+    uring_submit(ring);
+    bool ok = true;
+    for (int i = 0; i < URING_BENCH_FILES; i++) {
+        uring_cqe_t *cqe = uring_wait_cqe(ring);
+        if (!cqe || cqe->res != (int64_t)cqe->user_data) {
+            ok = false;
+        }
+        uring_cq_advance(ring, 1);
+    }
+
+    for (size_t b = 0; ok && b < sizeof(uring_bench_batches) / sizeof(uring_bench_batches[0]); b++) {
+        ok = uring_bench_run(ring, uring_bench_batches[b], buf);
+    }
+
+    uring_stats_t st;
+    uring_get_stats(ring, &st);
+    printk("  ring: %llu submitted, %llu completed in %llu worker batches, cq full %llu\n",
+           st.submitted, st.completed, st.batches, st.cq_full);
+    uring_destroy(ring);
+
+cleanup:
+    while (created > 0) {
+        fs_delete(ub_paths[--created]);
+    }
+    fs_delete("/urbench");
+    free_pages(buf, URING_BENCH_PAGES);
+}
@@ -0,0 +1,73 @@
+/* 页表基准测试: 逐页map_page与按范围映射/改权限/解除映射 */
+#include <kernel/bench.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/* 在一张独立的页表中映射1GB (不切换到它, 物理地址不会被访问) */
+#define VM_BENCH_VA    0x1000000000UL          /* 64GB, 远离恒等映射 */
+#define VM_BENCH_SIZE  (1UL << 30)
+#define VM_BENCH_PA    0x80000000UL
+
+static void vm_bench_unmap(pagetable_t pt, const char *what) {
+    uint64_t start = rdtime();
+    int ret = unmap_range(pt, VM_BENCH_VA, VM_BENCH_SIZE);
+    uint64_t ticks = rdtime() - start;
+
+    bench_report(what, VM_BENCH_SIZE / PAGE_SIZE, ticks, 0);
+    if (ret < 0) {
+        printk("    unmap_range failed\n");
+    }
+}
+
+void bench_vm(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uint64_t npages = VM_BENCH_SIZE / PAGE_SIZE;
+
+    pagetable_t pt = create_pagetable();
+    if (!pt) {
+        printk("bench vm: cannot allocate page table\n");
+        return;
+    }
+    uint64_t free_before = get_free_pages();
+
+    printk("  1GB of 4KB pages (%llu PTEs) in a private page table\n", npages);
+
+    /* 逐页: 每页从根走三级 */
+    uint64_t start = rdtime();
+    for (uint64_t i = 0; i < npages; i++) {
+        if (map_page(pt, VM_BENCH_VA + i * PAGE_SIZE, VM_BENCH_PA + i * PAGE_SIZE,
+                     PTE_R | PTE_W) < 0) {
+            printk("    map_page failed at page %llu\n", i);
+            break;
+        }
+    }
+    bench_report("map_page x 4KB", npages, rdtime() - start, 0);
+    printk("    page tables: %llu pages\n", free_before - get_free_pages());
+    vm_bench_unmap(pt, "unmap_range 1GB");
+
+    /* 按范围: 每张叶子页表走一次 */
+    start = rdtime();
+    int ret = map_range(pt, VM_BENCH_VA, VM_BENCH_PA, VM_BENCH_SIZE, PTE_R | PTE_W);
+    bench_report("map_range 1GB", npages, rdtime() - start, 0);
+    if (ret < 0) {
+        printk("    map_range failed\n");
+    }
+
+    start = rdtime();
+    ret = protect_range(pt, VM_BENCH_VA, VM_BENCH_SIZE, PTE_R);
+    bench_report("protect_range 1GB (R/W -> R)", npages, rdtime() - start, 0);
+    if (ret < 0) {
+        printk("    protect_range failed\n");
+    }
+
+    vm_bench_unmap(pt, "unmap_range 1GB");
+
+    /* 解除映射后中间页表应全部释放 */
+    uint64_t leaked = free_before - get_free_pages();
+    if (leaked) {
+        printk("    %llu page-table pages not freed\n", leaked);
+    }
+    free_page(pt);
+}
@@ -0,0 +1,39 @@
+/* PLIC 平台级中断控制器 */
+#include <kernel/plic.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/* 寄存器 (hart 0 的 S 模式上下文) */
+#define PLIC_PRIORITY(irq)  (PLIC_BASE + 4 * (irq))
+#define PLIC_SENABLE(hart)  (PLIC_BASE + 0x2080 + (hart) * 0x100)
+#define PLIC_SPRIORITY(hart) (PLIC_BASE + 0x201000 + (hart) * 0x2000)
+#define PLIC_SCLAIM(hart)   (PLIC_BASE + 0x201004 + (hart) * 0x2000)
+
+#define PLIC_REG(addr) (*(volatile uint32_t *)(addr))
+
+void plic_init(void) {
+    /* 接受所有优先级大于0的中断 */
+    PLIC_REG(PLIC_SPRIORITY(cpu_id())) = 0;
+
+    write_csr(sie, read_csr(sie) | SIE_SEIE);
+    printk("  PLIC initialized\n");
+}
+
+void plic_enable(int irq) {
+    uint64_t hart = cpu_id();
+    PLIC_REG(PLIC_PRIORITY(irq)) = 1;
+    PLIC_REG(PLIC_SENABLE(hart) + (irq / 32) * 4) |= (1U << (irq % 32));
+}
+
+void plic_disable(int irq) {
+    uint64_t hart = cpu_id();
+    PLIC_REG(PLIC_SENABLE(hart) + (irq / 32) * 4) &= ~(1U << (irq % 32));
+}
+
+uint32_t plic_claim(void) {
+    return PLIC_REG(PLIC_SCLAIM(cpu_id()));
+}
+
+void plic_complete(uint32_t irq) {
+    PLIC_REG(PLIC_SCLAIM(cpu_id())) = irq;
+}
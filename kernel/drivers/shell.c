@@ -2,21 +2,32 @@
 #include <kernel/printk.h>
 #include <kernel/string.h>
 #include <kernel/fs.h>
+#include <kernel/file.h>
 #include <kernel/process.h>
 #include <kernel/mm.h>
+#include <kernel/bench.h>
+#include <kernel/klog.h>
+#include <kernel/buf.h>
+#include <kernel/nosfs.h>
+#include <kernel/pipe.h>
+#include <kernel/net.h>
+#include <kernel/irq.h>
+#include <kernel/exec.h>
+#include <kernel/uvm.h>
+#include <kernel/init.h>
+#include <kernel/rcu.h>
+#include <arch/riscv/riscv.h>
 
 #define CMD_BUF_SIZE 256
 #define MAX_ARGS 16
 
-/* UART输入 */
-#define UART_BASE 0x10000000UL
-#define UART_RHR (*(volatile uint8_t *)(UART_BASE + 0))
-#define UART_LSR (*(volatile uint8_t *)(UART_BASE + 5))
-
 static char getchar_blocking(void) {
-    /* 等待数据可用 */
-    while ((UART_LSR & 0x01) == 0);
-    return UART_RHR;
+    /* 等待数据可用, 期间让出CPU给内核线程 (如klogd) */
+    int c;
+    while ((c = console_getc()) < 0) {
+        yield();
+    }
+    return c;
 }
 
 /* 读取一行输入 */
@@ -78,69 +89,473 @@ static int parse_args(char *cmd, char **argv) {
 static void cmd_help(void) {
     printk("Available commands:\n");
     printk("  help         - Show this help message\n");
-    printk("  ls           - List files\n");
-    printk("  cat <file>   - Display file contents\n");
+    printk("  ls [-l] [dir] - List files (-l: memory use and compression)\n");
+    printk("  cd [dir]     - Change directory\n");
+    printk("  pwd          - Print working directory\n");
+    printk("  mkdir <dir>  - Create a directory\n");
+    printk("  cat [file]   - Display file contents (stdin in a pipeline)\n");
+    printk("  wc [file]    - Count lines, words and bytes\n");
+    printk("  grep <pat> [file] - Print lines containing pat\n");
     printk("  touch <file> - Create a new file\n");
     printk("  rm <file>    - Remove a file\n");
     printk("  write <file> - Write to a file\n");
+    printk("  append <file> <text> - Append a line to a file\n");
+    printk("  chattr +c|-c <file> - Enable/disable transparent compression\n");
     printk("  ps           - List processes\n");
     printk("  mem          - Show memory info\n");
+    printk("  meminfo [checkpoint|leaks] - Page usage by owner and call site\n");
+    printk("  ksm [on|off|scan] - Zero page and page merging statistics\n");
+    printk("  swap         - Swap area usage and reclaim statistics\n");
+    printk("  rcu          - RCU grace periods and callbacks\n");
+    printk("  sync         - Write dirty disk blocks back\n");
+    printk("  net          - Network status; net send <ip> <port> <text>\n");
+    printk("  irqstat      - Interrupt and softirq counts and handling times\n");
+    printk("  bootstat     - Boot phase timings and deferred initcalls\n");
     printk("  echo <msg>   - Print a message\n");
     printk("  clear        - Clear screen\n");
+    printk("  dmesg        - Show kernel log (-n <lvl>, -l <lvl>, -C)\n");
+    printk("  bench <name> - Run a benchmark\n");
     printk("  about        - About NOS\n");
+    printk("  <prog> [args] - Run a user program (/bin/<prog>, or a path)\n");
+    printk("  cmd1 | cmd2  - Pipe the output of cmd1 into cmd2\n");
 }
 
 /* 命令: ls */
-static void cmd_ls(void) {
-    fs_list();
+static void cmd_ls(int argc, char **argv) {
+    bool detail = argc > 1 && strcmp(argv[1], "-l") == 0;
+    if (detail) {
+        argc--;
+        argv++;
+    }
+    fs_list(argc > 1 ? argv[1] : NULL, detail);
+}
+
+/* 命令: cd */
+static void cmd_cd(int argc, char **argv) {
+    fs_chdir(argc > 1 ? argv[1] : "/");
+}
+
+/* 命令: pwd */
+static void cmd_pwd(void) {
+    char path[MAX_PATH];
+    if (fs_getcwd(path, sizeof(path)) == 0) {
+        printk("%s\n", path);
+    }
+}
+
+/* 命令: mkdir */
+static void cmd_mkdir(int argc, char **argv) {
+    if (argc < 2) {
+        printk("Usage: mkdir <dir>\n");
+        return;
+    }
+
+    if (fs_mkdir(argv[1]) != 0) {
+        printk("Failed to create directory: %s\n", argv[1]);
+    }
+}
+
+/*
+ * 读取命令的输入: 给出了文件时从文件读取, 否则从管道中的标准输入读取.
+ * 返回打开的fd; 使用标准输入时返回-1; 出错时返回-2.
+ */
+static int input_open(const char *path) {
+    if (path) {
+        int fd = vfs_open(path, O_RDONLY);
+        if (fd < 0) {
+            printk("Failed to read file: %s\n", path);
+            return -2;
+        }
+        return fd;
+    }
+    if (!current_process()->pipe_in) {
+        return -2;
+    }
+    return -1;
+}
+
+static ssize_t input_read(int fd, void *buf, size_t len) {
+    if (fd >= 0) {
+        return vfs_read(fd, buf, len);
+    }
+    return pipe_read(current_process()->pipe_in, buf, len);
 }
 
-/* 命令: cat */
+static void input_close(int fd) {
+    if (fd >= 0) {
+        vfs_close(fd);
+    }
+}
+
+/* 命令: cat - 按块读取并输出, 不受文件大小限制 */
+#define CAT_CHUNK 256
+
 static void cmd_cat(int argc, char **argv) {
+    int fd = input_open(argc > 1 ? argv[1] : NULL);
+    if (fd == -2) {
+        if (argc < 2) {
+            printk("Usage: cat <filename>\n");
+        }
+        return;
+    }
+
+    /*
+     * 输出到管道时把文件按整页读进新页 (拷贝一次), 再把页转交给管道,
+     * 不经过printk; 之后到读者手里不再拷贝. 文件自己的页不直接交出去.
+     */
+    pipe_t *out = current_process()->pipe_out;
+    if (out && fd >= 0) {
+        for (;;) {
+            uint8_t *page = alloc_page_tag(PG_PIPE);
+            if (!page) {
+                break;
+            }
+            ssize_t n = vfs_read(fd, page, PAGE_SIZE);
+            if (n <= 0 || pipe_splice_write(out, page, n) < 0) {
+                free_page(page);
+                break;
+            }
+        }
+        vfs_close(fd);
+        return;
+    }
+
+    char buf[CAT_CHUNK];
+    ssize_t n;
+    while ((n = input_read(fd, buf, sizeof(buf))) > 0) {
+        printk("%.*s", (int)n, buf);
+    }
+
+    input_close(fd);
+    if (fd >= 0 && !out) {
+        printk("\n");
+    }
+}
+
+/* 命令: wc - 统计行数、单词数和字节数 */
+static void wc_count(const uint8_t *p, size_t n, uint64_t *counts, bool *in_word) {
+    for (size_t i = 0; i < n; i++) {
+        bool space = (p[i] == ' ' || p[i] == '\n' || p[i] == '\t' || p[i] == '\r');
+        if (p[i] == '\n') {
+            counts[0]++;
+        }
+        if (!space && !*in_word) {
+            counts[1]++;
+        }
+        *in_word = !space;
+    }
+    counts[2] += n;
+}
+
+static void cmd_wc(int argc, char **argv) {
+    int fd = input_open(argc > 1 ? argv[1] : NULL);
+    if (fd == -2) {
+        if (argc < 2) {
+            printk("Usage: wc <filename>\n");
+        }
+        return;
+    }
+
+    uint64_t counts[3] = { 0, 0, 0 };     /* 行, 单词, 字节 */
+    bool in_word = false;
+
+    if (fd < 0) {
+        /* 标准输入: 直接取走管道中的页, 不拷贝 */
+        pipe_buf_t b;
+        while (pipe_splice_read(current_process()->pipe_in, &b)) {
+            wc_count(b.page + b.offset, b.len, counts, &in_word);
+            free_page(b.page);
+        }
+    } else {
+        char buf[CAT_CHUNK];
+        ssize_t n;
+        while ((n = vfs_read(fd, buf, sizeof(buf))) > 0) {
+            wc_count((uint8_t *)buf, n, counts, &in_word);
+        }
+        vfs_close(fd);
+    }
+
+    printk("%8llu %8llu %8llu\n", counts[0], counts[1], counts[2]);
+}
+
+/* 命令: grep - 输出包含pattern的行 */
+#define GREP_LINE 256
+
+static bool line_contains(const char *line, const char *pat) {
+    size_t llen = strlen(line);
+    size_t plen = strlen(pat);
+    for (size_t i = 0; i + plen <= llen; i++) {
+        if (memcmp(line + i, pat, plen) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void cmd_grep(int argc, char **argv) {
     if (argc < 2) {
-        printk("Usage: cat <filename>\n");
+        printk("Usage: grep <pattern> [filename]\n");
         return;
     }
+    int fd = input_open(argc > 2 ? argv[2] : NULL);
+    if (fd == -2) {
+        if (argc < 3) {
+            printk("Usage: grep <pattern> [filename]\n");
+        }
+        return;
+    }
+
+    /* 超过GREP_LINE的行按多行处理 */
+    char buf[CAT_CHUNK];
+    char line[GREP_LINE];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = input_read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n' && len < sizeof(line) - 1) {
+                line[len++] = buf[i];
+                continue;
+            }
+            line[len] = '\0';
+            if (line_contains(line, argv[1])) {
+                printk("%s\n", line);
+            }
+            len = 0;
+            if (buf[i] != '\n') {
+                line[len++] = buf[i];
+            }
+        }
+    }
+    if (len > 0) {
+        line[len] = '\0';
+        if (line_contains(line, argv[1])) {
+            printk("%s\n", line);
+        }
+    }
+
+    input_close(fd);
+}
 
-    char buf[1024];
-    int size = fs_read(argv[1], buf, sizeof(buf) - 1);
+/* 命令: append - 在文件末尾追加一行 */
+static void cmd_append(int argc, char **argv) {
+    if (argc < 3) {
+        printk("Usage: append <filename> <text>\n");
+        return;
+    }
 
-    if (size < 0) {
-        printk("Failed to read file: %s\n", argv[1]);
+    int fd = vfs_open(argv[1], O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0) {
+        printk("Failed to open file: %s\n", argv[1]);
         return;
     }
 
-    buf[size] = '\0';
-    printk("%s\n", buf);
+    for (int i = 2; i < argc; i++) {
+        vfs_write(fd, argv[i], strlen(argv[i]));
+        vfs_write(fd, (i < argc - 1) ? " " : "\n", 1);
+    }
+    vfs_close(fd);
 }
 
 /* 命令: ps */
 static void cmd_ps(void) {
-    printk("Process list:\n");
-    printk("  PID  %-16s  State\n", "Name");
-    printk("  ----------------------------------\n");
+    static const char *state_str[] = {
+        "UNUSED", "READY", "RUNNING", "SLEEPING", "ZOMBIE"
+    };
+    proc_info_t procs[MAX_PROCESSES];
+    int n = process_snapshot(procs, MAX_PROCESSES);
 
-    /* 简化版：只显示当前进程 */
-    process_t *proc = current_process();
-    if (proc) {
-        const char *state_str[] = {
-            "UNUSED", "READY", "RUNNING", "SLEEPING", "ZOMBIE"
-        };
-        printk("  %-4d %-16s  %s\n",
-               proc->pid, proc->name, state_str[proc->state]);
+    printk("Process list:\n");
+    printk("  PID  %-16s  %-8s  Type\n", "Name", "State");
+    printk("  ----------------------------------------\n");
+    for (int i = 0; i < n; i++) {
+        printk("  %-4d %-16s  %-8s  %s\n", procs[i].pid, procs[i].name,
+               state_str[procs[i].state], procs[i].user ? "user" : "kernel");
     }
-
-    printk("\n  Note: Full process list not implemented yet\n");
 }
 
 /* 命令: mem */
 static void cmd_mem(void) {
-    extern uint64_t get_free_pages(void);
     uint64_t free = get_free_pages();
 
     printk("Memory information:\n");
-    printk("  Free pages: %u\n", free);
-    printk("  Free memory: %u KB\n", free * 4);
+    printk("  Free pages: %llu\n", free);
+    printk("  Free memory: %llu KB\n", free * 4);
+
+    vmalloc_stats_t vs;
+    vmalloc_get_stats(&vs);
+    printk("vmalloc:\n");
+    printk("  Areas: %llu, pages: %llu, used: %llu KB (with guards), largest free: %llu KB\n",
+           vs.nr_areas, vs.nr_pages, vs.used / 1024, vs.largest_free / 1024);
+    printk("  Kernel stacks: %d KB each, failures: %llu\n", KSTACK_SIZE / 1024, vs.failures);
+
+    dcache_stats_t dc;
+    dcache_get_stats(&dc);
+    printk("Dentry cache:\n");
+    printk("  Entries: %llu (negative %llu) in %llu buckets, evictions: %llu\n",
+           dc.nr_cached, dc.nr_negative, dc.nr_buckets, dc.evictions);
+    printk("  Lookups: %llu, hits: %llu, negative hits: %llu, misses: %llu\n",
+           dc.lookups, dc.hits, dc.negative_hits, dc.misses);
+    printk("  Lock-free walks: %llu, fallbacks to path_walk: %llu\n",
+           dc.rcu_walks, dc.rcu_fallbacks);
+
+    fs_csum_stats_t cs;
+    fs_get_csum_stats(&cs);
+    printk("File checksums (CRC32C):\n");
+    printk("  Summed: %llu KB in %llu us, verified: %llu KB in %llu us, mismatches: %llu\n",
+           cs.summed / 1024, cs.sum_ticks / (TIMEBASE_FREQ / 1000000),
+           cs.verified / 1024, cs.verify_ticks / (TIMEBASE_FREQ / 1000000), cs.errors);
+
+    if (blk_present()) {
+        bcache_stats_t bc;
+        bcache_get_stats(&bc);
+        printk("Buffer cache:\n");
+        printk("  Buffers: %llu (%llu KB), dirty: %llu, evictions: %llu\n",
+               bc.nr_buffers, bc.nr_buffers * BLOCK_SIZE / 1024, bc.nr_dirty, bc.evictions);
+        printk("  Lookups: %llu, hits: %llu, misses: %llu\n",
+               bc.lookups, bc.hits, bc.misses);
+        printk("  Readahead: %llu blocks, %llu used; writeback: %llu blocks in %llu batches\n",
+               bc.readahead, bc.readahead_hits, bc.writebacks, bc.flushes);
+    }
+
+    if (nosfs_mounted()) {
+        journal_stats_t js;
+        journal_get_stats(&js);
+        printk("Journal:\n");
+        printk("  Ops: %llu, commits: %llu, blocks logged: %llu, running: %u/%u\n",
+               js.ops, js.commits, js.blocks_logged, js.running, js.capacity);
+        printk("  Replayed at mount: %llu blocks in %llu us\n",
+               js.replayed, js.replay_ticks / (TIMEBASE_FREQ / 1000000));
+    }
+}
+
+/* 命令: meminfo */
+static void cmd_meminfo(int argc, char **argv) {
+    meminfo_show(argc, argv);
+}
+
+/* 命令: ksm - 页合并统计; ksm on|off 启停ksmd, ksm scan 立即扫描一轮 */
+static void cmd_ksm(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        ksm_start();
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        ksm_stop();
+    } else if (argc == 2 && strcmp(argv[1], "scan") == 0) {
+        ksm_scan();
+    } else if (argc != 1) {
+        printk("Usage: ksm [on|off|scan]\n");
+        return;
+    }
+    ksm_show();
+}
+
+/* 命令: swap */
+static void cmd_swap(void) {
+    swap_show();
+}
+
+/* 命令: rcu */
+static void cmd_rcu(void) {
+    rcu_show();
+}
+
+/* 命令: sync */
+static void cmd_sync(void) {
+    fs_sync();
+}
+
+/* 命令: net - 网卡状态; net send <ip> <port> <text> 发送一个UDP报文 */
+static bool parse_uint(const char **sp, uint32_t max, uint32_t *out) {
+    const char *s = *sp;
+    uint32_t v = 0;
+    if (*s < '0' || *s > '9') {
+        return false;
+    }
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (*s++ - '0');
+        if (v > max) {
+            return false;
+        }
+    }
+    *sp = s;
+    *out = v;
+    return true;
+}
+
+static bool parse_ip(const char *s, uint32_t *ip) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t octet;
+        if (!parse_uint(&s, 255, &octet) || *s != (i < 3 ? '.' : '\0')) {
+            return false;
+        }
+        s++;
+        v = (v << 8) | octet;
+    }
+    *ip = v;
+    return true;
+}
+
+static void cmd_net(int argc, char **argv) {
+    if (argc == 1) {
+        net_show();
+        return;
+    }
+
+    uint32_t ip, port;
+    const char *p = argc == 5 ? argv[3] : "";
+    if (argc != 5 || strcmp(argv[1], "send") != 0 || !parse_ip(argv[2], &ip) ||
+        !parse_uint(&p, 65535, &port) || *p) {
+        printk("Usage: net [send <a.b.c.d> <port> <text>]\n");
+        return;
+    }
+
+    /* 第一次发送时目标MAC未知, 等ARP应答后重试 */
+    for (int i = 0; i < 100; i++) {
+        if (udp_send(ip, port, 1024, argv[4], strlen(argv[4])) == 0) {
+            return;
+        }
+        yield();
+    }
+    printk("net: send failed (no ARP reply or no device)\n");
+}
+
+/* 命令: irqstat */
+static void cmd_irqstat(void) {
+    irqstat_show();
+}
+
+/* 命令: dmesg */
+static void cmd_dmesg(int argc, char **argv) {
+    if (argc == 1) {
+        klog_dump(LOGLEVEL_DEBUG);
+        return;
+    }
+
+    if (strcmp(argv[1], "-C") == 0) {
+        klog_clear();
+        return;
+    }
+
+    if (argc == 3 && argv[2][0] >= '0' && argv[2][0] <= '7' && argv[2][1] == '\0') {
+        int level = argv[2][0] - '0';
+        if (strcmp(argv[1], "-n") == 0) {
+            /* 控制台只输出级别 < level 的消息 */
+            klog_set_console_level(level);
+            return;
+        }
+        if (strcmp(argv[1], "-l") == 0) {
+            klog_dump(level);
+            return;
+        }
+    }
+
+    printk("Usage: dmesg [-C] [-n <0-7>] [-l <0-7>]\n");
+    printk("  console level: %d\n", klog_get_console_level());
+}
+
+/* 命令: bootstat */
+static void cmd_bootstat(void) {
+    bootstat_show();
 }
 
 /* 命令: echo */
@@ -187,6 +602,16 @@ static void cmd_rm(int argc, char **argv) {
     }
 }
 
+/* 命令: chattr - 打开/关闭文件的透明压缩 */
+static void cmd_chattr(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "+c") != 0 && strcmp(argv[1], "-c") != 0)) {
+        printk("Usage: chattr +c|-c <file|dir>\n");
+        return;
+    }
+
+    fs_set_compress(argv[2], argv[1][0] == '+');
+}
+
 /* 命令: write - 写入文件 */
 static void cmd_write(int argc, char **argv) {
     if (argc < 2) {
@@ -243,44 +668,219 @@ static void cmd_about(void) {
     printk("  - Basic shell with commands\n\n");
 }
 
-/* 执行命令 */
-static void execute_command(char *cmd) {
-    char *argv[MAX_ARGS];
-    int argc = parse_args(cmd, argv);
+/*
+ * 命令: 运行用户程序. 带'/'的命令名是程序的路径, 否则在/bin下查找.
+ * 找不到程序时返回false.
+ */
+static bool run_program(int argc, char **argv) {
+    char path[MAX_PATH];
+    bool has_slash = false;
+    for (const char *p = argv[0]; *p; p++) {
+        has_slash |= *p == '/';
+    }
+    snprintf(path, sizeof(path), has_slash ? "%s" : "/bin/%s", argv[0]);
 
-    if (argc == 0) {
-        return;
+    file_t *file = fs_find(path);
+    if (!file || file->type != FILE_TYPE_REGULAR) {
+        return false;
+    }
+    process_t *proc = exec(path, argc, argv);
+    if (proc) {
+        process_wait(proc, proc->pid);
     }
+    return true;
+}
 
+/* 执行一条命令 */
+static void run_command(int argc, char **argv) {
     /* 命令分发 */
     if (strcmp(argv[0], "help") == 0) {
         cmd_help();
     } else if (strcmp(argv[0], "ls") == 0) {
-        cmd_ls();
+        cmd_ls(argc, argv);
+    } else if (strcmp(argv[0], "cd") == 0) {
+        cmd_cd(argc, argv);
+    } else if (strcmp(argv[0], "pwd") == 0) {
+        cmd_pwd();
+    } else if (strcmp(argv[0], "mkdir") == 0) {
+        cmd_mkdir(argc, argv);
     } else if (strcmp(argv[0], "cat") == 0) {
         cmd_cat(argc, argv);
+    } else if (strcmp(argv[0], "wc") == 0) {
+        cmd_wc(argc, argv);
+    } else if (strcmp(argv[0], "grep") == 0) {
+        cmd_grep(argc, argv);
     } else if (strcmp(argv[0], "touch") == 0) {
         cmd_touch(argc, argv);
     } else if (strcmp(argv[0], "rm") == 0) {
         cmd_rm(argc, argv);
     } else if (strcmp(argv[0], "write") == 0) {
         cmd_write(argc, argv);
+    } else if (strcmp(argv[0], "append") == 0) {
+        cmd_append(argc, argv);
+    } else if (strcmp(argv[0], "chattr") == 0) {
+        cmd_chattr(argc, argv);
     } else if (strcmp(argv[0], "ps") == 0) {
         cmd_ps();
     } else if (strcmp(argv[0], "mem") == 0) {
         cmd_mem();
+    } else if (strcmp(argv[0], "meminfo") == 0) {
+        cmd_meminfo(argc, argv);
+    } else if (strcmp(argv[0], "ksm") == 0) {
+        cmd_ksm(argc, argv);
+    } else if (strcmp(argv[0], "swap") == 0) {
+        cmd_swap();
+    } else if (strcmp(argv[0], "rcu") == 0) {
+        cmd_rcu();
+    } else if (strcmp(argv[0], "sync") == 0) {
+        cmd_sync();
+    } else if (strcmp(argv[0], "net") == 0) {
+        cmd_net(argc, argv);
+    } else if (strcmp(argv[0], "irqstat") == 0) {
+        cmd_irqstat();
+    } else if (strcmp(argv[0], "bootstat") == 0) {
+        cmd_bootstat();
     } else if (strcmp(argv[0], "echo") == 0) {
         cmd_echo(argc, argv);
     } else if (strcmp(argv[0], "clear") == 0) {
         cmd_clear();
+    } else if (strcmp(argv[0], "dmesg") == 0) {
+        cmd_dmesg(argc, argv);
+    } else if (strcmp(argv[0], "bench") == 0) {
+        bench_main(argc, argv);
     } else if (strcmp(argv[0], "about") == 0) {
         cmd_about();
-    } else {
+    } else if (!run_program(argc, argv)) {
         printk("Unknown command: %s\n", argv[0]);
         printk("Type 'help' for available commands.\n");
     }
 }
 
+/* ---------------- 管道 ---------------- */
+
+/*
+ * cmd1 | cmd2 | ...: 最后一段在shell自己的线程中运行, 之前的每一段各在一个
+ * 内核线程中运行, 相邻两段之间是一个管道. 段的标准输出(不带级别的printk)
+ * 写入下一个管道, 标准输入从上一个管道读取. 线程退出时关闭它的管道端,
+ * 下游读到EOF; 下游提前结束时上游的写入失败, 输出被丢弃.
+ */
+#define MAX_STAGES 4
+
+typedef struct {
+    int argc;
+    char *argv[MAX_ARGS];
+    process_t *proc;
+    int pid;
+} stage_t;
+
+static stage_t stages[MAX_STAGES];
+static int nr_stages;
+
+static void stage_thread(void) {
+    process_t *self = current_process();
+    for (int i = 0; i < nr_stages; i++) {
+        if (stages[i].proc == self) {
+            run_command(stages[i].argc, stages[i].argv);
+            return;
+        }
+    }
+}
+
+static void execute_pipeline(char *cmd) {
+    /* 按'|'切分并解析各段 */
+    nr_stages = 0;
+    char *seg = cmd;
+    for (;;) {
+        char *bar = seg;
+        while (*bar && *bar != '|') {
+            bar++;
+        }
+        bool last = (*bar == '\0');
+        *bar = '\0';
+
+        if (nr_stages == MAX_STAGES) {
+            printk("Too many pipeline stages (max %d)\n", MAX_STAGES);
+            return;
+        }
+        stage_t *st = &stages[nr_stages++];
+        st->argc = parse_args(seg, st->argv);
+        st->proc = NULL;
+        if (st->argc == 0) {
+            printk("Syntax error near '|'\n");
+            return;
+        }
+        if (last) {
+            break;
+        }
+        seg = bar + 1;
+    }
+
+    /* 为前面各段创建管道和线程 */
+    pipe_t *prev = NULL;
+    for (int i = 0; i < nr_stages - 1; i++) {
+        pipe_t *pipe = pipe_create();
+        char name[PROC_NAME_LEN];
+        strcpy(name, "|");
+        size_t len = strlen(stages[i].argv[0]);
+        if (len > PROC_NAME_LEN - 2) {
+            len = PROC_NAME_LEN - 2;
+        }
+        memcpy(name + 1, stages[i].argv[0], len);
+        name[len + 1] = '\0';
+
+        process_t *proc = pipe ? create_process(name, stage_thread) : NULL;
+        if (!proc) {
+            if (pipe) {
+                pipe_close(pipe, PIPE_READ);
+                pipe_close(pipe, PIPE_WRITE);
+            }
+            if (prev) {
+                pipe_close(prev, PIPE_READ);
+            }
+            prev = NULL;
+            break;
+        }
+        proc->pipe_in = prev;
+        proc->pipe_out = pipe;
+        stages[i].proc = proc;
+        stages[i].pid = proc->pid;
+        prev = pipe;
+    }
+
+    /* 最后一段在shell中运行 */
+    process_t *self = current_process();
+    if (prev) {
+        self->pipe_in = prev;
+        stage_t *st = &stages[nr_stages - 1];
+        run_command(st->argc, st->argv);
+        self->pipe_in = NULL;
+        pipe_close(prev, PIPE_READ);
+    }
+
+    /* 各段的参数指向命令行缓冲区, 等所有线程结束后才能返回 */
+    for (int i = 0; i < nr_stages - 1; i++) {
+        if (stages[i].proc) {
+            process_wait(stages[i].proc, stages[i].pid);
+        }
+    }
+}
+
+/* 执行命令行 */
+static void execute_command(char *cmd) {
+    for (char *p = cmd; *p; p++) {
+        if (*p == '|') {
+            execute_pipeline(cmd);
+            return;
+        }
+    }
+
+    char *argv[MAX_ARGS];
+    int argc = parse_args(cmd, argv);
+    if (argc > 0) {
+        run_command(argc, argv);
+    }
+}
+
 /* Shell主循环 */
 void shell_main(void) {
     char cmd_buf[CMD_BUF_SIZE];
@@ -288,9 +888,12 @@ void shell_main(void) {
     printk("NOS Shell v1.0\n");
     printk("Type 'help' for available commands.\n\n");
 
+    boot_prompt_ready();
     while (1) {
         printk("nos> ");
         readline(cmd_buf, CMD_BUF_SIZE);
+        /* 命令可能用到推迟初始化的子系统 (initramfs中的程序、网卡) */
+        initcalls_wait();
         execute_command(cmd_buf);
     }
 }
@@ -0,0 +1,330 @@
+/* virtio-blk 块设备驱动 */
+#include <kernel/blk.h>
+#include <kernel/virtio.h>
+#include <kernel/irq.h>
+#include <kernel/process.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 请求先进入pending队列, 再由vblk_dispatch按空闲描述符数量发给设备:
+ * 一个virtio请求 = 头部 + 若干数据段 + 状态字节. 队列中扇区相邻、方向相同的
+ * 连续blk请求合并为一个virtio请求, 每个blk请求占一个数据段.
+ * 每批入队只通知设备一次; 完成由中断驱动, 在tasklet中处理并顺带补发pending请求.
+ */
+
+#define VIRTIO_BLK_T_IN  0
+#define VIRTIO_BLK_T_OUT 1
+
+#define VIRTIO_BLK_S_OK  0
+
+#define VIRTIO_BLK_F_RO  5
+
+/* 合并上限 */
+#define VBLK_MAX_SEGS    16
+#define VBLK_MAX_SECTORS 256    /* 128KB */
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} virtio_blk_req_hdr_t;
+
+/* 按头描述符编号索引的在途请求 */
+typedef struct {
+    virtio_blk_req_hdr_t hdr;
+    volatile uint8_t status;
+    blk_request_t *reqs;        /* 合并在一起的blk请求 */
+} vblk_slot_t;
+
+static virtio_dev_t *vblk_dev;
+static virtq_t vblk_vq;
+static vblk_slot_t vblk_slots[VIRTQ_MAX_SIZE];
+static uint64_t vblk_capacity;
+static bool vblk_readonly;
+
+static blk_request_t *pending_head;
+static blk_request_t *pending_tail;
+static int plug_depth;
+static uint32_t nr_inflight;
+
+static blk_stats_t stats;
+static tasklet_t vblk_tasklet;
+
+static void vblk_irq(void *arg);
+static void vblk_complete(void *arg);
+
+void virtio_blk_init(virtio_dev_t *dev) {
+    if (vblk_dev) {
+        return;     /* 只使用第一块磁盘 */
+    }
+
+    uint64_t features;
+    if (virtio_negotiate(dev, 1ULL << VIRTIO_BLK_F_RO, &features) < 0) {
+        return;
+    }
+    if (virtq_init(dev, &vblk_vq, 0) < 0) {
+        virtio_fail(dev);
+        return;
+    }
+
+    vblk_capacity = virtio_config_read64(dev, 0);
+    vblk_readonly = (features & (1ULL << VIRTIO_BLK_F_RO)) != 0;
+
+    tasklet_init(&vblk_tasklet, vblk_complete, NULL);
+    request_irq(dev->irq, vblk_irq, NULL, "virtio-blk");
+    virtio_driver_ok(dev);
+    vblk_dev = dev;
+
+    printk("  virtio-blk: %llu sectors (%llu MB)%s, queue size %u\n",
+           vblk_capacity, vblk_capacity * SECTOR_SIZE / (1024 * 1024),
+           vblk_readonly ? ", read-only" : "", vblk_vq.size);
+}
+
+bool blk_present(void) {
+    return vblk_dev != NULL;
+}
+
+uint64_t blk_capacity(void) {
+    return vblk_capacity;
+}
+
+/* 把pending队列头部能合并的请求组成一个virtio请求发出; 描述符不足时返回false */
+static bool vblk_dispatch_one(void) {
+    blk_request_t *first = pending_head;
+    blk_request_t *last = first;
+    uint32_t nsegs = 1;
+    uint32_t sectors = first->nr_sectors;
+
+    if (vblk_vq.nr_free < 3) {
+        return false;
+    }
+
+    while (last->next && nsegs < VBLK_MAX_SEGS && nsegs + 3 <= vblk_vq.nr_free) {
+        blk_request_t *n = last->next;
+        if (n->write != first->write ||
+            n->sector != last->sector + last->nr_sectors ||
+            sectors + n->nr_sectors > VBLK_MAX_SECTORS) {
+            break;
+        }
+        sectors += n->nr_sectors;
+        nsegs++;
+        last = n;
+    }
+
+    pending_head = last->next;
+    if (!pending_head) {
+        pending_tail = NULL;
+    }
+    last->next = NULL;
+
+    /* 头部 */
+    uint16_t head = virtq_alloc_desc(&vblk_vq);
+    vblk_slot_t *slot = &vblk_slots[head];
+    slot->hdr.type = first->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    slot->hdr.reserved = 0;
+    slot->hdr.sector = first->sector;
+    slot->status = 0xff;
+    slot->reqs = first;
+
+    virtq_desc_t *desc = vblk_vq.desc;
+    desc[head].addr = (uint64_t)&slot->hdr;
+    desc[head].len = sizeof(slot->hdr);
+    desc[head].flags = VIRTQ_DESC_F_NEXT;
+
+    /* 数据段, 每个blk请求一个 */
+    uint16_t prev = head;
+    for (blk_request_t *r = first; r; r = r->next) {
+        uint16_t d = virtq_alloc_desc(&vblk_vq);
+        desc[d].addr = (uint64_t)r->buf;
+        desc[d].len = r->nr_sectors * SECTOR_SIZE;
+        desc[d].flags = VIRTQ_DESC_F_NEXT | (r->write ? 0 : VIRTQ_DESC_F_WRITE);
+        desc[prev].next = d;
+        prev = d;
+    }
+
+    /* 状态 */
+    uint16_t st = virtq_alloc_desc(&vblk_vq);
+    desc[st].addr = (uint64_t)&slot->status;
+    desc[st].len = 1;
+    desc[st].flags = VIRTQ_DESC_F_WRITE;
+    desc[prev].next = st;
+
+    virtq_push(&vblk_vq, head);
+
+    stats.dispatched++;
+    stats.merged += nsegs - 1;
+    if (++nr_inflight > stats.max_inflight) {
+        stats.max_inflight = nr_inflight;
+    }
+    return true;
+}
+
+/* 调用者须已关中断 */
+static void vblk_dispatch(void) {
+    bool queued = false;
+
+    while (pending_head && vblk_dispatch_one()) {
+        queued = true;
+    }
+    if (queued) {
+        virtq_kick(&vblk_vq);
+    }
+}
+
+/* 硬中断只确认设备, 完成处理 (包括end_io回调) 在tasklet中打开中断进行 */
+static void vblk_irq(void *arg) {
+    (void)arg;
+    virtio_irq_ack(vblk_dev);
+    stats.interrupts++;
+    tasklet_schedule(&vblk_tasklet);
+}
+
+/*
+ * 进程上下文中修改队列的代码都关着中断, 下半部不会插在它们中间运行;
+ * 硬中断不碰队列, 所以这里取used环不需要关中断.
+ */
+static void vblk_complete(void *arg) {
+    (void)arg;
+    uint16_t head;
+
+    while (virtq_pop_used(&vblk_vq, &head, NULL)) {
+        vblk_slot_t *slot = &vblk_slots[head];
+        int status = (slot->status == VIRTIO_BLK_S_OK) ? 0 : -1;
+        blk_request_t *r = slot->reqs;
+
+        slot->reqs = NULL;
+        virtq_free_chain(&vblk_vq, head);
+        nr_inflight--;
+
+        while (r) {
+            blk_request_t *next = r->next;
+            r->next = NULL;
+            r->status = status;
+            if (r->write) {
+                stats.sectors_written += r->nr_sectors;
+            } else {
+                stats.sectors_read += r->nr_sectors;
+            }
+            stats.completed++;
+            if (status < 0) {
+                stats.errors++;
+            }
+            __atomic_store_n(&r->done, true, __ATOMIC_RELEASE);
+            if (r->end_io) {
+                r->end_io(r);
+            }
+            r = next;
+        }
+    }
+
+    uint64_t irq = local_irq_save();
+    if (plug_depth == 0) {
+        vblk_dispatch();
+    }
+    local_irq_restore(irq);
+}
+
+int blk_submit(blk_request_t *req) {
+    req->done = false;
+    req->status = 0;
+    req->next = NULL;
+
+    /* 无效请求立即以失败完成, 调用者照常blk_wait不会卡住. vmalloc内存 (含栈) 不能做DMA */
+    if (!vblk_dev || req->nr_sectors == 0 ||
+        req->sector + req->nr_sectors > vblk_capacity ||
+        (req->write && vblk_readonly) || is_vmalloc_addr(req->buf)) {
+        if (vblk_dev) {
+            printk(KERN_ERR "[BLK] Bad request: sector %llu count %u%s\n",
+                   req->sector, req->nr_sectors, req->write ? " (write)" : "");
+        }
+        req->status = -1;
+        req->done = true;
+        return -1;
+    }
+
+    uint64_t irq = local_irq_save();
+    if (pending_tail) {
+        pending_tail->next = req;
+    } else {
+        pending_head = req;
+    }
+    pending_tail = req;
+    stats.submitted++;
+
+    if (plug_depth == 0) {
+        vblk_dispatch();
+    }
+    local_irq_restore(irq);
+    return 0;
+}
+
+void blk_wait(blk_request_t *req) {
+    /* 等待前先把蓄流中的请求发出, 否则可能永远等不到完成 */
+    uint64_t flags = local_irq_save();
+    if (pending_head) {
+        vblk_dispatch();
+    }
+    local_irq_restore(flags);
+
+    while (!__atomic_load_n(&req->done, __ATOMIC_ACQUIRE)) {
+        yield();
+
+        /*
+         * 关中断后再检查, 避免完成中断恰好在检查和wfi之间到来.
+         * 完成留在ksoftirqd时不等中断, 回去yield让它运行.
+         */
+        uint64_t irq = local_irq_save();
+        if (!req->done && !softirq_pending()) {
+            asm volatile("wfi");
+        }
+        local_irq_restore(irq);
+    }
+}
+
+void blk_plug(void) {
+    uint64_t irq = local_irq_save();
+    plug_depth++;
+    local_irq_restore(irq);
+}
+
+void blk_unplug(void) {
+    uint64_t irq = local_irq_save();
+    if (plug_depth > 0 && --plug_depth == 0) {
+        vblk_dispatch();
+    }
+    local_irq_restore(irq);
+}
+
+static int blk_rw(uint64_t sector, void *buf, uint32_t count, bool write) {
+    blk_request_t req = {
+        .sector = sector,
+        .nr_sectors = count,
+        .write = write,
+        .buf = buf,
+    };
+
+    if (blk_submit(&req) < 0) {
+        return -1;
+    }
+    blk_wait(&req);
+    return req.status;
+}
+
+int blk_read(uint64_t sector, void *buf, uint32_t count) {
+    return blk_rw(sector, buf, count, false);
+}
+
+int blk_write(uint64_t sector, const void *buf, uint32_t count) {
+    return blk_rw(sector, (void *)buf, count, true);
+}
+
+void blk_get_stats(blk_stats_t *out) {
+    *out = stats;
+}
+
+void blk_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
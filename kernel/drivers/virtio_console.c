@@ -0,0 +1,201 @@
+/* virtio-console 控制台驱动 */
+#include <kernel/virtio.h>
+#include <kernel/printk.h>
+#include <kernel/klog.h>
+#include <kernel/mm.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 只使用0号端口 (不协商MULTIPORT): 队列0接收, 队列1发送.
+ * 发送: 输出先拷贝进发送页, 页满或一次console_write结束时整页交给设备,
+ * 一次通知发送一整段而不是每字节一次MMIO. 最多VCON_TX_PAGES页同时在途,
+ * 页用完时轮询used环回收.
+ * 接收: 预先放入VCON_RX_BUFS个整页缓冲区, 取完一页后重新放回.
+ * 控制台的使用者都是轮询的, 两个队列都关闭中断.
+ */
+
+#define VCON_RXQ 0
+#define VCON_TXQ 1
+
+#define VCON_TX_PAGES 8
+#define VCON_RX_BUFS  4
+
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 1
+
+static virtio_dev_t *vcon_dev;
+static virtq_t vcon_rxq;
+static virtq_t vcon_txq;
+
+/* 发送页 */
+static uint8_t *tx_pages[VCON_TX_PAGES];
+static bool tx_busy[VCON_TX_PAGES];
+static int8_t tx_owner[VIRTQ_MAX_SIZE];     /* 描述符 -> 发送页 */
+static int tx_cur;
+static uint32_t tx_len;
+static int plug_depth;
+
+/* 接收缓冲区 */
+static uint8_t *rx_pages[VCON_RX_BUFS];
+static int8_t rx_owner[VIRTQ_MAX_SIZE];
+static int rx_cur = -1;                     /* 正在读取的缓冲区 */
+static uint16_t rx_cur_desc;
+static uint32_t rx_pos;
+static uint32_t rx_len;
+
+static vcon_stats_t stats;
+
+/* 回收设备已发送完的页 */
+static void vcon_tx_reclaim(void) {
+    uint16_t head;
+    while (virtq_pop_used(&vcon_txq, &head, NULL)) {
+        tx_busy[tx_owner[head]] = false;
+        virtq_free_chain(&vcon_txq, head);
+    }
+}
+
+/* 把当前发送页交给设备, 并等待下一页可用 */
+static void vcon_tx_submit(void) {
+    if (tx_len == 0) {
+        return;
+    }
+
+    int d = virtq_alloc_desc(&vcon_txq);
+    vcon_txq.desc[d].addr = (uint64_t)tx_pages[tx_cur];
+    vcon_txq.desc[d].len = tx_len;
+    vcon_txq.desc[d].flags = 0;
+    tx_owner[d] = tx_cur;
+    tx_busy[tx_cur] = true;
+    virtq_push(&vcon_txq, d);
+    virtq_kick(&vcon_txq);
+
+    stats.tx_bytes += tx_len;
+    stats.tx_kicks++;
+
+    tx_cur = (tx_cur + 1) % VCON_TX_PAGES;
+    tx_len = 0;
+
+    vcon_tx_reclaim();
+    while (tx_busy[tx_cur]) {
+        stats.tx_stalls++;
+        vcon_tx_reclaim();
+    }
+}
+
+static inline void vcon_tx_byte(char c) {
+    tx_pages[tx_cur][tx_len++] = c;
+    if (tx_len == PAGE_SIZE) {
+        vcon_tx_submit();
+    }
+}
+
+void vcon_write(const char *s, size_t len) {
+    uint64_t irq = local_irq_save();
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\n') {
+            vcon_tx_byte('\r');
+        }
+        vcon_tx_byte(s[i]);
+    }
+    if (plug_depth == 0) {
+        vcon_tx_submit();
+    }
+    local_irq_restore(irq);
+}
+
+void vcon_plug(void) {
+    plug_depth++;
+}
+
+void vcon_unplug(void) {
+    if (--plug_depth == 0) {
+        uint64_t irq = local_irq_save();
+        vcon_tx_submit();
+        local_irq_restore(irq);
+    }
+}
+
+static void vcon_rx_post(uint16_t d) {
+    virtq_push(&vcon_rxq, d);
+    virtq_kick(&vcon_rxq);
+}
+
+int vcon_getc(void) {
+    for (;;) {
+        if (rx_cur >= 0 && rx_pos < rx_len) {
+            stats.rx_bytes++;
+            return rx_pages[rx_cur][rx_pos++];
+        }
+
+        /* 当前缓冲区读完, 放回设备 */
+        if (rx_cur >= 0) {
+            vcon_rx_post(rx_cur_desc);
+            rx_cur = -1;
+        }
+
+        uint16_t head;
+        uint32_t len;
+        if (!virtq_pop_used(&vcon_rxq, &head, &len)) {
+            return -1;
+        }
+        rx_cur = rx_owner[head];
+        rx_cur_desc = head;
+        rx_pos = 0;
+        rx_len = len;
+    }
+}
+
+bool vcon_present(void) {
+    return vcon_dev != NULL;
+}
+
+void vcon_get_stats(vcon_stats_t *out) {
+    *out = stats;
+}
+
+void virtio_console_init(virtio_dev_t *dev) {
+    if (vcon_dev) {
+        return;
+    }
+
+    if (virtio_negotiate(dev, 0, NULL) < 0) {
+        return;
+    }
+    if (virtq_init(dev, &vcon_rxq, VCON_RXQ) < 0 ||
+        virtq_init(dev, &vcon_txq, VCON_TXQ) < 0) {
+        virtio_fail(dev);
+        return;
+    }
+    vcon_rxq.avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+    vcon_txq.avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+
+    for (int i = 0; i < VCON_TX_PAGES; i++) {
+        if (!(tx_pages[i] = alloc_page_tag(PG_DRIVER))) {
+            printk(KERN_ERR "[VCON] Out of memory\n");
+            virtio_fail(dev);
+            return;
+        }
+    }
+    for (int i = 0; i < VCON_RX_BUFS; i++) {
+        if (!(rx_pages[i] = alloc_page_tag(PG_DRIVER))) {
+            printk(KERN_ERR "[VCON] Out of memory\n");
+            virtio_fail(dev);
+            return;
+        }
+        int d = virtq_alloc_desc(&vcon_rxq);
+        vcon_rxq.desc[d].addr = (uint64_t)rx_pages[i];
+        vcon_rxq.desc[d].len = PAGE_SIZE;
+        vcon_rxq.desc[d].flags = VIRTQ_DESC_F_WRITE;
+        rx_owner[d] = i;
+        virtq_push(&vcon_rxq, d);
+    }
+
+    virtio_driver_ok(dev);
+    virtq_kick(&vcon_rxq);
+
+    /* 这条消息还经UART输出, 之后的控制台输出都走virtio-console */
+    printk("  virtio-console: %d x 4KB TX, %d x 4KB RX, taking over the console\n",
+           VCON_TX_PAGES, VCON_RX_BUFS);
+    klog_console_flush();
+    vcon_dev = dev;
+}
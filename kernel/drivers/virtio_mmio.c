@@ -0,0 +1,259 @@
+/* virtio-mmio 传输层和split virtqueue */
+#include <kernel/virtio.h>
+#include <kernel/plic.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <kernel/init.h>
+#include <arch/riscv/riscv.h>
+
+static virtio_dev_t virtio_devs[VIRTIO_MMIO_SLOTS];
+static int nr_virtio_devs = 0;
+
+static inline uint32_t mmio_read(virtio_dev_t *dev, uint32_t reg) {
+    return *(volatile uint32_t *)(dev->base + reg);
+}
+
+static inline void mmio_write(virtio_dev_t *dev, uint32_t reg, uint32_t val) {
+    *(volatile uint32_t *)(dev->base + reg) = val;
+}
+
+static const char *virtio_name(uint32_t id) {
+    switch (id) {
+        case VIRTIO_ID_NET:     return "net";
+        case VIRTIO_ID_BLOCK:   return "block";
+        case VIRTIO_ID_CONSOLE: return "console";
+        default:                return "unknown";
+    }
+}
+
+void virtio_init(void) {
+    for (int i = 0; i < VIRTIO_MMIO_SLOTS; i++) {
+        virtio_dev_t probe = {
+            .base = VIRTIO_MMIO_BASE + i * VIRTIO_MMIO_STRIDE,
+            .irq = VIRTIO0_IRQ + i,
+        };
+
+        if (mmio_read(&probe, VIRTIO_MMIO_MAGIC_VALUE) != VIRTIO_MAGIC) {
+            continue;
+        }
+        probe.version = mmio_read(&probe, VIRTIO_MMIO_VERSION);
+        probe.device_id = mmio_read(&probe, VIRTIO_MMIO_DEVICE_ID);
+
+        /* 设备ID为0表示空槽位 */
+        if (probe.device_id == 0 || (probe.version != 1 && probe.version != 2)) {
+            continue;
+        }
+
+        printk("  virtio%d: %s device at 0x%llx (irq %d, %s)\n",
+               nr_virtio_devs, virtio_name(probe.device_id), probe.base,
+               probe.irq, probe.version == 1 ? "legacy" : "modern");
+        virtio_devs[nr_virtio_devs++] = probe;
+    }
+
+    if (nr_virtio_devs == 0) {
+        printk("  No virtio devices found\n");
+        return;
+    }
+
+    for (int i = 0; i < nr_virtio_devs; i++) {
+        if (virtio_devs[i].device_id == VIRTIO_ID_BLOCK) {
+            virtio_blk_init(&virtio_devs[i]);
+        } else if (virtio_devs[i].device_id == VIRTIO_ID_CONSOLE) {
+            virtio_console_init(&virtio_devs[i]);
+        }
+    }
+}
+
+/* 网卡 (页池、接收缓冲区和协议栈) 不影响shell可用, 由kinit线程初始化 */
+static void virtio_net_probe(void) {
+    for (int i = 0; i < nr_virtio_devs; i++) {
+        if (virtio_devs[i].device_id == VIRTIO_ID_NET) {
+            virtio_net_init(&virtio_devs[i]);
+        }
+    }
+}
+deferred_initcall(virtio_net_probe);
+
+int virtio_negotiate(virtio_dev_t *dev, uint64_t features, uint64_t *accepted) {
+    /* 复位 */
+    mmio_write(dev, VIRTIO_MMIO_STATUS, 0);
+
+    uint32_t status = VIRTIO_STATUS_ACKNOWLEDGE;
+    mmio_write(dev, VIRTIO_MMIO_STATUS, status);
+    status |= VIRTIO_STATUS_DRIVER;
+    mmio_write(dev, VIRTIO_MMIO_STATUS, status);
+
+    /* modern设备必须接受VERSION_1 */
+    if (dev->version == 2) {
+        features |= 1ULL << VIRTIO_F_VERSION_1;
+    }
+
+    mmio_write(dev, VIRTIO_MMIO_DEVICE_FEATURES_SEL, 0);
+    uint64_t offered = mmio_read(dev, VIRTIO_MMIO_DEVICE_FEATURES);
+    mmio_write(dev, VIRTIO_MMIO_DEVICE_FEATURES_SEL, 1);
+    offered |= (uint64_t)mmio_read(dev, VIRTIO_MMIO_DEVICE_FEATURES) << 32;
+
+    features &= offered;
+    mmio_write(dev, VIRTIO_MMIO_DRIVER_FEATURES_SEL, 0);
+    mmio_write(dev, VIRTIO_MMIO_DRIVER_FEATURES, (uint32_t)features);
+    mmio_write(dev, VIRTIO_MMIO_DRIVER_FEATURES_SEL, 1);
+    mmio_write(dev, VIRTIO_MMIO_DRIVER_FEATURES, (uint32_t)(features >> 32));
+
+    if (dev->version == 2) {
+        status |= VIRTIO_STATUS_FEATURES_OK;
+        mmio_write(dev, VIRTIO_MMIO_STATUS, status);
+        if (!(mmio_read(dev, VIRTIO_MMIO_STATUS) & VIRTIO_STATUS_FEATURES_OK)) {
+            printk(KERN_ERR "[VIRTIO] Device at 0x%llx rejected features\n", dev->base);
+            virtio_fail(dev);
+            return -1;
+        }
+    } else {
+        mmio_write(dev, VIRTIO_MMIO_GUEST_PAGE_SIZE, PAGE_SIZE);
+    }
+
+    if (accepted) {
+        *accepted = features;
+    }
+    return 0;
+}
+
+int virtq_init(virtio_dev_t *dev, virtq_t *vq, uint16_t index) {
+    mmio_write(dev, VIRTIO_MMIO_QUEUE_SEL, index);
+
+    uint32_t max = mmio_read(dev, VIRTIO_MMIO_QUEUE_NUM_MAX);
+    if (max == 0) {
+        printk(KERN_ERR "[VIRTIO] Queue %u not available\n", index);
+        return -1;
+    }
+    uint16_t size = (max < VIRTQ_MAX_SIZE) ? max : VIRTQ_MAX_SIZE;
+
+    /* legacy要求三部分连续且used环按页对齐, modern也沿用同一布局 */
+    uint8_t *mem = alloc_pages_tag(VIRTQ_RING_PAGES, PG_DRIVER);
+    if (!mem) {
+        printk(KERN_ERR "[VIRTIO] Out of memory for queue %u\n", index);
+        return -1;
+    }
+
+    vq->dev = dev;
+    vq->index = index;
+    vq->size = size;
+    vq->ring_mem = mem;
+    vq->desc = (virtq_desc_t *)mem;
+    vq->avail = (virtq_avail_t *)(mem + size * sizeof(virtq_desc_t));
+    vq->used = (virtq_used_t *)(mem + PAGE_SIZE);
+    vq->last_used = 0;
+    vq->avail_idx = 0;
+
+    /* 所有描述符串成空闲链表 */
+    for (uint16_t i = 0; i < size; i++) {
+        vq->desc[i].next = i + 1;
+    }
+    vq->free_head = 0;
+    vq->nr_free = size;
+
+    mmio_write(dev, VIRTIO_MMIO_QUEUE_NUM, size);
+
+    if (dev->version == 1) {
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_ALIGN, PAGE_SIZE);
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_PFN, (uint64_t)mem / PAGE_SIZE);
+    } else {
+        uint64_t desc = (uint64_t)vq->desc;
+        uint64_t avail = (uint64_t)vq->avail;
+        uint64_t used = (uint64_t)vq->used;
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DESC_LOW, (uint32_t)desc);
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DESC_HIGH, (uint32_t)(desc >> 32));
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DRIVER_LOW, (uint32_t)avail);
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DRIVER_HIGH, (uint32_t)(avail >> 32));
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DEVICE_LOW, (uint32_t)used);
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_DEVICE_HIGH, (uint32_t)(used >> 32));
+        mmio_write(dev, VIRTIO_MMIO_QUEUE_READY, 1);
+    }
+
+    return 0;
+}
+
+void virtio_driver_ok(virtio_dev_t *dev) {
+    uint32_t status = mmio_read(dev, VIRTIO_MMIO_STATUS);
+    mmio_write(dev, VIRTIO_MMIO_STATUS, status | VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(virtio_dev_t *dev) {
+    uint32_t status = mmio_read(dev, VIRTIO_MMIO_STATUS);
+    mmio_write(dev, VIRTIO_MMIO_STATUS, status | VIRTIO_STATUS_FAILED);
+}
+
+uint8_t virtio_config_read8(virtio_dev_t *dev, uint32_t offset) {
+    return *(volatile uint8_t *)(dev->base + VIRTIO_MMIO_CONFIG + offset);
+}
+
+uint32_t virtio_config_read32(virtio_dev_t *dev, uint32_t offset) {
+    return mmio_read(dev, VIRTIO_MMIO_CONFIG + offset);
+}
+
+uint64_t virtio_config_read64(virtio_dev_t *dev, uint32_t offset) {
+    uint64_t lo = virtio_config_read32(dev, offset);
+    uint64_t hi = virtio_config_read32(dev, offset + 4);
+    return lo | (hi << 32);
+}
+
+uint32_t virtio_irq_ack(virtio_dev_t *dev) {
+    uint32_t status = mmio_read(dev, VIRTIO_MMIO_INTERRUPT_STATUS);
+    mmio_write(dev, VIRTIO_MMIO_INTERRUPT_ACK, status);
+    return status;
+}
+
+int virtq_alloc_desc(virtq_t *vq) {
+    if (vq->nr_free == 0) {
+        return -1;
+    }
+    uint16_t id = vq->free_head;
+    vq->free_head = vq->desc[id].next;
+    vq->nr_free--;
+    return id;
+}
+
+void virtq_free_chain(virtq_t *vq, uint16_t head) {
+    uint16_t id = head;
+    for (;;) {
+        uint16_t flags = vq->desc[id].flags;
+        uint16_t next = vq->desc[id].next;
+
+        vq->desc[id].next = vq->free_head;
+        vq->free_head = id;
+        vq->nr_free++;
+
+        if (!(flags & VIRTQ_DESC_F_NEXT)) {
+            break;
+        }
+        id = next;
+    }
+}
+
+void virtq_push(virtq_t *vq, uint16_t head) {
+    vq->avail->ring[vq->avail_idx % vq->size] = head;
+    vq->avail_idx++;
+}
+
+void virtq_kick(virtq_t *vq) {
+    /* 描述符和环内容必须先于idx对设备可见, idx必须先于通知 */
+    mb();
+    vq->avail->idx = vq->avail_idx;
+    mb();
+    mmio_write(vq->dev, VIRTIO_MMIO_QUEUE_NOTIFY, vq->index);
+}
+
+bool virtq_pop_used(virtq_t *vq, uint16_t *head, uint32_t *len) {
+    if (vq->last_used == *(volatile uint16_t *)&vq->used->idx) {
+        return false;
+    }
+    mb();
+
+    virtq_used_elem_t *e = &vq->used->ring[vq->last_used % vq->size];
+    *head = e->id;
+    if (len) {
+        *len = e->len;
+    }
+    vq->last_used++;
+    return true;
+}
@@ -0,0 +1,269 @@
+/* virtio-net 网卡驱动 */
+#include <kernel/net.h>
+#include <kernel/virtio.h>
+#include <kernel/irq.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 接收: 启动时从页池取页预先放入接收队列, 设备把virtio-net头部和帧写进同一页.
+ * 收到的页直接交给协议栈, 接收队列从页池补充新页.
+ * 发送: 每个帧两个描述符, 一个指向共享的全0头部, 一个直接指向调用者的帧, 不拷贝.
+ *
+ * 中断缓解 (NAPI): 接收中断只关闭接收中断并触发SOFTIRQ_NET_RX, 软中断每次最多
+ * 处理VNET_BUDGET个帧; 一批用完预算说明负载高, 保持中断关闭并再次触发软中断,
+ * 接收队列取空后才重新打开中断. 软中断超过轮数或时间上限时由ksoftirqd继续轮询.
+ * 发送完成不产生中断, 在发送和轮询时顺带回收.
+ *
+ * 协议栈在软中断中运行; 进程上下文调用netdev_*前须local_bh_disable.
+ */
+
+#define VNET_RXQ 0
+#define VNET_TXQ 1
+
+#define VIRTIO_NET_F_MAC 5
+
+#define VNET_POOL_PAGES 256     /* 1MB */
+#define VNET_RX_BUFS    64
+#define VNET_BUDGET     64
+
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 1
+
+/* 没有协商MRG_RXBUF: legacy头部10字节, modern (VERSION_1) 多一个num_buffers为12字节 */
+typedef struct {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+    uint16_t num_buffers;
+} virtio_net_hdr_t;
+
+static virtio_dev_t *vnet_dev;
+static virtq_t vnet_rxq;
+static virtq_t vnet_txq;
+static uint32_t vnet_hdr_len;
+static uint8_t vnet_mac_addr[ETH_ALEN];
+
+static virtio_net_hdr_t vnet_tx_hdr;        /* 所有发送共用, 设备只读 */
+static void *tx_frames[VIRTQ_MAX_SIZE];     /* 头描述符 -> 帧 */
+static void *rx_pages[VIRTQ_MAX_SIZE];      /* 描述符 -> 接收页 */
+
+/* 页池 */
+static void *pool[VNET_POOL_PAGES];
+static int pool_free;
+
+static netdev_stats_t stats;
+
+/* ---------------- 页池 ---------------- */
+
+static void *pool_get(void) {
+    return pool_free ? pool[--pool_free] : NULL;
+}
+
+static void pool_put(void *page) {
+    pool[pool_free++] = page;
+}
+
+void *netdev_alloc_frame(void) {
+    return pool_get();
+}
+
+void netdev_free_frame(void *frame) {
+    pool_put((void *)PAGE_ALIGN_DOWN((uint64_t)frame));
+}
+
+/* ---------------- 发送 ---------------- */
+
+static void vnet_tx_reclaim(void) {
+    uint16_t head;
+    while (virtq_pop_used(&vnet_txq, &head, NULL)) {
+        netdev_free_frame(tx_frames[head]);
+        tx_frames[head] = NULL;
+        virtq_free_chain(&vnet_txq, head);
+    }
+}
+
+int netdev_xmit(void *frame, size_t len) {
+    if (!vnet_dev || len > ETH_FRAME_MAX) {
+        return -1;
+    }
+
+    if (vnet_txq.nr_free < 2) {
+        vnet_tx_reclaim();
+        if (vnet_txq.nr_free < 2) {
+            stats.tx_dropped++;
+            return -1;
+        }
+    }
+
+    uint16_t h = virtq_alloc_desc(&vnet_txq);
+    uint16_t d = virtq_alloc_desc(&vnet_txq);
+    virtq_desc_t *desc = vnet_txq.desc;
+    desc[h].addr = (uint64_t)&vnet_tx_hdr;
+    desc[h].len = vnet_hdr_len;
+    desc[h].flags = VIRTQ_DESC_F_NEXT;
+    desc[h].next = d;
+    desc[d].addr = (uint64_t)frame;
+    desc[d].len = len;
+    desc[d].flags = 0;
+    tx_frames[h] = frame;
+
+    virtq_push(&vnet_txq, h);
+    virtq_kick(&vnet_txq);
+
+    stats.tx_packets++;
+    stats.tx_bytes += len;
+    return 0;
+}
+
+/* ---------------- 接收 ---------------- */
+
+/* 补满接收队列, 返回放入的缓冲区数 */
+static int vnet_rx_refill(void) {
+    int n = 0;
+    while (vnet_rxq.nr_free > 0 && vnet_rxq.size - vnet_rxq.nr_free < VNET_RX_BUFS) {
+        void *page = pool_get();
+        if (!page) {
+            break;
+        }
+        uint16_t d = virtq_alloc_desc(&vnet_rxq);
+        vnet_rxq.desc[d].addr = (uint64_t)page;
+        vnet_rxq.desc[d].len = PAGE_SIZE;
+        vnet_rxq.desc[d].flags = VIRTQ_DESC_F_WRITE;
+        rx_pages[d] = page;
+        virtq_push(&vnet_rxq, d);
+        n++;
+    }
+    return n;
+}
+
+/* 处理至多budget个收到的帧, 返回处理的个数 */
+static int vnet_poll(int budget) {
+    int done = 0;
+    uint16_t head;
+    uint32_t len;
+
+    while (done < budget && virtq_pop_used(&vnet_rxq, &head, &len)) {
+        uint8_t *page = rx_pages[head];
+        rx_pages[head] = NULL;
+        virtq_free_chain(&vnet_rxq, head);
+        done++;
+
+        if (len <= vnet_hdr_len) {
+            pool_put(page);
+            stats.rx_dropped++;
+            continue;
+        }
+        len -= vnet_hdr_len;
+        stats.rx_packets++;
+        stats.rx_bytes += len;
+        net_rx(page + vnet_hdr_len, len);
+    }
+
+    vnet_tx_reclaim();
+    if (vnet_rx_refill() > 0) {
+        virtq_kick(&vnet_rxq);
+    }
+    return done;
+}
+
+static bool vnet_rx_pending(void) {
+    return vnet_rxq.last_used != *(volatile uint16_t *)&vnet_rxq.used->idx;
+}
+
+/* 接收中断: 关闭后续中断, 交给软中断轮询 */
+static void vnet_irq(void *arg) {
+    (void)arg;
+    virtio_irq_ack(vnet_dev);
+    stats.interrupts++;
+    vnet_rxq.avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+    raise_softirq(SOFTIRQ_NET_RX);
+}
+
+static void vnet_rx_action(void) {
+    stats.polls++;
+    if (vnet_poll(VNET_BUDGET) == VNET_BUDGET) {
+        stats.budget_exhausted++;
+        raise_softirq(SOFTIRQ_NET_RX);
+        return;
+    }
+
+    /* 取空了: 打开中断后再检查一次, 避免漏掉中间到达的帧 */
+    vnet_rxq.avail->flags = 0;
+    mb();
+    if (vnet_rx_pending()) {
+        vnet_rxq.avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+        raise_softirq(SOFTIRQ_NET_RX);
+    }
+}
+
+/* ---------------- 初始化 ---------------- */
+
+bool netdev_present(void) {
+    return vnet_dev != NULL;
+}
+
+const uint8_t *netdev_mac(void) {
+    return vnet_mac_addr;
+}
+
+void netdev_get_stats(netdev_stats_t *out) {
+    *out = stats;
+    out->pool_free = pool_free;
+    out->pool_total = VNET_POOL_PAGES;
+}
+
+void virtio_net_init(virtio_dev_t *dev) {
+    if (vnet_dev) {
+        return;
+    }
+
+    uint64_t features;
+    if (virtio_negotiate(dev, 1ULL << VIRTIO_NET_F_MAC, &features) < 0) {
+        return;
+    }
+    if (virtq_init(dev, &vnet_rxq, VNET_RXQ) < 0 ||
+        virtq_init(dev, &vnet_txq, VNET_TXQ) < 0) {
+        virtio_fail(dev);
+        return;
+    }
+    vnet_txq.avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+    vnet_hdr_len = (dev->version == 2) ? sizeof(virtio_net_hdr_t) : 10;
+
+    if (features & (1ULL << VIRTIO_NET_F_MAC)) {
+        for (int i = 0; i < ETH_ALEN; i++) {
+            vnet_mac_addr[i] = virtio_config_read8(dev, i);
+        }
+    } else {
+        /* 本地管理的单播地址 */
+        static const uint8_t def[ETH_ALEN] = { 0x52, 0x54, 0x00, 0x12, 0x34, 0x56 };
+        memcpy(vnet_mac_addr, def, ETH_ALEN);
+    }
+
+    uint8_t *mem = alloc_pages_tag(VNET_POOL_PAGES, PG_DRIVER);
+    if (!mem) {
+        printk(KERN_ERR "[NET] Out of memory for page pool\n");
+        virtio_fail(dev);
+        return;
+    }
+    for (int i = VNET_POOL_PAGES - 1; i >= 0; i--) {
+        pool_put(mem + i * PAGE_SIZE);
+    }
+
+    vnet_dev = dev;
+    vnet_rx_refill();
+    open_softirq(SOFTIRQ_NET_RX, vnet_rx_action, "NET_RX");
+    request_irq(dev->irq, vnet_irq, NULL, "virtio-net");
+    virtio_driver_ok(dev);
+    virtq_kick(&vnet_rxq);
+
+    const uint8_t *m = vnet_mac_addr;
+    printk("  virtio-net: mac %02x:%02x:%02x:%02x:%02x:%02x, %d RX buffers, %d-page pool\n",
+           m[0], m[1], m[2], m[3], m[4], m[5], VNET_RX_BUFS, VNET_POOL_PAGES);
+
+    net_init();
+}
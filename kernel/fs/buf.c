@@ -0,0 +1,450 @@
+/* 块缓存 - 位于文件系统和块设备之间 */
+#include <kernel/buf.h>
+#include <kernel/mm.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 缓冲区头静态分配, 数据页在第一次使用时分配. 有身份的缓冲区同时在哈希表和
+ * LRU链表中; 需要新缓冲区而已达上限(或内存不足)时, 从LRU尾部淘汰第一个
+ * 未被引用、干净且不在I/O中的缓冲区.
+ *
+ * 读: 连续访问相邻块时触发预读, 预读窗口从RA_MIN_BLOCKS开始加倍到RA_MAX_BLOCKS,
+ *     访问到窗口后半段时异步发出下一个窗口, 预读请求在蓄流中提交以便合并.
+ * 写: bdirty只做标记, bflushd线程定期把过期的脏块按块号排序后批量写回,
+ *     相邻块在块层合并成大请求.
+ *
+ * 线程间是协作式调度, 只有I/O完成回调在中断上下文中修改flags.
+ */
+
+#define BUF_HASH_SIZE 1024
+
+#define RA_MIN_BLOCKS 4
+#define RA_MAX_BLOCKS 32
+
+#define FLUSH_BATCH        64
+#define FLUSH_INTERVAL     (TIMEBASE_FREQ / 2)  /* bflushd每0.5秒检查一次 */
+#define DIRTY_EXPIRE       TIMEBASE_FREQ        /* 脏了1秒以上的块写回 */
+#define DIRTY_HIGH_WATER   (NR_BUFFERS / 4)     /* 超过时不论新旧全部写回 */
+
+static buf_t buffers[NR_BUFFERS];
+static int nr_buffers;
+static buf_t *buf_hash[BUF_HASH_SIZE];
+static buf_t *lru_head;
+static buf_t *lru_tail;
+static uint64_t nr_dirty;
+
+/* 预读状态 */
+static uint64_t ra_last = (uint64_t)-1;   /* 上次访问的块 */
+static uint64_t ra_next;                  /* 已预读到的位置 (不含) */
+static uint32_t ra_window = RA_MIN_BLOCKS;
+
+static bcache_stats_t stats;
+
+static inline uint32_t buf_hashfn(uint32_t dev, uint64_t blockno) {
+    return (uint32_t)((blockno ^ ((uint64_t)dev << 20)) * 0x9e3779b1U) % BUF_HASH_SIZE;
+}
+
+static inline void buf_set(buf_t *b, uint32_t f) {
+    __atomic_fetch_or(&b->flags, f, __ATOMIC_ACQ_REL);
+}
+
+static inline void buf_clear(buf_t *b, uint32_t f) {
+    __atomic_fetch_and(&b->flags, ~f, __ATOMIC_ACQ_REL);
+}
+
+static inline uint32_t buf_flags(buf_t *b) {
+    return __atomic_load_n(&b->flags, __ATOMIC_ACQUIRE);
+}
+
+/* ---------------- LRU和哈希表 ---------------- */
+
+static void lru_remove(buf_t *b) {
+    if (b->lru_prev) {
+        b->lru_prev->lru_next = b->lru_next;
+    } else {
+        lru_head = b->lru_next;
+    }
+    if (b->lru_next) {
+        b->lru_next->lru_prev = b->lru_prev;
+    } else {
+        lru_tail = b->lru_prev;
+    }
+    b->lru_prev = b->lru_next = NULL;
+}
+
+static void lru_push_front(buf_t *b) {
+    b->lru_prev = NULL;
+    b->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = b;
+    } else {
+        lru_tail = b;
+    }
+    lru_head = b;
+}
+
+static void hash_remove(buf_t *b) {
+    buf_t **pp = &buf_hash[buf_hashfn(b->dev, b->blockno)];
+    while (*pp && *pp != b) {
+        pp = &(*pp)->hash_next;
+    }
+    if (*pp) {
+        *pp = b->hash_next;
+    }
+    b->hash_next = NULL;
+}
+
+static buf_t *hash_lookup(uint32_t dev, uint64_t blockno) {
+    buf_t *b = buf_hash[buf_hashfn(dev, blockno)];
+    while (b && (b->dev != dev || b->blockno != blockno)) {
+        b = b->hash_next;
+    }
+    return b;
+}
+
+/* ---------------- I/O ---------------- */
+
+static void buf_end_io(blk_request_t *req) {
+    buf_t *b = req->private;
+
+    if (req->status < 0) {
+        buf_set(b, B_ERROR);
+    } else if (!req->write) {
+        buf_set(b, B_VALID);
+    }
+    buf_clear(b, B_IO);
+}
+
+static void buf_submit(buf_t *b, bool write) {
+    blk_request_t *req = &b->req;
+
+    memset(req, 0, sizeof(*req));
+    req->sector = b->blockno * BLOCK_SECTORS;
+    req->nr_sectors = BLOCK_SECTORS;
+    req->write = write;
+    req->buf = b->data;
+    req->end_io = buf_end_io;
+    req->private = b;
+
+    buf_clear(b, B_ERROR);
+    buf_set(b, B_IO);
+    if (blk_submit(req) < 0) {
+        /* 提交失败不会调用end_io */
+        buf_set(b, B_ERROR);
+        buf_clear(b, B_IO);
+    }
+}
+
+static void buf_wait(buf_t *b) {
+    if (buf_flags(b) & B_IO) {
+        blk_wait(&b->req);
+    }
+}
+
+static void buf_mark_clean(buf_t *b) {
+    if (buf_flags(b) & B_DIRTY) {
+        buf_clear(b, B_DIRTY);
+        nr_dirty--;
+    }
+}
+
+int bwrite_batch(buf_t **bufs, int n) {
+    int errors = 0;
+
+    for (int i = 1; i < n; i++) {
+        buf_t *b = bufs[i];
+        int j = i - 1;
+        while (j >= 0 && bufs[j]->blockno > b->blockno) {
+            bufs[j + 1] = bufs[j];
+            j--;
+        }
+        bufs[j + 1] = b;
+    }
+
+    for (int i = 0; i < n; i++) {
+        buf_wait(bufs[i]);
+    }
+
+    blk_plug();
+    for (int i = 0; i < n; i++) {
+        buf_mark_clean(bufs[i]);
+        buf_submit(bufs[i], true);
+    }
+    blk_unplug();
+
+    for (int i = 0; i < n; i++) {
+        buf_wait(bufs[i]);
+        if (buf_flags(bufs[i]) & B_ERROR) {
+            printk(KERN_ERR "[BCACHE] Write error on block %llu\n", bufs[i]->blockno);
+            errors++;
+        }
+    }
+
+    stats.writebacks += n;
+    stats.flushes++;
+    return errors;
+}
+
+/*
+ * 写回脏块: expire非0时只写回脏了超过expire个tick的块.
+ * 每批最多FLUSH_BATCH个, 直到没有符合条件的脏块.
+ * 未提交事务中的块 (B_JOURNAL) 由日志提交时写回原位, 这里跳过.
+ */
+static void bflush(uint64_t expire) {
+    buf_t *batch[FLUSH_BATCH];     /* bflushd和bsync可能同时在写回 */
+
+    for (;;) {
+        uint64_t now = rdtime();
+        int n = 0;
+
+        for (int i = 0; i < nr_buffers && n < FLUSH_BATCH; i++) {
+            buf_t *b = &buffers[i];
+            uint32_t f = buf_flags(b);
+            if (!(f & B_DIRTY) || (f & (B_IO | B_JOURNAL))) {
+                continue;
+            }
+            if (expire && now - b->dirty_time < expire) {
+                continue;
+            }
+            b->refcnt++;    /* 写回期间防止被淘汰 */
+            batch[n++] = b;
+        }
+
+        if (n == 0) {
+            return;
+        }
+        bwrite_batch(batch, n);
+        for (int i = 0; i < n; i++) {
+            batch[i]->refcnt--;
+        }
+    }
+}
+
+/* ---------------- 缓冲区分配 ---------------- */
+
+static buf_t *buf_evict(void) {
+    for (buf_t *b = lru_tail; b; b = b->lru_prev) {
+        if (b->refcnt == 0 && !(buf_flags(b) & (B_DIRTY | B_IO | B_JOURNAL))) {
+            if (buf_flags(b) & B_READAHEAD) {
+                /* 预读了却没用上, 窗口太大 */
+                ra_window = RA_MIN_BLOCKS;
+            }
+            hash_remove(b);
+            lru_remove(b);
+            stats.evictions++;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static buf_t *buf_alloc(void) {
+    if (nr_buffers < NR_BUFFERS) {
+        uint8_t *data = alloc_page_tag(PG_BUFCACHE);
+        if (data) {
+            buf_t *b = &buffers[nr_buffers++];
+            b->data = data;
+            return b;
+        }
+    }
+
+    buf_t *b = buf_evict();
+    if (!b && nr_dirty > 0) {
+        /* 全是脏块: 同步写回后再试 */
+        bflush(0);
+        b = buf_evict();
+    }
+    if (!b) {
+        printk(KERN_ERR "[BCACHE] No free buffers\n");
+    }
+    return b;
+}
+
+/* 找到或创建缓冲区并增加引用, 不读盘 */
+static buf_t *getblk(uint32_t dev, uint64_t blockno) {
+    buf_t *b = hash_lookup(dev, blockno);
+    if (b) {
+        b->refcnt++;
+        lru_remove(b);
+        lru_push_front(b);
+        return b;
+    }
+
+    b = buf_alloc();
+    if (!b) {
+        return NULL;
+    }
+    b->dev = dev;
+    b->blockno = blockno;
+    b->flags = 0;
+    b->refcnt = 1;
+
+    uint32_t h = buf_hashfn(dev, blockno);
+    b->hash_next = buf_hash[h];
+    buf_hash[h] = b;
+    lru_push_front(b);
+    return b;
+}
+
+/* ---------------- 预读 ---------------- */
+
+static void readahead(uint32_t dev, uint64_t blockno) {
+    uint64_t nblocks = blk_capacity() / BLOCK_SECTORS;
+
+    if (blockno != ra_last + 1) {
+        /* 非顺序访问: 重置 */
+        ra_last = blockno;
+        ra_next = blockno + 1;
+        ra_window = RA_MIN_BLOCKS;
+        return;
+    }
+    ra_last = blockno;
+
+    /* 访问进入已预读窗口的后半段时才发出下一个窗口 */
+    if (ra_next > blockno + ra_window / 2) {
+        return;
+    }
+    if (ra_next <= blockno) {
+        ra_next = blockno + 1;
+    }
+
+    uint64_t end = ra_next + ra_window;
+    if (end > nblocks) {
+        end = nblocks;
+    }
+
+    blk_plug();
+    for (uint64_t blk = ra_next; blk < end; blk++) {
+        buf_t *b = getblk(dev, blk);
+        if (!b) {
+            break;
+        }
+        if (!(buf_flags(b) & (B_VALID | B_IO))) {
+            buf_set(b, B_READAHEAD);
+            buf_submit(b, false);
+            stats.readahead++;
+        }
+        b->refcnt--;
+    }
+    blk_unplug();
+
+    ra_next = end;
+    if (ra_window < RA_MAX_BLOCKS) {
+        ra_window *= 2;
+    }
+}
+
+/* ---------------- 接口 ---------------- */
+
+buf_t *bget(uint32_t dev, uint64_t blockno) {
+    buf_t *b = getblk(dev, blockno);
+    if (b) {
+        buf_wait(b);
+        buf_set(b, B_VALID);
+        buf_clear(b, B_READAHEAD | B_ERROR);
+    }
+    return b;
+}
+
+buf_t *bread(uint32_t dev, uint64_t blockno) {
+    stats.lookups++;
+
+    buf_t *b = getblk(dev, blockno);
+    if (!b) {
+        return NULL;
+    }
+
+    uint32_t f = buf_flags(b);
+    if (f & (B_VALID | B_IO)) {
+        stats.hits++;
+        if (f & B_READAHEAD) {
+            stats.readahead_hits++;
+            buf_clear(b, B_READAHEAD);
+        }
+    } else {
+        stats.misses++;
+        buf_submit(b, false);
+    }
+
+    /* 先发出预读再等待本块, 让两者在设备中重叠 */
+    readahead(dev, blockno);
+    buf_wait(b);
+
+    if (!(buf_flags(b) & B_VALID)) {
+        printk(KERN_ERR "[BCACHE] Read error on block %llu\n", blockno);
+        brelse(b);
+        return NULL;
+    }
+    return b;
+}
+
+void bdirty(buf_t *b) {
+    if (!(buf_flags(b) & B_DIRTY)) {
+        b->dirty_time = rdtime();
+        buf_set(b, B_DIRTY);
+        nr_dirty++;
+    }
+}
+
+int bwrite(buf_t *b) {
+    buf_wait(b);
+    buf_mark_clean(b);
+    buf_submit(b, true);
+    buf_wait(b);
+    stats.writebacks++;
+    return (buf_flags(b) & B_ERROR) ? -1 : 0;
+}
+
+void bdiscard(uint32_t dev, uint64_t blockno) {
+    buf_t *b = hash_lookup(dev, blockno);
+    if (b) {
+        buf_mark_clean(b);
+    }
+}
+
+void brelse(buf_t *b) {
+    if (b && b->refcnt > 0) {
+        b->refcnt--;
+    }
+}
+
+void bsync(void) {
+    bflush(0);
+}
+
+void bcache_get_stats(bcache_stats_t *out) {
+    *out = stats;
+    out->nr_buffers = nr_buffers;
+    out->nr_dirty = nr_dirty;
+}
+
+/* ---------------- 写回线程 ---------------- */
+
+static void bflushd(void) {
+    uint64_t next_run = rdtime() + FLUSH_INTERVAL;
+
+    while (1) {
+        uint64_t now = rdtime();
+        if (now >= next_run) {
+            next_run = now + FLUSH_INTERVAL;
+            if (nr_dirty > DIRTY_HIGH_WATER) {
+                bflush(0);
+            } else if (nr_dirty > 0) {
+                bflush(DIRTY_EXPIRE);
+            }
+        }
+        yield();
+    }
+}
+
+void bcache_init(void) {
+    if (!blk_present()) {
+        return;
+    }
+
+    create_process("bflushd", bflushd);
+    printk("  Buffer cache: up to %d blocks of %d bytes\n", NR_BUFFERS, BLOCK_SIZE);
+}
@@ -0,0 +1,148 @@
+/* 文件描述符 - 在fs.c之上提供带读写位置的打开文件 */
+#include <kernel/file.h>
+#include <kernel/fs.h>
+#include <kernel/mm.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+
+/* 当前进程中fd对应的打开文件 */
+static open_file_t *fd_get(int fd) {
+    process_t *proc = current_process();
+    if (!proc || fd < 0 || fd >= PROC_MAX_FDS) {
+        return NULL;
+    }
+    return proc->fds[fd];
+}
+
+int vfs_open(const char *path, int flags) {
+    process_t *proc = current_process();
+    if (!proc) {
+        return -1;
+    }
+
+    /* 分配最小的空闲描述符 */
+    int fd = 0;
+    while (fd < PROC_MAX_FDS && proc->fds[fd]) {
+        fd++;
+    }
+    if (fd == PROC_MAX_FDS) {
+        printk("[FS] Too many open files\n");
+        return -1;
+    }
+
+    file_t *file = fs_find(path);
+    if (!file && (flags & O_CREAT)) {
+        if (fs_create(path, FILE_TYPE_REGULAR) != 0) {
+            return -1;
+        }
+        file = fs_find(path);
+    }
+    if (!file) {
+        printk("[FS] File not found: %s\n", path);
+        return -1;
+    }
+    if (file->type != FILE_TYPE_REGULAR) {
+        printk("[FS] Not a regular file: %s\n", path);
+        return -1;
+    }
+    if (file->readonly && (flags & O_ACCMODE) != O_RDONLY) {
+        printk("[FS] Read-only file system: %s\n", path);
+        return -1;
+    }
+
+    open_file_t *of = kmalloc(sizeof(open_file_t));
+    if (!of) {
+        return -1;
+    }
+    of->file = file;
+    of->offset = 0;
+    of->flags = flags;
+    fs_get(file);
+
+    if ((flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY) {
+        fs_truncate(file, 0);
+    }
+
+    proc->fds[fd] = of;
+    return fd;
+}
+
+int vfs_close(int fd) {
+    open_file_t *of = fd_get(fd);
+    if (!of) {
+        return -1;
+    }
+
+    current_process()->fds[fd] = NULL;
+    fs_put(of->file);
+    kfree(of);
+    return 0;
+}
+
+void vfs_close_all(void) {
+    for (int fd = 0; fd < PROC_MAX_FDS; fd++) {
+        vfs_close(fd);
+    }
+}
+
+ssize_t vfs_read(int fd, void *buf, size_t len) {
+    open_file_t *of = fd_get(fd);
+    if (!of || (of->flags & O_ACCMODE) == O_WRONLY) {
+        return -1;
+    }
+
+    size_t n = fs_read_at(of->file, of->offset, buf, len);
+    of->offset += n;
+    /* 没到文件末尾却读不出数据: 校验和不一致 */
+    if (n == 0 && len > 0 && of->offset < of->file->size) {
+        return -1;
+    }
+    return n;
+}
+
+ssize_t vfs_write(int fd, const void *buf, size_t len) {
+    open_file_t *of = fd_get(fd);
+    if (!of || (of->flags & O_ACCMODE) == O_RDONLY) {
+        return -1;
+    }
+
+    /* O_APPEND: 每次写之前移到文件末尾 */
+    if (of->flags & O_APPEND) {
+        of->offset = of->file->size;
+    }
+
+    size_t n = fs_write_at(of->file, of->offset, buf, len);
+    of->offset += n;
+    if (n == 0 && len > 0) {
+        return -1;
+    }
+    return n;
+}
+
+ssize_t vfs_lseek(int fd, ssize_t offset, int whence) {
+    open_file_t *of = fd_get(fd);
+    if (!of) {
+        return -1;
+    }
+
+    ssize_t base;
+    switch (whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = of->offset;
+            break;
+        case SEEK_END:
+            base = of->file->size;
+            break;
+        default:
+            return -1;
+    }
+
+    if (base + offset < 0) {
+        return -1;
+    }
+    of->offset = base + offset;
+    return of->offset;
+}
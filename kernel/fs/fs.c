@@ -1,139 +1,1385 @@
 #include <kernel/fs.h>
 #include <kernel/string.h>
 #include <kernel/printk.h>
+#include <kernel/mm.h>
+#include <kernel/process.h>
+#include <kernel/nosfs.h>
+#include <kernel/lz4.h>
+#include <kernel/crc32c.h>
+#include <arch/riscv/riscv.h>
 
-/* 文件表 (简单的内存文件系统) */
-static file_t file_table[MAX_FILES];
+/*
+ * 目录树 + 目录项缓存. 磁盘上有nosfs时根目录挂载在磁盘上, 目录树就是
+ * 磁盘inode的缓存 (文件数据由nosfs经块缓存读写); 否则是纯内存文件系统.
+ */
+static file_t *root_dir;
+static uint64_t next_ino = 1;
+
+/* ---------------- 透明压缩 ---------------- */
+
+/*
+ * 设置了compress的文件 (chattr +c), 数据页在"写回"时用LZ4压缩:
+ * 写入越过一页后该页即被压缩, 文件最后一个引用关闭或整体写入结束时压缩剩余的页.
+ * 压缩后的页放在zpool中 (kmalloc每页有头部, 2KB的对象一页只放一个, 省不了内存),
+ * 指针最低位置1存放在原来的叶子槽中 (数据页按页对齐, zpool的对象8字节对齐, 最低位总是0).
+ * 读取压缩页时解压到一个小的全局缓存中, 热文件的重复读取不必反复解压;
+ * 写入压缩页时先解压回普通页.
+ * 压缩后放不进zpool最大的对象 (节省不到一半内存) 的页保持不压缩.
+ */
+#define ZPAGE_TAG       1UL
+#define ZPAGE_MAX       (ZPOOL_MAX_ALLOC - sizeof(zpage_t))
+#define ZCACHE_ENTRIES  16
+
+typedef struct {
+    uint32_t len;               /* 压缩后的字节数 */
+    uint8_t data[];
+} zpage_t;
+
+/* 解压缓存: (文件编号, 页号) -> 解压后的页, 按最近使用淘汰 */
+typedef struct {
+    uint64_t ino;               /* 0表示空闲 */
+    uint64_t idx;
+    uint8_t *page;
+    uint64_t last_used;
+} zcache_entry_t;
+
+static zcache_entry_t zcache[ZCACHE_ENTRIES];
+static uint64_t zcache_clock;
+static fs_zstats_t zstats;
+static uint8_t zbuf[LZ4_BOUND(PAGE_SIZE)];
+
+static inline bool is_zpage(void *p) {
+    return (uintptr_t)p & ZPAGE_TAG;
+}
+
+static inline zpage_t *to_zpage(void *p) {
+    return (zpage_t *)((uintptr_t)p & ~ZPAGE_TAG);
+}
+
+static void zcache_invalidate(uint64_t ino, uint64_t idx) {
+    for (int i = 0; i < ZCACHE_ENTRIES; i++) {
+        if (zcache[i].ino == ino && zcache[i].idx == idx) {
+            zcache[i].ino = 0;
+        }
+    }
+}
+
+/* 解压到dst, 数据损坏时填0 */
+static void zpage_inflate(zpage_t *z, uint8_t *dst) {
+    uint64_t start = rdtime();
+    ssize_t n = lz4_decompress(z->data, z->len, dst, PAGE_SIZE);
+    if (n < 0) {
+        printk(KERN_ERR "[FS] Corrupt compressed page\n");
+        n = 0;
+    }
+    memset(dst + n, 0, PAGE_SIZE - n);
+    zstats.decompress_ticks += rdtime() - start;
+    zstats.decompressed += PAGE_SIZE;
+}
+
+static void zpage_free(file_t *file, uint64_t idx, void *slot) {
+    zpage_t *z = to_zpage(slot);
+    file->nr_zpages--;
+    file->zbytes -= zpool_size(z);
+    zcache_invalidate(file->ino, idx);
+    zpool_free(z);
+}
+
+/* 压缩slot中的普通页, 压缩效果不够时保持原样 */
+static void zpage_store(file_t *file, uint64_t idx, void **slot) {
+    uint64_t start = rdtime();
+    size_t n = lz4_compress(*slot, PAGE_SIZE, zbuf, ZPAGE_MAX);
+    zstats.compress_ticks += rdtime() - start;
+    zstats.compressed += PAGE_SIZE;
+    if (n == 0) {
+        zstats.incompressible++;
+        return;
+    }
+
+    zpage_t *z = zpool_alloc(sizeof(zpage_t) + n);
+    if (!z) {
+        return;
+    }
+    z->len = n;
+    memcpy(z->data, zbuf, n);
+
+    free_page(*slot);
+    *slot = (void *)((uintptr_t)z | ZPAGE_TAG);
+    file->nr_pages--;
+    file->nr_zpages++;
+    file->zbytes += zpool_size(z);
+    zcache_invalidate(file->ino, idx);
+}
+
+/* ---------------- 数据页索引 ---------------- */
+
+/* height层的树可寻址的页数 */
+static uint64_t radix_capacity(int height) {
+    if (height == 0) {
+        return 0;
+    }
+    return 1ULL << (FS_RADIX_SHIFT * (height - 1));
+}
+
+/* 查找文件第idx页的叶子槽, create时按需分配索引页 (不分配数据页) */
+static void **file_slot(file_t *file, uint64_t idx, bool create) {
+    /* 树高不够时在顶部加一层, 原来的树成为新根的第0个子树 */
+    while (idx >= radix_capacity(file->height)) {
+        if (!create) {
+            return NULL;
+        }
+        if (file->height == FS_MAX_HEIGHT) {
+            printk(KERN_ERR "[FS] File too large: %s\n", file->dentry->name);
+            return NULL;
+        }
+        if (file->root) {
+            void **node = alloc_page_tag(PG_FSMETA);
+            if (!node) {
+                return NULL;
+            }
+            node[0] = file->root;
+            file->root = node;
+        }
+        file->height++;
+    }
+
+    void **slot = &file->root;
+    for (int h = file->height; h > 1; h--) {
+        if (!*slot) {
+            if (!create || !(*slot = alloc_page_tag(PG_FSMETA))) {
+                return NULL;
+            }
+        }
+        int shift = FS_RADIX_SHIFT * (h - 2);
+        slot = &((void **)*slot)[(idx >> shift) & (FS_RADIX_SLOTS - 1)];
+    }
+    return slot;
+}
+
+/*
+ * 查找文件的第idx页用于写入, create时按需分配索引页和数据页.
+ * 压缩页先解压回普通页.
+ */
+static uint8_t *file_page(file_t *file, uint64_t idx, bool create) {
+    void **slot = file_slot(file, idx, create);
+    if (!slot) {
+        return NULL;
+    }
+
+    if (is_zpage(*slot)) {
+        uint8_t *page = alloc_page_tag(PG_PAGECACHE);
+        if (!page) {
+            return NULL;
+        }
+        zpage_inflate(to_zpage(*slot), page);
+        zpage_free(file, idx, *slot);
+        *slot = page;
+        file->nr_pages++;
+    } else if (!*slot && create) {
+        *slot = alloc_page_tag(PG_PAGECACHE);
+        if (*slot) {
+            file->nr_pages++;
+        }
+    }
+    return *slot;
+}
+
+/*
+ * 查找文件的第idx页用于读取, 压缩页经解压缓存返回.
+ * 空洞时*page为NULL; 解压缓存分配不到页时返回-1.
+ */
+static int file_page_read(file_t *file, uint64_t idx, const uint8_t **page) {
+    void **slot = file_slot(file, idx, false);
+    *page = NULL;
+    if (!slot || !*slot) {
+        return 0;
+    }
+    if (!is_zpage(*slot)) {
+        *page = *slot;
+        return 0;
+    }
+
+    zcache_entry_t *victim = &zcache[0];
+    for (int i = 0; i < ZCACHE_ENTRIES; i++) {
+        zcache_entry_t *e = &zcache[i];
+        if (e->ino == file->ino && e->idx == idx) {
+            e->last_used = ++zcache_clock;
+            zstats.cache_hits++;
+            *page = e->page;
+            return 0;
+        }
+        if (e->last_used < victim->last_used) {
+            victim = e;
+        }
+    }
+
+    zstats.cache_misses++;
+    if (!victim->page && !(victim->page = alloc_page_tag(PG_PAGECACHE))) {
+        printk(KERN_ERR "[FS] Out of memory decompressing %s page %llu\n",
+               file->dentry->name, idx);
+        return -1;
+    }
+    zpage_inflate(to_zpage(*slot), victim->page);
+    victim->ino = file->ino;
+    victim->idx = idx;
+    victim->last_used = ++zcache_clock;
+    *page = victim->page;
+    return 0;
+}
+
+/* 压缩[from, to)页中的普通页 */
+static void file_compress_range(file_t *file, uint64_t from, uint64_t to) {
+    for (uint64_t idx = from; idx < to && file->nr_pages > 0; idx++) {
+        void **slot = file_slot(file, idx, false);
+        if (slot && *slot && !is_zpage(*slot)) {
+            zpage_store(file, idx, slot);
+        }
+    }
+}
+
+/* 压缩文件中所有还未压缩的页 */
+static void file_compress(file_t *file) {
+    if (file->compress && file->nr_pages > 0) {
+        file_compress_range(file, 0, PAGE_ALIGN_UP(file->size) / PAGE_SIZE);
+    }
+}
+
+/* ---------------- 数据校验 ---------------- */
+
+/*
+ * 内存中的文件每个数据页有一个CRC32C, 写入时计算, 读取时验证, 用来发现
+ * 内存中的文件数据被意外改写 (野指针、位翻转). 校验和覆盖解压后的内容,
+ * 压缩和解压不改变它. 像压缩一样在"写回"时计算: 写入越过的页马上计算,
+ * 只写了一部分的最后一页记为待计算 (追加写多半还落在这一页),
+ * 写到别的页、整体写入结束或文件最后一个引用关闭时再算. 待计算的页读取时不验证.
+ */
+static fs_csum_stats_t cstats;
+
+/* 保证csums能存放第idx页的校验和, 不够时扩大一倍 */
+static bool csum_reserve(file_t *file, uint64_t idx) {
+    if (idx < file->csum_cap) {
+        return true;
+    }
+    uint64_t cap = file->csum_cap ? file->csum_cap : 16;
+    while (cap <= idx) {
+        cap *= 2;
+    }
+    uint32_t *csums = kmalloc(cap * sizeof(uint32_t));
+    if (!csums) {
+        return false;
+    }
+    if (file->csums) {
+        memcpy(csums, file->csums, file->csum_cap * sizeof(uint32_t));
+        kfree(file->csums);
+    }
+    file->csums = csums;
+    file->csum_cap = cap;
+    return true;
+}
+
+/*
+ * 计算第idx页的校验和, 空洞没有校验和.
+ * 压缩页解压不了时返回false, 校验和不变, 待计算的页仍然待计算.
+ */
+static bool csum_update(file_t *file, uint64_t idx) {
+    const uint8_t *page;
+    if (file_page_read(file, idx, &page) < 0) {
+        return false;
+    }
+    if (page) {
+        uint64_t start = rdtime();
+        file->csums[idx] = crc32c(0, page, PAGE_SIZE);
+        cstats.sum_ticks += rdtime() - start;
+        cstats.summed += PAGE_SIZE;
+    }
+    if (file->csum_pending == idx + 1) {
+        file->csum_pending = 0;
+    }
+    return true;
+}
+
+static void csum_flush(file_t *file) {
+    if (file->csum_pending) {
+        csum_update(file, file->csum_pending - 1);
+    }
+}
+
+static bool csum_verify(file_t *file, uint64_t idx, const uint8_t *page) {
+    if (file->csum_pending == idx + 1) {
+        return true;
+    }
+    uint64_t start = rdtime();
+    uint32_t crc = crc32c(0, page, PAGE_SIZE);
+    cstats.verify_ticks += rdtime() - start;
+    cstats.verified += PAGE_SIZE;
+    if (crc == file->csums[idx]) {
+        return true;
+    }
+    cstats.errors++;
+    printk(KERN_ERR "[FS] Checksum mismatch: %s page %llu (crc %08x, expected %08x)\n",
+           file->dentry->name, idx, crc, file->csums[idx]);
+    return false;
+}
+
+/* 写回: 计算待计算页的校验和, 压缩剩余的页 */
+static void file_writeback(file_t *file) {
+    csum_flush(file);
+    file_compress(file);
+}
+
+void fs_get_csum_stats(fs_csum_stats_t *stats) {
+    *stats = cstats;
+}
+
+/*
+ * 释放子树中页号 >= from 的数据页, base为子树的第一个页号.
+ * 子树被整个释放时返回true.
+ */
+static bool radix_truncate(file_t *file, void *node, int height,
+                           uint64_t base, uint64_t from) {
+    if (height == 1) {
+        if (base < from) {
+            return false;
+        }
+        if (is_zpage(node)) {
+            zpage_free(file, base, node);
+        } else {
+            free_page(node);
+            file->nr_pages--;
+        }
+        return true;
+    }
+
+    void **slots = node;
+    uint64_t span = radix_capacity(height - 1);
+    bool empty = true;
+
+    for (int i = 0; i < FS_RADIX_SLOTS; i++) {
+        if (!slots[i]) {
+            continue;
+        }
+        uint64_t child = base + i * span;
+        if (child + span > from &&
+            radix_truncate(file, slots[i], height - 1, child, from)) {
+            slots[i] = NULL;
+        } else {
+            empty = false;
+        }
+    }
+
+    if (empty) {
+        free_page(node);
+    }
+    return empty;
+}
+
+/* 截断到size字节, 释放之后的整页 */
+void fs_truncate(file_t *file, size_t size) {
+    if (file->readonly) {
+        return;
+    }
+    if (file->disk_ino) {
+        nosfs_truncate(file, size);
+        return;
+    }
+
+    uint64_t from = PAGE_ALIGN_UP(size) / PAGE_SIZE;
+
+    if (file->root &&
+        radix_truncate(file, file->root, file->height, 0, from)) {
+        file->root = NULL;
+        file->height = 0;
+    }
+
+    /* 根索引页只剩第0个子树时降低树高 */
+    while (file->height > 1) {
+        void **node = file->root;
+        int i = 1;
+        while (i < FS_RADIX_SLOTS && !node[i]) {
+            i++;
+        }
+        if (i < FS_RADIX_SLOTS) {
+            break;
+        }
+        file->root = node[0];
+        file->height--;
+        free_page(node);
+    }
+
+    if (file->csum_pending > from) {
+        file->csum_pending = 0;
+    }
+    if (size == 0) {
+        kfree(file->csums);
+        file->csums = NULL;
+        file->csum_cap = 0;
+    }
+
+    /* 最后一页size之后的部分清零, 以后扩展文件时读出为0 */
+    if (size % PAGE_SIZE) {
+        uint8_t *page = file_page(file, size / PAGE_SIZE, false);
+        if (page) {
+            memset(page + size % PAGE_SIZE, 0, PAGE_SIZE - size % PAGE_SIZE);
+            csum_update(file, size / PAGE_SIZE);
+        }
+    }
+
+    file->size = size;
+}
+
+/* 从offset开始写入, 返回写入的字节数 (内存不足时可能少于len) */
+size_t fs_write_at(file_t *file, size_t offset, const void *buf, size_t len) {
+    if (file->readonly) {
+        return 0;
+    }
+    if (file->disk_ino) {
+        return nosfs_write_at(file, offset, buf, len);
+    }
+
+    const uint8_t *src = buf;
+    size_t done = 0;
+
+    while (done < len) {
+        size_t pos = offset + done;
+        size_t in_page = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        if (!csum_reserve(file, pos / PAGE_SIZE)) {
+            break;
+        }
+        uint8_t *page = file_page(file, pos / PAGE_SIZE, true);
+        if (!page) {
+            break;
+        }
+        memcpy(page + in_page, src + done, chunk);
+        done += chunk;
+    }
+
+    if (offset + done > file->size) {
+        file->size = offset + done;
+    }
+
+    /* 写回: 越过的页计算校验和, 写了一部分的最后一页留到以后 */
+    if (done > 0) {
+        uint64_t end = (offset + done) / PAGE_SIZE;
+        uint64_t tail = (offset + done) % PAGE_SIZE ? end + 1 : 0;
+        if (file->csum_pending != tail) {
+            csum_flush(file);
+        }
+        for (uint64_t idx = offset / PAGE_SIZE; idx < end; idx++) {
+            csum_update(file, idx);
+        }
+        file->csum_pending = tail;
+    }
+
+    /* 压缩已经写过去的页, 最后一页可能马上还要写, 留到关闭时 */
+    if (file->compress && done > 0) {
+        file_compress_range(file, offset / PAGE_SIZE, (offset + done) / PAGE_SIZE);
+    }
+    return done;
+}
+
+/* 从offset开始读取, 空洞读出为0, 返回读取的字节数 (内存不足或校验失败时停在那一页) */
+size_t fs_read_at(file_t *file, size_t offset, void *buf, size_t len) {
+    if (file->disk_ino) {
+        return nosfs_read_at(file, offset, buf, len);
+    }
+
+    uint8_t *dst = buf;
+
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (len > file->size - offset) {
+        len = file->size - offset;
+    }
+
+    /* 只读文件直接从内核镜像中拷贝 */
+    if (file->readonly) {
+        memcpy(dst, file->rodata + offset, len);
+        return len;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        size_t pos = offset + done;
+        size_t in_page = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        const uint8_t *page;
+        if (file_page_read(file, pos / PAGE_SIZE, &page) < 0) {
+            break;
+        }
+        if (page) {
+            if (!csum_verify(file, pos / PAGE_SIZE, page)) {
+                break;
+            }
+            memcpy(dst + done, page + in_page, chunk);
+        } else {
+            memset(dst + done, 0, chunk);
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+/* ---------------- 目录项缓存 ---------------- */
+
+/*
+ * 所有存在的文件的目录项都在哈希表中, 因此查找不需要扫描目录, 未命中即不存在.
+ * 未命中的名字记为负缓存项, 重复查找不存在的名字(如探测路径)同样O(1)命中,
+ * 之后创建同名文件时直接复用. 负缓存项按LRU淘汰 (被再次查找过的给第二次机会),
+ * 删除文件时目录项转为负缓存项. 装载因子超过2时哈希表扩大一倍.
+ *
+ * fs_find不加锁地读哈希表 (path_walk_rcu): 修改者先初始化再用rcu_assign_pointer
+ * 发布; 摘下的目录项、删除的文件和扩大后的旧表都在宽限期之后才释放,
+ * 摘链时保留hash_next, 停在它上面的读者可以继续走完链表.
+ */
+#define DCACHE_INIT_BUCKETS (PAGE_SIZE / sizeof(dentry_t *))
+#define DCACHE_MAX_NEGATIVE 4096
+
+/* 桶数组和桶数一起发布, 读者不会看到不匹配的一对 */
+typedef struct {
+    dentry_t **heads;
+    uint64_t nr_buckets;
+    rcu_head_t rcu;
+} dcache_table_t;
+
+static dcache_table_t *dcache;
+static dentry_t *lru_head;               /* 负缓存项, 最近使用的在前 */
+static dentry_t *lru_tail;
+static dcache_stats_t dstats;
+
+bool fs_rcu_walk = true;
+
+/* FNV-1a, 混入父目录编号 */
+static uint32_t dentry_hash(uint64_t parent_ino, const char *name) {
+    uint32_t h = 2166136261U;
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ (uint8_t)(parent_ino >> (i * 8))) * 16777619U;
+    }
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619U;
+    }
+    return h;
+}
+
+static void lru_unlink(dentry_t *d) {
+    if (d->lru_prev) {
+        d->lru_prev->lru_next = d->lru_next;
+    } else {
+        lru_head = d->lru_next;
+    }
+    if (d->lru_next) {
+        d->lru_next->lru_prev = d->lru_prev;
+    } else {
+        lru_tail = d->lru_prev;
+    }
+    d->lru_next = d->lru_prev = NULL;
+}
+
+static void lru_push(dentry_t *d) {
+    d->referenced = false;
+    d->lru_prev = NULL;
+    d->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = d;
+    } else {
+        lru_tail = d;
+    }
+    lru_head = d;
+}
+
+static void dcache_table_free(rcu_head_t *head) {
+    dcache_table_t *t = container_of(head, dcache_table_t, rcu);
+    free_pages(t->heads, t->nr_buckets * sizeof(dentry_t *) / PAGE_SIZE);
+    kfree(t);
+}
+
+static void dentry_free_rcu(rcu_head_t *head) {
+    kfree(container_of(head, dentry_t, rcu));
+}
+
+static void file_free_rcu(rcu_head_t *head) {
+    kfree(container_of(head, file_t, rcu));
+}
+
+/*
+ * 哈希表扩大一倍; 分配失败时继续使用旧表.
+ * 目录项逐个移到新表, 旧表上的读者可能因此漏掉一些项, 未命中时会回到普通路径.
+ */
+static void dcache_grow(void) {
+    dcache_table_t *old = dcache;
+    dcache_table_t *t = kmalloc(sizeof(dcache_table_t));
+    if (!t) {
+        return;
+    }
+    t->nr_buckets = old->nr_buckets * 2;
+    t->heads = alloc_pages_tag(t->nr_buckets * sizeof(dentry_t *) / PAGE_SIZE, PG_FSMETA);
+    if (!t->heads) {
+        kfree(t);
+        return;
+    }
+
+    for (uint64_t i = 0; i < old->nr_buckets; i++) {
+        dentry_t *d = old->heads[i];
+        while (d) {
+            dentry_t *next = d->hash_next;
+            dentry_t **bucket = &t->heads[d->hash & (t->nr_buckets - 1)];
+            rcu_assign_pointer(d->hash_next, *bucket);
+            *bucket = d;
+            d = next;
+        }
+    }
+
+    rcu_assign_pointer(dcache, t);
+    call_rcu(&old->rcu, dcache_table_free);
+}
+
+/* 摘下的目录项保留hash_next (可能有读者停在它上面) */
+static void dcache_unhash(dentry_t *d) {
+    dentry_t **pp = &dcache->heads[d->hash & (dcache->nr_buckets - 1)];
+    while (*pp != d) {
+        pp = &(*pp)->hash_next;
+    }
+    rcu_assign_pointer(*pp, d->hash_next);
+    dstats.nr_cached--;
+}
+
+/*
+ * 目录项变为负缓存项, 超出上限时淘汰最久未用的负缓存项.
+ * 被再次查找过的负缓存项移回头部 (第二次机会): 查找只设置标志,
+ * 不加锁的读者也能做, 不用移动链表.
+ */
+static void dentry_make_negative(dentry_t *d) {
+    rcu_assign_pointer(d->inode, NULL);
+    d->parent = NULL;
+    lru_push(d);
+    dstats.nr_negative++;
+
+    while (dstats.nr_negative > DCACHE_MAX_NEGATIVE) {
+        dentry_t *victim = lru_tail;
+        lru_unlink(victim);
+        if (victim->referenced) {
+            lru_push(victim);
+            continue;
+        }
+        dcache_unhash(victim);
+        dstats.nr_negative--;
+        dstats.evictions++;
+        call_rcu(&victim->rcu, dentry_free_rcu);
+    }
+}
+
+static void dcache_insert(dentry_t *d) {
+    if (dstats.nr_cached >= dcache->nr_buckets * 2) {
+        dcache_grow();
+    }
+
+    dentry_t **bucket = &dcache->heads[d->hash & (dcache->nr_buckets - 1)];
+    d->hash_next = *bucket;
+    rcu_assign_pointer(*bucket, d);
+    dstats.nr_cached++;
+}
+
+/* 把正缓存项挂到目录的子项链表末尾 (inode最后发布, 读者看到时文件已初始化) */
+static void dentry_attach(file_t *dir, dentry_t *d, file_t *file) {
+    file->dentry = d;
+    d->parent = dir;
+    rcu_assign_pointer(d->inode, file);
+
+    d->sibling_next = NULL;
+    d->sibling_prev = dir->children_tail;
+    if (dir->children_tail) {
+        dir->children_tail->sibling_next = d;
+    } else {
+        dir->children = d;
+    }
+    dir->children_tail = d;
+    dir->nr_children++;
+}
+
+/* nosfs_dir_load的回调: 为磁盘目录项建立file_t和正缓存项 */
+static int dir_fill(file_t *dir, const char *name, uint32_t ino,
+                    file_type_t type, size_t size, uint32_t slot) {
+    file_t *file = kzalloc(sizeof(file_t));
+    dentry_t *d = kzalloc(sizeof(dentry_t));
+    if (!file || !d) {
+        kfree(file);
+        kfree(d);
+        return -1;
+    }
+
+    file->ino = next_ino++;
+    file->type = type;
+    file->size = size;
+    file->disk_ino = ino;
+
+    d->parent_ino = dir->ino;
+    d->hash = dentry_hash(dir->ino, name);
+    d->slot = slot;
+    strcpy(d->name, name);
+    dcache_insert(d);
+    dentry_attach(dir, d, file);
+    return 0;
+}
+
+/*
+ * 磁盘目录在第一次访问时整个读入dcache, 之后"哈希表未命中即不存在"仍然成立.
+ * 在此之前不会有该目录下的负缓存项.
+ */
+static void dir_load(file_t *dir) {
+    if (!dir->disk_ino || dir->type != FILE_TYPE_DIRECTORY || dir->loaded) {
+        return;
+    }
+    dir->loaded = true;
+    if (nosfs_dir_load(dir, dir_fill) < 0) {
+        printk(KERN_ERR "[FS] Failed to read directory %s\n", dir->dentry->name);
+    }
+}
+
+/*
+ * 在目录dir中查找name的目录项, 未命中时新建负缓存项.
+ * 只有内存不足时返回NULL; 返回的目录项inode为NULL表示不存在.
+ */
+static dentry_t *dir_lookup_dentry(file_t *dir, const char *name) {
+    dir_load(dir);
+
+    uint32_t hash = dentry_hash(dir->ino, name);
+    dstats.lookups++;
+
+    for (dentry_t *d = dcache->heads[hash & (dcache->nr_buckets - 1)]; d; d = d->hash_next) {
+        if (d->hash == hash && d->parent_ino == dir->ino &&
+            strcmp(d->name, name) == 0) {
+            if (d->inode) {
+                dstats.hits++;
+            } else {
+                dstats.negative_hits++;
+                d->referenced = true;
+            }
+            return d;
+        }
+    }
+
+    /* 记住这次失败 */
+    dstats.misses++;
+    dentry_t *neg = kzalloc(sizeof(dentry_t));
+    if (!neg) {
+        return NULL;
+    }
+    neg->parent_ino = dir->ino;
+    neg->hash = hash;
+    strcpy(neg->name, name);
+    dcache_insert(neg);
+    dentry_make_negative(neg);
+    return neg;
+}
+
+static file_t *dir_lookup(file_t *dir, const char *name) {
+    dentry_t *d = dir_lookup_dentry(dir, name);
+    return d ? d->inode : NULL;
+}
+
+void dcache_get_stats(dcache_stats_t *stats) {
+    *stats = dstats;
+    stats->nr_buckets = dcache->nr_buckets;
+}
+
+/* ---------------- 路径解析 ---------------- */
+
+static file_t *cwd(void) {
+    process_t *proc = current_process();
+    return (proc && proc->cwd) ? proc->cwd : root_dir;
+}
+
+/*
+ * 逐级解析路径.
+ * last为NULL时返回路径指向的文件;
+ * 否则返回最后一个分量所在的目录, 并把最后一个分量复制到last.
+ */
+static file_t *path_walk(const char *path, char *last) {
+    file_t *dir = (*path == '/') ? root_dir : cwd();
+    char name[MAX_FILENAME];
+
+    if (last) {
+        last[0] = '\0';
+    }
+
+    while (1) {
+        while (*path == '/') {
+            path++;
+        }
+        if (*path == '\0') {
+            return dir;
+        }
+
+        /* 取出一个分量 */
+        int len = 0;
+        while (*path && *path != '/') {
+            if (len == MAX_FILENAME - 1) {
+                return NULL;
+            }
+            name[len++] = *path++;
+        }
+        name[len] = '\0';
+
+        while (*path == '/') {
+            path++;
+        }
+        if (*path == '\0' && last) {
+            strcpy(last, name);
+            return dir;
+        }
+
+        if (dir->type != FILE_TYPE_DIRECTORY) {
+            return NULL;
+        }
+
+        if (strcmp(name, ".") == 0) {
+            continue;
+        } else if (strcmp(name, "..") == 0) {
+            if (dir->dentry->parent) {
+                dir = dir->dentry->parent;
+            }
+        } else {
+            dir = dir_lookup(dir, name);
+            if (!dir) {
+                return NULL;
+            }
+        }
+    }
+}
+
+/*
+ * 不加锁的路径解析, 在rcu_read_lock中调用: 只读dcache, 不建立负缓存项、
+ * 不读磁盘目录、不移动LRU链表. 遇到需要这些的情况返回false,
+ * 由path_walk重新解析; 否则*result是路径指向的文件 (NULL表示不存在).
+ */
+static bool path_walk_rcu(const char *path, file_t **result) {
+    dcache_table_t *t = rcu_dereference(dcache);
+    file_t *dir = (*path == '/') ? root_dir : cwd();
+    char name[MAX_FILENAME];
+
+    *result = NULL;
+    while (1) {
+        while (*path == '/') {
+            path++;
+        }
+        if (*path == '\0') {
+            *result = dir;
+            return true;
+        }
+
+        int len = 0;
+        while (*path && *path != '/') {
+            if (len == MAX_FILENAME - 1) {
+                return true;
+            }
+            name[len++] = *path++;
+        }
+        name[len] = '\0';
+
+        if (dir->type != FILE_TYPE_DIRECTORY) {
+            return true;
+        }
+
+        if (strcmp(name, ".") == 0) {
+            continue;
+        } else if (strcmp(name, "..") == 0) {
+            file_t *parent = rcu_dereference(dir->dentry->parent);
+            if (parent) {
+                dir = parent;
+            }
+            continue;
+        }
+
+        if (dir->disk_ino && !__atomic_load_n(&dir->loaded, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        uint32_t hash = dentry_hash(dir->ino, name);
+        dentry_t *d = rcu_dereference(t->heads[hash & (t->nr_buckets - 1)]);
+        while (d && !(d->hash == hash && d->parent_ino == dir->ino &&
+                      strcmp(d->name, name) == 0)) {
+            d = rcu_dereference(d->hash_next);
+        }
+        if (!d) {
+            return false;
+        }
+
+        dstats.lookups++;
+        file_t *file = rcu_dereference(d->inode);
+        if (!file) {
+            dstats.negative_hits++;
+            d->referenced = true;
+            return true;
+        }
+        dstats.hits++;
+        dir = file;
+    }
+}
+
+/* 从dir向上走到根, 拼出绝对路径 */
+static int fs_getcwd_of(file_t *dir, char *buf, size_t size) {
+    char tmp[MAX_PATH];
+    size_t pos = sizeof(tmp) - 1;
+    tmp[pos] = '\0';
+
+    for (file_t *f = dir; f != root_dir; f = f->dentry->parent) {
+        size_t len = strlen(f->dentry->name);
+        if (len + 1 > pos) {
+            return -1;
+        }
+        pos -= len;
+        memcpy(&tmp[pos], f->dentry->name, len);
+        tmp[--pos] = '/';
+    }
+    if (pos == sizeof(tmp) - 1) {
+        tmp[--pos] = '/';
+    }
+
+    size_t len = sizeof(tmp) - 1 - pos;
+    if (len + 1 > size) {
+        return -1;
+    }
+    memcpy(buf, &tmp[pos], len + 1);
+    return 0;
+}
+
+/* 检查要创建/删除的最后一个分量 */
+static bool valid_name(const char *name) {
+    return name[0] != '\0' && strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
+
+/* ---------------- 文件操作 ---------------- */
 
 void fs_init(void) {
-    /* 初始化文件表 */
-    for (int i = 0; i < MAX_FILES; i++) {
-        file_table[i].in_use = false;
+    dcache = kmalloc(sizeof(dcache_table_t));
+    if (dcache) {
+        dcache->nr_buckets = DCACHE_INIT_BUCKETS;
+        dcache->heads = alloc_page_tag(PG_FSMETA);
     }
 
-    printk("  File system initialized (in-memory)\n");
+    /* 根目录 */
+    root_dir = kzalloc(sizeof(file_t));
+    dentry_t *root_dentry = kzalloc(sizeof(dentry_t));
+    if (!dcache || !dcache->heads || !root_dir || !root_dentry) {
+        printk(KERN_ERR "[FS] Failed to allocate root directory\n");
+        return;
+    }
+    root_dir->ino = next_ino++;
+    root_dir->type = FILE_TYPE_DIRECTORY;
+    root_dir->dentry = root_dentry;
+    root_dentry->inode = root_dir;
+    strcpy(root_dentry->name, "/");
 
-    /* 创建一些示例文件 */
-    fs_create("README.txt", FILE_TYPE_REGULAR);
-    fs_write("README.txt",
-             "Welcome to NOS - A Teaching Operating System!\n"
-             "This is a simple RISC-V OS for educational purposes.\n",
-             108);
+    if (nosfs_mount(root_dir) == 0) {
+        printk("  File system mounted from disk\n");
+    } else {
+        printk("  File system initialized (in-memory)\n");
+    }
 
-    fs_create("info.txt", FILE_TYPE_REGULAR);
-    fs_write("info.txt",
-             "NOS supports:\n"
-             "- Memory management\n"
-             "- Process scheduling\n"
-             "- Simple file system\n"
-             "- Basic shell\n",
-             95);
+    dir_load(root_dir);
+    /* initramfs由kinit线程在shell出现后载入 (initramfs.c) */
 }
 
-/* 查找文件 */
-file_t *fs_find(const char *name) {
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (file_table[i].in_use &&
-            strcmp(file_table[i].name, name) == 0) {
-            return &file_table[i];
+/*
+ * 查找文件: 先不加锁地解析, 不行再走会修改dcache的path_walk.
+ * 返回的文件和以前一样不持有引用, 调用者在让出CPU之前使用它.
+ */
+file_t *fs_find(const char *path) {
+    if (fs_rcu_walk) {
+        file_t *file;
+        rcu_read_lock();
+        bool done = path_walk_rcu(path, &file);
+        rcu_read_unlock();
+        if (done) {
+            dstats.rcu_walks++;
+            return file;
         }
+        dstats.rcu_fallbacks++;
     }
-    return NULL;
+    return path_walk(path, NULL);
 }
 
-/* 创建文件 */
-int fs_create(const char *name, file_type_t type) {
+/* 创建文件; rodata非NULL时创建只读文件, 数据引用rodata->data */
+typedef struct {
+    const void *data;
+    size_t size;
+} rodata_t;
+
+static int file_create(const char *path, file_type_t type, const rodata_t *rodata) {
+    char name[MAX_FILENAME];
+    file_t *dir = path_walk(path, name);
+
+    if (!dir || dir->type != FILE_TYPE_DIRECTORY || !valid_name(name)) {
+        printk("[FS] Invalid path: %s\n", path);
+        return -1;
+    }
+    if (dir->readonly && !rodata) {
+        printk("[FS] Read-only file system: %s\n", path);
+        return -1;
+    }
+
+    dentry_t *d = dir_lookup_dentry(dir, name);
+    if (!d) {
+        printk(KERN_ERR "[FS] Out of memory\n");
+        return -1;
+    }
+
     /* 检查文件是否已存在 */
-    if (fs_find(name)) {
-        printk("[FS] File already exists: %s\n", name);
+    if (d->inode) {
+        printk("[FS] File already exists: %s\n", path);
         return -1;
     }
 
-    /* 查找空闲槽 */
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (!file_table[i].in_use) {
-            file_table[i].in_use = true;
-            file_table[i].type = type;
-            file_table[i].size = 0;
-            strcpy(file_table[i].name, name);
-            memset(file_table[i].data, 0, MAX_FILESIZE);
-            return 0;
+    file_t *file = kzalloc(sizeof(file_t));
+    if (!file) {
+        printk(KERN_ERR "[FS] Out of memory\n");
+        return -1;
+    }
+    file->ino = next_ino++;
+    file->type = type;
+
+    file->compress = dir->compress && !rodata;
+
+    if (rodata) {
+        /* 只读文件只在内存中, 即使父目录在磁盘上 */
+        file->readonly = true;
+        file->rodata = rodata->data;
+        file->size = rodata->size;
+    } else if (dir->disk_ino) {
+        /* 磁盘目录中的文件同时在磁盘上创建 */
+        if (nosfs_create(dir, name, file, &d->slot) < 0) {
+            kfree(file);
+            return -1;
         }
+        file->loaded = true;
     }
 
-    printk("[FS] No free file slots\n");
-    return -1;
+    /* 负缓存项转为正缓存项, 并加入目录 */
+    lru_unlink(d);
+    dstats.nr_negative--;
+    dentry_attach(dir, d, file);
+    return 0;
+}
+
+int fs_create(const char *path, file_type_t type) {
+    return file_create(path, type, NULL);
+}
+
+int fs_create_rodata(const char *path, file_type_t type, const void *data, size_t size) {
+    rodata_t rodata = { data, (type == FILE_TYPE_REGULAR) ? size : 0 };
+    return file_create(path, type, &rodata);
+}
+
+int fs_mkdir(const char *path) {
+    return fs_create(path, FILE_TYPE_DIRECTORY);
 }
 
 /* 删除文件 */
-int fs_delete(const char *name) {
-    file_t *file = fs_find(name);
-    if (!file) {
-        printk("[FS] File not found: %s\n", name);
+int fs_delete(const char *path) {
+    char name[MAX_FILENAME];
+    file_t *dir = path_walk(path, name);
+    dentry_t *d = NULL;
+
+    if (dir && dir->type == FILE_TYPE_DIRECTORY && valid_name(name)) {
+        d = dir_lookup_dentry(dir, name);
+    }
+    if (!d || !d->inode) {
+        printk("[FS] File not found: %s\n", path);
+        return -1;
+    }
+
+    file_t *file = d->inode;
+    if (file->readonly) {
+        printk("[FS] Read-only file system: %s\n", path);
+        return -1;
+    }
+    dir_load(file);
+    if (file->type == FILE_TYPE_DIRECTORY && file->nr_children > 0) {
+        printk("[FS] Directory not empty: %s\n", path);
+        return -1;
+    }
+    if (file->refs > 0) {
+        printk("[FS] File is busy: %s\n", path);
         return -1;
     }
 
-    file->in_use = false;
+    if (file->disk_ino) {
+        if (nosfs_remove(dir, file, d->slot) < 0) {
+            printk(KERN_ERR "[FS] Failed to remove %s from disk\n", path);
+            return -1;
+        }
+    } else {
+        fs_truncate(file, 0);
+    }
+
+    /* 移出目录 */
+    if (d->sibling_prev) {
+        d->sibling_prev->sibling_next = d->sibling_next;
+    } else {
+        dir->children = d->sibling_next;
+    }
+    if (d->sibling_next) {
+        d->sibling_next->sibling_prev = d->sibling_prev;
+    } else {
+        dir->children_tail = d->sibling_prev;
+    }
+    dir->nr_children--;
+
+    /* 目录项留在缓存中成为负缓存项 */
+    d->sibling_next = d->sibling_prev = NULL;
+    dentry_make_negative(d);
+
+    call_rcu(&file->rcu, file_free_rcu);
     return 0;
 }
 
 /* 写文件 */
-int fs_write(const char *name, const void *buf, size_t size) {
-    file_t *file = fs_find(name);
+int fs_write(const char *path, const void *buf, size_t size) {
+    file_t *file = fs_find(path);
     if (!file) {
-        printk("[FS] File not found: %s\n", name);
+        printk("[FS] File not found: %s\n", path);
         return -1;
     }
 
     if (file->type != FILE_TYPE_REGULAR) {
-        printk("[FS] Not a regular file: %s\n", name);
+        printk("[FS] Not a regular file: %s\n", path);
         return -1;
     }
-
-    if (size > MAX_FILESIZE) {
-        printk("[FS] File too large: %u bytes\n", size);
+    if (file->readonly) {
+        printk("[FS] Read-only file system: %s\n", path);
         return -1;
     }
 
-    memcpy(file->data, buf, size);
-    file->size = size;
+    /* 覆盖原有内容, 多余的页释放 */
+    size_t written = fs_write_at(file, 0, buf, size);
+    fs_truncate(file, written);
+    file_writeback(file);
+    if (written < size) {
+        printk(KERN_ERR "[FS] Out of memory writing %s\n", path);
+        return -1;
+    }
     return size;
 }
 
 /* 读文件 */
-int fs_read(const char *name, void *buf, size_t size) {
-    file_t *file = fs_find(name);
+int fs_read(const char *path, void *buf, size_t size) {
+    file_t *file = fs_find(path);
     if (!file) {
-        printk("[FS] File not found: %s\n", name);
+        printk("[FS] File not found: %s\n", path);
         return -1;
     }
 
     if (file->type != FILE_TYPE_REGULAR) {
-        printk("[FS] Not a regular file: %s\n", name);
+        printk("[FS] Not a regular file: %s\n", path);
+        return -1;
+    }
+
+    /* 读到的比文件内容少说明遇到了校验和不一致的页 */
+    size_t n = fs_read_at(file, 0, buf, size);
+    if (n < size && n < file->size) {
+        printk(KERN_ERR "[FS] I/O error reading %s\n", path);
         return -1;
     }
+    return n;
+}
 
-    size_t read_size = (size < file->size) ? size : file->size;
-    memcpy(buf, file->data, read_size);
-    return read_size;
+/*
+ * 文件数据实际占用的内存 (磁盘文件和initramfs文件不占用数据页).
+ * 压缩页按它在zpool中占的对象大小计; 各文件共用zpool的页, ls -l另外列出zpool占用的页数.
+ */
+static uint64_t file_stored(file_t *file) {
+    if (file->disk_ino || file->readonly) {
+        return 0;
+    }
+    return file->nr_pages * PAGE_SIZE + file->zbytes;
 }
 
-/* 列出所有文件 */
-void fs_list(void) {
-    printk("Files:\n");
-    printk("  %-20s %-10s %-10s\n", "Name", "Type", "Size");
-    printk("  ----------------------------------------\n");
+static void list_detail(dentry_t *d) {
+    file_t *file = d->inode;
+    uint64_t stored = file_stored(file);
+    char attr[4];
+    int n = 0;
+    if (file->compress) {
+        attr[n++] = 'c';
+    }
+    if (file->readonly) {
+        attr[n++] = 'r';
+    }
+    if (file->disk_ino) {
+        attr[n++] = 'D';
+    }
+    attr[n] = '\0';
+
+    printk("  %-20s %-5s %10llu %10llu ", d->name,
+           (file->type == FILE_TYPE_REGULAR) ? "file" : "dir",
+           (uint64_t)file->size, stored);
+    if (stored && file->type == FILE_TYPE_REGULAR) {
+        uint64_t ratio = (uint64_t)file->size * 100 / stored;
+        printk("%4llu.%02llux", ratio / 100, ratio % 100);
+    } else {
+        printk("%8s", "-");
+    }
+    printk("  %s\n", attr);
+}
+
+/* 列出目录 (path为NULL时列出当前目录), detail时显示内存占用和压缩率 (ls -l) */
+int fs_list(const char *path, bool detail) {
+    file_t *dir = path ? fs_find(path) : cwd();
+    if (!dir) {
+        printk("[FS] File not found: %s\n", path);
+        return -1;
+    }
+
+    char dir_path[MAX_PATH];
+    dir_load(dir);
+    if (dir->type == FILE_TYPE_DIRECTORY) {
+        fs_getcwd_of(dir, dir_path, sizeof(dir_path));
+    } else {
+        strcpy(dir_path, path);
+    }
+
+    printk("Files in %s:\n", dir_path);
+    if (detail) {
+        printk("  %-20s %-5s %10s %10s %8s  %s\n",
+               "Name", "Type", "Size", "Stored", "Ratio", "Attr");
+        printk("  ----------------------------------------------------------------\n");
+    } else {
+        printk("  %-20s %-10s %-10s\n", "Name", "Type", "Size");
+        printk("  ----------------------------------------\n");
+    }
 
     int count = 0;
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (file_table[i].in_use) {
-            const char *type_str = (file_table[i].type == FILE_TYPE_REGULAR)
-                                   ? "file" : "dir";
-            printk("  %-20s %-10s %-10u\n",
-                   file_table[i].name, type_str, file_table[i].size);
-            count++;
+    uint64_t total_size = 0, total_stored = 0;
+    dentry_t *first = (dir->type == FILE_TYPE_DIRECTORY) ? dir->children : dir->dentry;
+    for (dentry_t *d = first; d; d = d->sibling_next) {
+        file_t *file = d->inode;
+        if (detail) {
+            list_detail(d);
+            if (file_stored(file)) {
+                total_size += file->size;
+                total_stored += file_stored(file);
+            }
+        } else {
+            const char *type_str = (file->type == FILE_TYPE_REGULAR) ? "file" : "dir";
+            printk("  %-20s %-10s %-10llu\n", d->name, type_str, (uint64_t)file->size);
+        }
+        count++;
+        if (dir->type != FILE_TYPE_DIRECTORY) {
+            break;
         }
     }
 
     printk("\n  Total: %d files\n", count);
+    if (!detail) {
+        return 0;
+    }
+
+    if (total_stored) {
+        uint64_t ratio = total_size * 100 / total_stored;
+        printk("  Memory: %llu bytes in %llu bytes (%llu.%02llux)\n",
+               total_size, total_stored, ratio / 100, ratio % 100);
+    }
+    zpool_stats_t zp;
+    zpool_get_stats(&zp);
+    if (zp.nr_objs) {
+        printk("  zpool: %llu compressed pages in %llu pages (objects %llu KB)\n",
+               zp.nr_objs, zp.nr_pages, zp.bytes / 1024);
+    }
+    if (zstats.compressed) {
+        uint64_t cticks = zstats.compress_ticks ? zstats.compress_ticks : 1;
+        uint64_t dticks = zstats.decompress_ticks ? zstats.decompress_ticks : 1;
+        printk("  Compress: %llu KB at %llu KB/s, %llu incompressible pages\n",
+               zstats.compressed / 1024,
+               zstats.compressed * TIMEBASE_FREQ / cticks / 1024,
+               zstats.incompressible);
+        printk("  Decompress: %llu KB at %llu KB/s, cache %llu hits / %llu misses\n",
+               zstats.decompressed / 1024,
+               zstats.decompressed * TIMEBASE_FREQ / dticks / 1024,
+               zstats.cache_hits, zstats.cache_misses);
+    }
+    return 0;
+}
+
+int fs_set_compress(const char *path, bool on) {
+    file_t *file = fs_find(path);
+    if (!file) {
+        printk("[FS] File not found: %s\n", path);
+        return -1;
+    }
+    if (file->disk_ino || file->readonly) {
+        printk("[FS] Compression not supported: %s\n", path);
+        return -1;
+    }
+
+    file->compress = on;
+    if (file->type != FILE_TYPE_REGULAR) {
+        return 0;
+    }
+
+    if (on) {
+        file_compress(file);
+    } else {
+        /* 全部解压回普通页 */
+        uint64_t npages = PAGE_ALIGN_UP(file->size) / PAGE_SIZE;
+        for (uint64_t idx = 0; idx < npages && file->nr_zpages > 0; idx++) {
+            void **slot = file_slot(file, idx, false);
+            if (slot && is_zpage(*slot) && !file_page(file, idx, false)) {
+                printk(KERN_ERR "[FS] Out of memory decompressing %s\n", path);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+void fs_get_zstats(fs_zstats_t *stats) {
+    *stats = zstats;
+}
+
+void fs_sync(void) {
+    nosfs_sync();
+}
+
+/* ---------------- 当前目录 ---------------- */
+
+void fs_get(file_t *file) {
+    file->refs++;
+}
+
+/* 最后一个引用释放时写回 (计算校验和、压缩剩余的页) */
+void fs_put(file_t *file) {
+    if (--file->refs == 0) {
+        file_writeback(file);
+    }
+}
+
+int fs_chdir(const char *path) {
+    file_t *dir = fs_find(path);
+    if (!dir || dir->type != FILE_TYPE_DIRECTORY) {
+        printk("[FS] Not a directory: %s\n", path);
+        return -1;
+    }
+
+    process_t *proc = current_process();
+    if (!proc) {
+        return -1;
+    }
+    fs_get(dir);
+    if (proc->cwd) {
+        fs_put(proc->cwd);
+    }
+    proc->cwd = dir;
+    return 0;
+}
+
+int fs_getcwd(char *buf, size_t size) {
+    return fs_getcwd_of(cwd(), buf, size);
 }
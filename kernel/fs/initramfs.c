@@ -0,0 +1,140 @@
+/* initramfs - 链接进内核镜像的cpio归档, 作为只读文件直接提供 */
+#include <kernel/fs.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+#include <kernel/init.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * make时tools/mkcpio把initramfs/目录打包成newc格式的initramfs.cpio,
+ * kernel/fs/initramfs_data.S用.incbin把它放进.initramfs段.
+ * 启动时只解析头部建立目录树, 文件数据留在原处: file->rodata直接指向归档中的数据,
+ * 不分配数据页, 也没有拷贝, 因此归档的大小不影响启动时间.
+ * 载入在shell出现之后由kinit线程进行 (deferred_initcall), shell执行命令前会等它完成.
+ *
+ * newc格式: 每个条目是110字节的ASCII头部 + 文件名 (含结尾0) + 数据,
+ * 文件名和数据分别补齐到4字节. 以名为TRAILER!!!的条目结束.
+ */
+
+extern char initramfs_start[];
+extern char initramfs_end[];
+
+#define CPIO_HDR_SIZE 110
+#define CPIO_TRAILER  "TRAILER!!!"
+
+#define CPIO_S_IFMT   0170000
+#define CPIO_S_IFDIR  0040000
+#define CPIO_S_IFREG  0100000
+
+/* 头部字段 (magic之后, 每个8位十六进制) */
+enum {
+    CPIO_INO, CPIO_MODE, CPIO_UID, CPIO_GID, CPIO_NLINK, CPIO_MTIME,
+    CPIO_FILESIZE, CPIO_DEVMAJOR, CPIO_DEVMINOR, CPIO_RDEVMAJOR,
+    CPIO_RDEVMINOR, CPIO_NAMESIZE, CPIO_CHECK
+};
+
+#define CPIO_ALIGN(x) (((x) + 3) & ~(uint64_t)3)
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* 读取第idx个头部字段, 格式错误返回-1 */
+static int64_t cpio_field(const char *hdr, int idx) {
+    const char *p = hdr + 6 + idx * 8;
+    int64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        int d = hex_digit(p[i]);
+        if (d < 0) {
+            return -1;
+        }
+        v = (v << 4) | d;
+    }
+    return v;
+}
+
+void initramfs_init(void) {
+    const char *p = initramfs_start;
+    const char *end = initramfs_end;
+    uint64_t nr_files = 0, nr_dirs = 0, bytes = 0;
+    char path[MAX_PATH];
+    uint64_t start = rdtime();
+
+    while (p + CPIO_HDR_SIZE <= end) {
+        if (memcmp(p, "07070", 5) != 0 || (p[5] != '1' && p[5] != '2')) {
+            printk(KERN_ERR "[INITRAMFS] Bad cpio header at offset %llu\n",
+                   (uint64_t)(p - initramfs_start));
+            return;
+        }
+
+        int64_t mode = cpio_field(p, CPIO_MODE);
+        int64_t size = cpio_field(p, CPIO_FILESIZE);
+        int64_t namesize = cpio_field(p, CPIO_NAMESIZE);
+        const char *name = p + CPIO_HDR_SIZE;
+        const char *data = initramfs_start +
+                           CPIO_ALIGN(name + namesize - initramfs_start);
+
+        if (mode < 0 || size < 0 || namesize <= 0 || data + size > end ||
+            name[namesize - 1] != '\0') {
+            printk(KERN_ERR "[INITRAMFS] Corrupt entry at offset %llu\n",
+                   (uint64_t)(p - initramfs_start));
+            return;
+        }
+        if (strcmp(name, CPIO_TRAILER) == 0) {
+            break;
+        }
+        p = initramfs_start + CPIO_ALIGN(data + size - initramfs_start);
+
+        /* 归档中的路径相对于根目录, 可能带"./"前缀 */
+        while (name[0] == '.' && name[1] == '/') {
+            name += 2;
+        }
+        if (name[0] == '\0' || strcmp(name, ".") == 0) {
+            continue;
+        }
+        if (strlen(name) + 2 > sizeof(path)) {
+            printk(KERN_WARNING "[INITRAMFS] Path too long, skipped: %s\n", name);
+            continue;
+        }
+        path[0] = '/';
+        strcpy(path + 1, name);
+
+        /* 磁盘上已有同名文件时保留磁盘上的 */
+        if (fs_find(path)) {
+            printk(KERN_WARNING "[INITRAMFS] %s exists, skipped\n", path);
+            continue;
+        }
+
+        switch (mode & CPIO_S_IFMT) {
+            case CPIO_S_IFDIR:
+                if (fs_create_rodata(path, FILE_TYPE_DIRECTORY, NULL, 0) == 0) {
+                    nr_dirs++;
+                }
+                break;
+            case CPIO_S_IFREG:
+                if (fs_create_rodata(path, FILE_TYPE_REGULAR, data, size) == 0) {
+                    nr_files++;
+                    bytes += size;
+                }
+                break;
+            default:
+                /* 设备文件、符号链接等不支持 */
+                break;
+        }
+    }
+
+    uint64_t us = (rdtime() - start) / (TIMEBASE_FREQ / 1000000);
+    printk("  initramfs: %llu files, %llu dirs, %llu bytes in %llu us (read-only, zero-copy)\n",
+           nr_files, nr_dirs, bytes, us);
+}
+
+deferred_initcall(initramfs_init);
@@ -0,0 +1,306 @@
+/* 元数据日志 - 成组提交的物理块日志 */
+#include <kernel/nosfs.h>
+#include <kernel/buf.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 文件系统操作在journal_begin/journal_end之间修改元数据块, 每修改一个块就调用
+ * journal_log: 块被钉在缓存中 (引用计数 + B_JOURNAL), 既不会被淘汰也不会被
+ * bflushd提前写回. 多个操作累积成一个事务, 在事务将满、sync或kjournald定时
+ * 到期时提交:
+ *   1. 写回脏数据块 (元数据提交后不会指向未写入的数据)
+ *   2. 把事务中的块写入日志区
+ *   3. 写日志头 (nr = 块数)        <- 提交点
+ *   4. 把这些块写回原位
+ *   5. 清空日志头 (nr = 0)
+ * 在3和5之间崩溃时, 挂载只需把日志块复制回原位, 耗时与日志大小有关,
+ * 与磁盘大小和文件数无关.
+ */
+
+#define JOURNAL_COMMIT_INTERVAL TIMEBASE_FREQ   /* 最多1秒提交一次 */
+#define JOURNAL_IO_BATCH 64     /* 复制日志时每批占用的缓冲区数 */
+
+static uint64_t j_start;
+static uint32_t j_capacity;
+static uint64_t j_seq;
+
+static buf_t *tx_bufs[NOSFS_JOURNAL_MAX];
+static uint32_t tx_nr;
+static int op_count;            /* 正在进行的操作数 */
+static bool committing;
+
+static journal_stats_t jstats;
+
+/*
+ * 把块src(i)的内容复制到块dst(i)并同步写盘, i = 0..n-1.
+ * 分批进行, 避免大事务同时占住太多缓冲区. 返回成功复制的块数.
+ */
+static uint32_t journal_copy(uint32_t n, uint64_t (*src)(uint32_t, void *),
+                             uint64_t (*dst)(uint32_t, void *), void *arg) {
+    buf_t *batch[JOURNAL_IO_BATCH];
+
+    for (uint32_t i = 0; i < n; i += JOURNAL_IO_BATCH) {
+        uint32_t cnt = (n - i < JOURNAL_IO_BATCH) ? n - i : JOURNAL_IO_BATCH;
+
+        for (uint32_t k = 0; k < cnt; k++) {
+            buf_t *from = bread(ROOT_DEV, src(i + k, arg));
+            buf_t *to = from ? bget(ROOT_DEV, dst(i + k, arg)) : NULL;
+            if (!to) {
+                printk(KERN_ERR "[JOURNAL] Cannot copy block %u\n", i + k);
+                brelse(from);
+                bwrite_batch(batch, k);
+                for (uint32_t j = 0; j < k; j++) {
+                    brelse(batch[j]);
+                }
+                return i + k;
+            }
+            if (to != from) {
+                memcpy(to->data, from->data, BLOCK_SIZE);
+            }
+            brelse(from);
+            batch[k] = to;
+        }
+
+        int errors = bwrite_batch(batch, cnt);
+        for (uint32_t k = 0; k < cnt; k++) {
+            brelse(batch[k]);
+        }
+        if (errors) {
+            return i;
+        }
+    }
+    return n;
+}
+
+static uint64_t log_block(uint32_t i, void *arg) {
+    (void)arg;
+    return j_start + 1 + i;
+}
+
+static uint64_t home_block(uint32_t i, void *arg) {
+    return ((nosfs_journal_t *)arg)->blocks[i];
+}
+
+/* 把日志中已提交的事务写回原位, 返回重放的块数 */
+static int journal_recover(void) {
+    buf_t *hb = bread(ROOT_DEV, j_start);
+    if (!hb) {
+        return -1;
+    }
+    nosfs_journal_t *hdr = (nosfs_journal_t *)hb->data;
+    uint32_t n = hdr->nr;
+
+    if (n == 0) {
+        brelse(hb);
+        return 0;
+    }
+    if (n > j_capacity) {
+        printk(KERN_ERR "[JOURNAL] Corrupt header (%u blocks)\n", n);
+        brelse(hb);
+        return -1;
+    }
+
+    uint64_t start = rdtime();
+
+    if (journal_copy(n, log_block, home_block, hdr) < n) {
+        printk(KERN_ERR "[JOURNAL] Replay failed\n");
+        brelse(hb);
+        return -1;
+    }
+
+    hdr->nr = 0;
+    bwrite(hb);
+    brelse(hb);
+
+    jstats.replayed += n;
+    jstats.replay_ticks += rdtime() - start;
+    return n;
+}
+
+static void kjournald(void) {
+    uint64_t next_run = rdtime() + JOURNAL_COMMIT_INTERVAL;
+
+    while (1) {
+        uint64_t now = rdtime();
+        if (now >= next_run) {
+            next_run = now + JOURNAL_COMMIT_INTERVAL;
+            journal_commit();
+        }
+        yield();
+    }
+}
+
+int journal_init(uint64_t start, uint64_t nblocks) {
+    if (nblocks < 2) {
+        return -1;
+    }
+
+    j_start = start;
+    j_capacity = nblocks - 1;
+    if (j_capacity > NOSFS_JOURNAL_MAX) {
+        j_capacity = NOSFS_JOURNAL_MAX;
+    }
+    if (j_capacity < JOURNAL_OP_BLOCKS) {
+        printk(KERN_ERR "[JOURNAL] Journal too small (%u blocks)\n", j_capacity);
+        return -1;
+    }
+
+    buf_t *hb = bread(ROOT_DEV, j_start);
+    if (!hb) {
+        return -1;
+    }
+    nosfs_journal_t *hdr = (nosfs_journal_t *)hb->data;
+    bool valid = (hdr->magic == NOSFS_JOURNAL_MAGIC);
+    j_seq = hdr->seq;
+    brelse(hb);
+
+    if (!valid) {
+        printk(KERN_ERR "[JOURNAL] Bad journal magic\n");
+        return -1;
+    }
+
+    int n = journal_recover();
+    if (n < 0) {
+        return -1;
+    }
+    if (n > 0) {
+        printk("  Journal: replayed %d blocks in %llu us\n",
+               n, jstats.replay_ticks / (TIMEBASE_FREQ / 1000000));
+    }
+
+    jstats.capacity = j_capacity;
+    create_process("kjournald", kjournald);
+    return 0;
+}
+
+void journal_begin(void) {
+    /* 提交期间不开始新操作; 剩余空间不够所有进行中的操作时先提交 */
+    while (committing ||
+           tx_nr + (op_count + 1) * JOURNAL_OP_BLOCKS > j_capacity) {
+        if (!committing && op_count == 0) {
+            journal_commit();
+        } else {
+            yield();
+        }
+    }
+    op_count++;
+    jstats.ops++;
+}
+
+void journal_end(void) {
+    op_count--;
+    if (op_count == 0 && tx_nr + JOURNAL_OP_BLOCKS > j_capacity) {
+        journal_commit();
+    }
+}
+
+void journal_log(buf_t *b) {
+    if (__atomic_load_n(&b->flags, __ATOMIC_ACQUIRE) & B_JOURNAL) {
+        return;     /* 同一事务中多次修改只记录一次 */
+    }
+    if (tx_nr >= j_capacity) {
+        printk(KERN_EMERG "[JOURNAL] Transaction overflow at block %llu\n", b->blockno);
+        return;
+    }
+
+    __atomic_fetch_or(&b->flags, B_JOURNAL, __ATOMIC_ACQ_REL);
+    b->refcnt++;
+    tx_bufs[tx_nr++] = b;
+}
+
+void journal_commit(void) {
+    static nosfs_journal_t tx_blocks;
+
+    if (committing || op_count > 0 || tx_nr == 0) {
+        return;
+    }
+    committing = true;
+
+    uint32_t n = tx_nr;
+
+    /* 1. 数据先落盘 */
+    bsync();
+
+    /* 2. 写日志块 (事务中的块还钉在缓存里, 按块号读到的就是它们) */
+    for (uint32_t i = 0; i < n; i++) {
+        tx_blocks.blocks[i] = tx_bufs[i]->blockno;
+    }
+    int errors = (journal_copy(n, home_block, log_block, &tx_blocks) < n);
+
+    /* 3. 提交点 */
+    buf_t *hb = bread(ROOT_DEV, j_start);
+    if (hb && errors == 0) {
+        nosfs_journal_t *hdr = (nosfs_journal_t *)hb->data;
+        hdr->magic = NOSFS_JOURNAL_MAGIC;
+        hdr->seq = ++j_seq;
+        memcpy(hdr->blocks, tx_blocks.blocks, n * sizeof(uint32_t));
+        hdr->nr = n;
+        bwrite(hb);
+    } else {
+        printk(KERN_ERR "[JOURNAL] Commit %llu failed, writing in place\n", j_seq + 1);
+    }
+
+    /* 4. 写回原位 */
+    bwrite_batch(tx_bufs, n);
+
+    /* 5. 清空日志 */
+    if (hb) {
+        ((nosfs_journal_t *)hb->data)->nr = 0;
+        bwrite(hb);
+        brelse(hb);
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        __atomic_fetch_and(&tx_bufs[i]->flags, ~B_JOURNAL, __ATOMIC_ACQ_REL);
+        tx_bufs[i]->refcnt--;
+    }
+
+    jstats.commits++;
+    jstats.blocks_logged += n;
+    tx_nr = 0;
+    committing = false;
+}
+
+void journal_get_stats(journal_stats_t *stats) {
+    *stats = jstats;
+    stats->running = tx_nr;
+}
+
+int journal_replay_test(uint32_t nblocks) {
+    journal_commit();
+    if (tx_nr > 0 || op_count > 0) {
+        return -1;
+    }
+    if (nblocks > j_capacity) {
+        nblocks = j_capacity;
+    }
+
+    /* 日志区之后紧接着位图和inode表; 把它们的当前内容写入日志并提交, 但不清空日志头 */
+    uint64_t first_block = j_start + 1 + j_capacity;
+    committing = true;
+    buf_t *hb = bread(ROOT_DEV, j_start);
+    if (!hb) {
+        committing = false;
+        return -1;
+    }
+    nosfs_journal_t *hdr = (nosfs_journal_t *)hb->data;
+
+    for (uint32_t i = 0; i < nblocks; i++) {
+        hdr->blocks[i] = first_block + i;
+    }
+    nblocks = journal_copy(nblocks, home_block, log_block, hdr);
+
+    hdr->magic = NOSFS_JOURNAL_MAGIC;
+    hdr->seq = ++j_seq;
+    hdr->nr = nblocks;
+    bwrite(hb);
+    brelse(hb);
+
+    /* "崩溃"后的恢复 */
+    int n = journal_recover();
+    committing = false;
+    return n;
+}
@@ -0,0 +1,636 @@
+/* nosfs - 带元数据日志的磁盘文件系统 */
+#include <kernel/nosfs.h>
+#include <kernel/buf.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+
+/*
+ * 内存中的目录树 (fs.c的file_t/dentry) 充当inode和目录项缓存:
+ * 磁盘上的目录在第一次被访问时整个读入, 之后的查找都在dcache中完成.
+ * 这里只负责磁盘格式: inode、位图、块映射和目录块.
+ *
+ * 元数据 (inode表、位图、间接块、目录块) 的修改都经过日志;
+ * 文件数据直接写入块缓存, 由bflushd或日志提交时写回.
+ */
+
+#define IPB NOSFS_INODES_PER_BLOCK
+#define DPB NOSFS_DIRENTS_PER_BLOCK
+#define NIND NOSFS_NINDIRECT
+
+/* 单个日志操作写入的最大数据量, 保证元数据修改不超过JOURNAL_OP_BLOCKS */
+#define WRITE_OP_BYTES (1024 * 1024)
+
+static nosfs_super_t sb;
+static bool mounted;
+static uint64_t inode_hint = NOSFS_ROOT_INO;
+static uint64_t block_hint;
+
+bool nosfs_mounted(void) {
+    return mounted;
+}
+
+uint64_t nosfs_nr_blocks(void) {
+    return mounted ? sb.nr_blocks : 0;
+}
+
+/* ---------------- inode和位图 ---------------- */
+
+static buf_t *inode_get(uint32_t ino, nosfs_inode_t **ip) {
+    buf_t *b = bread(ROOT_DEV, sb.inode_table_start + ino / IPB);
+    if (b) {
+        *ip = (nosfs_inode_t *)(b->data + (ino % IPB) * NOSFS_INODE_SIZE);
+    }
+    return b;
+}
+
+/* 从hint开始找一个空闲位并置位, 返回位号; 0表示没有空闲位 (位0总是被占用) */
+static uint64_t bitmap_alloc(uint64_t start, uint64_t nbits, uint64_t *hint) {
+    uint64_t nblocks = (nbits + NOSFS_BITS_PER_BLOCK - 1) / NOSFS_BITS_PER_BLOCK;
+    uint64_t first = (*hint % nbits) / NOSFS_BITS_PER_BLOCK;
+
+    /* 多看一次起始块, 覆盖hint之前的部分 */
+    for (uint64_t i = 0; i <= nblocks; i++) {
+        uint64_t blk = (first + i) % nblocks;
+        buf_t *b = bread(ROOT_DEV, start + blk);
+        if (!b) {
+            return 0;
+        }
+
+        uint64_t *words = (uint64_t *)b->data;
+        uint64_t w = (i == 0) ? (*hint % NOSFS_BITS_PER_BLOCK) / 64 : 0;
+        for (; w < NOSFS_BLOCK_SIZE / 8; w++) {
+            if (words[w] == ~0ULL) {
+                continue;
+            }
+            int bit = 0;
+            while (words[w] & (1ULL << bit)) {
+                bit++;
+            }
+            uint64_t n = blk * NOSFS_BITS_PER_BLOCK + w * 64 + bit;
+            if (n >= nbits) {
+                break;
+            }
+            words[w] |= 1ULL << bit;
+            journal_log(b);
+            brelse(b);
+            *hint = n + 1;
+            return n;
+        }
+        brelse(b);
+    }
+    return 0;
+}
+
+static void bitmap_free(uint64_t start, uint64_t n) {
+    buf_t *b = bread(ROOT_DEV, start + n / NOSFS_BITS_PER_BLOCK);
+    if (!b) {
+        return;
+    }
+    uint64_t bit = n % NOSFS_BITS_PER_BLOCK;
+    b->data[bit / 8] &= ~(1 << (bit % 8));
+    journal_log(b);
+    brelse(b);
+}
+
+static uint32_t balloc(void) {
+    uint32_t blk = bitmap_alloc(sb.block_bitmap_start, sb.nr_blocks, &block_hint);
+    if (!blk) {
+        printk(KERN_ERR "[NOSFS] Disk full\n");
+    }
+    return blk;
+}
+
+/* 释放的块在缓存中的脏数据不再写回 (重新分配后可能成为元数据块) */
+static void bfree(uint32_t blk) {
+    if (blk >= sb.data_start && blk < sb.nr_blocks) {
+        bdiscard(ROOT_DEV, blk);
+        bitmap_free(sb.block_bitmap_start, blk);
+    }
+}
+
+/* ---------------- 块映射 ---------------- */
+
+/*
+ * 读取块指针*ptr (位于缓冲区holder中), 为0且alloc时分配新块.
+ * 新分配的间接块/目录块(meta)清零并记入日志; 新数据块由调用者初始化.
+ */
+static uint32_t map_slot(uint32_t *ptr, buf_t *holder, bool alloc, bool meta, bool *fresh) {
+    if (*ptr) {
+        return *ptr;
+    }
+    if (!alloc) {
+        return 0;
+    }
+
+    uint32_t blk = balloc();
+    if (!blk) {
+        return 0;
+    }
+    if (meta) {
+        /* 缓存中可能还有这个块以前作为数据块的脏内容, 不能在提交前写回原位 */
+        bdiscard(ROOT_DEV, blk);
+        buf_t *nb = bget(ROOT_DEV, blk);
+        if (!nb) {
+            bfree(blk);
+            return 0;
+        }
+        memset(nb->data, 0, BLOCK_SIZE);
+        journal_log(nb);
+        brelse(nb);
+    }
+
+    *ptr = blk;
+    journal_log(holder);
+    if (fresh) {
+        *fresh = true;
+    }
+    return blk;
+}
+
+/* 文件第bn块所在的磁盘块, 0表示空洞 (或分配失败) */
+static uint32_t bmap(nosfs_inode_t *ip, buf_t *ib, uint64_t bn, bool alloc,
+                     bool meta, bool *fresh) {
+    if (fresh) {
+        *fresh = false;
+    }
+
+    if (bn < NOSFS_NDIRECT) {
+        return map_slot(&ip->direct[bn], ib, alloc, meta, fresh);
+    }
+    bn -= NOSFS_NDIRECT;
+
+    uint32_t ind;
+    if (bn < NIND) {
+        ind = map_slot(&ip->indirect, ib, alloc, true, NULL);
+    } else {
+        bn -= NIND;
+        if (bn >= (uint64_t)NIND * NIND) {
+            printk(KERN_ERR "[NOSFS] File too large\n");
+            return 0;
+        }
+        uint32_t dind = map_slot(&ip->dindirect, ib, alloc, true, NULL);
+        if (!dind) {
+            return 0;
+        }
+        buf_t *b = bread(ROOT_DEV, dind);
+        if (!b) {
+            return 0;
+        }
+        ind = map_slot(&((uint32_t *)b->data)[bn / NIND], b, alloc, true, NULL);
+        brelse(b);
+        bn %= NIND;
+    }
+    if (!ind) {
+        return 0;
+    }
+
+    buf_t *b = bread(ROOT_DEV, ind);
+    if (!b) {
+        return 0;
+    }
+    uint32_t blk = map_slot(&((uint32_t *)b->data)[bn], b, alloc, meta, fresh);
+    brelse(b);
+    return blk;
+}
+
+/*
+ * 释放以blk为根、高度为level的子树中文件块号 >= from 的块,
+ * base为子树覆盖的第一个文件块号. 整个子树被释放时返回true.
+ */
+static bool free_tree(uint32_t blk, int level, uint64_t base, uint64_t from) {
+    if (level == 0) {
+        if (base < from) {
+            return false;
+        }
+        bfree(blk);
+        return true;
+    }
+
+    uint64_t span = (level == 1) ? 1 : NIND;
+    buf_t *b = bread(ROOT_DEV, blk);
+    if (!b) {
+        return false;
+    }
+
+    uint32_t *ptrs = (uint32_t *)b->data;
+    bool empty = true;
+    bool changed = false;
+
+    for (int i = 0; i < NIND; i++) {
+        if (!ptrs[i]) {
+            continue;
+        }
+        uint64_t child = base + i * span;
+        if (child + span > from && free_tree(ptrs[i], level - 1, child, from)) {
+            ptrs[i] = 0;
+            changed = true;
+        } else {
+            empty = false;
+        }
+    }
+
+    if (empty) {
+        brelse(b);
+        bfree(blk);
+        return true;
+    }
+    if (changed) {
+        journal_log(b);
+    }
+    brelse(b);
+    return false;
+}
+
+/* 截断inode到size字节; 调用者在日志操作中 */
+static void inode_truncate(nosfs_inode_t *ip, buf_t *ib, size_t size) {
+    uint64_t from = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    for (uint64_t i = from; i < NOSFS_NDIRECT; i++) {
+        if (ip->direct[i]) {
+            bfree(ip->direct[i]);
+            ip->direct[i] = 0;
+        }
+    }
+    if (ip->indirect && free_tree(ip->indirect, 1, NOSFS_NDIRECT, from)) {
+        ip->indirect = 0;
+    }
+    if (ip->dindirect && free_tree(ip->dindirect, 2, NOSFS_NDIRECT + NIND, from)) {
+        ip->dindirect = 0;
+    }
+
+    /* 最后一块size之后的部分清零, 以后扩展文件时读出为0 */
+    if (size % BLOCK_SIZE) {
+        uint32_t blk = bmap(ip, ib, size / BLOCK_SIZE, false, false, NULL);
+        buf_t *db = blk ? bread(ROOT_DEV, blk) : NULL;
+        if (db) {
+            memset(db->data + size % BLOCK_SIZE, 0, BLOCK_SIZE - size % BLOCK_SIZE);
+            bdirty(db);
+            brelse(db);
+        }
+    }
+
+    ip->size = size;
+    journal_log(ib);
+}
+
+/* ---------------- 文件数据 ---------------- */
+
+size_t nosfs_read_at(file_t *file, size_t offset, void *buf, size_t len) {
+    uint8_t *dst = buf;
+
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (len > file->size - offset) {
+        len = file->size - offset;
+    }
+
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(file->disk_ino, &ip);
+    if (!ib) {
+        return 0;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        size_t pos = offset + done;
+        size_t in_block = pos % BLOCK_SIZE;
+        size_t chunk = BLOCK_SIZE - in_block;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        uint32_t blk = bmap(ip, ib, pos / BLOCK_SIZE, false, false, NULL);
+        if (blk) {
+            buf_t *db = bread(ROOT_DEV, blk);
+            if (!db) {
+                break;
+            }
+            memcpy(dst + done, db->data + in_block, chunk);
+            brelse(db);
+        } else {
+            memset(dst + done, 0, chunk);
+        }
+        done += chunk;
+    }
+
+    brelse(ib);
+    return done;
+}
+
+size_t nosfs_write_at(file_t *file, size_t offset, const void *buf, size_t len) {
+    const uint8_t *src = buf;
+    size_t done = 0;
+    bool failed = false;
+
+    /* 大的写入拆成多个日志操作 */
+    while (done < len && !failed) {
+        size_t op_end = done + WRITE_OP_BYTES;
+        if (op_end > len) {
+            op_end = len;
+        }
+
+        journal_begin();
+        nosfs_inode_t *ip;
+        buf_t *ib = inode_get(file->disk_ino, &ip);
+        if (!ib) {
+            journal_end();
+            break;
+        }
+
+        while (done < op_end) {
+            size_t pos = offset + done;
+            size_t in_block = pos % BLOCK_SIZE;
+            size_t chunk = BLOCK_SIZE - in_block;
+            if (chunk > op_end - done) {
+                chunk = op_end - done;
+            }
+
+            bool fresh;
+            uint32_t blk = bmap(ip, ib, pos / BLOCK_SIZE, true, false, &fresh);
+            if (!blk) {
+                failed = true;
+                break;
+            }
+
+            /* 整块覆盖或新块不需要先读盘 */
+            buf_t *db = (fresh || chunk == BLOCK_SIZE) ? bget(ROOT_DEV, blk)
+                                                       : bread(ROOT_DEV, blk);
+            if (!db) {
+                failed = true;
+                break;
+            }
+            if (fresh && chunk < BLOCK_SIZE) {
+                memset(db->data, 0, BLOCK_SIZE);
+            }
+            memcpy(db->data + in_block, src + done, chunk);
+            bdirty(db);
+            brelse(db);
+            done += chunk;
+        }
+
+        if (offset + done > ip->size) {
+            ip->size = offset + done;
+            journal_log(ib);
+        }
+        file->size = ip->size;
+        brelse(ib);
+        journal_end();
+    }
+
+    return done;
+}
+
+void nosfs_truncate(file_t *file, size_t size) {
+    journal_begin();
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(file->disk_ino, &ip);
+    if (ib) {
+        inode_truncate(ip, ib, size);
+        file->size = size;
+        brelse(ib);
+    }
+    journal_end();
+}
+
+/* ---------------- 目录 ---------------- */
+
+int nosfs_dir_load(file_t *dir, nosfs_fill_t fill) {
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(dir->disk_ino, &ip);
+    if (!ib) {
+        return -1;
+    }
+
+    int ret = 0;
+    uint64_t nblocks = ip->size / BLOCK_SIZE;
+
+    for (uint64_t bn = 0; bn < nblocks && ret == 0; bn++) {
+        uint32_t blk = bmap(ip, ib, bn, false, false, NULL);
+        buf_t *db = blk ? bread(ROOT_DEV, blk) : NULL;
+        if (!db) {
+            continue;
+        }
+
+        nosfs_dirent_t *de = (nosfs_dirent_t *)db->data;
+        for (uint32_t s = 0; s < DPB && ret == 0; s++) {
+            if (de[s].ino == 0 || de[s].ino >= sb.nr_inodes) {
+                continue;
+            }
+
+            char name[NOSFS_NAME_LEN];
+            memcpy(name, de[s].name, NOSFS_NAME_LEN);
+            name[NOSFS_NAME_LEN - 1] = '\0';
+
+            nosfs_inode_t *cip;
+            buf_t *cb = inode_get(de[s].ino, &cip);
+            if (!cb) {
+                continue;
+            }
+            file_type_t type = (cip->type == NOSFS_T_DIR) ? FILE_TYPE_DIRECTORY
+                                                          : FILE_TYPE_REGULAR;
+            size_t size = cip->size;
+            brelse(cb);
+
+            ret = fill(dir, name, de[s].ino, type, size, bn * DPB + s);
+        }
+        brelse(db);
+    }
+
+    brelse(ib);
+    return ret;
+}
+
+/* 目录中的第slot个目录项所在的缓冲区 */
+static buf_t *dirent_get(nosfs_inode_t *dip, buf_t *dib, uint32_t slot,
+                         nosfs_dirent_t **de) {
+    uint32_t blk = bmap(dip, dib, slot / DPB, false, false, NULL);
+    buf_t *db = blk ? bread(ROOT_DEV, blk) : NULL;
+    if (db) {
+        *de = &((nosfs_dirent_t *)db->data)[slot % DPB];
+    }
+    return db;
+}
+
+int nosfs_create(file_t *dir, const char *name, file_t *file, uint32_t *slot_out) {
+    int ret = -1;
+    journal_begin();
+
+    nosfs_inode_t *dip;
+    buf_t *dib = inode_get(dir->disk_ino, &dip);
+    if (!dib) {
+        goto out;
+    }
+
+    /* 分配inode */
+    uint32_t ino = bitmap_alloc(sb.inode_bitmap_start, sb.nr_inodes, &inode_hint);
+    if (!ino) {
+        printk(KERN_ERR "[NOSFS] No free inodes\n");
+        goto out_dir;
+    }
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(ino, &ip);
+    if (!ib) {
+        bitmap_free(sb.inode_bitmap_start, ino);
+        goto out_dir;
+    }
+    memset(ip, 0, NOSFS_INODE_SIZE);
+    ip->type = (file->type == FILE_TYPE_DIRECTORY) ? NOSFS_T_DIR : NOSFS_T_FILE;
+    ip->nlink = 1;
+    ip->parent = dir->disk_ino;
+    journal_log(ib);
+    brelse(ib);
+
+    /* 从dir_hint开始找空目录项, 没有就在目录末尾加一块 */
+    uint32_t nslots = dip->size / BLOCK_SIZE * DPB;
+    uint32_t slot = dir->dir_hint;
+    nosfs_dirent_t *de = NULL;
+    buf_t *db = NULL;
+
+    for (; slot < nslots; slot++) {
+        if (!db || slot % DPB == 0) {
+            brelse(db);
+            db = dirent_get(dip, dib, slot, &de);
+            if (!db) {
+                continue;
+            }
+        } else {
+            de++;
+        }
+        if (de->ino == 0) {
+            break;
+        }
+    }
+
+    if (slot >= nslots) {
+        brelse(db);
+        if (!bmap(dip, dib, nslots / DPB, true, true, NULL)) {
+            bitmap_free(sb.inode_bitmap_start, ino);
+            goto out_dir;
+        }
+        dip->size += BLOCK_SIZE;
+        journal_log(dib);
+        slot = nslots;
+        db = dirent_get(dip, dib, slot, &de);
+        if (!db) {
+            bitmap_free(sb.inode_bitmap_start, ino);
+            goto out_dir;
+        }
+    }
+
+    memset(de, 0, sizeof(*de));
+    de->ino = ino;
+    de->type = ip->type;
+    de->name_len = strlen(name);
+    strcpy(de->name, name);
+    journal_log(db);
+    brelse(db);
+
+    dir->dir_hint = slot + 1;
+    dir->size = dip->size;
+    file->disk_ino = ino;
+    *slot_out = slot;
+    ret = 0;
+
+out_dir:
+    brelse(dib);
+out:
+    journal_end();
+    return ret;
+}
+
+int nosfs_remove(file_t *dir, file_t *file, uint32_t slot) {
+    int ret = -1;
+    journal_begin();
+
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(file->disk_ino, &ip);
+    if (!ib) {
+        goto out;
+    }
+    inode_truncate(ip, ib, 0);
+    ip->type = NOSFS_T_FREE;
+    ip->nlink = 0;
+    brelse(ib);
+    bitmap_free(sb.inode_bitmap_start, file->disk_ino);
+
+    nosfs_inode_t *dip;
+    buf_t *dib = inode_get(dir->disk_ino, &dip);
+    if (!dib) {
+        goto out;
+    }
+    nosfs_dirent_t *de;
+    buf_t *db = dirent_get(dip, dib, slot, &de);
+    if (db) {
+        de->ino = 0;
+        journal_log(db);
+        brelse(db);
+        ret = 0;
+    }
+    brelse(dib);
+
+    if (slot < dir->dir_hint) {
+        dir->dir_hint = slot;
+    }
+
+out:
+    journal_end();
+    return ret;
+}
+
+/* ---------------- 挂载 ---------------- */
+
+int nosfs_mount(file_t *root) {
+    if (!blk_present()) {
+        return -1;
+    }
+
+    buf_t *b = bread(ROOT_DEV, 0);
+    if (!b) {
+        return -1;
+    }
+    memcpy(&sb, b->data, sizeof(sb));
+    brelse(b);
+
+    if (sb.magic != NOSFS_MAGIC) {
+        printk("  No nosfs filesystem on disk (create one with tools/mkfs)\n");
+        return -1;
+    }
+    if (sb.version != NOSFS_VERSION || sb.block_size != NOSFS_BLOCK_SIZE ||
+        sb.nr_blocks * BLOCK_SECTORS > blk_capacity() || sb.data_start >= sb.nr_blocks) {
+        printk(KERN_ERR "[NOSFS] Unsupported or corrupt superblock\n");
+        return -1;
+    }
+
+    if (journal_init(sb.journal_start, sb.journal_blocks) < 0) {
+        return -1;
+    }
+
+    nosfs_inode_t *ip;
+    buf_t *ib = inode_get(NOSFS_ROOT_INO, &ip);
+    if (!ib) {
+        return -1;
+    }
+    bool is_dir = (ip->type == NOSFS_T_DIR);
+    root->size = ip->size;
+    brelse(ib);
+    if (!is_dir) {
+        printk(KERN_ERR "[NOSFS] Root inode is not a directory\n");
+        return -1;
+    }
+
+    root->disk_ino = NOSFS_ROOT_INO;
+    block_hint = sb.data_start;
+    mounted = true;
+
+    printk("  nosfs: %llu blocks, %llu inodes, journal %llu blocks\n",
+           sb.nr_blocks, sb.nr_inodes, sb.journal_blocks);
+    return 0;
+}
+
+void nosfs_sync(void) {
+    if (mounted) {
+        journal_commit();
+        bsync();
+    }
+}
@@ -0,0 +1,186 @@
+/* 内核管道 - 页组成的环形缓冲区, 支持整页转交 */
+#include <kernel/pipe.h>
+#include <kernel/mm.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+
+static inline pipe_buf_t *pipe_slot(pipe_t *pipe, uint32_t i) {
+    return &pipe->bufs[(pipe->head + i) % PIPE_BUFS];
+}
+
+static uint8_t *pipe_alloc_page(pipe_t *pipe) {
+    if (pipe->spare) {
+        uint8_t *page = pipe->spare;
+        pipe->spare = NULL;
+        return page;
+    }
+    return alloc_page_tag(PG_PIPE);
+}
+
+static void pipe_free_page(pipe_t *pipe, uint8_t *page) {
+    if (!pipe->spare) {
+        pipe->spare = page;
+    } else {
+        free_page(page);
+    }
+}
+
+pipe_t *pipe_create(void) {
+    pipe_t *pipe = kzalloc(sizeof(pipe_t));
+    if (!pipe) {
+        printk(KERN_ERR "[PIPE] Out of memory\n");
+        return NULL;
+    }
+    pipe->readers = 1;
+    pipe->writers = 1;
+    wait_queue_init(&pipe->rd_wait);
+    wait_queue_init(&pipe->wr_wait);
+    return pipe;
+}
+
+void pipe_dup(pipe_t *pipe, int end) {
+    if (end == PIPE_READ) {
+        pipe->readers++;
+    } else {
+        pipe->writers++;
+    }
+}
+
+void pipe_close(pipe_t *pipe, int end) {
+    if (end == PIPE_READ) {
+        pipe->readers--;
+    } else {
+        pipe->writers--;
+    }
+
+    /* 对端可能在等待: 写者将发现没有读者, 读者将读到EOF */
+    wake_up(&pipe->rd_wait);
+    wake_up(&pipe->wr_wait);
+
+    if (pipe->readers == 0 && pipe->writers == 0) {
+        for (uint32_t i = 0; i < pipe->nr_bufs; i++) {
+            free_page(pipe_slot(pipe, i)->page);
+        }
+        if (pipe->spare) {
+            free_page(pipe->spare);
+        }
+        kfree(pipe);
+    }
+}
+
+/* 等待空闲槽, 读端全部关闭时返回false */
+static bool pipe_wait_room(pipe_t *pipe) {
+    while (pipe->readers > 0 && pipe->nr_bufs == PIPE_BUFS) {
+        wake_up(&pipe->rd_wait);
+        sleep_on(&pipe->wr_wait);
+    }
+    return pipe->readers > 0;
+}
+
+/* 等待数据, EOF时返回false */
+static bool pipe_wait_data(pipe_t *pipe) {
+    while (pipe->nr_bufs == 0 && pipe->writers > 0) {
+        wake_up(&pipe->wr_wait);
+        sleep_on(&pipe->rd_wait);
+    }
+    return pipe->nr_bufs > 0;
+}
+
+ssize_t pipe_write(pipe_t *pipe, const void *buf, size_t len) {
+    const uint8_t *src = buf;
+    size_t done = 0;
+
+    if (pipe->readers == 0) {
+        return -1;
+    }
+
+    while (done < len) {
+        /* 先填满最后一个槽的页 */
+        pipe_buf_t *last = pipe->nr_bufs ? pipe_slot(pipe, pipe->nr_bufs - 1) : NULL;
+        if (last && last->offset + last->len < PAGE_SIZE) {
+            size_t chunk = PAGE_SIZE - (last->offset + last->len);
+            if (chunk > len - done) {
+                chunk = len - done;
+            }
+            memcpy(last->page + last->offset + last->len, src + done, chunk);
+            last->len += chunk;
+            done += chunk;
+            continue;
+        }
+
+        if (!pipe_wait_room(pipe)) {
+            return done ? (ssize_t)done : -1;
+        }
+        uint8_t *page = pipe_alloc_page(pipe);
+        if (!page) {
+            printk(KERN_ERR "[PIPE] Out of memory\n");
+            break;
+        }
+        pipe_buf_t *b = pipe_slot(pipe, pipe->nr_bufs++);
+        b->page = page;
+        b->offset = 0;
+        b->len = 0;
+    }
+
+    wake_up(&pipe->rd_wait);
+    return done;
+}
+
+ssize_t pipe_read(pipe_t *pipe, void *buf, size_t len) {
+    uint8_t *dst = buf;
+    size_t done = 0;
+
+    if (len == 0 || !pipe_wait_data(pipe)) {
+        return 0;
+    }
+
+    /* 有多少读多少, 不等待更多数据 */
+    while (done < len && pipe->nr_bufs > 0) {
+        pipe_buf_t *b = pipe_slot(pipe, 0);
+        size_t chunk = b->len;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        memcpy(dst + done, b->page + b->offset, chunk);
+        b->offset += chunk;
+        b->len -= chunk;
+        done += chunk;
+
+        /* 读空的槽释放; 最后一个槽写者可能还在追加, 但读空后重新分配也无妨 */
+        if (b->len == 0) {
+            pipe_free_page(pipe, b->page);
+            pipe->head = (pipe->head + 1) % PIPE_BUFS;
+            pipe->nr_bufs--;
+        }
+    }
+
+    wake_up(&pipe->wr_wait);
+    return done;
+}
+
+int pipe_splice_write(pipe_t *pipe, void *page, size_t len) {
+    if (!pipe_wait_room(pipe)) {
+        return -1;
+    }
+
+    pipe_buf_t *b = pipe_slot(pipe, pipe->nr_bufs++);
+    b->page = page;
+    b->offset = 0;
+    b->len = len;
+
+    wake_up(&pipe->rd_wait);
+    return 0;
+}
+
+int pipe_splice_read(pipe_t *pipe, pipe_buf_t *buf) {
+    if (!pipe_wait_data(pipe)) {
+        return 0;
+    }
+
+    *buf = *pipe_slot(pipe, 0);
+    pipe->head = (pipe->head + 1) % PIPE_BUFS;
+    pipe->nr_bufs--;
+
+    wake_up(&pipe->wr_wait);
+    return 1;
+}
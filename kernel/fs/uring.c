@@ -0,0 +1,262 @@
+/* 异步文件I/O环 - 提交/完成队列和执行请求的内核工作线程 */
+#include <kernel/uring.h>
+#include <kernel/file.h>
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+
+/* 工作线程通过匹配自己的PCB找到所属的环 */
+#define URING_MAX_RINGS 8
+static uring_t *rings[URING_MAX_RINGS];
+
+static int64_t uring_open(uring_t *ring, const uring_sqe_t *sqe) {
+    int slot = 0;
+    while (slot < URING_MAX_FILES && ring->files[slot]) {
+        slot++;
+    }
+    if (slot == URING_MAX_FILES || !sqe->path) {
+        return -1;
+    }
+
+    file_t *file = fs_find(sqe->path);
+    if (!file && (sqe->flags & O_CREAT)) {
+        if (fs_create(sqe->path, FILE_TYPE_REGULAR) != 0) {
+            return -1;
+        }
+        file = fs_find(sqe->path);
+    }
+    if (!file || file->type != FILE_TYPE_REGULAR) {
+        return -1;
+    }
+    if (file->readonly && (sqe->flags & O_ACCMODE) != O_RDONLY) {
+        return -1;
+    }
+
+    fs_get(file);
+    if ((sqe->flags & O_TRUNC) && (sqe->flags & O_ACCMODE) != O_RDONLY) {
+        fs_truncate(file, 0);
+    }
+    ring->files[slot] = file;
+    return slot;
+}
+
+static file_t *uring_file(uring_t *ring, int32_t fd) {
+    if (fd < 0 || fd >= URING_MAX_FILES) {
+        return NULL;
+    }
+    return ring->files[fd];
+}
+
+static int64_t uring_execute(uring_t *ring, const uring_sqe_t *sqe) {
+    file_t *file;
+
+    switch (sqe->opcode) {
+        case URING_OP_NOP:
+            return 0;
+        case URING_OP_OPEN:
+            return uring_open(ring, sqe);
+        case URING_OP_READ:
+            if (!(file = uring_file(ring, sqe->file))) {
+                return -1;
+            }
+            return fs_read_at(file, sqe->offset, sqe->buf, sqe->len);
+        case URING_OP_WRITE:
+            if (!(file = uring_file(ring, sqe->file)) || file->readonly) {
+                return -1;
+            }
+            if (fs_write_at(file, sqe->offset, sqe->buf, sqe->len) != sqe->len) {
+                return -1;
+            }
+            return sqe->len;
+        case URING_OP_CLOSE:
+            if (!(file = uring_file(ring, sqe->file))) {
+                return -1;
+            }
+            ring->files[sqe->file] = NULL;
+            fs_put(file);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * 工作线程: 取出所有已发布的请求依次执行, 一批结束后唤醒一次等待完成的提交者.
+ * CQ满时先唤醒提交者让它消费, 自己等待空位.
+ */
+static void uring_worker(void) {
+    uring_t *ring = NULL;
+    for (int i = 0; i < URING_MAX_RINGS; i++) {
+        if (rings[i] && rings[i]->worker == current_process()) {
+            ring = rings[i];
+            break;
+        }
+    }
+    if (!ring) {
+        return;
+    }
+
+    for (;;) {
+        uint32_t tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+        if (ring->sq_head == tail) {
+            if (ring->stop) {
+                break;
+            }
+            sleep_on(&ring->sq_wait);
+            continue;
+        }
+
+        ring->stats.batches++;
+        while (ring->sq_head != tail) {
+            while (ring->cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE) ==
+                   ring->cq_entries) {
+                ring->stats.cq_full++;
+                wake_up(&ring->cq_wait);
+                sleep_on(&ring->cq_wait);
+            }
+
+            const uring_sqe_t *sqe = &ring->sqes[ring->sq_head & (ring->sq_entries - 1)];
+            uring_cqe_t *cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+            cqe->user_data = sqe->user_data;
+            cqe->res = uring_execute(ring, sqe);
+
+            __atomic_store_n(&ring->sq_head, ring->sq_head + 1, __ATOMIC_RELEASE);
+            __atomic_store_n(&ring->cq_tail, ring->cq_tail + 1, __ATOMIC_RELEASE);
+            ring->stats.completed++;
+        }
+        wake_up(&ring->cq_wait);
+    }
+}
+
+uring_t *uring_create(uint32_t entries) {
+    if (entries == 0 || entries > URING_MAX_ENTRIES) {
+        return NULL;
+    }
+    uint32_t n = 1;
+    while (n < entries) {
+        n <<= 1;
+    }
+
+    int idx = 0;
+    while (idx < URING_MAX_RINGS && rings[idx]) {
+        idx++;
+    }
+    if (idx == URING_MAX_RINGS) {
+        printk(KERN_ERR "[URING] Too many rings\n");
+        return NULL;
+    }
+
+    uring_t *ring = kzalloc(sizeof(uring_t));
+    if (!ring) {
+        return NULL;
+    }
+    ring->sq_entries = n;
+    ring->cq_entries = 2 * n;
+    ring->sqes = kzalloc(n * sizeof(uring_sqe_t));
+    ring->cqes = kzalloc(2 * n * sizeof(uring_cqe_t));
+    if (!ring->sqes || !ring->cqes) {
+        kfree(ring->sqes);
+        kfree(ring->cqes);
+        kfree(ring);
+        printk(KERN_ERR "[URING] Out of memory\n");
+        return NULL;
+    }
+    wait_queue_init(&ring->sq_wait);
+    wait_queue_init(&ring->cq_wait);
+
+    ring->worker = create_process("kuring", uring_worker);
+    if (!ring->worker) {
+        kfree(ring->sqes);
+        kfree(ring->cqes);
+        kfree(ring);
+        return NULL;
+    }
+    ring->worker_pid = ring->worker->pid;
+    rings[idx] = ring;
+    return ring;
+}
+
+void uring_destroy(uring_t *ring) {
+    ring->stop = true;
+    wake_up(&ring->sq_wait);
+    wake_up(&ring->cq_wait);
+
+    /* 工作线程可能在等CQ空位: 边等边丢弃完成项 */
+    while (ring->worker->pid == ring->worker_pid &&
+           ring->worker->state != PROC_ZOMBIE && ring->worker->state != PROC_UNUSED) {
+        uring_cq_advance(ring, ring->cq_tail - ring->cq_head);
+        yield();
+    }
+
+    for (int i = 0; i < URING_MAX_RINGS; i++) {
+        if (rings[i] == ring) {
+            rings[i] = NULL;
+        }
+    }
+    for (int i = 0; i < URING_MAX_FILES; i++) {
+        if (ring->files[i]) {
+            fs_put(ring->files[i]);
+        }
+    }
+    kfree(ring->sqes);
+    kfree(ring->cqes);
+    kfree(ring);
+}
+
+uring_sqe_t *uring_get_sqe(uring_t *ring) {
+    uint32_t head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head == ring->sq_entries) {
+        return NULL;
+    }
+    uring_sqe_t *sqe = &ring->sqes[ring->sqe_tail & (ring->sq_entries - 1)];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_submit(uring_t *ring) {
+    int n = ring->sqe_tail - ring->sq_tail;
+    if (n == 0) {
+        return 0;
+    }
+    __atomic_store_n(&ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    ring->stats.submitted += n;
+    wake_up(&ring->sq_wait);
+    return n;
+}
+
+uring_cqe_t *uring_peek_cqe(uring_t *ring) {
+    if (ring->cq_head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[ring->cq_head & (ring->cq_entries - 1)];
+}
+
+uring_cqe_t *uring_wait_cqe(uring_t *ring) {
+    uring_cqe_t *cqe;
+    while (!(cqe = uring_peek_cqe(ring))) {
+        /* 没有已提交的请求时等不到完成项 */
+        if (__atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_tail &&
+            ring->cq_head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        wake_up(&ring->sq_wait);
+        sleep_on(&ring->cq_wait);
+    }
+    return cqe;
+}
+
+void uring_cq_advance(uring_t *ring, uint32_t n) {
+    if (n == 0) {
+        return;
+    }
+    bool was_full = (ring->cq_tail - ring->cq_head == ring->cq_entries);
+    __atomic_store_n(&ring->cq_head, ring->cq_head + n, __ATOMIC_RELEASE);
+    if (was_full) {
+        wake_up(&ring->cq_wait);
+    }
+}
+
+void uring_get_stats(uring_t *ring, uring_stats_t *stats) {
+    *stats = ring->stats;
+}
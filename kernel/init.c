@@ -0,0 +1,122 @@
+/* 启动计时和推迟的初始化调用 */
+#include <kernel/init.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+#define MAX_BOOT_PHASES 16
+#define MAX_INITCALLS   16      /* 超过的照常执行, 只是不记录耗时 */
+
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} boot_phase_t;
+
+/* boot/start.S */
+extern uint64_t boot_time_entry;
+extern uint64_t boot_time_bss;
+
+/* 链接脚本收集的.initcall.deferred段 */
+extern const initcall_t __initcall_start[];
+extern const initcall_t __initcall_end[];
+
+static boot_phase_t phases[MAX_BOOT_PHASES];
+static int nr_phases;
+static uint64_t prompt_time;
+
+static boot_phase_t initcall_times[MAX_INITCALLS];
+static uint64_t initcalls_begin;
+static uint64_t initcalls_end;
+static volatile bool initcalls_done;
+
+void boot_phase(const char *name, void (*fn)(void)) {
+    uint64_t start = rdtime();
+    fn();
+    if (nr_phases < MAX_BOOT_PHASES) {
+        phases[nr_phases++] = (boot_phase_t){ name, start, rdtime() };
+    }
+}
+
+void boot_prompt_ready(void) {
+    if (!prompt_time) {
+        prompt_time = rdtime();
+    }
+}
+
+static void kinit(void) {
+    initcalls_begin = rdtime();
+    for (const initcall_t *call = __initcall_start; call < __initcall_end; call++) {
+        uint64_t start = rdtime();
+        call->fn();
+        int i = call - __initcall_start;
+        if (i < MAX_INITCALLS) {
+            initcall_times[i] = (boot_phase_t){ call->name, start, rdtime() };
+        }
+        /* shell已经在等待输入, 每个调用之间让它响应 */
+        yield();
+    }
+    initcalls_end = rdtime();
+    initcalls_done = true;
+}
+
+void initcalls_start(void) {
+    if (!create_process("kinit", kinit)) {
+        /* 没有线程可用时直接在启动路径上执行 */
+        printk(KERN_WARNING "[INIT] Cannot create kinit, running initcalls inline\n");
+        kinit();
+    }
+}
+
+void initcalls_wait(void) {
+    while (!initcalls_done) {
+        yield();
+    }
+}
+
+/* 以us为单位打印0.1us精度的时间 */
+static void print_us(uint64_t ticks, int width) {
+    uint64_t tenths = ticks * 10 / (TIMEBASE_FREQ / 1000000);
+    printk(" %*llu.%llu", width - 2, tenths / 10, tenths % 10);
+}
+
+static void print_phase(const char *name, uint64_t start, uint64_t end) {
+    printk("  %-16s", name);
+    print_us(start, 12);
+    print_us(end - start, 12);
+    printk("\n");
+}
+
+void bootstat_show(void) {
+    printk("Boot phases (us since reset):\n");
+    printk("  %-16s %12s %12s\n", "phase", "start", "time");
+    print_phase("firmware", 0, boot_time_entry);
+    print_phase("bss clear", boot_time_entry, boot_time_bss);
+    for (int i = 0; i < nr_phases; i++) {
+        print_phase(phases[i].name, phases[i].start, phases[i].end);
+    }
+
+    printk("  time to prompt:");
+    print_us(prompt_time, 2);
+    printk(" us (kernel:");
+    print_us(prompt_time - boot_time_entry, 2);
+    printk(" us)\n");
+
+    int nr_calls = __initcall_end - __initcall_start;
+    printk("Deferred initcalls (kinit, %d):\n", nr_calls);
+    for (int i = 0; i < nr_calls && i < MAX_INITCALLS; i++) {
+        if (initcall_times[i].name) {
+            print_phase(initcall_times[i].name, initcall_times[i].start,
+                        initcall_times[i].end);
+        }
+    }
+    if (initcalls_done) {
+        printk("  all done at");
+        print_us(initcalls_end, 2);
+        printk(" us (");
+        print_us(initcalls_end - initcalls_begin, 2);
+        printk(" us in kinit)\n");
+    } else {
+        printk("  still running\n");
+    }
+}
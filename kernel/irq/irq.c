@@ -0,0 +1,156 @@
+/* 中断分发与统计 */
+#include <kernel/irq.h>
+#include <kernel/trap.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+typedef struct {
+    irq_handler_t handler;
+    void *arg;
+    const char *name;
+    irq_time_t time;
+} irq_desc_t;
+
+static irq_desc_t irq_descs[NR_IRQS];
+
+static uint64_t irq_unknown;    /* 未知的本地中断原因 */
+static uint64_t irq_unhandled;  /* 没有处理函数的外部中断 (之后在PLIC中屏蔽) */
+
+int request_irq(int irq, irq_handler_t handler, void *arg, const char *name) {
+    if (irq <= 0 || irq >= NR_IRQS || !handler) {
+        return -1;
+    }
+    if (irq_descs[irq].handler) {
+        printk(KERN_ERR "[IRQ] irq %d already taken by %s\n", irq, irq_descs[irq].name);
+        return -1;
+    }
+
+    uint64_t flags = local_irq_save();
+    irq_descs[irq].handler = handler;
+    irq_descs[irq].arg = arg;
+    irq_descs[irq].name = name;
+    local_irq_restore(flags);
+
+    if (irq < PLIC_MAX_IRQ) {
+        plic_enable(irq);
+    }
+    return 0;
+}
+
+void irq_time_account(irq_time_t *t, uint64_t ticks) {
+    uint64_t us = ticks / (TIMEBASE_FREQ / 1000000);
+    int b = 0;
+
+    while (us > 0 && b < IRQ_HIST_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    t->count++;
+    t->total += ticks;
+    if (ticks > t->max) {
+        t->max = ticks;
+    }
+    t->hist[b]++;
+}
+
+static void handle_irq(int irq) {
+    irq_desc_t *desc = &irq_descs[irq];
+
+    if (!desc->handler) {
+        irq_unhandled++;
+        printk(KERN_WARNING "[IRQ] Unhandled interrupt %d, masking it\n", irq);
+        if (irq < PLIC_MAX_IRQ) {
+            plic_disable(irq);
+        }
+        return;
+    }
+
+    uint64_t start = rdtime();
+    desc->handler(desc->arg);
+    irq_time_account(&desc->time, rdtime() - start);
+}
+
+void irq_entry(uint64_t cause) {
+    uint32_t irq;
+
+    irq_enter();
+    switch (cause) {
+        case CAUSE_SUPERVISOR_TIMER:
+            handle_irq(IRQ_TIMER);
+            break;
+        case CAUSE_SUPERVISOR_EXTERNAL:
+            /* claim -> 处理 -> complete, 直到没有待处理的中断 */
+            while ((irq = plic_claim()) != 0) {
+                if (irq < PLIC_MAX_IRQ) {
+                    handle_irq(irq);
+                } else {
+                    irq_unhandled++;
+                }
+                plic_complete(irq);
+            }
+            break;
+        default:
+            irq_unknown++;
+            printk(KERN_WARNING "[IRQ] Unknown interrupt: %llx\n", cause);
+            break;
+    }
+    irq_exit();
+}
+
+/* ---------------- irqstat ---------------- */
+
+static const char *hist_labels[IRQ_HIST_BUCKETS] = {
+    "<1us", "<2us", "<4us", "<8us", "<16us", "<32us", "<64us", "<128us", "<256us", ">=256us"
+};
+
+/* 以us为单位打印0.1us精度的时间 */
+static void print_us(uint64_t ticks, int width) {
+    uint64_t tenths = ticks * 10 / (TIMEBASE_FREQ / 1000000);
+    printk(" %*llu.%llu", width - 2, tenths / 10, tenths % 10);
+}
+
+/* 次数、平均和最大时间, 下一行是非空的直方图桶 */
+static void print_time_row(const irq_time_t *t) {
+    printk(" %10llu", t->count);
+    print_us(t->count ? t->total / t->count : 0, 10);
+    print_us(t->max, 10);
+    printk("\n");
+
+    if (t->count == 0) {
+        return;
+    }
+    printk("     ");
+    for (int b = 0; b < IRQ_HIST_BUCKETS; b++) {
+        if (t->hist[b]) {
+            printk(" %s:%llu", hist_labels[b], t->hist[b]);
+        }
+    }
+    printk("\n");
+}
+
+void irqstat_show(void) {
+    printk("Hard IRQs (handler time in us):\n");
+    printk("  %3s %-16s %10s %10s %10s\n", "IRQ", "name", "count", "avg", "max");
+    for (int irq = 1; irq < NR_IRQS; irq++) {
+        irq_desc_t *desc = &irq_descs[irq];
+        if (!desc->handler) {
+            continue;
+        }
+        printk("  %3d %-16s", irq, desc->name);
+        print_time_row(&desc->time);
+    }
+    printk("  unhandled %llu, unknown cause %llu\n", irq_unhandled, irq_unknown);
+
+    softirq_stat_t vec[NR_SOFTIRQS];
+    softirq_stats_t st;
+    softirq_get_stats(vec, &st);
+
+    printk("\nSoftirqs (time per pass in us):\n");
+    printk("  %-10s %10s %10s %10s %10s\n", "name", "raised", "runs", "avg", "max");
+    for (int i = 0; i < NR_SOFTIRQS; i++) {
+        printk("  %-10s %10llu", vec[i].name ? vec[i].name : "-", vec[i].raised);
+        print_time_row(&vec[i].time);
+    }
+    printk("  tasklets run %llu, deferred to ksoftirqd %llu, ksoftirqd passes %llu\n",
+           st.tasklets, st.deferred, st.ksoftirqd_runs);
+}
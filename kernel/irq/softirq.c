@@ -0,0 +1,183 @@
+/* 软中断、tasklet和ksoftirqd */
+#include <kernel/irq.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 单hart, 内核线程协作式调度: 下半部只在三个地方运行
+ *   - 中断返回前 (irq_exit), 被打断的上下文没有禁止下半部时
+ *   - local_bh_enable把计数减到0时
+ *   - ksoftirqd线程
+ * 运行期间bh_depth > 0, 嵌套的硬中断只标记待处理, 不会重入.
+ * pending只在关中断时修改.
+ */
+
+static softirq_handler_t softirq_vec[NR_SOFTIRQS];
+static softirq_stat_t softirq_stat[NR_SOFTIRQS];
+static softirq_stats_t stats;
+
+static volatile uint32_t pending;
+static int irq_depth;           /* 硬中断嵌套层数 */
+static int bh_depth;            /* 禁止下半部的层数, 正在运行下半部时也加1 */
+
+static tasklet_t *tasklet_head;
+static tasklet_t **tasklet_tail = &tasklet_head;
+
+void open_softirq(int nr, softirq_handler_t handler, const char *name) {
+    softirq_vec[nr] = handler;
+    softirq_stat[nr].name = name;
+}
+
+void raise_softirq(int nr) {
+    uint64_t flags = local_irq_save();
+    pending |= 1U << nr;
+    softirq_stat[nr].raised++;
+    local_irq_restore(flags);
+}
+
+bool softirq_pending(void) {
+    return pending != 0;
+}
+
+bool in_interrupt(void) {
+    return irq_depth > 0 || bh_depth > 0;
+}
+
+/*
+ * 运行挂起的软中断, 处理函数运行时打开中断.
+ * 每轮取走当前全部挂起位; 处理期间又被标记的 (例如网卡一批用完预算) 进入下一轮,
+ * 超过轮数或时间上限后留给ksoftirqd.
+ */
+static void do_softirq(void) {
+    uint64_t flags = local_irq_save();
+
+    if (bh_depth > 0 || irq_depth > 0 || !pending) {
+        local_irq_restore(flags);
+        return;
+    }
+    bh_depth++;
+
+    uint64_t start = rdtime();
+    int restart = SOFTIRQ_MAX_RESTART;
+    uint32_t todo;
+
+    while ((todo = pending) != 0) {
+        pending = 0;
+        local_irq_enable();
+
+        for (int nr = 0; todo; nr++, todo >>= 1) {
+            if ((todo & 1) && softirq_vec[nr]) {
+                uint64_t t = rdtime();
+                softirq_vec[nr]();
+                irq_time_account(&softirq_stat[nr].time, rdtime() - t);
+            }
+        }
+
+        local_irq_disable();
+        if (--restart == 0 || rdtime() - start > SOFTIRQ_TIME_LIMIT) {
+            break;
+        }
+    }
+    if (pending) {
+        stats.deferred++;
+    }
+
+    bh_depth--;
+    local_irq_restore(flags);
+}
+
+void irq_enter(void) {
+    irq_depth++;
+}
+
+/* 在陷阱处理中调用, 此时中断关闭; 返回时中断仍然关闭 (恢复sepc前不能再被打断) */
+void irq_exit(void) {
+    irq_depth--;
+    if (pending && bh_depth == 0 && irq_depth == 0) {
+        do_softirq();
+    }
+}
+
+void local_bh_disable(void) {
+    uint64_t flags = local_irq_save();
+    bh_depth++;
+    local_irq_restore(flags);
+}
+
+void local_bh_enable(void) {
+    uint64_t flags = local_irq_save();
+    bh_depth--;
+    local_irq_restore(flags);
+
+    if (bh_depth == 0 && pending) {
+        do_softirq();
+    }
+}
+
+/* ---------------- tasklet ---------------- */
+
+void tasklet_init(tasklet_t *t, void (*func)(void *arg), void *arg) {
+    t->next = NULL;
+    t->func = func;
+    t->arg = arg;
+    t->scheduled = false;
+}
+
+void tasklet_schedule(tasklet_t *t) {
+    uint64_t flags = local_irq_save();
+    if (!t->scheduled) {
+        t->scheduled = true;
+        t->next = NULL;
+        *tasklet_tail = t;
+        tasklet_tail = &t->next;
+        raise_softirq(SOFTIRQ_TASKLET);
+    }
+    local_irq_restore(flags);
+}
+
+static void tasklet_action(void) {
+    uint64_t flags = local_irq_save();
+    tasklet_t *list = tasklet_head;
+    tasklet_head = NULL;
+    tasklet_tail = &tasklet_head;
+    local_irq_restore(flags);
+
+    while (list) {
+        tasklet_t *t = list;
+        list = t->next;
+        /* 先清标记: 运行期间到来的中断可以再次调度它 */
+        t->scheduled = false;
+        t->func(t->arg);
+        stats.tasklets++;
+    }
+}
+
+/* ---------------- ksoftirqd ---------------- */
+
+static void ksoftirqd(void) {
+    while (1) {
+        if (pending) {
+            stats.ksoftirqd_runs++;
+            do_softirq();
+        }
+        yield();
+    }
+}
+
+void softirq_get_stats(softirq_stat_t vec[NR_SOFTIRQS], softirq_stats_t *out) {
+    for (int i = 0; i < NR_SOFTIRQS; i++) {
+        vec[i] = softirq_stat[i];
+    }
+    *out = stats;
+}
+
+void softirq_init(void) {
+    open_softirq(SOFTIRQ_TASKLET, tasklet_action, "TASKLET");
+    if (!create_process("ksoftirqd", ksoftirqd)) {
+        printk(KERN_ERR "[IRQ] Failed to start ksoftirqd\n");
+        return;
+    }
+    printk("  Softirqs ready: %d restarts or %dus per pass, then ksoftirqd\n",
+           SOFTIRQ_MAX_RESTART, (int)(SOFTIRQ_TIME_LIMIT / (TIMEBASE_FREQ / 1000000)));
+}
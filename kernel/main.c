@@ -1,14 +1,23 @@
 #include <kernel/printk.h>
+#include <kernel/klog.h>
+#include <kernel/init.h>
 #include <kernel/types.h>
 
 /* 前向声明 */
 void mm_init(void);
 void trap_init(void);
 void process_init(void);
+void softirq_init(void);
+void plic_init(void);
+void virtio_init(void);
+void bcache_init(void);
 void fs_init(void);
 void shell_main(void);
 
 void kernel_main(void) {
+    /* 每个初始化步骤都经过boot_phase计时, bootstat命令查看 */
+    boot_phase("console", console_init);
+
     /* 初始化内核 */
     printk("\n");
     printk("=================================\n");
@@ -20,22 +29,35 @@ void kernel_main(void) {
 
     /* 初始化内存管理 */
     printk("[MM] Initializing memory management...\n");
-    mm_init();
+    boot_phase("mm", mm_init);
 
     /* 初始化中断系统 */
     printk("[TRAP] Initializing interrupt handling...\n");
-    trap_init();
+    boot_phase("trap", trap_init);
+    boot_phase("plic", plic_init);
 
     /* 初始化进程管理 */
     printk("[PROCESS] Initializing process scheduler...\n");
-    process_init();
+    boot_phase("process", process_init);
+    boot_phase("softirq", softirq_init);
+
+    /* 探测设备 (网卡推迟到kinit) */
+    printk("[DEV] Probing virtio devices...\n");
+    boot_phase("virtio", virtio_init);
+    boot_phase("bcache", bcache_init);
 
-    /* 初始化文件系统 */
+    /* 初始化文件系统 (initramfs推迟到kinit) */
     printk("[FS] Initializing file system...\n");
-    fs_init();
+    boot_phase("fs", fs_init);
 
     printk("[KERNEL] Initialization complete!\n\n");
 
+    /* 之后的printk只写入日志缓冲区, 由klogd输出 */
+    boot_phase("klogd", klogd_start);
+
+    /* 不影响shell可用的初始化在kinit线程中进行, shell等待输入时它就会运行 */
+    initcalls_start();
+
     /* 启动Shell */
     printk("Starting shell...\n\n");
     shell_main();
@@ -0,0 +1,163 @@
+/* 内核小对象分配器 - 按2的幂大小分级的slab */
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+
+/*
+ * 16B ~ 2KB的对象从slab分配: 每个slab是一页, 页首是slab_t头部,
+ * 其余空间切成同样大小的对象. kfree通过对象地址所在页找到头部.
+ * 更大的请求直接分配连续页, 页首同样放一个头部记录页数.
+ */
+
+#define KMALLOC_MIN_SHIFT 4                     /* 16B */
+#define KMALLOC_MAX_SHIFT 11                    /* 2KB */
+#define KMALLOC_CLASSES (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+
+typedef struct slab {
+    struct slab *next;      /* 同一级别中还有空闲对象的slab */
+    struct slab *prev;
+    void *free;             /* 空闲对象链表 */
+    uint32_t size;          /* 对象大小, 0表示大块分配 */
+    uint16_t inuse;
+    uint16_t total;         /* 对象数; 大块分配时为页数 */
+} slab_t;
+
+#define SLAB_HDR_SIZE 32
+
+static slab_t *partial[KMALLOC_CLASSES];
+
+static int size_class(size_t size) {
+    int shift = KMALLOC_MIN_SHIFT;
+    while ((1UL << shift) < size) {
+        shift++;
+    }
+    return shift - KMALLOC_MIN_SHIFT;
+}
+
+static void slab_unlink(int cls, slab_t *slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        partial[cls] = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = slab->prev = NULL;
+}
+
+static void slab_push(int cls, slab_t *slab) {
+    slab->prev = NULL;
+    slab->next = partial[cls];
+    if (partial[cls]) {
+        partial[cls]->prev = slab;
+    }
+    partial[cls] = slab;
+}
+
+static slab_t *slab_create(int cls) {
+    slab_t *slab = alloc_page_tag(PG_SLAB);
+    if (!slab) {
+        return NULL;
+    }
+
+    uint32_t size = 1U << (cls + KMALLOC_MIN_SHIFT);
+    slab->size = size;
+    slab->total = (PAGE_SIZE - SLAB_HDR_SIZE) / size;
+    slab->inuse = 0;
+    slab->free = NULL;
+
+    /* 把对象串成空闲链表 */
+    uint8_t *obj = (uint8_t *)slab + SLAB_HDR_SIZE;
+    for (int i = slab->total - 1; i >= 0; i--) {
+        void **o = (void **)(obj + i * size);
+        *o = slab->free;
+        slab->free = o;
+    }
+
+    slab_push(cls, slab);
+    return slab;
+}
+
+void *kmalloc(size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    /* 大块: 直接分配连续页 */
+    if (size > (1UL << KMALLOC_MAX_SHIFT)) {
+        size_t npages = PAGE_ALIGN_UP(size + SLAB_HDR_SIZE) / PAGE_SIZE;
+        slab_t *hdr = alloc_pages_tag(npages, PG_SLAB);
+        if (!hdr) {
+            return NULL;
+        }
+        hdr->size = 0;
+        hdr->total = npages;
+        return (uint8_t *)hdr + SLAB_HDR_SIZE;
+    }
+
+    int cls = size_class(size);
+    slab_t *slab = partial[cls];
+    if (!slab && !(slab = slab_create(cls))) {
+        return NULL;
+    }
+
+    void **obj = slab->free;
+    slab->free = *obj;
+    slab->inuse++;
+    if (!slab->free) {
+        slab_unlink(cls, slab);
+    }
+    return obj;
+}
+
+void *kzalloc(size_t size) {
+    void *p = kmalloc(size);
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+void kfree(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    slab_t *slab = (slab_t *)PAGE_ALIGN_DOWN((uint64_t)ptr);
+
+    if (slab->size == 0) {
+        free_pages(slab, slab->total);
+        return;
+    }
+
+    int cls = size_class(slab->size);
+    bool was_full = (slab->free == NULL);
+
+    *(void **)ptr = slab->free;
+    slab->free = ptr;
+    slab->inuse--;
+
+    if (was_full) {
+        slab_push(cls, slab);
+    }
+
+    /* 空slab还给页分配器, 但每级保留一个避免反复分配 */
+    if (slab->inuse == 0 && (slab->next || slab->prev)) {
+        slab_unlink(cls, slab);
+        free_page(slab);
+    }
+}
+
+/* 对象所在级别的大小, 即kmalloc实际为它保留的空间 */
+size_t ksize(const void *ptr) {
+    if (!ptr) {
+        return 0;
+    }
+
+    slab_t *slab = (slab_t *)PAGE_ALIGN_DOWN((uint64_t)ptr);
+    if (slab->size == 0) {
+        return slab->total * PAGE_SIZE - SLAB_HDR_SIZE;
+    }
+    return slab->size;
+}
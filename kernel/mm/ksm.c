@@ -0,0 +1,303 @@
+/* 页合并 (KSM) - 内容相同的用户私有页合并成一个只读页, 写入时复制 */
+#include <kernel/uvm.h>
+#include <kernel/process.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * ksmd按地址顺序扫描mm_list中每个地址空间的私有页 (可写映射的PG_USER页):
+ *   1. 全0的页换成共享零页;
+ *   2. 与某个合并页 (稳定表) 内容相同的, 映射那个合并页;
+ *   3. 与本轮之前扫描到的某个候选页 (不稳定表) 内容相同的, 两页合并成一个新的合并页;
+ *   4. 否则记进不稳定表, 等本轮后面的页来匹配.
+ * 两张表都按内容的哈希分桶, 哈希相同时再逐字节比较. 不稳定表每轮清空:
+ * 候选页随时可能被写, 合并时重新检查它仍然映射在原处并比较内容.
+ * 合并后的PTE是只读的, 写入时mm_fault复制出私有页 (cow_page).
+ */
+#define KSM_MAX_STABLE      512
+#define KSM_MAX_UNSTABLE    1024
+#define KSM_HASH_SIZE       256         /* 必须是2的幂 */
+#define KSM_BATCH_PAGES     64          /* ksmd每批扫描的页数, 批之间让出CPU */
+#define KSM_INTERVAL        (TIMEBASE_FREQ / 5)     /* 一轮结束后隔200ms开始下一轮 */
+
+typedef struct {
+    void *page;                 /* NULL为空闲项 */
+    uint64_t hash;
+    uint32_t refs;              /* 映射它的PTE数 */
+    int16_t next;               /* 同一个桶的下一项, -1结束 */
+} stable_t;
+
+typedef struct {
+    mm_t *mm;                   /* 地址空间已销毁时为NULL */
+    uint64_t va;
+    void *page;
+    uint64_t hash;
+    int16_t next;
+} unstable_t;
+
+static stable_t stable[KSM_MAX_STABLE];
+static int16_t stable_hash[KSM_HASH_SIZE];
+static unstable_t unstable[KSM_MAX_UNSTABLE];
+static int16_t unstable_hash[KSM_HASH_SIZE];
+static int nr_unstable;
+static bool tables_ready;
+
+/* 扫描位置: scan_mm为NULL时下一批开始新的一轮 */
+static mm_t *scan_mm;
+static uint64_t scan_va;
+
+static bool ksm_enabled;
+static process_t *ksmd_proc;
+
+static struct {
+    uint64_t full_scans;
+    uint64_t pages_scanned;
+    uint64_t zero_merged;       /* 换成零页的 */
+    uint64_t merged;            /* 映射到合并页的 */
+    uint64_t pages_shared;      /* 当前的合并页数 */
+    uint64_t pages_sharing;     /* 当前映射合并页的PTE数 */
+    uint64_t stable_full;
+    uint64_t scan_ticks;
+} ksm_stat;
+
+static uint64_t zero_hash;
+
+/* FNV-1a, 每次取8字节 */
+static uint64_t page_hash(const void *page) {
+    const uint64_t *p = page;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void tables_init(void) {
+    for (int i = 0; i < KSM_HASH_SIZE; i++) {
+        stable_hash[i] = -1;
+        unstable_hash[i] = -1;
+    }
+    zero_hash = page_hash(zero_page);
+    tables_ready = true;
+}
+
+static int16_t stable_find(const void *page, uint64_t hash) {
+    for (int16_t i = stable_hash[hash & (KSM_HASH_SIZE - 1)]; i >= 0; i = stable[i].next) {
+        if (stable[i].hash == hash && memcmp(stable[i].page, page, PAGE_SIZE) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int16_t stable_insert(void *page, uint64_t hash) {
+    for (int16_t i = 0; i < KSM_MAX_STABLE; i++) {
+        if (!stable[i].page) {
+            int b = hash & (KSM_HASH_SIZE - 1);
+            stable[i] = (stable_t){ page, hash, 0, stable_hash[b] };
+            stable_hash[b] = i;
+            ksm_stat.pages_shared++;
+            return i;
+        }
+    }
+    ksm_stat.stable_full++;
+    return -1;
+}
+
+void ksm_put(void *page) {
+    uint64_t hash = page_hash(page);
+    int16_t *pp = &stable_hash[hash & (KSM_HASH_SIZE - 1)];
+
+    for (; *pp >= 0; pp = &stable[*pp].next) {
+        stable_t *s = &stable[*pp];
+        if (s->page != page) {
+            continue;
+        }
+        ksm_stat.pages_sharing--;
+        if (--s->refs == 0) {
+            *pp = s->next;
+            s->page = NULL;
+            ksm_stat.pages_shared--;
+            free_page(page);
+        }
+        return;
+    }
+    printk(KERN_ERR "[KSM] Put of unknown page %p\n", page);
+}
+
+/* 候选页是否仍然映射在mm的va处且可写 (没有被合并、换掉或解除映射) */
+static bool still_mapped(mm_t *mm, uint64_t va, void *page) {
+    uint64_t *pte = walk_pte(mm->pagetable, va);
+    return pte && (*pte & PTE_V) && (*pte & PTE_W) && walk_addr(mm->pagetable, va) == (uint64_t)page;
+}
+
+static vma_t *vma_of(mm_t *mm, uint64_t va) {
+    for (vma_t *vma = mm->vmas; vma && vma->start <= va; vma = vma->next) {
+        if (va < vma->end) {
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+static void scan_page(mm_t *mm, vma_t *vma, uint64_t va) {
+    uint64_t *pte = walk_pte(mm->pagetable, va);
+    if (!pte || !(*pte & PTE_V) || !(*pte & PTE_W)) {
+        return;
+    }
+    void *page = (void *)walk_addr(mm->pagetable, va);
+    if (page_tag(page) != PG_USER) {
+        return;
+    }
+    ksm_stat.pages_scanned++;
+    uint64_t hash = page_hash(page);
+
+    if (hash == zero_hash && memcmp(page, zero_page, PAGE_SIZE) == 0) {
+        mm_merge_page(mm, vma, va, zero_page);
+        ksm_stat.zero_merged++;
+        return;
+    }
+
+    int16_t s = stable_find(page, hash);
+    if (s >= 0) {
+        stable[s].refs++;
+        ksm_stat.pages_sharing++;
+        mm_merge_page(mm, vma, va, stable[s].page);
+        ksm_stat.merged++;
+        return;
+    }
+
+    int b = hash & (KSM_HASH_SIZE - 1);
+    for (int16_t *pp = &unstable_hash[b]; *pp >= 0; pp = &unstable[*pp].next) {
+        unstable_t *u = &unstable[*pp];
+        if (u->hash != hash || !u->mm || !still_mapped(u->mm, u->va, u->page) ||
+            memcmp(u->page, page, PAGE_SIZE) != 0) {
+            continue;
+        }
+        vma_t *uvma = vma_of(u->mm, u->va);
+        void *merged = uvma ? alloc_page_tag(PG_KSM) : NULL;
+        if (!merged) {
+            return;
+        }
+        memcpy(merged, page, PAGE_SIZE);
+        s = stable_insert(merged, hash);
+        if (s < 0) {
+            free_page(merged);
+            return;
+        }
+        stable[s].refs = 2;
+        ksm_stat.pages_sharing += 2;
+        mm_merge_page(u->mm, uvma, u->va, merged);
+        mm_merge_page(mm, vma, va, merged);
+        ksm_stat.merged += 2;
+        *pp = u->next;
+        return;
+    }
+
+    if (nr_unstable < KSM_MAX_UNSTABLE) {
+        unstable[nr_unstable] = (unstable_t){ mm, va, page, hash, unstable_hash[b] };
+        unstable_hash[b] = nr_unstable++;
+    }
+}
+
+/* 扫描至多budget个地址, 一轮结束时返回true */
+static bool scan_batch(int budget) {
+    if (!tables_ready) {
+        tables_init();
+    }
+    if (!scan_mm) {
+        /* 新的一轮 */
+        for (int i = 0; i < KSM_HASH_SIZE; i++) {
+            unstable_hash[i] = -1;
+        }
+        nr_unstable = 0;
+        scan_mm = mm_list;
+        scan_va = USER_BASE;
+    }
+
+    uint64_t start = rdtime();
+    while (scan_mm && budget > 0) {
+        vma_t *vma = scan_mm->vmas;
+        while (vma && (vma->end <= scan_va || vma->shared)) {
+            vma = vma->next;
+        }
+        /* 内核正在使用其中页的地址空间整个跳过, 下一轮再扫 */
+        if (!vma || scan_mm->pinned) {
+            scan_mm = scan_mm->next;
+            scan_va = USER_BASE;
+            continue;
+        }
+        if (scan_va < vma->start) {
+            scan_va = vma->start;
+        }
+        scan_page(scan_mm, vma, scan_va);
+        scan_va += PAGE_SIZE;
+        budget--;
+    }
+    ksm_stat.scan_ticks += rdtime() - start;
+
+    if (!scan_mm) {
+        ksm_stat.full_scans++;
+        return true;
+    }
+    return false;
+}
+
+void ksm_forget_mm(mm_t *mm) {
+    if (scan_mm == mm) {
+        scan_mm = mm->next;
+        scan_va = USER_BASE;
+    }
+    for (int i = 0; i < nr_unstable; i++) {
+        if (unstable[i].mm == mm) {
+            unstable[i].mm = NULL;
+        }
+    }
+}
+
+static void ksmd(void) {
+    uint64_t next_run = 0;
+
+    while (ksm_enabled) {
+        if (rdtime() >= next_run && scan_batch(KSM_BATCH_PAGES)) {
+            next_run = rdtime() + KSM_INTERVAL;
+        }
+        yield();
+    }
+    ksmd_proc = NULL;
+}
+
+void ksm_start(void) {
+    ksm_enabled = true;
+    if (!ksmd_proc && !(ksmd_proc = create_process("ksmd", ksmd))) {
+        ksm_enabled = false;
+    }
+}
+
+void ksm_stop(void) {
+    /* 已合并的页保持合并, 写入时照常复制 */
+    ksm_enabled = false;
+}
+
+void ksm_scan(void) {
+    scan_mm = NULL;
+    while (!scan_batch(KSM_BATCH_PAGES)) {
+    }
+}
+
+void ksm_show(void) {
+    uint64_t zero = zero_page_mappings();
+    uint64_t saved = zero + ksm_stat.pages_sharing - ksm_stat.pages_shared;
+
+    printk("KSM: ksmd %s, %llu full scans, %llu pages scanned in %llu us\n",
+           ksm_enabled ? "running" : "stopped", ksm_stat.full_scans,
+           ksm_stat.pages_scanned, ksm_stat.scan_ticks / (TIMEBASE_FREQ / 1000000));
+    printk("  zero page:   %llu mappings (%llu merged by scan)\n", zero, ksm_stat.zero_merged);
+    printk("  merged:      %llu shared pages, %llu mappings (%llu merges)\n",
+           ksm_stat.pages_shared, ksm_stat.pages_sharing, ksm_stat.merged);
+    printk("  pages saved: %llu (%llu KB)\n", saved, saved * PAGE_SIZE / 1024);
+    if (ksm_stat.stable_full) {
+        printk("  stable table full %llu times\n", ksm_stat.stable_full);
+    }
+}
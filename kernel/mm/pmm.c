@@ -3,9 +3,18 @@
 #include <kernel/printk.h>
 #include <kernel/string.h>
 
-/* 内存布局 (QEMU RISC-V virt) */
+/*
+ * 内存布局 (QEMU RISC-V virt): 管理从内核开始到RAM结束的页, 默认-m 128M时是126MB.
+ * 不能超过RAM_END: 之后的地址不存在, 也不在内核恒等映射中.
+ * 主机构建 (host/) 把RAM映射到别的地址.
+ */
+#ifndef KERNEL_BASE
 #define KERNEL_BASE 0x80200000UL
-#define MEMORY_SIZE (128 * 1024 * 1024)  /* 128MB */
+#endif
+#ifndef MEMORY_END
+#define MEMORY_END RAM_END
+#endif
+#define MEMORY_SIZE (MEMORY_END - KERNEL_BASE)
 #define MAX_PAGES (MEMORY_SIZE / PAGE_SIZE)
 
 /* 外部符号 - 来自链接脚本 */
@@ -14,19 +23,75 @@ extern char kernel_end[];
 /* 页分配位图 */
 static uint8_t page_bitmap[MAX_PAGES / 8];
 static uint64_t total_pages;
-static uint64_t free_pages;
+static uint64_t nr_free_pages;
 static uint64_t first_free_page;
+static uint64_t search_hint;     /* 下一次查找的起点, 低于它的页都已分配 */
+
+#define PAGE_USED(i) (page_bitmap[(i) / 8] & (1 << ((i) % 8)))
+
+/*
+ * 记账: 每页一个字节记录tag, 分配和释放时更新该tag的计数.
+ * PAGE_OWNER时另记分配点 (内核在4GB以下, 返回地址放得进32位) 和分配序号,
+ * 同一次alloc_pages分配的页序号相同.
+ */
+static uint8_t page_tags[MAX_PAGES];
+static page_tag_stat_t tag_stats[NR_PAGE_TAGS];
+static uint64_t min_free_pages;
+
+static const char *tag_names[NR_PAGE_TAGS] = {
+    "other", "kernel", "pgtable", "slab", "vmalloc", "kstack",
+    "pagecache", "fs-meta", "bufcache", "pipe", "driver", "user", "ksm", "zpool"
+};
+
+#ifdef PAGE_OWNER
+typedef struct {
+    uint32_t site;
+    uint32_t seq;
+} page_owner_t;
+
+static page_owner_t page_owners[MAX_PAGES];
+static uint32_t alloc_seq;              /* 内核镜像的序号是0, 汇总时跳过 */
+static uint32_t checkpoint_seq;
+#endif
+
+static void account_alloc(uint64_t first, size_t n, int tag, void *site) {
+    if (tag < 0 || tag >= NR_PAGE_TAGS) {
+        tag = PG_OTHER;
+    }
+    for (uint64_t i = first; i < first + n; i++) {
+        page_tags[i] = tag;
+#ifdef PAGE_OWNER
+        page_owners[i].site = (uint32_t)(uint64_t)site;
+        page_owners[i].seq = alloc_seq;
+#endif
+    }
+#ifdef PAGE_OWNER
+    alloc_seq++;
+#else
+    (void)site;
+#endif
+
+    page_tag_stat_t *ts = &tag_stats[tag];
+    ts->live += n;
+    ts->allocs += n;
+    if (ts->live > ts->peak) {
+        ts->peak = ts->live;
+    }
+    if (nr_free_pages < min_free_pages) {
+        min_free_pages = nr_free_pages;
+    }
+}
 
 void pmm_init(void) {
     /* 计算内核结束后的第一个可用页 */
     uint64_t kernel_end_addr = (uint64_t)kernel_end;
 
-    printk("  Kernel end address: %p\n", kernel_end_addr);
-    printk("  Kernel base: %p\n", KERNEL_BASE);
+    printk("  Kernel end address: %p\n", (void *)kernel_end_addr);
+    printk("  Kernel base: %p\n", (void *)KERNEL_BASE);
 
     /* 计算内核占用的大小 */
     if (kernel_end_addr < KERNEL_BASE) {
-        printk("  ERROR: kernel_end < KERNEL_BASE!\n");
+        printk(KERN_ERR "  ERROR: kernel_end < KERNEL_BASE!\n");
         kernel_end_addr = KERNEL_BASE + (1 * 1024 * 1024); /* 假设1MB */
     }
 
@@ -34,7 +99,8 @@ void pmm_init(void) {
     first_free_page = PAGE_ALIGN_UP(kernel_size) / PAGE_SIZE;
 
     total_pages = MAX_PAGES;
-    free_pages = total_pages - first_free_page;
+    nr_free_pages = total_pages - first_free_page;
+    search_hint = first_free_page;
 
     /* 初始化位图 */
     memset(page_bitmap, 0, sizeof(page_bitmap));
@@ -43,22 +109,32 @@ void pmm_init(void) {
     for (uint64_t i = 0; i < first_free_page; i++) {
         page_bitmap[i / 8] |= (1 << (i % 8));
     }
+    min_free_pages = nr_free_pages;
+    account_alloc(0, first_free_page, PG_KERNEL, NULL);
 
-    printk("  Physical memory: %d MB\n", MEMORY_SIZE / 1024 / 1024);
-    printk("  Total pages: %d, Free pages: %d\n", (int)total_pages, (int)free_pages);
+    printk("  Physical memory: %llu MB\n", (uint64_t)MEMORY_SIZE / 1024 / 1024);
+    printk("  Total pages: %d, Free pages: %d\n", (int)total_pages, (int)nr_free_pages);
     printk("  First free page: %d\n", (int)first_free_page);
 }
 
-void *alloc_page(void) {
+static void *do_alloc_page(int tag, void *site) {
     /* 查找空闲页 */
-    for (uint64_t i = first_free_page; i < total_pages; i++) {
+    for (uint64_t i = search_hint; i < total_pages; i++) {
         uint64_t byte_idx = i / 8;
         uint64_t bit_idx = i % 8;
 
+        /* 整个字节都已分配时一次跳过8页 */
+        if (bit_idx == 0 && page_bitmap[byte_idx] == 0xFF) {
+            i += 7;
+            continue;
+        }
+
         if (!(page_bitmap[byte_idx] & (1 << bit_idx))) {
             /* 找到空闲页 */
             page_bitmap[byte_idx] |= (1 << bit_idx);
-            free_pages--;
+            nr_free_pages--;
+            search_hint = i + 1;
+            account_alloc(i, 1, tag, site);
 
             /* 计算物理地址 */
             uint64_t pa = KERNEL_BASE + i * PAGE_SIZE;
@@ -70,15 +146,24 @@ void *alloc_page(void) {
         }
     }
 
-    printk("[PMM] Out of memory!\n");
+    printk(KERN_ERR "[PMM] Out of memory!\n");
     return NULL;
 }
 
+/* 分配点取调用者的返回地址, 所以这两个入口不能互相调用 */
+void *alloc_page(void) {
+    return do_alloc_page(PG_OTHER, __builtin_return_address(0));
+}
+
+void *alloc_page_tag(int tag) {
+    return do_alloc_page(tag, __builtin_return_address(0));
+}
+
 void free_page(void *page) {
     uint64_t pa = (uint64_t)page;
 
     if (pa < KERNEL_BASE || pa >= KERNEL_BASE + MEMORY_SIZE) {
-        printk("[PMM] Invalid page address: %p\n", page);
+        printk(KERN_ERR "[PMM] Invalid page address: %p\n", page);
         return;
     }
 
@@ -87,14 +172,198 @@ void free_page(void *page) {
     uint64_t bit_idx = page_idx % 8;
 
     if (!(page_bitmap[byte_idx] & (1 << bit_idx))) {
-        printk("[PMM] Double free detected: %p\n", page);
+        printk(KERN_ERR "[PMM] Double free detected: %p\n", page);
         return;
     }
 
     page_bitmap[byte_idx] &= ~(1 << bit_idx);
-    free_pages++;
+    nr_free_pages++;
+    tag_stats[page_tags[page_idx]].live--;
+    tag_stats[page_tags[page_idx]].frees++;
+    if (page_idx < search_hint) {
+        search_hint = page_idx;
+    }
+}
+
+/* 分配n个物理连续的页 (已清零) */
+static void *do_alloc_pages(size_t n, int tag, void *site) {
+    if (n == 0) {
+        return NULL;
+    }
+
+    uint64_t run = 0;
+    for (uint64_t i = search_hint; i < total_pages; i++) {
+        run = PAGE_USED(i) ? 0 : run + 1;
+        if (run == n) {
+            uint64_t first = i + 1 - n;
+            for (uint64_t j = first; j <= i; j++) {
+                page_bitmap[j / 8] |= (1 << (j % 8));
+            }
+            nr_free_pages -= n;
+            if (first == search_hint) {
+                search_hint = i + 1;
+            }
+            account_alloc(first, n, tag, site);
+
+            void *pa = (void *)(KERNEL_BASE + first * PAGE_SIZE);
+            memset(pa, 0, n * PAGE_SIZE);
+            return pa;
+        }
+    }
+
+    printk(KERN_ERR "[PMM] No %llu contiguous free pages\n", (uint64_t)n);
+    return NULL;
+}
+
+void *alloc_pages(size_t n) {
+    return do_alloc_pages(n, PG_OTHER, __builtin_return_address(0));
+}
+
+void *alloc_pages_tag(size_t n, int tag) {
+    return do_alloc_pages(n, tag, __builtin_return_address(0));
+}
+
+void free_pages(void *pages, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        free_page((uint8_t *)pages + i * PAGE_SIZE);
+    }
+}
+
+int page_tag(const void *page) {
+    uint64_t pa = (uint64_t)page;
+    if (pa < KERNEL_BASE || pa >= KERNEL_BASE + MEMORY_SIZE) {
+        return PG_OTHER;
+    }
+    return page_tags[(pa - KERNEL_BASE) / PAGE_SIZE];
 }
 
 uint64_t get_free_pages(void) {
-    return free_pages;
+    return nr_free_pages;
+}
+
+/* ---------------- meminfo ---------------- */
+
+void page_tag_get_stats(page_tag_stat_t stats[NR_PAGE_TAGS]) {
+    for (int i = 0; i < NR_PAGE_TAGS; i++) {
+        stats[i] = tag_stats[i];
+        stats[i].name = tag_names[i];
+    }
+}
+
+#ifdef PAGE_OWNER
+/* 按 (分配点, tag) 汇总在用页; 表满后剩下的记到dropped */
+#define MAX_SITES 32
+
+typedef struct {
+    uint32_t site;
+    uint8_t tag;
+    uint64_t pages;
+    uint64_t first_pa;
+} site_stat_t;
+
+static site_stat_t sites[MAX_SITES];
+
+static int collect_sites(uint32_t since, uint64_t *dropped) {
+    int n = 0;
+    *dropped = 0;
+
+    for (uint64_t i = 0; i < total_pages; i++) {
+        if (!PAGE_USED(i) || page_owners[i].seq <= since) {
+            continue;
+        }
+        uint32_t site = page_owners[i].site;
+        int j = 0;
+        while (j < n && (sites[j].site != site || sites[j].tag != page_tags[i])) {
+            j++;
+        }
+        if (j == n) {
+            if (n == MAX_SITES) {
+                (*dropped)++;
+                continue;
+            }
+            sites[n].site = site;
+            sites[n].tag = page_tags[i];
+            sites[n].pages = 0;
+            sites[n].first_pa = KERNEL_BASE + i * PAGE_SIZE;
+            n++;
+        }
+        sites[j].pages++;
+    }
+
+    /* 按页数从多到少 */
+    for (int a = 1; a < n; a++) {
+        site_stat_t tmp = sites[a];
+        int b = a;
+        while (b > 0 && sites[b - 1].pages < tmp.pages) {
+            sites[b] = sites[b - 1];
+            b--;
+        }
+        sites[b] = tmp;
+    }
+    return n;
+}
+
+static void print_sites(uint32_t since, int limit) {
+    uint64_t dropped;
+    int n = collect_sites(since, &dropped);
+
+    if (n == 0) {
+        printk("  (none)\n");
+        return;
+    }
+    printk("  %-18s %-10s %8s %18s\n", "site", "tag", "pages", "first page");
+    for (int i = 0; i < n && i < limit; i++) {
+        printk("  %-18p %-10s %8llu %18p\n", (void *)(uint64_t)sites[i].site,
+               tag_names[sites[i].tag], sites[i].pages, (void *)sites[i].first_pa);
+    }
+    if (n > limit) {
+        printk("  ... %d more sites\n", n - limit);
+    }
+    if (dropped) {
+        printk("  %llu pages from further sites not shown\n", dropped);
+    }
+}
+#endif
+
+void meminfo_show(int argc, char **argv) {
+#ifdef PAGE_OWNER
+    if (argc >= 2 && strcmp(argv[1], "checkpoint") == 0) {
+        checkpoint_seq = alloc_seq - 1;
+        printk("Checkpoint set at allocation #%u, %llu pages in use\n",
+               checkpoint_seq, total_pages - nr_free_pages);
+        return;
+    }
+    if (argc >= 2 && strcmp(argv[1], "leaks") == 0) {
+        printk("Pages allocated since checkpoint #%u and still in use:\n", checkpoint_seq);
+        print_sites(checkpoint_seq, MAX_SITES);
+        return;
+    }
+#endif
+    if (argc >= 2) {
+#ifdef PAGE_OWNER
+        printk("meminfo: unknown option %s (checkpoint|leaks)\n", argv[1]);
+#else
+        printk("meminfo: %s needs a kernel built with PAGE_OWNER=1\n", argv[1]);
+#endif
+        return;
+    }
+
+    uint64_t used = total_pages - nr_free_pages;
+    printk("Pages: %llu total, %llu used, %llu free (low water %llu free)\n",
+           total_pages, used, nr_free_pages, min_free_pages);
+    printk("  %-10s %10s %10s %10s %10s %10s\n",
+           "tag", "live", "KB", "peak", "allocs", "frees");
+    for (int i = 0; i < NR_PAGE_TAGS; i++) {
+        page_tag_stat_t *ts = &tag_stats[i];
+        if (ts->allocs == 0) {
+            continue;
+        }
+        printk("  %-10s %10llu %10llu %10llu %10llu %10llu\n", tag_names[i],
+               ts->live, ts->live * (PAGE_SIZE / 1024), ts->peak, ts->allocs, ts->frees);
+    }
+
+#ifdef PAGE_OWNER
+    printk("\nTop allocation sites (live pages):\n");
+    print_sites(0, 10);
+#endif
 }
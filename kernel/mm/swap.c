@@ -0,0 +1,264 @@
+/* 交换 - 内存不足时把用户私有页换出到磁盘上的交换区 */
+#include <kernel/uvm.h>
+#include <kernel/blk.h>
+#include <kernel/buf.h>
+#include <kernel/nosfs.h>
+#include <kernel/process.h>
+#include <kernel/init.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 交换区在磁盘上文件系统之后 (mkfs -w): 头部块之后每块一个槽.
+ * 槽的分配用位图, 一个槽只属于一个PTE (没有fork, 不需要引用计数).
+ *
+ * 回收用时钟算法: 指针按地址顺序走过mm_list中各地址空间的私有页 (可写映射的
+ * PG_USER页), A位置位的清掉并跳过, A位为0的 (指针上次经过以来没被访问) 换出.
+ * 换出时先把PTE改成只读再写盘, 写盘期间进程仍可以读; 进程写入时mm_fault
+ * 恢复可写, 写盘完成后发现PTE变了就放弃这次换出. 写完才把PTE换成交换项、释放页.
+ */
+#define SWAP_SCAN_RATIO 16      /* 每回收一页最多扫描的页数 */
+
+static uint64_t swap_start;     /* 第一个槽的块号 */
+static uint64_t nr_slots;
+static uint64_t nr_used;
+static uint64_t slot_hint;
+static uint8_t *slot_map;
+
+/* 时钟指针 */
+static mm_t *clock_mm;
+static uint64_t clock_va;
+
+/* 正在写盘的换出所属的地址空间, 写盘期间被销毁时清为NULL */
+static mm_t *writeback_mm;
+
+/* 回收会睡眠 (写盘), kswapd和直接回收轮流进行 */
+static bool reclaiming;
+static process_t *kswapd_proc;
+
+static struct {
+    uint64_t swap_outs;
+    uint64_t swap_ins;
+    uint64_t aborted;           /* 写盘期间被写入或地址空间销毁 */
+    uint64_t io_errors;
+    uint64_t scanned;
+    uint64_t aged;              /* 清掉A位的 */
+    uint64_t kswapd_runs;
+    uint64_t direct;            /* 分配用户页时的直接回收 */
+    uint64_t reclaim_ticks;
+} swap_stat;
+
+static uint64_t slot_sector(uint64_t slot) {
+    return (swap_start + slot) * BLOCK_SECTORS;
+}
+
+static int64_t slot_alloc(void) {
+    for (uint64_t n = 0; n < nr_slots; n++) {
+        uint64_t i = (slot_hint + n) % nr_slots;
+        if (!(slot_map[i / 8] & (1 << (i % 8)))) {
+            slot_map[i / 8] |= 1 << (i % 8);
+            slot_hint = i + 1;
+            nr_used++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void swap_free(uint64_t slot) {
+    if (slot >= nr_slots || !(slot_map[slot / 8] & (1 << (slot % 8)))) {
+        printk(KERN_ERR "[SWAP] Bad free of slot %llu\n", slot);
+        return;
+    }
+    slot_map[slot / 8] &= ~(1 << (slot % 8));
+    nr_used--;
+}
+
+int swap_read(uint64_t slot, void *page) {
+    if (slot >= nr_slots || blk_read(slot_sector(slot), page, BLOCK_SECTORS) < 0) {
+        swap_stat.io_errors++;
+        printk(KERN_ERR "[SWAP] Cannot read slot %llu\n", slot);
+        return -1;
+    }
+    swap_stat.swap_ins++;
+    return 0;
+}
+
+/* 换出mm中va处的私有页, pte是它的叶子PTE */
+static int swap_out(mm_t *mm, uint64_t va, uint64_t *pte) {
+    void *page = (void *)walk_addr(mm->pagetable, va);
+    int64_t slot = slot_alloc();
+    if (slot < 0) {
+        return -1;
+    }
+
+    *pte &= ~PTE_W;
+    sfence_vma();
+    writeback_mm = mm;
+    int err = blk_write(slot_sector(slot), page, BLOCK_SECTORS);
+    bool alive = writeback_mm == mm;
+    writeback_mm = NULL;
+
+    /* 写盘时会睡眠: 地址空间可能已销毁, 页可能已被写 (mm_fault恢复了W) */
+    if (err < 0 || !alive || (*pte & (PTE_W | PTE_V)) != PTE_V) {
+        if (err < 0) {
+            swap_stat.io_errors++;
+            if (alive && (*pte & PTE_V)) {
+                *pte |= PTE_W;
+            }
+        } else {
+            swap_stat.aborted++;
+        }
+        swap_free(slot);
+        return -1;
+    }
+
+    *pte = SWAP_PTE(slot);
+    sfence_vma();
+    free_page(page);
+    swap_stat.swap_outs++;
+    return 0;
+}
+
+uint64_t swap_reclaim(uint64_t nr) {
+    if (!slot_map || nr_used == nr_slots || !mm_list) {
+        return 0;
+    }
+    while (reclaiming) {
+        yield();
+    }
+    reclaiming = true;
+    if (current_process() != kswapd_proc) {
+        swap_stat.direct++;
+    }
+
+    uint64_t start = rdtime();
+    uint64_t reclaimed = 0;
+    uint64_t budget = nr * SWAP_SCAN_RATIO;
+    bool flush = false;
+
+    while (reclaimed < nr && budget > 0 && nr_used < nr_slots) {
+        if (!clock_mm) {
+            if (!(clock_mm = mm_list)) {
+                break;
+            }
+            clock_va = USER_BASE;
+        }
+        mm_t *mm = clock_mm;
+        vma_t *vma = mm->vmas;
+        while (vma && (vma->end <= clock_va || vma->shared)) {
+            vma = vma->next;
+        }
+        /* 内核正通过物理地址使用其中页的地址空间跳过 */
+        if (!vma || mm->pinned) {
+            clock_mm = mm->next;
+            clock_va = USER_BASE;
+            continue;
+        }
+        if (clock_va < vma->start) {
+            clock_va = vma->start;
+        }
+        uint64_t va = clock_va;
+        clock_va += PAGE_SIZE;
+        budget--;
+
+        uint64_t *pte = walk_pte(mm->pagetable, va);
+        if (!pte || (*pte & (PTE_V | PTE_W)) != (PTE_V | PTE_W) ||
+            page_tag((void *)walk_addr(mm->pagetable, va)) != PG_USER) {
+            continue;
+        }
+        swap_stat.scanned++;
+        if (*pte & PTE_A) {
+            *pte &= ~PTE_A;
+            flush = true;
+            swap_stat.aged++;
+            continue;
+        }
+        if (swap_out(mm, va, pte) == 0) {
+            reclaimed++;
+        }
+    }
+
+    if (flush) {
+        sfence_vma();
+    }
+    swap_stat.reclaim_ticks += rdtime() - start;
+    reclaiming = false;
+    return reclaimed;
+}
+
+void swap_forget_mm(mm_t *mm) {
+    if (clock_mm == mm) {
+        clock_mm = mm->next;
+        clock_va = USER_BASE;
+    }
+    if (writeback_mm == mm) {
+        writeback_mm = NULL;
+    }
+}
+
+static void kswapd(void) {
+    while (1) {
+        if (get_free_pages() < SWAP_WMARK_LOW) {
+            swap_stat.kswapd_runs++;
+            while (get_free_pages() < SWAP_WMARK_HIGH && swap_reclaim(SWAP_CLUSTER) > 0) {
+                yield();
+            }
+        }
+        yield();
+    }
+}
+
+/* 交换区跟在文件系统之后, 没有挂载nosfs或磁盘上没有交换区时不启用 */
+static void swap_init(void) {
+    uint64_t start = nosfs_nr_blocks();
+    if (!start) {
+        return;
+    }
+
+    nosfs_swap_t *hdr = alloc_page();
+    if (!hdr) {
+        return;
+    }
+    if (blk_read(start * BLOCK_SECTORS, hdr, BLOCK_SECTORS) < 0 ||
+        hdr->magic != NOSFS_SWAP_MAGIC) {
+        printk("  swap: no swap area on disk (make a disk with mkfs -w)\n");
+        free_page(hdr);
+        return;
+    }
+    uint64_t slots = hdr->nr_slots;
+    free_page(hdr);
+
+    if (slots == 0 || (start + 1 + slots) * BLOCK_SECTORS > blk_capacity()) {
+        printk(KERN_ERR "[SWAP] Swap area of %llu slots does not fit the disk\n", slots);
+        return;
+    }
+    if (!(slot_map = kzalloc((slots + 7) / 8))) {
+        printk(KERN_ERR "[SWAP] Out of memory for slot map\n");
+        return;
+    }
+    swap_start = start + 1;
+    nr_slots = slots;
+
+    kswapd_proc = create_process("kswapd", kswapd);
+    printk("  swap: %llu slots (%llu MB) from block %llu, watermarks %d/%d/%d pages\n",
+           nr_slots, nr_slots * PAGE_SIZE / (1024 * 1024), swap_start,
+           SWAP_WMARK_MIN, SWAP_WMARK_LOW, SWAP_WMARK_HIGH);
+}
+deferred_initcall(swap_init);
+
+void swap_show(void) {
+    if (!slot_map) {
+        printk("Swap: not enabled\n");
+        return;
+    }
+    printk("Swap: %llu/%llu slots used (%llu KB), %llu free pages (watermarks %d/%d/%d)\n",
+           nr_used, nr_slots, nr_used * PAGE_SIZE / 1024, get_free_pages(),
+           SWAP_WMARK_MIN, SWAP_WMARK_LOW, SWAP_WMARK_HIGH);
+    printk("  swap-out %llu, swap-in %llu, aborted %llu, I/O errors %llu\n",
+           swap_stat.swap_outs, swap_stat.swap_ins, swap_stat.aborted, swap_stat.io_errors);
+    printk("  reclaim: kswapd %llu runs, direct %llu, %llu pages scanned, %llu aged, %llu us\n",
+           swap_stat.kswapd_runs, swap_stat.direct, swap_stat.scanned, swap_stat.aged,
+           swap_stat.reclaim_ticks / (TIMEBASE_FREQ / 1000000));
+}
@@ -0,0 +1,390 @@
+/* 用户地址空间 - 区域 (vma) 管理和按需缺页 */
+#include <kernel/uvm.h>
+#include <kernel/fs.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/* 用户空间和vmalloc区在根页表中的位置 (每项1GB) */
+#define ROOT_SLOT(va)   ((va) >> 30)
+#define USER_SLOT       ROOT_SLOT(USER_BASE)
+#define VMALLOC_SLOT    ROOT_SLOT(VMALLOC_START)
+
+/* 用户页的PTE: 预先置A位; 可写页预先置D位 */
+#define PTE_USER(prot)  ((prot) | PTE_U | PTE_A | (((prot) & PTE_W) ? PTE_D : 0))
+
+mm_t *mm_list;
+
+uint8_t zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+static uint64_t zero_mappings;
+
+uint64_t zero_page_mappings(void) {
+    return zero_mappings;
+}
+
+/* 解除一个用户页的映射后: 零页只减计数, 合并页减引用, 私有页释放 */
+static void put_user_page(void *page) {
+    if (page == zero_page) {
+        zero_mappings--;
+    } else if (page_tag(page) == PG_KSM) {
+        ksm_put(page);
+    } else {
+        free_page(page);
+    }
+}
+
+mm_t *mm_create(void) {
+    mm_t *mm = kzalloc(sizeof(mm_t));
+    if (!mm) {
+        return NULL;
+    }
+    mm->pagetable = create_pagetable();
+    if (!mm->pagetable) {
+        kfree(mm);
+        return NULL;
+    }
+
+    /* 内核映射 (恒等映射、设备、vmalloc区) 共享内核页表的下级页表 */
+    for (int i = 0; i < 512; i++) {
+        if (i != USER_SLOT) {
+            mm->pagetable[i] = kernel_pagetable[i];
+        }
+    }
+    mm->next = mm_list;
+    mm_list = mm;
+    return mm;
+}
+
+void mm_activate(mm_t *mm) {
+    if (!mm) {
+        switch_pagetable(kernel_pagetable);
+        return;
+    }
+    /*
+     * vmalloc区的一级页表在区域变空时会被释放、之后重新分配,
+     * 切换前重新复制这一项 (内核栈就在vmalloc区).
+     */
+    mm->pagetable[VMALLOC_SLOT] = kernel_pagetable[VMALLOC_SLOT];
+    switch_pagetable(mm->pagetable);
+}
+
+static void vma_free(vma_t *vma) {
+    if (vma->file) {
+        fs_put(vma->file);
+    }
+    kfree(vma);
+}
+
+void mm_destroy(mm_t *mm) {
+    ksm_forget_mm(mm);
+    swap_forget_mm(mm);
+    for (mm_t **pp = &mm_list; *pp; pp = &(*pp)->next) {
+        if (*pp == mm) {
+            *pp = mm->next;
+            break;
+        }
+    }
+
+    vma_t *vma = mm->vmas;
+    while (vma) {
+        vma_t *next = vma->next;
+
+        /* 共享页属于提供者, 只释放私有页和交换槽 */
+        if (!vma->shared) {
+            for (uint64_t va = vma->start; va < vma->end; va += PAGE_SIZE) {
+                uint64_t *pte = walk_pte(mm->pagetable, va);
+                if (pte && PTE_IS_SWAP(*pte)) {
+                    swap_free(PTE_SWAP_SLOT(*pte));
+                } else if (pte && (*pte & PTE_V)) {
+                    put_user_page((void *)walk_addr(mm->pagetable, va));
+                }
+            }
+        }
+        unmap_range(mm->pagetable, vma->start, vma->end - vma->start);
+        vma_free(vma);
+        vma = next;
+    }
+    free_page(mm->pagetable);
+    kfree(mm);
+}
+
+int mm_map(mm_t *mm, const vma_t *area) {
+    if ((area->start | area->end) & (PAGE_SIZE - 1) || area->start >= area->end ||
+        area->start < USER_BASE || area->end > USER_END) {
+        return -1;
+    }
+
+    vma_t **pp = &mm->vmas;
+    while (*pp && (*pp)->end <= area->start) {
+        pp = &(*pp)->next;
+    }
+    if (*pp && (*pp)->start < area->end) {
+        return -1;
+    }
+
+    vma_t *vma = kmalloc(sizeof(vma_t));
+    if (!vma) {
+        return -1;
+    }
+    *vma = *area;
+    if (vma->file) {
+        fs_get(vma->file);
+    }
+    vma->next = *pp;
+    *pp = vma;
+    return 0;
+}
+
+static vma_t *find_vma(mm_t *mm, uint64_t va) {
+    for (vma_t *vma = mm->vmas; vma && vma->start <= va; vma = vma->next) {
+        if (va < vma->end) {
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+/* 填充va开始的一页: 落在[file_va, file_end)中的部分从文件读入, 其余为0 */
+static void fill_page(vma_t *vma, uint64_t va, uint8_t *page) {
+    if (!vma->file) {
+        return;
+    }
+    uint64_t from = va > vma->file_va ? va : vma->file_va;
+    uint64_t to = va + PAGE_SIZE < vma->file_end ? va + PAGE_SIZE : vma->file_end;
+    if (from < to) {
+        fs_read_at(vma->file, vma->file_off + (from - vma->file_va), page + (from - va), to - from);
+    }
+}
+
+/* 页中有来自文件的内容 */
+static bool page_has_file_data(vma_t *vma, uint64_t va) {
+    return vma->file && va < vma->file_end && va + PAGE_SIZE > vma->file_va;
+}
+
+static bool page_is_zero(const void *page) {
+    const uint64_t *p = page;
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 分配私有页; 空闲页低于最低水位时先同步换出一批 (直接回收) */
+static void *alloc_user_page(void) {
+    if (get_free_pages() < SWAP_WMARK_MIN) {
+        swap_reclaim(SWAP_CLUSTER);
+    }
+    return alloc_page_tag(PG_USER);
+}
+
+/* 为还没有映射的va建立映射 */
+static int map_new_page(mm_t *mm, vma_t *vma, uint64_t va, uint64_t access) {
+    uint64_t prot = vma->prot;
+    /* 只读访问可以先映射零页 (区域不可读时不行: 去掉W后PTE就不是叶子了) */
+    bool may_zero = !(access & PTE_W) && (prot & PTE_R);
+    void *page;
+
+    if (vma->shared) {
+        void **slot = &vma->shared[(va - vma->start) >> PAGE_SHIFT];
+        if (*slot) {
+            mm->shared_hits++;
+        } else {
+            if (!(*slot = alloc_page_tag(PG_PAGECACHE))) {
+                return -1;
+            }
+            fill_page(vma, va, *slot);
+        }
+        page = *slot;
+        mm->shared_pages++;
+    } else if (may_zero && !page_has_file_data(vma, va)) {
+        /* 读还没写过的匿名内存: 第一次写入时才分配 */
+        page = zero_page;
+    } else {
+        if (!(page = alloc_user_page())) {
+            return -1;
+        }
+        fill_page(vma, va, page);
+        if (!page_has_file_data(vma, va)) {
+            mm->anon_pages++;
+        } else if (may_zero && page_is_zero(page)) {
+            /* 文件中的空洞 (或全0的数据) 也映射零页 */
+            free_page(page);
+            page = zero_page;
+        } else {
+            mm->file_pages++;
+        }
+    }
+
+    if (page == zero_page) {
+        prot &= ~PTE_W;
+    }
+    if (map_page(mm->pagetable, va, (uint64_t)page, PTE_USER(prot)) < 0) {
+        if (page != zero_page && !vma->shared) {
+            free_page(page);
+        }
+        return -1;
+    }
+    if (page == zero_page) {
+        zero_mappings++;
+        mm->zero_pages++;
+    }
+    return 0;
+}
+
+/* 写只读映射的零页或合并页: 复制出私有页 */
+static int cow_page(mm_t *mm, vma_t *vma, uint64_t va) {
+    void *old = (void *)walk_addr(mm->pagetable, va);
+    void *page = alloc_user_page();
+    if (!page) {
+        return -1;
+    }
+    if (old != zero_page) {
+        memcpy(page, old, PAGE_SIZE);
+    }
+    if (map_page(mm->pagetable, va, (uint64_t)page, PTE_USER(vma->prot)) < 0) {
+        free_page(page);
+        return -1;
+    }
+    put_user_page(old);
+    mm->cow_faults++;
+    return 0;
+}
+
+/* 读回换出的页. 读盘时会睡眠, 但这个PTE只有进程自己会改 */
+static int swap_in_page(mm_t *mm, vma_t *vma, uint64_t va, uint64_t slot) {
+    void *page = alloc_user_page();
+    if (!page) {
+        return -1;
+    }
+    if (swap_read(slot, page) < 0 ||
+        map_page(mm->pagetable, va, (uint64_t)page, PTE_USER(vma->prot)) < 0) {
+        free_page(page);
+        return -1;
+    }
+    swap_free(slot);
+    mm->swap_ins++;
+    return 0;
+}
+
+int mm_fault(mm_t *mm, uint64_t va, uint64_t access) {
+    vma_t *vma = find_vma(mm, va);
+    if (!vma || (vma->prot & access) != access) {
+        return -1;
+    }
+
+    va = PAGE_ALIGN_DOWN(va);
+    uint64_t *pte = walk_pte(mm->pagetable, va);
+    bool cow = false;
+
+    if (pte && (*pte & PTE_V)) {
+        if (!(access & PTE_W) || (*pte & PTE_W)) {
+            /*
+             * 已经映射: TLB中还是旧的无效PTE, 或者kswapd清了A位而硬件
+             * 不自动置位 (没有Svadu时访问A=0的页会缺页), 在这里补上
+             */
+            if (!(*pte & PTE_A)) {
+                *pte |= PTE_A;
+                sfence_vma();
+            }
+            return 0;
+        }
+        if (page_tag((void *)walk_addr(mm->pagetable, va)) == PG_USER) {
+            /* 私有页正在写入交换区 (期间只读): 恢复可写, 这次换出作废 */
+            *pte |= PTE_W | PTE_A | PTE_D;
+            sfence_vma();
+            return 0;
+        }
+        /* 写只读映射的零页或合并页 (区域本身可写) */
+        cow = true;
+    }
+
+    uint64_t start = rdtime();
+    mm->faults++;
+    int ret;
+    if (cow) {
+        ret = cow_page(mm, vma, va);
+    } else if (pte && PTE_IS_SWAP(*pte)) {
+        ret = swap_in_page(mm, vma, va, PTE_SWAP_SLOT(*pte));
+    } else {
+        ret = map_new_page(mm, vma, va, access);
+    }
+    if (ret == 0) {
+        mm->fault_ticks += rdtime() - start;
+    }
+    return ret;
+}
+
+void mm_merge_page(mm_t *mm, vma_t *vma, uint64_t va, void *page) {
+    void *old = (void *)walk_addr(mm->pagetable, va);
+    /* 叶子页表已经存在, 改写PTE不需要分配 */
+    map_page(mm->pagetable, va, (uint64_t)page, PTE_USER(vma->prot & ~PTE_W));
+    if (page == zero_page) {
+        zero_mappings++;
+    }
+    put_user_page(old);
+}
+
+void *user_page_ptr(mm_t *mm, uint64_t va, size_t len, uint64_t access) {
+    if (len == 0 || PAGE_ALIGN_DOWN(va) != PAGE_ALIGN_DOWN(va + len - 1)) {
+        return NULL;
+    }
+    /* 内核通过物理地址访问, 不受PTE权限约束, 按区域的权限检查 */
+    vma_t *vma = find_vma(mm, va);
+    if (!vma || (vma->prot & access) != access) {
+        return NULL;
+    }
+    /* 要写入时只读映射的零页和合并页也得先复制 */
+    uint64_t *pte = walk_pte(mm->pagetable, va);
+    if (!pte || !(*pte & PTE_V) || ((access & PTE_W) && !(*pte & PTE_W))) {
+        if (mm_fault(mm, va, access) < 0) {
+            return NULL;
+        }
+    }
+    return (void *)walk_addr(mm->pagetable, va);
+}
+
+/* 按页拷贝: access为PTE_W时从kbuf写入用户内存, 否则从用户内存读到kbuf */
+static int user_copy(mm_t *mm, uint64_t uva, uint8_t *kbuf, size_t len, uint64_t access) {
+    while (len > 0) {
+        size_t n = PAGE_SIZE - (uva & (PAGE_SIZE - 1));
+        if (n > len) {
+            n = len;
+        }
+        uint8_t *p = user_page_ptr(mm, uva, n, access);
+        if (!p) {
+            return -1;
+        }
+        if (access & PTE_W) {
+            memcpy(p, kbuf, n);
+        } else {
+            memcpy(kbuf, p, n);
+        }
+        uva += n;
+        kbuf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int copy_to_user(mm_t *mm, uint64_t dst, const void *src, size_t len) {
+    return user_copy(mm, dst, (uint8_t *)src, len, PTE_W);
+}
+
+int copy_from_user(mm_t *mm, void *dst, uint64_t src, size_t len) {
+    return user_copy(mm, src, dst, len, PTE_R);
+}
+
+int strncpy_from_user(mm_t *mm, char *dst, uint64_t src, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        char *p = user_page_ptr(mm, src + i, 1, PTE_R);
+        if (!p) {
+            return -1;
+        }
+        if ((dst[i] = *p) == '\0') {
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,176 @@
+/* vmalloc区 - 虚拟连续、物理不连续的内核内存 */
+#include <kernel/mm.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 已分配区间按地址排序放在链表中, 分配时首次适配.
+ * 每个区间占用 size + 一个保护页 (在区间之后), 区域开头留一个保护页,
+ * 所以任何一块分配的上下都紧挨着未映射的页.
+ * 物理页逐页分配, 地址连续的页合并成一段用map_range映射.
+ */
+
+typedef struct vm_area {
+    uint64_t addr;
+    uint64_t size;              /* 映射的字节数, 不含保护页 */
+    struct vm_area *next;
+} vm_area_t;
+
+static vm_area_t *areas;
+static bool vmalloc_ready;
+static vmalloc_stats_t stats;
+
+void vmalloc_init(void) {
+    vmalloc_ready = true;
+    printk("  vmalloc: %llu MB at %p, guard page after each area\n",
+           (uint64_t)(VMALLOC_SIZE >> 20), (void *)VMALLOC_START);
+}
+
+bool is_vmalloc_addr(const void *addr) {
+    return (uint64_t)addr >= VMALLOC_START && (uint64_t)addr < VMALLOC_END;
+}
+
+/* 找一段能放下need字节的空闲虚拟区间, 返回起始地址并设置插入位置 */
+static uint64_t find_gap(uint64_t need, vm_area_t ***link) {
+    uint64_t start = VMALLOC_START + PAGE_SIZE;
+    vm_area_t **pp = &areas;
+
+    while (*pp) {
+        if ((*pp)->addr - start >= need) {
+            break;
+        }
+        start = (*pp)->addr + (*pp)->size + PAGE_SIZE;
+        pp = &(*pp)->next;
+    }
+    if (start > VMALLOC_END || VMALLOC_END - start < need) {
+        return 0;
+    }
+    *link = pp;
+    return start;
+}
+
+/* 释放[addr, addr+size)中已映射的物理页并解除映射 */
+static void unmap_free(uint64_t addr, uint64_t size) {
+    for (uint64_t va = addr; va < addr + size; va += PAGE_SIZE) {
+        uint64_t pa = walk_addr(kernel_pagetable, va);
+        if (pa) {
+            free_page((void *)pa);
+        }
+    }
+    unmap_range(kernel_pagetable, addr, size);
+}
+
+void *vmalloc(size_t size) {
+    return vmalloc_tag(size, PG_VMALLOC);
+}
+
+void *vmalloc_tag(size_t size, int tag) {
+    if (!vmalloc_ready || size == 0) {
+        return NULL;
+    }
+    size = PAGE_ALIGN_UP(size);
+
+    vm_area_t *area = kmalloc(sizeof(vm_area_t));
+    if (!area) {
+        stats.failures++;
+        return NULL;
+    }
+
+    vm_area_t **link;
+    uint64_t addr = find_gap(size + PAGE_SIZE, &link);
+    if (!addr) {
+        printk(KERN_ERR "[VMALLOC] No space for %llu KB\n", (uint64_t)size / 1024);
+        kfree(area);
+        stats.failures++;
+        return NULL;
+    }
+
+    /* 逐页分配, 物理连续的页攒成一段再映射 */
+    uint64_t run_va = addr;
+    uint64_t run_pa = 0;
+    uint64_t run_len = 0;
+
+    for (uint64_t va = addr; va < addr + size; va += PAGE_SIZE) {
+        void *page = alloc_page_tag(tag);
+        if (!page) {
+            goto fail;
+        }
+        if (run_len && (uint64_t)page == run_pa + run_len) {
+            run_len += PAGE_SIZE;
+            continue;
+        }
+        if (run_len && map_range(kernel_pagetable, run_va, run_pa, run_len, PTE_KERNEL) < 0) {
+            free_page(page);
+            goto fail;
+        }
+        run_va = va;
+        run_pa = (uint64_t)page;
+        run_len = PAGE_SIZE;
+    }
+    if (map_range(kernel_pagetable, run_va, run_pa, run_len, PTE_KERNEL) < 0) {
+        goto fail;
+    }
+
+    area->addr = addr;
+    area->size = size;
+    area->next = *link;
+    *link = area;
+
+    stats.nr_areas++;
+    stats.nr_pages += size / PAGE_SIZE;
+    stats.used += size + PAGE_SIZE;
+    return (void *)addr;
+
+fail:
+    /* [addr, run_va)已经映射; 当前段[run_pa, run_pa+run_len)分配了但还没映射 */
+    if (run_len) {
+        free_pages((void *)run_pa, run_len / PAGE_SIZE);
+    }
+    unmap_free(addr, run_va - addr);
+    printk(KERN_ERR "[VMALLOC] Out of memory for %llu KB\n", (uint64_t)size / 1024);
+    kfree(area);
+    stats.failures++;
+    return NULL;
+}
+
+void vfree(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    vm_area_t **pp = &areas;
+    while (*pp && (*pp)->addr != (uint64_t)ptr) {
+        pp = &(*pp)->next;
+    }
+    if (!*pp) {
+        printk(KERN_ERR "[VMALLOC] vfree: %p is not a vmalloc area\n", ptr);
+        return;
+    }
+
+    vm_area_t *area = *pp;
+    *pp = area->next;
+
+    unmap_free(area->addr, area->size);
+
+    stats.nr_areas--;
+    stats.nr_pages -= area->size / PAGE_SIZE;
+    stats.used -= area->size + PAGE_SIZE;
+    kfree(area);
+}
+
+void vmalloc_get_stats(vmalloc_stats_t *out) {
+    *out = stats;
+
+    uint64_t start = VMALLOC_START + PAGE_SIZE;
+    uint64_t largest = 0;
+    for (vm_area_t *a = areas; a; a = a->next) {
+        if (a->addr - start > largest) {
+            largest = a->addr - start;
+        }
+        start = a->addr + a->size + PAGE_SIZE;
+    }
+    if (VMALLOC_END - start > largest) {
+        largest = VMALLOC_END - start;
+    }
+    out->largest_free = largest;
+}
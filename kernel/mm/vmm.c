@@ -1,6 +1,8 @@
 /* 虚拟内存管理 - 页表管理 */
 #include <kernel/mm.h>
 #include <kernel/printk.h>
+#include <kernel/plic.h>
+#include <kernel/virtio.h>
 #include <arch/riscv/riscv.h>
 
 /* Sv39 页表结构 */
@@ -10,46 +12,252 @@
 /* 获取虚拟地址的各级页表索引 */
 #define VPN(va, level) (((va) >> (12 + 9 * (level))) & 0x1FF)
 
+/* 第level级一个PTE覆盖的大小: 4KB, 2MB, 1GB */
+#define LEVEL_SIZE(level) (1UL << (PAGE_SHIFT + 9 * (level)))
+
+/* Sv39虚拟地址空间 (只使用低半部分, 第38位以上为0) */
+#define MAXVA (1UL << 38)
+
 /* PTE操作 */
 #define PTE_TO_PA(pte) (((pte) >> 10) << 12)
 #define PA_TO_PTE(pa) (((pa) >> 12) << 10)
 
-static pagetable_t kernel_pagetable;
+#define PTE_LEAF (PTE_R | PTE_W | PTE_X)
+#define PTE_PERM_MASK (PTE_R | PTE_W | PTE_X | PTE_U | PTE_G)
+
+pagetable_t kernel_pagetable;
 
 /* 创建新页表 */
 pagetable_t create_pagetable(void) {
-    pagetable_t pt = (pagetable_t)alloc_page();
+    pagetable_t pt = (pagetable_t)alloc_page_tag(PG_PGTABLE);
     if (!pt) {
-        printk("[VMM] Failed to allocate page table\n");
+        printk(KERN_ERR "[VMM] Failed to allocate page table\n");
         return NULL;
     }
     return pt;
 }
 
-/* 映射一个页 */
-void map_page(pagetable_t pt, uint64_t va, uint64_t pa, uint64_t flags) {
-    /* 遍历三级页表 */
+/*
+ * 返回va所在的叶子页表 (第0级). alloc为true时补齐缺失的中间页表,
+ * 分配失败时释放这次新建的页表并返回NULL; alloc为false时中间页表不存在返回NULL.
+ * 不创建也不拆分大页, 路径上遇到大页返回NULL.
+ */
+static pagetable_t walk_leaf(pagetable_t pt, uint64_t va, bool alloc) {
+    uint64_t *created = NULL;
+
     for (int level = 2; level > 0; level--) {
-        uint64_t idx = VPN(va, level);
-        uint64_t *pte = &pt[idx];
+        uint64_t *pte = &pt[VPN(va, level)];
 
         if (*pte & PTE_V) {
-            /* PTE有效，获取下一级页表 */
+            if (*pte & PTE_LEAF) {
+                return NULL;
+            }
             pt = (pagetable_t)PTE_TO_PA(*pte);
         } else {
-            /* PTE无效，分配新页表 */
+            if (!alloc) {
+                return NULL;
+            }
             pagetable_t new_pt = create_pagetable();
             if (!new_pt) {
-                return;
+                if (created) {
+                    free_page((void *)PTE_TO_PA(*created));
+                    *created = 0;
+                }
+                return NULL;
             }
             *pte = PA_TO_PTE((uint64_t)new_pt) | PTE_V;
+            if (!created) {
+                created = pte;
+            }
             pt = new_pt;
         }
     }
+    return pt;
+}
+
+static bool range_ok(const char *op, uint64_t va, uint64_t pa, size_t size) {
+    if ((va | pa | size) & (PAGE_SIZE - 1) || va >= MAXVA || size > MAXVA - va) {
+        printk(KERN_ERR "[VMM] %s: bad range %p+%llx\n", op, (void *)va, (uint64_t)size);
+        return false;
+    }
+    return true;
+}
+
+/* va所在叶子页表中, 从va开始、不超过end的PTE个数 */
+static uint64_t leaf_span(uint64_t va, uint64_t end) {
+    uint64_t n = PGTABLE_ENTRIES - VPN(va, 0);
+    uint64_t left = (end - va) >> PAGE_SHIFT;
+    return n < left ? n : left;
+}
+
+/*
+ * 建立[va, va+size)到[pa, pa+size)的映射. 每张叶子页表只从根走一次,
+ * 之后连续填写其中落在范围内的PTE. 最后刷新一次TLB: 硬件允许缓存无效的PTE,
+ * 新建的映射 (如vmalloc) 也要刷新后才保证可见.
+ * 分配页表失败时撤销本次建立的映射并返回-1.
+ */
+int map_range(pagetable_t pt, uint64_t va, uint64_t pa, size_t size, uint64_t flags) {
+    if (!range_ok("map_range", va, pa, size) || !(flags & PTE_LEAF)) {
+        return -1;
+    }
+
+    uint64_t start = va;
+    uint64_t end = va + size;
+
+    while (va < end) {
+        pagetable_t leaf = walk_leaf(pt, va, true);
+        if (!leaf) {
+            printk(KERN_ERR "[VMM] map_range: cannot map %p\n", (void *)va);
+            unmap_range(pt, start, va - start);
+            return -1;
+        }
+
+        uint64_t *pte = &leaf[VPN(va, 0)];
+        uint64_t n = leaf_span(va, end);
+        for (uint64_t i = 0; i < n; i++) {
+            pte[i] = PA_TO_PTE(pa) | flags | PTE_V;
+            pa += PAGE_SIZE;
+        }
+        va += n << PAGE_SHIFT;
+    }
+
+    if (size > 0) {
+        sfence_vma();
+    }
+    return 0;
+}
 
-    /* 设置叶子PTE */
-    uint64_t idx = VPN(va, 0);
-    pt[idx] = PA_TO_PTE(pa) | flags | PTE_V;
+/* 映射一个页 */
+int map_page(pagetable_t pt, uint64_t va, uint64_t pa, uint64_t flags) {
+    return map_range(pt, va, pa, PAGE_SIZE, flags);
+}
+
+/* 查页表: 返回va映射到的物理地址, 没有映射时返回0. 能查大页 (内核恒等映射) */
+uint64_t walk_addr(pagetable_t pt, uint64_t va) {
+    if (va >= MAXVA) {
+        return 0;
+    }
+    for (int level = 2; level >= 0; level--) {
+        uint64_t pte = pt[VPN(va, level)];
+        if (!(pte & PTE_V)) {
+            return 0;
+        }
+        if (level == 0 || (pte & PTE_LEAF)) {
+            return PTE_TO_PA(pte) | (va & (LEVEL_SIZE(level) - 1));
+        }
+        pt = (pagetable_t)PTE_TO_PA(pte);
+    }
+    return 0;
+}
+
+uint64_t *walk_pte(pagetable_t pt, uint64_t va) {
+    if (va >= MAXVA) {
+        return NULL;
+    }
+    pagetable_t leaf = walk_leaf(pt, va, false);
+    return leaf ? &leaf[VPN(va, 0)] : NULL;
+}
+
+static bool table_empty(pagetable_t table) {
+    for (int i = 0; i < PGTABLE_ENTRIES; i++) {
+        if (table[i] & PTE_V) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * 清除第level级页表table中[va, end)的映射, 返回清除的PTE数.
+ * 下级页表被清空后释放; 整张下级页表都在范围内时不必扫描就知道它空了.
+ * 大页只在整个被覆盖时清除.
+ */
+static uint64_t unmap_level(pagetable_t table, int level, uint64_t va, uint64_t end) {
+    uint64_t cleared = 0;
+
+    while (va < end) {
+        uint64_t next = (va & ~(LEVEL_SIZE(level) - 1)) + LEVEL_SIZE(level);
+        if (next > end) {
+            next = end;
+        }
+        bool whole = (next - va) == LEVEL_SIZE(level);
+        uint64_t *pte = &table[VPN(va, level)];
+
+        if (!(*pte & PTE_V)) {
+            /* 空洞: 整段跳过 */
+        } else if (level == 0 || (*pte & PTE_LEAF)) {
+            if (whole) {
+                *pte = 0;
+                cleared++;
+            }
+        } else {
+            pagetable_t sub = (pagetable_t)PTE_TO_PA(*pte);
+            cleared += unmap_level(sub, level - 1, va, next);
+            if (whole || table_empty(sub)) {
+                *pte = 0;
+                free_page(sub);
+            }
+        }
+        va = next;
+    }
+    return cleared;
+}
+
+/*
+ * 解除[va, va+size)的映射 (不释放映射的物理页), 释放变空的中间页表.
+ * 所有PTE清除后只刷新一次TLB.
+ */
+int unmap_range(pagetable_t pt, uint64_t va, size_t size) {
+    if (!range_ok("unmap_range", va, 0, size)) {
+        return -1;
+    }
+    if (size > 0 && unmap_level(pt, 2, va, va + size) > 0) {
+        sfence_vma();
+    }
+    return 0;
+}
+
+/*
+ * 把[va, va+size)中已映射页的权限改为flags (R/W/X/U/G), 保留A/D位.
+ * 范围内有未映射的页时照常处理其余页并返回-1. TLB只刷新一次.
+ */
+int protect_range(pagetable_t pt, uint64_t va, size_t size, uint64_t flags) {
+    if (!range_ok("protect_range", va, 0, size) || !(flags & PTE_LEAF)) {
+        return -1;
+    }
+
+    uint64_t end = va + size;
+    bool changed = false;
+    bool hole = false;
+
+    while (va < end) {
+        pagetable_t leaf = walk_leaf(pt, va, false);
+        if (!leaf) {
+            /* 整张叶子页表不存在, 跳到下一个2MB */
+            hole = true;
+            uint64_t next = (va & ~(LEVEL_SIZE(1) - 1)) + LEVEL_SIZE(1);
+            va = next < end ? next : end;
+            continue;
+        }
+
+        uint64_t *pte = &leaf[VPN(va, 0)];
+        uint64_t n = leaf_span(va, end);
+        for (uint64_t i = 0; i < n; i++) {
+            if (!(pte[i] & PTE_V)) {
+                hole = true;
+                continue;
+            }
+            uint64_t old = pte[i];
+            pte[i] = (old & ~PTE_PERM_MASK) | (flags & PTE_PERM_MASK);
+            changed |= pte[i] != old;
+        }
+        va += n << PAGE_SHIFT;
+    }
+
+    if (changed) {
+        sfence_vma();
+    }
+    return hole ? -1 : 0;
 }
 
 /* 切换页表 */
@@ -59,38 +267,81 @@ void switch_pagetable(pagetable_t pt) {
     sfence_vma();
 }
 
+/*
+ * 用2MB大页建立[va, va+size)到[pa, pa+size)的映射, 只填第1级PTE.
+ * 内核RAM的128MB (默认) 只需一张中间页表和64个PTE, 不用分配64张叶子页表、
+ * 填写32768个PTE, 启动更快, TLB也覆盖得更多.
+ * 大页不能被unmap_range/protect_range部分修改, 只用于不会变化的内核恒等映射.
+ */
+static int map_megapages(pagetable_t pt, uint64_t va, uint64_t pa, size_t size, uint64_t flags) {
+    if (!range_ok("map_megapages", va, pa, size) || ((va | pa | size) & (LEVEL_SIZE(1) - 1))) {
+        return -1;
+    }
+
+    for (uint64_t off = 0; off < size; off += LEVEL_SIZE(1)) {
+        uint64_t *pte = &pt[VPN(va + off, 2)];
+        if (!(*pte & PTE_V)) {
+            pagetable_t mid = create_pagetable();
+            if (!mid) {
+                return -1;
+            }
+            *pte = PA_TO_PTE((uint64_t)mid) | PTE_V;
+        } else if (*pte & PTE_LEAF) {
+            return -1;
+        }
+        pagetable_t mid = (pagetable_t)PTE_TO_PA(*pte);
+        mid[VPN(va + off, 1)] = PA_TO_PTE(pa + off) | flags | PTE_V;
+    }
+
+    sfence_vma();
+    return 0;
+}
+
 /* 建立内核恒等映射 */
-static void setup_kernel_mapping(void) {
+static int setup_kernel_mapping(void) {
     kernel_pagetable = create_pagetable();
     if (!kernel_pagetable) {
-        printk("[VMM] Failed to create kernel page table\n");
-        return;
+        printk(KERN_ERR "[VMM] Failed to create kernel page table\n");
+        return -1;
     }
 
-    /* 映射内核代码段 (0x80000000 - 0x88000000, 128MB) */
-    uint64_t kernel_start = 0x80000000UL;
-    uint64_t kernel_size = 128 * 1024 * 1024;  /* 128MB */
+    /* 恒等映射整个RAM (OpenSBI、内核和pmm管理的页, 默认0x80000000 - 0x88000000) */
+    uint64_t kernel_start = RAM_BASE;
+    uint64_t kernel_size = RAM_END - RAM_BASE;
 
-    for (uint64_t offset = 0; offset < kernel_size; offset += PAGE_SIZE) {
-        uint64_t addr = kernel_start + offset;
-        map_page(kernel_pagetable, addr, addr,
-                 PTE_R | PTE_W | PTE_X | PTE_G);
-    }
+    int err = 0;
+    err |= map_megapages(kernel_pagetable, kernel_start, kernel_start, kernel_size,
+                         PTE_KERNEL | PTE_X);
 
     /* 映射UART设备 (0x10000000) */
-    map_page(kernel_pagetable, 0x10000000UL, 0x10000000UL,
-             PTE_R | PTE_W | PTE_G);
+    err |= map_page(kernel_pagetable, 0x10000000UL, 0x10000000UL, PTE_KERNEL);
 
+    /* 映射virtio-mmio设备 (0x10001000 - 0x10008fff) */
+    err |= map_range(kernel_pagetable, VIRTIO_MMIO_BASE, VIRTIO_MMIO_BASE,
+                     PAGE_ALIGN_UP(VIRTIO_MMIO_SLOTS * VIRTIO_MMIO_STRIDE), PTE_KERNEL);
+
+    /* 映射PLIC (0x0c000000, 4MB) */
+    err |= map_range(kernel_pagetable, PLIC_BASE, PLIC_BASE, PLIC_SIZE, PTE_KERNEL);
+
+    if (err) {
+        printk(KERN_ERR "[VMM] Kernel page table incomplete\n");
+        return -1;
+    }
     printk("  Kernel page table created\n");
+    return 0;
 }
 
 void vmm_init(void) {
-    setup_kernel_mapping();
+    if (setup_kernel_mapping() < 0) {
+        printk(KERN_ERR "[VMM] Paging disabled, vmalloc unavailable\n");
+        return;
+    }
 
-    /* 暂时不切换页表，保持恒等映射 */
-    /* switch_pagetable(kernel_pagetable); */
+    /* 内核恒等映射, 另外vmalloc区按需映射 */
+    switch_pagetable(kernel_pagetable);
+    vmalloc_init();
 
-    printk("  Virtual memory ready (paging disabled for simplicity)\n");
+    printk("  Virtual memory ready (Sv39 paging enabled)\n");
 }
 
 void mm_init(void) {
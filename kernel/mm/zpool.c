@@ -0,0 +1,165 @@
+/* 压缩数据池 - 按大小分级, 对象紧挨着放在物理连续的几页中 */
+#include <kernel/mm.h>
+
+/*
+ * kmalloc的slab页首有32字节头部, 2KB的对象一页只放得下一个, 用来放压缩页
+ * 几乎省不了内存. 这里每级对象的大小是32字节的倍数, 一个span是1~4个物理
+ * 连续的页, 页里没有头部, 对象可以跨页. span的页数按末尾剩下的空间最少选.
+ * span的描述符从kmalloc分配, 每个对象开头8字节记下所在的span, 释放时据此
+ * 找到描述符; 空闲对象的这8字节串成空闲链表. 空span立即还给页分配器.
+ */
+#define ZPOOL_SHIFT     5
+#define ZPOOL_ALIGN     (1UL << ZPOOL_SHIFT)
+#define ZPOOL_OBJ_MAX   (ZPOOL_MAX_ALLOC + sizeof(zspan_t *))
+#define ZPOOL_CLASSES   (ZPOOL_OBJ_MAX / ZPOOL_ALIGN)
+#define ZPOOL_MAX_SPAN  4
+
+typedef struct zspan {
+    struct zspan *next;         /* 同一级别中还有空闲对象的span */
+    struct zspan *prev;
+    uint8_t *base;
+    void *free;                 /* 空闲对象链表 */
+    uint16_t inuse;
+    uint16_t total;
+    uint8_t cls;
+    uint8_t npages;
+} zspan_t;
+
+static zspan_t *partial[ZPOOL_CLASSES];
+static zpool_stats_t stats;
+
+static inline size_t class_size(int cls) {
+    return (size_t)(cls + 1) << ZPOOL_SHIFT;
+}
+
+/* 1~ZPOOL_MAX_SPAN页中放这一级对象时末尾浪费比例最小的页数 */
+static int span_pages(size_t size) {
+    int best = 1;
+    for (int n = 2; n <= ZPOOL_MAX_SPAN; n++) {
+        /* 比较 waste(n)/n 和 waste(best)/best */
+        if ((n * PAGE_SIZE % size) * best < (best * PAGE_SIZE % size) * n) {
+            best = n;
+        }
+    }
+    return best;
+}
+
+static void span_unlink(zspan_t *span) {
+    if (span->prev) {
+        span->prev->next = span->next;
+    } else {
+        partial[span->cls] = span->next;
+    }
+    if (span->next) {
+        span->next->prev = span->prev;
+    }
+    span->next = span->prev = NULL;
+}
+
+static void span_push(zspan_t *span) {
+    span->prev = NULL;
+    span->next = partial[span->cls];
+    if (partial[span->cls]) {
+        partial[span->cls]->prev = span;
+    }
+    partial[span->cls] = span;
+}
+
+static zspan_t *span_create(int cls) {
+    size_t size = class_size(cls);
+    int npages = span_pages(size);
+
+    zspan_t *span = kmalloc(sizeof(zspan_t));
+    if (!span) {
+        return NULL;
+    }
+    /* 连续页不够时退回单页 */
+    uint8_t *base = alloc_pages_tag(npages, PG_ZPOOL);
+    if (!base && npages > 1) {
+        npages = 1;
+        base = alloc_pages_tag(npages, PG_ZPOOL);
+    }
+    if (!base) {
+        kfree(span);
+        return NULL;
+    }
+
+    span->base = base;
+    span->cls = cls;
+    span->npages = npages;
+    span->total = npages * PAGE_SIZE / size;
+    span->inuse = 0;
+    span->free = NULL;
+    for (int i = span->total - 1; i >= 0; i--) {
+        void **o = (void **)(base + i * size);
+        *o = span->free;
+        span->free = o;
+    }
+
+    stats.nr_pages += npages;
+    span_push(span);
+    return span;
+}
+
+void *zpool_alloc(size_t size) {
+    if (size == 0 || size > ZPOOL_MAX_ALLOC) {
+        return NULL;
+    }
+
+    int cls = (size + sizeof(zspan_t *) - 1) >> ZPOOL_SHIFT;
+    zspan_t *span = partial[cls];
+    if (!span && !(span = span_create(cls))) {
+        return NULL;
+    }
+
+    void **obj = span->free;
+    span->free = *obj;
+    span->inuse++;
+    if (!span->free) {
+        span_unlink(span);
+    }
+
+    *obj = span;
+    stats.nr_objs++;
+    stats.bytes += class_size(cls);
+    return obj + 1;
+}
+
+void zpool_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    void **obj = (void **)ptr - 1;
+    zspan_t *span = *obj;
+    bool was_full = (span->free == NULL);
+
+    *obj = span->free;
+    span->free = obj;
+    span->inuse--;
+    stats.nr_objs--;
+    stats.bytes -= class_size(span->cls);
+
+    if (span->inuse == 0) {
+        if (!was_full) {
+            span_unlink(span);
+        }
+        stats.nr_pages -= span->npages;
+        free_pages(span->base, span->npages);
+        kfree(span);
+    } else if (was_full) {
+        span_push(span);
+    }
+}
+
+size_t zpool_size(const void *ptr) {
+    if (!ptr) {
+        return 0;
+    }
+    const zspan_t *span = *((zspan_t *const *)ptr - 1);
+    return class_size(span->cls);
+}
+
+void zpool_get_stats(zpool_stats_t *out) {
+    *out = stats;
+}
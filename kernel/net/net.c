@@ -0,0 +1,369 @@
+/* 最小网络协议栈: 以太网/ARP/IPv4/UDP 和 UDP回显服务 */
+#include <kernel/net.h>
+#include <kernel/irq.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+
+#define ARP_CACHE_SIZE 16
+#define UDP_MAX_BINDS  8
+#define IP_TTL         64
+
+static const uint8_t eth_broadcast[ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+/* ARP缓存 (IP为主机字节序), 满时按轮转替换 */
+static struct {
+    uint32_t ip;
+    uint8_t mac[ETH_ALEN];
+    bool valid;
+} arp_cache[ARP_CACHE_SIZE];
+static int arp_next;
+
+static struct {
+    uint16_t port;
+    udp_handler_t handler;
+} udp_binds[UDP_MAX_BINDS];
+
+static uint16_t ip_next_id;
+static net_stats_t stats;
+
+static uint16_t ip_checksum(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (p[i] << 8) | p[i + 1];
+    }
+    if (len & 1) {
+        sum += p[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return htons(~sum);
+}
+
+static bool on_link(uint32_t ip) {
+    return (ip & NET_NETMASK) == (NET_IP_ADDR & NET_NETMASK);
+}
+
+/* ---------------- ARP ---------------- */
+
+static void arp_learn(uint32_t ip, const uint8_t *mac) {
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (arp_cache[i].valid && arp_cache[i].ip == ip) {
+            memcpy(arp_cache[i].mac, mac, ETH_ALEN);
+            return;
+        }
+    }
+    arp_cache[arp_next].ip = ip;
+    memcpy(arp_cache[arp_next].mac, mac, ETH_ALEN);
+    arp_cache[arp_next].valid = true;
+    arp_next = (arp_next + 1) % ARP_CACHE_SIZE;
+}
+
+static const uint8_t *arp_lookup(uint32_t ip) {
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (arp_cache[i].valid && arp_cache[i].ip == ip) {
+            return arp_cache[i].mac;
+        }
+    }
+    return NULL;
+}
+
+static void arp_fill(arp_hdr_t *arp, uint16_t op, const uint8_t *tha, uint32_t tpa) {
+    arp->htype = htons(1);
+    arp->ptype = htons(ETH_P_IP);
+    arp->hlen = ETH_ALEN;
+    arp->plen = 4;
+    arp->op = htons(op);
+    memcpy(arp->sha, netdev_mac(), ETH_ALEN);
+    arp->spa = htonl(NET_IP_ADDR);
+    memcpy(arp->tha, tha, ETH_ALEN);
+    arp->tpa = htonl(tpa);
+}
+
+static void arp_request(uint32_t ip) {
+    uint8_t *frame = netdev_alloc_frame();
+    if (!frame) {
+        return;
+    }
+    eth_hdr_t *eth = (eth_hdr_t *)frame;
+    memcpy(eth->dst, eth_broadcast, ETH_ALEN);
+    memcpy(eth->src, netdev_mac(), ETH_ALEN);
+    eth->type = htons(ETH_P_ARP);
+
+    static const uint8_t zero[ETH_ALEN];
+    arp_fill((arp_hdr_t *)(frame + ETH_HLEN), ARP_REQUEST, zero, ip);
+    if (netdev_xmit(frame, ETH_HLEN + sizeof(arp_hdr_t)) < 0) {
+        netdev_free_frame(frame);
+    }
+}
+
+static void arp_rx(uint8_t *frame, size_t len) {
+    eth_hdr_t *eth = (eth_hdr_t *)frame;
+    arp_hdr_t *arp = (arp_hdr_t *)(frame + ETH_HLEN);
+
+    if (len < ETH_HLEN + sizeof(arp_hdr_t) || ntohs(arp->ptype) != ETH_P_IP ||
+        arp->hlen != ETH_ALEN || arp->plen != 4) {
+        netdev_free_frame(frame);
+        return;
+    }
+
+    uint32_t spa = ntohl(arp->spa);
+    arp_learn(spa, arp->sha);
+
+    if (ntohs(arp->op) != ARP_REQUEST || ntohl(arp->tpa) != NET_IP_ADDR) {
+        netdev_free_frame(frame);
+        return;
+    }
+    stats.arp_requests++;
+
+    /* 就地改写为应答 */
+    uint8_t sha[ETH_ALEN];
+    memcpy(sha, arp->sha, ETH_ALEN);
+    arp_fill(arp, ARP_REPLY, sha, spa);
+    memcpy(eth->dst, sha, ETH_ALEN);
+    memcpy(eth->src, netdev_mac(), ETH_ALEN);
+
+    if (netdev_xmit(frame, ETH_HLEN + sizeof(arp_hdr_t)) < 0) {
+        netdev_free_frame(frame);
+        return;
+    }
+    stats.arp_replies++;
+}
+
+/* ---------------- IPv4 / UDP ---------------- */
+
+/* 填写IP头部 (地址为主机字节序) */
+static void ip_fill(ip_hdr_t *ip, uint32_t src, uint32_t dst, size_t payload) {
+    ip->ver_ihl = 0x45;
+    ip->tos = 0;
+    ip->len = htons(sizeof(ip_hdr_t) + payload);
+    ip->id = htons(ip_next_id++);
+    ip->frag = 0;
+    ip->ttl = IP_TTL;
+    ip->proto = IP_PROTO_UDP;
+    ip->src = htonl(src);
+    ip->dst = htonl(dst);
+    ip->csum = 0;
+    ip->csum = ip_checksum(ip, sizeof(ip_hdr_t));
+}
+
+static void udp_rx(uint8_t *frame, ip_hdr_t *ip, size_t ip_len) {
+    size_t ihl = (ip->ver_ihl & 0xf) * 4;
+    udp_hdr_t *udp = (udp_hdr_t *)((uint8_t *)ip + ihl);
+    size_t ulen = ntohs(udp->len);
+
+    if (ip_len < ihl + sizeof(udp_hdr_t) || ulen < sizeof(udp_hdr_t) || ulen > ip_len - ihl) {
+        stats.ip_bad++;
+        netdev_free_frame(frame);
+        return;
+    }
+    stats.udp_rx++;
+
+    uint16_t port = ntohs(udp->dport);
+    for (int i = 0; i < UDP_MAX_BINDS; i++) {
+        if (udp_binds[i].handler && udp_binds[i].port == port) {
+            if (!udp_binds[i].handler(frame, ip, udp, (uint8_t *)(udp + 1),
+                                      ulen - sizeof(udp_hdr_t))) {
+                netdev_free_frame(frame);
+            }
+            return;
+        }
+    }
+
+    stats.udp_no_port++;
+    netdev_free_frame(frame);
+}
+
+static void ip_rx(uint8_t *frame, size_t len) {
+    eth_hdr_t *eth = (eth_hdr_t *)frame;
+    ip_hdr_t *ip = (ip_hdr_t *)(frame + ETH_HLEN);
+    size_t ihl = (ip->ver_ihl & 0xf) * 4;
+
+    if (len < ETH_HLEN + sizeof(ip_hdr_t) || (ip->ver_ihl >> 4) != 4 ||
+        ihl < sizeof(ip_hdr_t) || ETH_HLEN + ihl > len ||
+        ntohs(ip->len) < ihl || ntohs(ip->len) > len - ETH_HLEN ||
+        ip_checksum(ip, ihl) != 0) {
+        stats.ip_bad++;
+        netdev_free_frame(frame);
+        return;
+    }
+
+    /* 不是发给本机的, 或者是分片 (不支持重组) */
+    uint32_t dst = ntohl(ip->dst);
+    if ((dst != NET_IP_ADDR && dst != 0xffffffff) || (ntohs(ip->frag) & 0x3fff)) {
+        netdev_free_frame(frame);
+        return;
+    }
+
+    uint32_t src = ntohl(ip->src);
+    if (on_link(src)) {
+        arp_learn(src, eth->src);
+    }
+
+    if (ip->proto == IP_PROTO_UDP) {
+        udp_rx(frame, ip, ntohs(ip->len));
+    } else {
+        netdev_free_frame(frame);
+    }
+}
+
+void net_rx(void *frame, size_t len) {
+    eth_hdr_t *eth = frame;
+
+    if (len < ETH_HLEN) {
+        netdev_free_frame(frame);
+        return;
+    }
+
+    switch (ntohs(eth->type)) {
+        case ETH_P_ARP:
+            arp_rx(frame, len);
+            break;
+        case ETH_P_IP:
+            ip_rx(frame, len);
+            break;
+        default:
+            netdev_free_frame(frame);
+            break;
+    }
+}
+
+int udp_bind(uint16_t port, udp_handler_t handler) {
+    for (int i = 0; i < UDP_MAX_BINDS; i++) {
+        if (udp_binds[i].handler && udp_binds[i].port == port) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < UDP_MAX_BINDS; i++) {
+        if (!udp_binds[i].handler) {
+            udp_binds[i].port = port;
+            udp_binds[i].handler = handler;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int udp_xmit(uint32_t dst_ip, uint16_t dst_port, uint16_t src_port,
+                    const void *data, size_t len) {
+    uint32_t next_hop = on_link(dst_ip) ? dst_ip : NET_GATEWAY;
+    const uint8_t *mac = arp_lookup(next_hop);
+    if (!mac) {
+        arp_request(next_hop);
+        return -1;
+    }
+
+    uint8_t *frame = netdev_alloc_frame();
+    if (!frame) {
+        return -1;
+    }
+    eth_hdr_t *eth = (eth_hdr_t *)frame;
+    ip_hdr_t *ip = (ip_hdr_t *)(frame + ETH_HLEN);
+    udp_hdr_t *udp = (udp_hdr_t *)(ip + 1);
+
+    memcpy(eth->dst, mac, ETH_ALEN);
+    memcpy(eth->src, netdev_mac(), ETH_ALEN);
+    eth->type = htons(ETH_P_IP);
+    ip_fill(ip, NET_IP_ADDR, dst_ip, sizeof(udp_hdr_t) + len);
+    udp->sport = htons(src_port);
+    udp->dport = htons(dst_port);
+    udp->len = htons(sizeof(udp_hdr_t) + len);
+    udp->csum = 0;                      /* IPv4下UDP校验和可选 */
+    memcpy(udp + 1, data, len);
+
+    if (netdev_xmit(frame, UDP_HDRS + len) < 0) {
+        netdev_free_frame(frame);
+        return -1;
+    }
+    return 0;
+}
+
+/* 进程上下文调用: ARP缓存、页池和发送队列也由NET_RX软中断使用 */
+int udp_send(uint32_t dst_ip, uint16_t dst_port, uint16_t src_port,
+             const void *data, size_t len) {
+    if (!netdev_present() || len > UDP_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    local_bh_disable();
+    int ret = udp_xmit(dst_ip, dst_port, src_port, data, len);
+    local_bh_enable();
+    return ret;
+}
+
+/* ---------------- UDP回显 ---------------- */
+
+/* 交换收到的帧的地址和端口, 原样发回 */
+static bool udp_echo(void *frame, ip_hdr_t *ip, udp_hdr_t *udp, uint8_t *data, size_t len) {
+    (void)data;
+    (void)len;
+    eth_hdr_t *eth = frame;
+
+    /* 带IP选项的报文不回显 (回复的头部固定20字节) */
+    size_t ulen = ntohs(udp->len);
+    if ((ip->ver_ihl & 0xf) * 4 != sizeof(ip_hdr_t)) {
+        return false;
+    }
+
+    memcpy(eth->dst, eth->src, ETH_ALEN);
+    memcpy(eth->src, netdev_mac(), ETH_ALEN);
+    ip_fill(ip, NET_IP_ADDR, ntohl(ip->src), ulen);
+
+    uint16_t port = udp->sport;
+    udp->sport = udp->dport;
+    udp->dport = port;
+    udp->csum = 0;
+
+    if (netdev_xmit(frame, ETH_HLEN + sizeof(ip_hdr_t) + ulen) < 0) {
+        return false;
+    }
+    stats.udp_echoed++;
+    return true;
+}
+
+void net_init(void) {
+    udp_bind(UDP_ECHO_PORT, udp_echo);
+    printk("  net: %u.%u.%u.%u, gateway %u.%u.%u.%u, UDP echo on port %d\n",
+           NET_IP_ADDR >> 24, (NET_IP_ADDR >> 16) & 0xff, (NET_IP_ADDR >> 8) & 0xff,
+           NET_IP_ADDR & 0xff, NET_GATEWAY >> 24, (NET_GATEWAY >> 16) & 0xff,
+           (NET_GATEWAY >> 8) & 0xff, NET_GATEWAY & 0xff, UDP_ECHO_PORT);
+}
+
+void net_get_stats(net_stats_t *out) {
+    *out = stats;
+}
+
+void net_show(void) {
+    if (!netdev_present()) {
+        printk("No network device (run with 'make run-net')\n");
+        return;
+    }
+
+    netdev_stats_t ns;
+    netdev_get_stats(&ns);
+    const uint8_t *m = netdev_mac();
+
+    printk("eth0: mac %02x:%02x:%02x:%02x:%02x:%02x  inet %u.%u.%u.%u\n",
+           m[0], m[1], m[2], m[3], m[4], m[5],
+           NET_IP_ADDR >> 24, (NET_IP_ADDR >> 16) & 0xff, (NET_IP_ADDR >> 8) & 0xff,
+           NET_IP_ADDR & 0xff);
+    printk("  RX: %llu packets, %llu bytes, %llu dropped\n",
+           ns.rx_packets, ns.rx_bytes, ns.rx_dropped);
+    printk("  TX: %llu packets, %llu bytes, %llu dropped\n",
+           ns.tx_packets, ns.tx_bytes, ns.tx_dropped);
+    printk("  %llu interrupts, %llu polls (%llu hit budget), pool %llu/%llu pages free\n",
+           ns.interrupts, ns.polls, ns.budget_exhausted, ns.pool_free, ns.pool_total);
+    printk("  ARP: %llu requests answered; UDP: %llu received, %llu echoed, %llu no port, %llu bad IP\n",
+           stats.arp_replies, stats.udp_rx, stats.udp_echoed, stats.udp_no_port, stats.ip_bad);
+
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (arp_cache[i].valid) {
+            const uint8_t *a = arp_cache[i].mac;
+            uint32_t ip = arp_cache[i].ip;
+            printk("  arp %u.%u.%u.%u -> %02x:%02x:%02x:%02x:%02x:%02x\n",
+                   ip >> 24, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff,
+                   a[0], a[1], a[2], a[3], a[4], a[5]);
+        }
+    }
+}
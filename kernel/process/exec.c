@@ -0,0 +1,393 @@
+/* ELF程序加载 - 按需映射的段、共享的只读页、用户态异常 */
+#include <kernel/exec.h>
+#include <kernel/elf.h>
+#include <kernel/uvm.h>
+#include <kernel/fs.h>
+#include <kernel/pipe.h>
+#include <kernel/string.h>
+#include <kernel/printk.h>
+#include <arch/riscv/riscv.h>
+
+#define ELF_MAX_PHDRS   16
+
+/* 缓存的程序映像数 (超出时淘汰最久没有使用、没有实例在运行的映像) */
+#define IMAGE_CACHE_MAX 8
+
+/*
+ * 程序映像: 一个可执行文件解析好的段 (作为建立区域的模板) 和只读段已读入的页.
+ * 持有文件的引用, 文件在映像释放前不能删除.
+ */
+typedef struct elf_image {
+    file_t *file;
+    uint64_t entry;
+    int nsegs;
+    vma_t segs[ELF_MAX_PHDRS];
+    int users;                  /* 正在运行的实例 */
+    uint64_t last_used;
+    struct elf_image *next;
+} elf_image_t;
+
+static elf_image_t *images;
+static int nr_images;
+
+static void image_free(elf_image_t *img) {
+    for (int i = 0; i < img->nsegs; i++) {
+        vma_t *seg = &img->segs[i];
+        if (!seg->shared) {
+            continue;
+        }
+        for (uint64_t j = 0; j < (seg->end - seg->start) >> PAGE_SHIFT; j++) {
+            if (seg->shared[j]) {
+                free_page(seg->shared[j]);
+            }
+        }
+        kfree(seg->shared);
+    }
+    fs_put(img->file);
+    kfree(img);
+}
+
+/* 缓存超过IMAGE_CACHE_MAX时淘汰没有实例的映像, 最久没用的先淘汰 */
+static void image_trim(void) {
+    while (nr_images > IMAGE_CACHE_MAX) {
+        elf_image_t **victim = NULL;
+        for (elf_image_t **pp = &images; *pp; pp = &(*pp)->next) {
+            if ((*pp)->users == 0 && (!victim || (*pp)->last_used < (*victim)->last_used)) {
+                victim = pp;
+            }
+        }
+        if (!victim) {
+            return;
+        }
+        elf_image_t *img = *victim;
+        *victim = img->next;
+        nr_images--;
+        image_free(img);
+    }
+}
+
+/* 检查程序头并把PT_LOAD段转换成区域模板 */
+static int image_parse(elf_image_t *img, const elf64_ehdr_t *eh, const elf64_phdr_t *ph) {
+    file_t *file = img->file;
+    bool entry_ok = false;
+
+    for (int i = 0; i < eh->e_phnum; i++) {
+        const elf64_phdr_t *p = &ph[i];
+        if (p->p_type != PT_LOAD || p->p_memsz == 0) {
+            continue;
+        }
+        if (p->p_filesz > p->p_memsz || p->p_offset > file->size ||
+            p->p_filesz > file->size - p->p_offset ||
+            p->p_vaddr < USER_BASE || p->p_vaddr > USER_STACK_TOP - USER_STACK_SIZE ||
+            p->p_memsz > USER_STACK_TOP - USER_STACK_SIZE - p->p_vaddr) {
+            printk(KERN_ERR "[EXEC] Bad segment %d: vaddr %llx memsz %llx\n",
+                   i, p->p_vaddr, p->p_memsz);
+            return -1;
+        }
+
+        vma_t *seg = &img->segs[img->nsegs++];
+        memset(seg, 0, sizeof(vma_t));
+        seg->start = PAGE_ALIGN_DOWN(p->p_vaddr);
+        seg->end = PAGE_ALIGN_UP(p->p_vaddr + p->p_memsz);
+        seg->prot = ((p->p_flags & PF_R) ? PTE_R : 0) | ((p->p_flags & PF_W) ? PTE_W : 0) |
+                    ((p->p_flags & PF_X) ? PTE_X : 0);
+        seg->file = file;
+        seg->file_va = p->p_vaddr;
+        seg->file_end = p->p_vaddr + p->p_filesz;
+        seg->file_off = p->p_offset;
+
+        /* 只读段的页在实例间共享, 可写段每个实例一份私有副本 */
+        if (!(seg->prot & PTE_W)) {
+            seg->shared = kzalloc(((seg->end - seg->start) >> PAGE_SHIFT) * sizeof(void *));
+            if (!seg->shared) {
+                return -1;
+            }
+        }
+
+        if ((seg->prot & PTE_X) && eh->e_entry >= p->p_vaddr &&
+            eh->e_entry < p->p_vaddr + p->p_memsz) {
+            entry_ok = true;
+        }
+    }
+
+    if (!entry_ok) {
+        printk(KERN_ERR "[EXEC] Entry point %llx is not in an executable segment\n", eh->e_entry);
+        return -1;
+    }
+    img->entry = eh->e_entry;
+    return 0;
+}
+
+/* 读出并检查文件头和程序头, 建立新映像 */
+static elf_image_t *image_load(file_t *file, const char *path) {
+    elf64_ehdr_t eh;
+    elf64_phdr_t ph[ELF_MAX_PHDRS];
+
+    if (fs_read_at(file, 0, &eh, sizeof(eh)) != sizeof(eh) ||
+        eh.e_magic != ELF_MAGIC || eh.e_class != ELFCLASS64 || eh.e_data != ELFDATA2LSB ||
+        eh.e_type != ET_EXEC || eh.e_machine != EM_RISCV) {
+        printk(KERN_ERR "[EXEC] %s: not a RISC-V ELF64 executable\n", path);
+        return NULL;
+    }
+    size_t phsize = (size_t)eh.e_phnum * sizeof(elf64_phdr_t);
+    if (eh.e_phentsize != sizeof(elf64_phdr_t) || eh.e_phnum == 0 ||
+        eh.e_phnum > ELF_MAX_PHDRS || fs_read_at(file, eh.e_phoff, ph, phsize) != phsize) {
+        printk(KERN_ERR "[EXEC] %s: bad program headers\n", path);
+        return NULL;
+    }
+
+    elf_image_t *img = kzalloc(sizeof(elf_image_t));
+    if (!img) {
+        return NULL;
+    }
+    img->file = file;
+    fs_get(file);
+
+    if (image_parse(img, &eh, ph) < 0) {
+        image_free(img);
+        return NULL;
+    }
+    return img;
+}
+
+/* 找到或加载file的映像, 增加实例计数 */
+static elf_image_t *image_get(file_t *file, const char *path) {
+    elf_image_t *img = images;
+    while (img && img->file != file) {
+        img = img->next;
+    }
+
+    if (!img) {
+        if (!(img = image_load(file, path))) {
+            return NULL;
+        }
+        img->next = images;
+        images = img;
+        nr_images++;
+    }
+    img->users++;
+    img->last_used = rdtime();
+    image_trim();
+    return img;
+}
+
+/*
+ * 实例退出. 内存中的文件可能被改写, 没有实例时立即丢弃映像;
+ * initramfs中的程序是只读的, 映像留在缓存中.
+ */
+static void image_put(elf_image_t *img) {
+    if (--img->users > 0) {
+        return;
+    }
+    if (img->file->readonly) {
+        image_trim();
+        return;
+    }
+    elf_image_t **pp = &images;
+    while (*pp != img) {
+        pp = &(*pp)->next;
+    }
+    *pp = img->next;
+    nr_images--;
+    image_free(img);
+}
+
+/*
+ * 在栈顶放参数字符串和argv数组 (以NULL结尾), 返回初始sp (16字节对齐).
+ * 参数放不进栈顶一页时返回0.
+ */
+static uint64_t setup_stack(mm_t *mm, int argc, char **argv) {
+    uint64_t uargv[EXEC_MAX_ARGS + 1];
+    uint64_t sp = USER_STACK_TOP;
+
+    for (int i = argc - 1; i >= 0; i--) {
+        size_t len = strlen(argv[i]) + 1;
+        sp -= len;
+        if (USER_STACK_TOP - sp > PAGE_SIZE / 2 || copy_to_user(mm, sp, argv[i], len) < 0) {
+            return 0;
+        }
+        uargv[i] = sp;
+    }
+    uargv[argc] = 0;
+
+    sp = (sp - (argc + 1) * sizeof(uint64_t)) & ~15UL;
+    if (copy_to_user(mm, sp, uargv, (argc + 1) * sizeof(uint64_t)) < 0) {
+        return 0;
+    }
+    mm->argc = argc;
+    mm->arg_start = sp;
+    return sp;
+}
+
+/* 用户进程的内核线程: 构造陷阱帧后"返回"到用户态的入口 */
+static void user_thread(void) {
+    mm_t *mm = current_process()->mm;
+    trapframe_t tf;
+
+    memset(&tf, 0, sizeof(tf));
+    tf.sepc = mm->entry;
+    tf.sp = mm->start_stack;
+    tf.a0 = mm->argc;
+    tf.a1 = mm->arg_start;
+    /* sret后进入U态并打开中断; sret之前中断必须关闭 */
+    tf.sstatus = (read_csr(sstatus) & ~(SSTATUS_SPP | SSTATUS_SIE)) | SSTATUS_SPIE;
+
+    local_irq_disable();
+    user_return(&tf);
+}
+
+static const char *basename(const char *path) {
+    const char *name = path;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' && p[1]) {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+process_t *exec(const char *path, int argc, char **argv) {
+    uint64_t start = rdcycle();
+
+    if (argc > EXEC_MAX_ARGS) {
+        printk(KERN_ERR "[EXEC] Too many arguments (max %d)\n", EXEC_MAX_ARGS);
+        return NULL;
+    }
+    file_t *file = fs_find(path);
+    if (!file || file->type != FILE_TYPE_REGULAR) {
+        printk(KERN_ERR "[EXEC] %s: no such program\n", path);
+        return NULL;
+    }
+
+    elf_image_t *img = image_get(file, path);
+    if (!img) {
+        return NULL;
+    }
+
+    mm_t *mm = mm_create();
+    if (!mm) {
+        image_put(img);
+        return NULL;
+    }
+    mm->exe = img;
+    mm->entry = img->entry;
+
+    /* 只建立区域, 不读入任何页 (参数所在的栈顶页除外) */
+    vma_t stack = {
+        .start = USER_STACK_TOP - USER_STACK_SIZE,
+        .end = USER_STACK_TOP,
+        .prot = PTE_R | PTE_W,
+    };
+    int err = mm_map(mm, &stack);
+    for (int i = 0; i < img->nsegs && !err; i++) {
+        err = mm_map(mm, &img->segs[i]);
+    }
+    if (err) {
+        printk(KERN_ERR "[EXEC] %s: overlapping segments\n", path);
+        goto fail;
+    }
+    if (!(mm->start_stack = setup_stack(mm, argc, argv))) {
+        printk(KERN_ERR "[EXEC] %s: arguments too long\n", path);
+        goto fail;
+    }
+
+    char name[PROC_NAME_LEN];
+    size_t len = strlen(basename(path));
+    if (len > PROC_NAME_LEN - 1) {
+        len = PROC_NAME_LEN - 1;
+    }
+    memcpy(name, basename(path), len);
+    name[len] = '\0';
+
+    process_t *proc = create_process(name, user_thread);
+    if (!proc) {
+        goto fail;
+    }
+    proc->mm = mm;
+
+    /* 继承创建者的标准输入输出 (shell管道), 各自持有一个引用 */
+    process_t *parent = current_process();
+    if (parent->pipe_in) {
+        pipe_dup(parent->pipe_in, PIPE_READ);
+        proc->pipe_in = parent->pipe_in;
+    }
+    if (parent->pipe_out) {
+        pipe_dup(parent->pipe_out, PIPE_WRITE);
+        proc->pipe_out = parent->pipe_out;
+    }
+
+    mm->load_cycles = rdcycle() - start;
+    return proc;
+
+fail:
+    mm_destroy(mm);
+    image_put(img);
+    return NULL;
+}
+
+void exec_exit_mm(void) {
+    process_t *proc = current_process();
+    mm_t *mm = proc->mm;
+
+    printk(KERN_INFO "[EXEC] %s (pid %d) exited with %d: loaded in %llu cycles, "
+           "%llu page faults in %llu us\n", proc->name, proc->pid, proc->exit_code,
+           mm->load_cycles, mm->faults, mm->fault_ticks / (TIMEBASE_FREQ / 1000000));
+    printk(KERN_INFO "  shared %llu (%llu already in memory), file %llu, anon %llu, "
+           "zero page %llu, copy-on-write %llu, swap-in %llu\n", mm->shared_pages,
+           mm->shared_hits, mm->file_pages, mm->anon_pages, mm->zero_pages, mm->cow_faults,
+           mm->swap_ins);
+
+    /* 先离开这个地址空间再释放它的页表 */
+    proc->mm = NULL;
+    mm_activate(NULL);
+    elf_image_t *img = mm->exe;
+    mm_destroy(mm);
+    image_put(img);
+}
+
+/* ---------------- 用户态异常 ---------------- */
+
+void user_exception(trapframe_t *tf) {
+    process_t *proc = current_process();
+    uint64_t access = 0;
+    const char *what = "exception";
+
+    switch (tf->scause) {
+        case CAUSE_USER_ECALL:
+            /* 返回到ecall的下一条指令; 系统调用可能睡眠, 打开中断 */
+            tf->sepc += 4;
+            local_irq_enable();
+            do_syscall(tf);
+            local_irq_disable();
+            return;
+        case CAUSE_INST_PAGE_FAULT:
+            access = PTE_X;
+            break;
+        case CAUSE_LOAD_PAGE_FAULT:
+            access = PTE_R;
+            break;
+        case CAUSE_STORE_PAGE_FAULT:
+            access = PTE_W;
+            break;
+        case CAUSE_ILLEGAL_INSTRUCTION:
+            what = "illegal instruction";
+            break;
+    }
+
+    if (access) {
+        /* 从文件读入页可能等待磁盘 */
+        local_irq_enable();
+        int ret = mm_fault(proc->mm, tf->stval, access);
+        local_irq_disable();
+        if (ret == 0) {
+            return;
+        }
+        what = "segmentation fault";
+    }
+
+    printk(KERN_ERR "[EXEC] %s (pid %d): %s at %llx (scause %llx, sepc %llx), killed\n",
+           proc->name, proc->pid, what, tf->stval, tf->scause, tf->sepc);
+    proc->exit_code = -1;
+    local_irq_enable();
+    process_exit();
+}
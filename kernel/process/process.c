@@ -2,6 +2,12 @@
 #include <kernel/mm.h>
 #include <kernel/string.h>
 #include <kernel/printk.h>
+#include <kernel/fs.h>
+#include <kernel/file.h>
+#include <kernel/pipe.h>
+#include <kernel/uvm.h>
+#include <kernel/exec.h>
+#include <kernel/rcu.h>
 
 /* 进程表 */
 static process_t proc_table[MAX_PROCESSES];
@@ -9,6 +15,8 @@ static process_t *current_proc = NULL;
 static process_t *ready_queue = NULL;
 static int next_pid = 1;
 
+uint64_t kstack_limit;
+
 /* 上下文切换 (在switch.S中实现) */
 extern void switch_context(context_t *old, context_t *new);
 
@@ -16,10 +24,10 @@ process_t *current_process(void) {
     return current_proc;
 }
 
-/* 添加进程到就绪队列 */
+/* 添加进程到就绪队列 (新进程的状态在这里发布, 之前process_find看不到它) */
 static void enqueue_ready(process_t *proc) {
     proc->next = NULL;
-    proc->state = PROC_READY;
+    __atomic_store_n(&proc->state, PROC_READY, __ATOMIC_RELEASE);
 
     if (!ready_queue) {
         ready_queue = proc;
@@ -44,51 +52,94 @@ static process_t *dequeue_ready(void) {
     return proc;
 }
 
-/* 创建进程 */
-process_t *create_process(const char *name, void (*entry)(void)) {
-    /* 查找空闲PCB */
-    process_t *proc = NULL;
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (proc_table[i].state == PROC_UNUSED) {
-            proc = &proc_table[i];
+/* 线程入口: 入口函数返回后自动退出 */
+static void kthread_start(void) {
+    kstack_limit = (uint64_t)current_proc->kstack;
+    current_proc->entry();
+    process_exit();
+}
+
+/*
+ * 回收已退出进程的PCB. process_find的读者可能还在看它,
+ * 所以记下宽限期, 到期前不重用.
+ */
+static void reap_zombie(process_t *proc) {
+    vfree(proc->kstack);
+    if (proc->cwd) {
+        fs_put(proc->cwd);
+    }
+    proc->rcu_gp = get_state_synchronize_rcu();
+    __atomic_store_n(&proc->state, PROC_UNUSED, __ATOMIC_RELEASE);
+}
+
+/* 查找可以重用的PCB; 只有还在宽限期中的时等一个宽限期再找 */
+static process_t *alloc_pcb(void) {
+    for (int pass = 0; pass < 2; pass++) {
+        bool waiting = false;
+        for (int i = 0; i < MAX_PROCESSES; i++) {
+            if (proc_table[i].state == PROC_ZOMBIE) {
+                reap_zombie(&proc_table[i]);
+            }
+            if (proc_table[i].state == PROC_UNUSED) {
+                if (poll_state_synchronize_rcu(proc_table[i].rcu_gp)) {
+                    return &proc_table[i];
+                }
+                waiting = true;
+            }
+        }
+        if (!waiting) {
             break;
         }
+        synchronize_rcu();
     }
+    return NULL;
+}
 
+/* 创建进程 */
+process_t *create_process(const char *name, void (*entry)(void)) {
+    process_t *proc = alloc_pcb();
     if (!proc) {
-        printk("[PROCESS] No free PCB\n");
+        printk(KERN_ERR "[PROCESS] No free PCB\n");
         return NULL;
     }
 
-    /* 初始化PCB */
+    /* 初始化PCB (状态保持UNUSED, 由enqueue_ready发布) */
     memset(proc, 0, sizeof(process_t));
     proc->pid = next_pid++;
-    proc->state = PROC_READY;
     proc->priority = 1;
+    proc->entry = entry;
     strcpy(proc->name, name);
 
     /* 分配内核栈 */
-    proc->kstack = alloc_page();
+    proc->kstack = vmalloc_tag(KSTACK_SIZE, PG_KSTACK);
     if (!proc->kstack) {
-        printk("[PROCESS] Failed to allocate kernel stack\n");
-        proc->state = PROC_UNUSED;
+        printk(KERN_ERR "[PROCESS] Failed to allocate kernel stack\n");
         return NULL;
     }
 
     /* 设置上下文 */
-    uint64_t sp = (uint64_t)proc->kstack + PAGE_SIZE;
-    proc->context.ra = (uint64_t)entry;  /* 返回地址设为入口函数 */
+    uint64_t sp = (uint64_t)proc->kstack + KSTACK_SIZE;
+    proc->context.ra = (uint64_t)kthread_start;  /* 首次切换时从这里开始执行 */
     proc->context.sp = sp;
 
+    /* 继承创建者的当前目录 */
+    if (current_proc && current_proc->cwd) {
+        proc->cwd = current_proc->cwd;
+        fs_get(proc->cwd);
+    }
+
     /* 加入就绪队列 */
     enqueue_ready(proc);
 
-    printk("  Created process: %s (PID %d)\n", name, proc->pid);
+    printk(KERN_DEBUG "  Created process: %s (PID %d)\n", name, proc->pid);
     return proc;
 }
 
 /* 调度器 - 时间片轮转 */
 void schedule(void) {
+    /* 调用schedule的地方都不在RCU读临界区中: 静止状态 */
+    rcu_qs();
+
     if (!ready_queue) {
         return;
     }
@@ -110,16 +161,135 @@ void schedule(void) {
     current_proc = next;
 
     if (prev && prev != next) {
+        /* 换栈期间关闭溢出检查, 切回来后换成当前进程的栈底 */
+        kstack_limit = 0;
+        if (prev->mm != next->mm) {
+            mm_activate(next->mm);
+        }
         switch_context(&prev->context, &next->context);
+        kstack_limit = (uint64_t)current_proc->kstack;
     }
 }
 
-/* 主动让出CPU */
+/* 主动让出CPU (当前进程保持RUNNING, 由schedule放回就绪队列) */
 void yield(void) {
-    if (current_proc) {
-        current_proc->state = PROC_READY;
+    schedule();
+}
+
+/* 退出当前进程, PCB和内核栈由create_process回收 */
+void process_exit(void) {
+    vfs_close_all();
+    if (current_proc->pipe_in) {
+        pipe_close(current_proc->pipe_in, PIPE_READ);
+        current_proc->pipe_in = NULL;
+    }
+    if (current_proc->pipe_out) {
+        pipe_close(current_proc->pipe_out, PIPE_WRITE);
+        current_proc->pipe_out = NULL;
     }
+    if (current_proc->mm) {
+        exec_exit_mm();
+    }
+    current_proc->state = PROC_ZOMBIE;
+    while (1) {
+        schedule();
+    }
+}
+
+void process_wait(process_t *proc, int pid) {
+    while (proc->pid == pid &&
+           proc->state != PROC_ZOMBIE && proc->state != PROC_UNUSED) {
+        yield();
+    }
+}
+
+process_t *process_find(int pid) {
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        process_t *proc = &proc_table[i];
+        if (__atomic_load_n(&proc->state, __ATOMIC_ACQUIRE) != PROC_UNUSED &&
+            proc->pid == pid) {
+            return proc;
+        }
+    }
+    return NULL;
+}
+
+int process_snapshot(proc_info_t *out, int max) {
+    int n = 0;
+    rcu_read_lock();
+    for (int i = 0; i < MAX_PROCESSES && n < max; i++) {
+        process_t *proc = &proc_table[i];
+        proc_state_t state = __atomic_load_n(&proc->state, __ATOMIC_ACQUIRE);
+        if (state == PROC_UNUSED) {
+            continue;
+        }
+        out[n].pid = proc->pid;
+        out[n].state = state;
+        out[n].user = proc->mm != NULL;
+        memcpy(out[n].name, proc->name, PROC_NAME_LEN);
+        out[n].name[PROC_NAME_LEN - 1] = '\0';
+        n++;
+    }
+    rcu_read_unlock();
+    return n;
+}
+
+/* ---------------- 等待队列 ---------------- */
+
+void wait_queue_init(wait_queue_t *wq) {
+    wq->head = wq->tail = NULL;
+}
+
+static void wait_queue_remove(wait_queue_t *wq, process_t *proc) {
+    process_t **pp = &wq->head;
+    process_t *prev = NULL;
+    while (*pp && *pp != proc) {
+        prev = *pp;
+        pp = &(*pp)->wait_next;
+    }
+    if (*pp) {
+        *pp = proc->wait_next;
+        if (wq->tail == proc) {
+            wq->tail = prev;
+        }
+        proc->wait_next = NULL;
+    }
+}
+
+/* 睡眠直到被wake_up唤醒 (只在进程上下文中调用, 中断处理程序不使用等待队列) */
+void sleep_on(wait_queue_t *wq) {
+    process_t *proc = current_proc;
+
+    proc->wait_next = NULL;
+    if (wq->tail) {
+        wq->tail->wait_next = proc;
+    } else {
+        wq->head = proc;
+    }
+    wq->tail = proc;
+    proc->state = PROC_SLEEPING;
+
     schedule();
+
+    /* 没有其他可运行的进程, schedule直接返回了: 撤销睡眠 */
+    if (proc->state == PROC_SLEEPING) {
+        wait_queue_remove(wq, proc);
+        proc->state = PROC_RUNNING;
+    }
+}
+
+void wake_up(wait_queue_t *wq) {
+    process_t *proc = wq->head;
+    wq->head = wq->tail = NULL;
+
+    while (proc) {
+        process_t *next = proc->wait_next;
+        proc->wait_next = NULL;
+        if (proc->state == PROC_SLEEPING) {
+            enqueue_ready(proc);
+        }
+        proc = next;
+    }
 }
 
 /* 示例进程函数 */
@@ -157,6 +327,14 @@ void process_init(void) {
         proc_table[i].state = PROC_UNUSED;
     }
 
+    /* 启动上下文(kernel_main/shell)作为0号进程, 使schedule可以从它切换出去 */
+    process_t *init = &proc_table[0];
+    init->pid = 0;
+    init->state = PROC_RUNNING;
+    init->priority = 1;
+    strcpy(init->name, "init");
+    current_proc = init;
+
     printk("  Process management initialized\n");
 
     /* 暂时不创建测试进程，让系统先启动到shell */
@@ -168,5 +346,5 @@ void process_init(void) {
     schedule();
     */
 
-    printk("  (Process scheduling disabled for now)\n");
+    printk("  (Cooperative scheduling: kernel threads run when the shell yields)\n");
 }
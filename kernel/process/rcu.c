@@ -0,0 +1,165 @@
+/* RCU - 宽限期检测和推迟的回调 */
+#include <kernel/rcu.h>
+#include <kernel/process.h>
+#include <kernel/printk.h>
+
+/*
+ * gp_seq为偶数时没有宽限期在进行, 奇数时正在进行; 开始和结束各加1.
+ * 宽限期开始时记下所有在线hart, 每个hart在schedule中 (不在读临界区时)
+ * 清掉自己那一位, 清掉最后一位的结束宽限期. 有回调在等或有人取了状态时
+ * 下一次schedule开始新的宽限期.
+ *
+ * 回调挂在调用call_rcu的hart的队列上, 按要等的宽限期序号排序 (取状态的顺序),
+ * 由这个hart在schedule中运行: 回调只做释放这样不睡眠的工作, 运行时调用者
+ * 不在读临界区, 也不在kmalloc等分配器中间 (中断下半部里则可能在).
+ *
+ * 目前只有启动hart运行内核, 在线位图只有它一位; 各hart的数据已经分开,
+ * 宽限期的开始和结束用原子操作, 多个hart同时调用schedule时也只有一个成功.
+ */
+#define RCU_BATCH   64          /* 每次schedule最多运行的回调数 */
+
+int rcu_nesting[MAX_HARTS];
+
+static uint64_t gp_seq;
+static uint64_t gp_start;
+static uint64_t qs_pending;     /* 本宽限期还没经过静止状态的hart */
+static uint64_t online_harts;
+static bool gp_requested;
+
+typedef struct {
+    rcu_head_t *head;
+    rcu_head_t **tail;
+} rcu_queue_t;
+
+static rcu_queue_t queues[MAX_HARTS];
+static rcu_stats_t stats;
+
+uint64_t get_state_synchronize_rcu(void) {
+    uint64_t seq = __atomic_load_n(&gp_seq, __ATOMIC_ACQUIRE);
+    gp_requested = true;
+    /* 空闲时等下一个宽限期; 进行中的可能早于调用者的修改开始, 再多等一个 */
+    return (seq + 3) & ~1ULL;
+}
+
+bool poll_state_synchronize_rcu(uint64_t state) {
+    return (int64_t)(__atomic_load_n(&gp_seq, __ATOMIC_ACQUIRE) - state) >= 0;
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head)) {
+    rcu_queue_t *q = &queues[cpu_id()];
+    head->func = func;
+    head->next = NULL;
+    head->gp = get_state_synchronize_rcu();
+
+    uint64_t flags = local_irq_save();
+    if (!q->head) {
+        q->tail = &q->head;
+    }
+    *q->tail = head;
+    q->tail = &head->next;
+    stats.queued++;
+    local_irq_restore(flags);
+}
+
+void synchronize_rcu(void) {
+    if (rcu_nesting[cpu_id()]) {
+        printk(KERN_ERR "[RCU] synchronize_rcu() inside a read-side critical section\n");
+        return;
+    }
+    uint64_t state = get_state_synchronize_rcu();
+    while (!poll_state_synchronize_rcu(state)) {
+        yield();
+    }
+}
+
+void rcu_barrier(void) {
+    rcu_queue_t *q = &queues[cpu_id()];
+    if (rcu_nesting[cpu_id()]) {
+        printk(KERN_ERR "[RCU] rcu_barrier() inside a read-side critical section\n");
+        return;
+    }
+    while (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+        yield();
+    }
+}
+
+static void gp_try_start(void) {
+    uint64_t seq = __atomic_load_n(&gp_seq, __ATOMIC_ACQUIRE);
+    if ((seq & 1) || !gp_requested) {
+        return;
+    }
+    if (!online_harts) {
+        online_harts = 1UL << cpu_id();
+    }
+    gp_requested = false;
+    qs_pending = online_harts;
+    gp_start = rdtime();
+    /* 发布之前记下要等的hart; 别的hart抢先开始了就算了 */
+    __atomic_compare_exchange_n(&gp_seq, &seq, seq + 1, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void gp_report_qs(void) {
+    uint64_t bit = 1UL << cpu_id();
+    if (!(__atomic_load_n(&gp_seq, __ATOMIC_ACQUIRE) & 1) ||
+        !(__atomic_load_n(&qs_pending, __ATOMIC_ACQUIRE) & bit)) {
+        return;
+    }
+    if (__atomic_and_fetch(&qs_pending, ~bit, __ATOMIC_ACQ_REL) == 0) {
+        uint64_t ticks = rdtime() - gp_start;
+        stats.gps++;
+        stats.gp_ticks += ticks;
+        if (ticks > stats.gp_max_ticks) {
+            stats.gp_max_ticks = ticks;
+        }
+        __atomic_fetch_add(&gp_seq, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void invoke_callbacks(void) {
+    rcu_queue_t *q = &queues[cpu_id()];
+
+    for (int n = 0; n < RCU_BATCH; n++) {
+        uint64_t flags = local_irq_save();
+        rcu_head_t *head = q->head;
+        if (!head || !poll_state_synchronize_rcu(head->gp)) {
+            local_irq_restore(flags);
+            break;
+        }
+        q->head = head->next;
+        local_irq_restore(flags);
+
+        head->func(head);
+        stats.invoked++;
+    }
+}
+
+void rcu_qs(void) {
+    if (rcu_nesting[cpu_id()]) {
+        stats.bad_qs++;
+        printk(KERN_ERR "[RCU] schedule() inside a read-side critical section\n");
+        return;
+    }
+    stats.qs++;
+    gp_try_start();
+    gp_report_qs();
+    invoke_callbacks();
+}
+
+void rcu_get_stats(rcu_stats_t *out) {
+    *out = stats;
+    out->gp_seq = gp_seq;
+}
+
+void rcu_show(void) {
+    uint64_t waiting = stats.queued - stats.invoked;
+    printk("RCU: grace period %llu (%s), %llu completed, avg %llu us, max %llu us\n",
+           gp_seq / 2, (gp_seq & 1) ? "in progress" : "idle", stats.gps,
+           stats.gps ? stats.gp_ticks / stats.gps / (TIMEBASE_FREQ / 1000000) : 0,
+           stats.gp_max_ticks / (TIMEBASE_FREQ / 1000000));
+    printk("  quiescent states: %llu, callbacks: %llu queued, %llu invoked, %llu waiting\n",
+           stats.qs, stats.queued, stats.invoked, waiting);
+    if (stats.bad_qs) {
+        printk("  schedule() inside read-side critical sections: %llu\n", stats.bad_qs);
+    }
+}
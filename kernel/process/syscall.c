@@ -0,0 +1,163 @@
+/* 系统调用 - 用户程序通过ecall进入, 参数在陷阱帧的a0-a5中 */
+#include <kernel/exec.h>
+#include <kernel/syscall.h>
+#include <kernel/uvm.h>
+#include <kernel/file.h>
+#include <kernel/pipe.h>
+#include <kernel/printk.h>
+
+/* 用户的文件描述符0-2是标准输入输出, 3起对应进程文件表的0起 */
+#define USER_FD_BASE 3
+
+/* 控制台输出时每次printk的字节数 (printk一次最多输出PRINTK_BUF_SIZE-1字节) */
+#define CONSOLE_CHUNK 256
+
+/*
+ * 用户缓冲区按页分段处理: fn对[p, p+n)操作, 返回处理的字节数或-1.
+ * 某段处理的字节数少于n (读到文件末尾等) 时停止.
+ */
+static int64_t user_buf_foreach(uint64_t ubuf, size_t len, uint64_t access,
+                                ssize_t (*fn)(int fd, void *p, size_t n), int fd) {
+    mm_t *mm = current_process()->mm;
+    int64_t done = 0;
+
+    while (len > 0) {
+        size_t n = PAGE_SIZE - (ubuf & (PAGE_SIZE - 1));
+        if (n > len) {
+            n = len;
+        }
+        void *p = user_page_ptr(mm, ubuf, n, access);
+        if (!p) {
+            return done ? done : -1;
+        }
+        /* fn可能睡眠 (管道、磁盘), 期间p所在的页不能被ksm换掉 */
+        mm->pinned++;
+        ssize_t ret = fn(fd, p, n);
+        mm->pinned--;
+        if (ret < 0) {
+            return done ? done : -1;
+        }
+        done += ret;
+        if ((size_t)ret < n) {
+            break;
+        }
+        ubuf += n;
+        len -= n;
+    }
+    return done;
+}
+
+static ssize_t stdin_read(int fd, void *p, size_t n) {
+    (void)fd;
+    pipe_t *pipe = current_process()->pipe_in;
+    return pipe ? pipe_read(pipe, p, n) : 0;
+}
+
+static ssize_t stdout_write(int fd, void *p, size_t n) {
+    (void)fd;
+    pipe_t *pipe = current_process()->pipe_out;
+    if (pipe) {
+        return pipe_write(pipe, p, n) < 0 ? -1 : (ssize_t)n;
+    }
+    for (size_t off = 0; off < n; off += CONSOLE_CHUNK) {
+        int chunk = n - off < CONSOLE_CHUNK ? n - off : CONSOLE_CHUNK;
+        printk("%.*s", chunk, (char *)p + off);
+    }
+    return n;
+}
+
+static ssize_t file_read(int fd, void *p, size_t n) {
+    return vfs_read(fd, p, n);
+}
+
+static ssize_t file_write(int fd, void *p, size_t n) {
+    return vfs_write(fd, p, n);
+}
+
+static int64_t sys_read(trapframe_t *tf) {
+    int fd = tf->a0;
+    if (fd == 0) {
+        return user_buf_foreach(tf->a1, tf->a2, PTE_W, stdin_read, fd);
+    }
+    if (fd < USER_FD_BASE) {
+        return -1;
+    }
+    return user_buf_foreach(tf->a1, tf->a2, PTE_W, file_read, fd - USER_FD_BASE);
+}
+
+static int64_t sys_write(trapframe_t *tf) {
+    int fd = tf->a0;
+    if (fd == 1 || fd == 2) {
+        return user_buf_foreach(tf->a1, tf->a2, PTE_R, stdout_write, fd);
+    }
+    if (fd < USER_FD_BASE) {
+        return -1;
+    }
+    return user_buf_foreach(tf->a1, tf->a2, PTE_R, file_write, fd - USER_FD_BASE);
+}
+
+static int64_t sys_openat(trapframe_t *tf) {
+    char path[MAX_PATH];
+    if (strncpy_from_user(current_process()->mm, path, tf->a1, sizeof(path)) < 0) {
+        return -1;
+    }
+    int fd = vfs_open(path, tf->a2);
+    return fd < 0 ? -1 : fd + USER_FD_BASE;
+}
+
+static int64_t sys_close(trapframe_t *tf) {
+    int fd = tf->a0;
+    if (fd < USER_FD_BASE) {
+        return fd >= 0 ? 0 : -1;
+    }
+    return vfs_close(fd - USER_FD_BASE);
+}
+
+static int64_t sys_lseek(trapframe_t *tf) {
+    int fd = tf->a0;
+    if (fd < USER_FD_BASE) {
+        return -1;
+    }
+    return vfs_lseek(fd - USER_FD_BASE, tf->a1, tf->a2);
+}
+
+static int64_t sys_exit(trapframe_t *tf) {
+    current_process()->exit_code = tf->a0;
+    process_exit();
+    return 0;
+}
+
+static int64_t sys_sched_yield(trapframe_t *tf) {
+    (void)tf;
+    yield();
+    return 0;
+}
+
+static int64_t sys_getpid(trapframe_t *tf) {
+    (void)tf;
+    return current_process()->pid;
+}
+
+static int64_t (*const syscalls[NR_SYSCALLS])(trapframe_t *tf) = {
+    [SYS_openat]      = sys_openat,
+    [SYS_close]       = sys_close,
+    [SYS_lseek]       = sys_lseek,
+    [SYS_read]        = sys_read,
+    [SYS_write]       = sys_write,
+    [SYS_exit]        = sys_exit,
+    [SYS_sched_yield] = sys_sched_yield,
+    [SYS_getpid]      = sys_getpid,
+};
+
+void do_syscall(trapframe_t *tf) {
+    uint64_t nr = tf->a7;
+
+    if (nr >= NR_SYSCALLS || !syscalls[nr]) {
+        process_t *proc = current_process();
+        printk(KERN_WARNING "[SYSCALL] %s (pid %d): unknown system call %llu\n",
+               proc->name, proc->pid, nr);
+        tf->a0 = -1;
+        return;
+    }
+    tf->a0 = syscalls[nr](tf);
+}
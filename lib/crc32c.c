@@ -0,0 +1,119 @@
+/* CRC32C校验和 - 查表 (slicing-by-8) 和Zbc无进位乘法两种实现 */
+#include <kernel/crc32c.h>
+
+/*
+ * 按位反射的形式计算 (数据的最低位先进入), 多项式也是反射的.
+ * 查表: table[0][b]是字节b的CRC; table[k][b]是字节b后面再跟k个0字节的CRC,
+ * 8字节与crc异或后分别查8张表再异或起来, 每8字节只有一次对crc的依赖.
+ * 8字节的读取要求对齐 (RISC-V上非对齐访问可能陷入), 开头和结尾的零头逐字节处理.
+ */
+#define CRC32C_POLY 0x82f63b78
+
+static uint32_t table[8][256];
+static bool table_ready;
+
+static void table_init(void) {
+    for (int b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+        }
+        table[0][b] = crc;
+    }
+    for (int b = 0; b < 256; b++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+        }
+    }
+    table_ready = true;
+}
+
+static inline uint32_t step_byte(uint32_t crc, uint8_t b) {
+    return table[0][(crc ^ b) & 0xff] ^ (crc >> 8);
+}
+
+uint32_t crc32c_byte(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    if (!table_ready) {
+        table_init();
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = step_byte(crc, *p++);
+    }
+    return ~crc;
+}
+
+uint32_t crc32c_sw(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    if (!table_ready) {
+        table_init();
+    }
+    crc = ~crc;
+
+    for (; len > 0 && ((uintptr_t)p & 7); len--) {
+        crc = step_byte(crc, *p++);
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v = *(const uint64_t *)p ^ crc;
+        crc = table[7][v & 0xff] ^ table[6][(v >> 8) & 0xff] ^
+              table[5][(v >> 16) & 0xff] ^ table[4][(v >> 24) & 0xff] ^
+              table[3][(v >> 32) & 0xff] ^ table[2][(v >> 40) & 0xff] ^
+              table[1][(v >> 48) & 0xff] ^ table[0][v >> 56];
+    }
+    while (len--) {
+        crc = step_byte(crc, *p++);
+    }
+    return ~crc;
+}
+
+#ifdef __riscv_zbc
+/*
+ * Barrett约简: 把64位的s (crc异或8字节数据) 约简成s*x^32 mod P.
+ * QT是x^96/P的商 (省略x^64那一位, 按位反射), 商的高半部分
+ * clmulh(s, QT) + s 乘回P后取低32位就是余数. 反射形式下高半部分对应
+ * clmul的低位 (再左移1位对齐), 乘P后的低32位对应clmulr结果的高32位.
+ */
+#define CRC32C_QT 0xa434f61c6f5389f8ULL
+
+static inline uint64_t clmul(uint64_t a, uint64_t b) {
+    uint64_t r;
+    asm("clmul %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+static inline uint64_t clmulr(uint64_t a, uint64_t b) {
+    uint64_t r;
+    asm("clmulr %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+uint32_t crc32c_clmul(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    if (!table_ready) {
+        table_init();
+    }
+    crc = ~crc;
+
+    for (; len > 0 && ((uintptr_t)p & 7); len--) {
+        crc = step_byte(crc, *p++);
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t s = *(const uint64_t *)p ^ crc;
+        uint64_t t = (clmul(s, CRC32C_QT) << 1) ^ s;
+        crc = clmulr(t, (uint64_t)CRC32C_POLY << 32) >> 32;
+    }
+    while (len--) {
+        crc = step_byte(crc, *p++);
+    }
+    return ~crc;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len) {
+#ifdef __riscv_zbc
+    return crc32c_clmul(crc, buf, len);
+#else
+    return crc32c_sw(crc, buf, len);
+#endif
+}
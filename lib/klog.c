@@ -0,0 +1,342 @@
+/* 内核日志缓冲区 - 无锁多写者环形缓冲区 */
+#include <kernel/klog.h>
+#include <kernel/printk.h>
+#include <kernel/string.h>
+#include <kernel/process.h>
+#include <kernel/pipe.h>
+#include <arch/riscv/riscv.h>
+
+/*
+ * 缓冲区按字节的逻辑位置(单调递增的64位数)寻址, 实际偏移为 pos % LOG_BUF_SIZE.
+ *
+ *   log_tail  <= 有效记录 <  log_head
+ *
+ * 写者用CAS预留[start, end), 记录不跨越缓冲区末尾: 末尾放不下时连同填充一起预留.
+ * 写入前先把log_tail推过将被覆盖的旧记录, 最后以release语义写入头部的pos字段完成提交.
+ * 读者看到 hdr->pos == 读位置 即表示记录已提交; 拷贝完成后再检查log_tail,
+ * 若已越过读位置说明读取期间被覆盖, 丢弃重读.
+ */
+
+#define LOG_ALIGN    8
+#define LOG_REC_PAD  0x01  /* 缓冲区末尾的填充记录 */
+
+typedef struct {
+    uint64_t pos;       /* 记录的逻辑位置, 提交时最后写入 */
+    uint64_t ts;        /* 时间戳 */
+    uint32_t len;       /* 记录总长度 (含头部, 8字节对齐) */
+    uint16_t text_len;
+    uint8_t level;
+    uint8_t flags;
+} log_hdr_t;
+
+#define LOG_HDR_SIZE sizeof(log_hdr_t)
+#define LOG_ALIGN_UP(x) (((x) + LOG_ALIGN - 1) & ~(uint64_t)(LOG_ALIGN - 1))
+
+static uint8_t log_buf[LOG_BUF_SIZE] __attribute__((aligned(LOG_ALIGN)));
+static uint64_t log_head;       /* 下一个预留位置 */
+static uint64_t log_tail;       /* 最老的有效记录 */
+
+/* 控制台输出状态 */
+static uint64_t console_pos;    /* 下一条待输出的记录 */
+static int console_busy;        /* 同一时间只允许一个drainer */
+static int console_loglevel = CONSOLE_LOGLEVEL_DEFAULT;
+static bool klog_async = false; /* klogd启动前printk同步输出 */
+static uint64_t dmesg_start;    /* dmesg -C 之后的起始位置 */
+
+/* 未输出的积压超过此值时写者自己同步输出, 避免覆盖尚未显示的消息 */
+#define LOG_FLUSH_WATERMARK (LOG_BUF_SIZE / 2)
+
+static inline log_hdr_t *log_hdr(uint64_t pos) {
+    return (log_hdr_t *)&log_buf[pos % LOG_BUF_SIZE];
+}
+
+/* pos处记录占用的字节数; 末尾不足一个头部的空间是隐式填充 */
+static uint64_t log_span(uint64_t pos) {
+    uint64_t room = LOG_BUF_SIZE - (pos % LOG_BUF_SIZE);
+    if (room < LOG_HDR_SIZE) {
+        return room;
+    }
+    return log_hdr(pos)->len;
+}
+
+/*
+ * 推进log_tail直到[tail, end)能容纳在缓冲区内.
+ * 被回收的记录总是早已提交的 (缓冲区远大于所有hart同时在写的记录总和),
+ * 因此其头部的len是可靠的; CAS失败说明其他写者已推进, 用新值重试.
+ */
+static void log_make_room(uint64_t end) {
+    uint64_t tail = __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+
+    while (end - tail > LOG_BUF_SIZE) {
+        uint64_t next = tail + log_span(tail);
+        if (__atomic_compare_exchange_n(&log_tail, &tail, next, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            tail = next;
+        }
+    }
+}
+
+void klog_store(int level, const char *text, size_t len) {
+    if (len > PRINTK_BUF_SIZE - 1) {
+        len = PRINTK_BUF_SIZE - 1;
+    }
+
+    uint64_t rec_len = LOG_ALIGN_UP(LOG_HDR_SIZE + len);
+    uint64_t start, pad, end;
+
+    /* 预留空间 */
+    uint64_t head = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    do {
+        start = head;
+        uint64_t room = LOG_BUF_SIZE - (start % LOG_BUF_SIZE);
+        pad = (room < rec_len) ? room : 0;
+        end = start + pad + rec_len;
+    } while (!__atomic_compare_exchange_n(&log_head, &head, end, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    log_make_room(end);
+
+    /* 末尾的填充 */
+    if (pad >= LOG_HDR_SIZE) {
+        log_hdr_t *ph = log_hdr(start);
+        ph->len = pad;
+        ph->text_len = 0;
+        ph->level = 0;
+        ph->flags = LOG_REC_PAD;
+        __atomic_store_n(&ph->pos, start, __ATOMIC_RELEASE);
+    }
+
+    /* 写入记录 */
+    uint64_t pos = start + pad;
+    log_hdr_t *hdr = log_hdr(pos);
+    hdr->ts = rdtime();
+    hdr->len = rec_len;
+    hdr->text_len = len;
+    hdr->level = level;
+    hdr->flags = 0;
+    memcpy(hdr + 1, text, len);
+
+    /* 提交 */
+    __atomic_store_n(&hdr->pos, pos, __ATOMIC_RELEASE);
+}
+
+bool klog_read(uint64_t *pos, klog_record_t *rec, bool *lost) {
+    *lost = false;
+
+    for (;;) {
+        uint64_t p = *pos;
+        uint64_t tail = __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+
+        if (p < tail) {
+            *pos = tail;
+            *lost = true;
+            continue;
+        }
+        if (p >= __atomic_load_n(&log_head, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+
+        uint64_t room = LOG_BUF_SIZE - (p % LOG_BUF_SIZE);
+        if (room < LOG_HDR_SIZE) {
+            *pos = p + room;
+            continue;
+        }
+
+        log_hdr_t *hdr = log_hdr(p);
+        if (__atomic_load_n(&hdr->pos, __ATOMIC_ACQUIRE) != p) {
+            return false;  /* 写者尚未提交 */
+        }
+
+        uint64_t span = hdr->len;
+        uint8_t flags = hdr->flags;
+        rec->ts = hdr->ts;
+        rec->level = hdr->level;
+        rec->len = hdr->text_len;
+        if (rec->len > PRINTK_BUF_SIZE - 1) {
+            rec->len = PRINTK_BUF_SIZE - 1;
+        }
+        memcpy(rec->text, hdr + 1, rec->len);
+        rec->text[rec->len] = '\0';
+
+        /* 拷贝期间是否被覆盖 */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) > p) {
+            continue;
+        }
+
+        *pos = p + span;
+        if (flags & LOG_REC_PAD) {
+            continue;
+        }
+        return true;
+    }
+}
+
+uint64_t klog_first(void) {
+    uint64_t tail = __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+    return (dmesg_start > tail) ? dmesg_start : tail;
+}
+
+void klog_console_flush(void) {
+    /* 已有其他drainer在输出, 由它负责 */
+    if (__atomic_exchange_n(&console_busy, 1, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    static klog_record_t rec;
+    bool lost;
+
+    console_plug();
+    while (klog_read(&console_pos, &rec, &lost)) {
+        if (lost) {
+            puts("** kernel log messages dropped **\n");
+        }
+        if (rec.level < console_loglevel) {
+            console_write(rec.text, rec.len);
+        }
+    }
+    console_unplug();
+
+    __atomic_store_n(&console_busy, 0, __ATOMIC_RELEASE);
+}
+
+void klog_set_console_level(int level) {
+    console_loglevel = level;
+}
+
+int klog_get_console_level(void) {
+    return console_loglevel;
+}
+
+/* ---------------- printk ---------------- */
+
+/* 每个hart一个格式化缓冲区, 格式化期间关中断防止中断处理程序重入 */
+static char printk_buf[MAX_HARTS][PRINTK_BUF_SIZE];
+
+void vprintk(const char *fmt, va_list ap) {
+    /*
+     * shell管道中的命令: 未指定级别的输出是命令的标准输出, 写入管道而不进入日志.
+     * 指定了级别的消息 (错误等) 和中断上下文中的输出照常进入日志.
+     */
+    process_t *proc = current_process();
+    if (proc && proc->pipe_out && fmt[0] != KERN_SOH[0] &&
+        (read_csr(sstatus) & SSTATUS_SIE)) {
+        char out[PRINTK_BUF_SIZE];
+        int n = vsnprintf(out, sizeof(out), fmt, ap);
+        if (n >= PRINTK_BUF_SIZE) {
+            n = PRINTK_BUF_SIZE - 1;
+        }
+        pipe_write(proc->pipe_out, out, n);
+        return;
+    }
+
+    uint64_t irq = local_irq_save();
+    char *buf = printk_buf[cpu_id() % MAX_HARTS];
+
+    int len = vsnprintf(buf, PRINTK_BUF_SIZE, fmt, ap);
+    if (len >= PRINTK_BUF_SIZE) {
+        len = PRINTK_BUF_SIZE - 1;
+    }
+
+    /* 解析级别前缀 */
+    int level = LOGLEVEL_DEFAULT;
+    const char *text = buf;
+    if (len >= 2 && buf[0] == KERN_SOH[0] && buf[1] >= '0' && buf[1] <= '7') {
+        level = buf[1] - '0';
+        text += 2;
+        len -= 2;
+    }
+
+    klog_store(level, text, len);
+    local_irq_restore(irq);
+
+    /* 错误级别的消息和积压过多时立即输出 */
+    uint64_t backlog = __atomic_load_n(&log_head, __ATOMIC_RELAXED) - console_pos;
+    if (!klog_async || level <= LOGLEVEL_ERR || backlog > LOG_FLUSH_WATERMARK) {
+        klog_console_flush();
+    }
+}
+
+void printk(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintk(fmt, ap);
+    va_end(ap);
+}
+
+/* ---------------- klogd ---------------- */
+
+static void klogd(void) {
+    while (1) {
+        klog_console_flush();
+        yield();
+    }
+}
+
+void klogd_start(void) {
+    if (create_process("klogd", klogd)) {
+        klog_async = true;
+    }
+}
+
+/* ---------------- dmesg ---------------- */
+
+static const char *level_names[] = {
+    "emerg", "alert", "crit", "err", "warn", "notice", "info", "debug"
+};
+
+void klog_dump(int max_level) {
+    static klog_record_t rec;
+    char prefix[40];
+    bool lost;
+    bool line_start = true;
+
+    /* 先输出控制台积压, 保证顺序 */
+    klog_console_flush();
+
+    /* dmesg的输出直接写控制台, 不再进入日志缓冲区 */
+    uint64_t pos = klog_first();
+    uint64_t end = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+
+    console_plug();
+    while (pos < end && klog_read(&pos, &rec, &lost)) {
+        if (lost) {
+            puts("** kernel log messages dropped **\n");
+            line_start = true;
+        }
+        if (rec.level > max_level) {
+            continue;
+        }
+
+        const char *p = rec.text;
+        const char *stop = rec.text + rec.len;
+        while (p < stop) {
+            if (line_start) {
+                uint64_t us = rec.ts / (TIMEBASE_FREQ / 1000000);
+                int n = snprintf(prefix, sizeof(prefix), "[%5llu.%06llu] <%s> ",
+                                 us / 1000000, us % 1000000, level_names[rec.level & 7]);
+                console_write(prefix, n);
+            }
+
+            const char *nl = p;
+            while (nl < stop && *nl != '\n') {
+                nl++;
+            }
+            if (nl < stop) {
+                nl++;
+            }
+            console_write(p, nl - p);
+            line_start = (nl[-1] == '\n');
+            p = nl;
+        }
+    }
+
+    if (!line_start) {
+        puts("\n");
+    }
+    console_unplug();
+}
+
+void klog_clear(void) {
+    dmesg_start = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+}
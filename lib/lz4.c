@@ -0,0 +1,207 @@
+/* LZ4块格式压缩/解压 */
+#include <kernel/lz4.h>
+#include <kernel/string.h>
+
+/*
+ * 压缩数据是一串序列, 每个序列:
+ *   token           高4位字面量长度, 低4位匹配长度-4 (为15时后面跟扩展字节)
+ *   [扩展字节...]    每个255累加, 遇到小于255的字节结束
+ *   字面量
+ *   offset          2字节小端, 匹配位置在当前输出之前offset字节
+ *   [扩展字节...]    匹配长度的扩展
+ * 最后一个序列只有字面量. 格式要求最后5个字节总是字面量,
+ * 并且最后一个匹配在结尾12字节之前开始, 解码器可以据此做越界优化.
+ */
+
+#define MINMATCH      4
+#define LASTLITERALS  5
+#define MFLIMIT       12
+#define MAX_OFFSET    65535
+#define RUN_MASK      15
+
+#define HASH_BITS     12
+
+/* 按字节读取, 不依赖非对齐访问 (RISC-V上非对齐访问可能陷入) */
+static inline uint32_t read32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/* 输出长度的扩展字节 */
+static uint8_t *put_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+/*
+ * 哈希表记录每个4字节序列最后出现的位置 (相对src).
+ * 不在每次调用时清空: 旧的条目可能指向无关的数据, 但每次使用前都会检查
+ * 位置在当前位置之前并且4个字节确实相同, 所以只影响压缩率, 不影响正确性.
+ */
+static uint32_t hash_table[1 << HASH_BITS];
+
+size_t lz4_compress(const void *src, size_t len, void *dst, size_t cap) {
+    const uint8_t *in = src;
+    const uint8_t *ip = in;
+    const uint8_t *anchor = in;         /* 尚未输出的字面量起点 */
+    const uint8_t *end = in + len;
+    uint8_t *op = dst;
+    uint8_t *oend = op + cap;
+
+    if (len >= MFLIMIT + 1) {
+        const uint8_t *mflimit = end - MFLIMIT;
+        const uint8_t *matchlimit = end - LASTLITERALS;
+
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash4(seq);
+            const uint8_t *ref = in + hash_table[h];
+            hash_table[h] = ip - in;
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            /* 向前扩展匹配 */
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            const uint8_t *mp = ip + MINMATCH;
+            const uint8_t *rp = ref + MINMATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            size_t lit = ip - anchor;
+            size_t mlen = mp - ip - MINMATCH;
+            if (op + 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1 > oend) {
+                return 0;
+            }
+
+            uint8_t *token = op++;
+            if (lit >= RUN_MASK) {
+                *token = RUN_MASK << 4;
+                op = put_length(op, lit - RUN_MASK);
+            } else {
+                *token = lit << 4;
+            }
+            memcpy(op, anchor, lit);
+            op += lit;
+
+            uint32_t offset = ip - ref;
+            *op++ = offset;
+            *op++ = offset >> 8;
+
+            if (mlen >= RUN_MASK) {
+                *token |= RUN_MASK;
+                op = put_length(op, mlen - RUN_MASK);
+            } else {
+                *token |= mlen;
+            }
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    /* 最后的字面量 */
+    size_t lit = end - anchor;
+    if (op + 1 + lit / 255 + 1 + lit > oend) {
+        return 0;
+    }
+    if (lit >= RUN_MASK) {
+        *op++ = RUN_MASK << 4;
+        op = put_length(op, lit - RUN_MASK);
+    } else {
+        *op++ = lit << 4;
+    }
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    return op - (uint8_t *)dst;
+}
+
+/* 读取长度扩展字节, 输入结束前没有终止字节时返回false */
+static bool get_length(const uint8_t **ipp, const uint8_t *iend, size_t *len) {
+    const uint8_t *ip = *ipp;
+    uint8_t b;
+    do {
+        if (ip >= iend) {
+            return false;
+        }
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+    *ipp = ip;
+    return true;
+}
+
+ssize_t lz4_decompress(const void *src, size_t len, void *dst, size_t cap) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = ip + len;
+    uint8_t *out = dst;
+    uint8_t *op = out;
+    uint8_t *oend = out + cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == RUN_MASK && !get_length(&ip, iend, &lit)) {
+            return -1;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        /* 最后一个序列没有匹配部分 */
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out)) {
+            return -1;
+        }
+
+        size_t mlen = token & RUN_MASK;
+        if (mlen == RUN_MASK && !get_length(&ip, iend, &mlen)) {
+            return -1;
+        }
+        mlen += MINMATCH;
+        if (mlen > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        /* 匹配可以和输出重叠 (offset < mlen时重复最近的字节) */
+        const uint8_t *match = op - offset;
+        if (offset >= mlen) {
+            memcpy(op, match, mlen);
+            op += mlen;
+        } else {
+            while (mlen--) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op - out;
+}
@@ -1,100 +1,317 @@
 #include <kernel/printk.h>
 #include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/virtio.h>
 
 /* UART 基地址 (QEMU RISC-V virt) */
 #define UART_BASE 0x10000000UL
 
 /* UART 寄存器 */
 #define UART_THR (*(volatile uint8_t *)(UART_BASE + 0)) /* 发送保持寄存器 */
+#define UART_RHR (*(volatile uint8_t *)(UART_BASE + 0)) /* 接收保持寄存器 */
+#define UART_FCR (*(volatile uint8_t *)(UART_BASE + 2)) /* FIFO控制寄存器 */
 #define UART_LSR (*(volatile uint8_t *)(UART_BASE + 5)) /* 线路状态寄存器 */
 
+#define UART_LSR_DR    0x01  /* 接收数据就绪 */
+#define UART_LSR_THRE  0x20  /* 发送FIFO为空 */
+#define UART_FIFO_SIZE 16
+
+/* 发送FIFO中剩余的空位: THRE置位时整个FIFO可用, 未启用FIFO时只有1个 */
+static int tx_fifo_size = 1;
+static int tx_room = 0;
+
+static inline void uart_tx(char c) {
+    if (tx_room == 0) {
+        while ((UART_LSR & UART_LSR_THRE) == 0);
+        tx_room = tx_fifo_size;
+    }
+    UART_THR = c;
+    tx_room--;
+}
+
+/* 启用16550的FIFO, 之后每次轮询LSR可以连续写入16个字节 */
+void console_init(void) {
+    UART_FCR = 0x07;  /* 启用FIFO并清空收发队列 */
+    tx_fifo_size = UART_FIFO_SIZE;
+    tx_room = 0;
+}
+
+/*
+ * 探测到virtio-console后控制台的输入输出都改走它 (virtio_console.c),
+ * 否则使用UART.
+ */
+void console_write(const char *s, size_t len) {
+    if (vcon_present()) {
+        vcon_write(s, len);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\n') {
+            uart_tx('\r');
+        }
+        uart_tx(s[i]);
+    }
+}
+
+/* 单字符输出: 每个字节都轮询一次LSR (交互回显等零散输出使用) */
 void putchar(char c) {
-    /* 等待UART就绪 */
-    while ((UART_LSR & 0x20) == 0);
+    if (vcon_present()) {
+        vcon_write(&c, 1);
+        return;
+    }
+    while ((UART_LSR & UART_LSR_THRE) == 0);
     UART_THR = c;
+    tx_room = tx_fifo_size - 1;
 }
 
 void puts(const char *s) {
-    while (*s) {
-        if (*s == '\n') {
-            putchar('\r');
+    console_write(s, strlen(s));
+}
+
+/* 读取一个输入字符, 没有输入时返回-1 */
+int console_getc(void) {
+    if (vcon_present()) {
+        int c = vcon_getc();
+        if (c >= 0) {
+            return c;
         }
-        putchar(*s++);
     }
+    if (UART_LSR & UART_LSR_DR) {
+        return UART_RHR;
+    }
+    return -1;
 }
 
-/* 简单的整数转字符串 */
-static void print_num(uint64_t num, int base, int sign) {
-    char buf[32];
-    int i = 0;
-    int is_neg = 0;
+/* 大段输出前后调用: virtio-console把期间的输出攒成整页发送, UART不受影响 */
+void console_plug(void) {
+    if (vcon_present()) {
+        vcon_plug();
+    }
+}
 
-    if (sign && (int64_t)num < 0) {
-        is_neg = 1;
-        num = -(int64_t)num;
+void console_unplug(void) {
+    if (vcon_present()) {
+        vcon_unplug();
     }
+}
 
-    if (num == 0) {
-        putchar('0');
-        return;
+/* ---------------- vsnprintf ---------------- */
+
+/* 格式标志 */
+#define FMT_LEFT  0x01  /* '-' 左对齐 */
+#define FMT_ZERO  0x02  /* '0' 用0填充 */
+#define FMT_ALT   0x04  /* '#' 十六进制加0x前缀 */
+
+/* 输出游标: 超出缓冲区的部分只计数不写入 */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t pos;
+} fmt_out_t;
+
+static inline void out_char(fmt_out_t *out, char c) {
+    if (out->pos + 1 < out->size) {
+        out->buf[out->pos] = c;
     }
+    out->pos++;
+}
 
-    while (num > 0) {
-        int digit = num % base;
-        buf[i++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
-        num /= base;
+static void out_pad(fmt_out_t *out, char c, int n) {
+    while (n-- > 0) {
+        out_char(out, c);
+    }
+}
+
+static void out_str(fmt_out_t *out, const char *s, int width, int prec, int flags) {
+    if (!s) {
+        s = "(null)";
+    }
+
+    int len = 0;
+    while (s[len] && (prec < 0 || len < prec)) {
+        len++;
+    }
+
+    if (!(flags & FMT_LEFT)) {
+        out_pad(out, ' ', width - len);
     }
+    for (int i = 0; i < len; i++) {
+        out_char(out, s[i]);
+    }
+    if (flags & FMT_LEFT) {
+        out_pad(out, ' ', width - len);
+    }
+}
 
-    if (is_neg) {
-        putchar('-');
+static void out_num(fmt_out_t *out, uint64_t num, int base, bool upper,
+                    bool negative, int width, int flags) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    int n = 0;
+
+    do {
+        tmp[n++] = digits[num % base];
+        num /= base;
+    } while (num > 0);
+
+    const char *prefix = "";
+    if (negative) {
+        prefix = "-";
+    } else if ((flags & FMT_ALT) && base == 16) {
+        prefix = upper ? "0X" : "0x";
     }
+    int prefix_len = strlen(prefix);
+    int pad = width - n - prefix_len;
 
-    while (i > 0) {
-        putchar(buf[--i]);
+    if (!(flags & FMT_LEFT) && !(flags & FMT_ZERO)) {
+        out_pad(out, ' ', pad);
+    }
+    while (*prefix) {
+        out_char(out, *prefix++);
+    }
+    if (!(flags & FMT_LEFT) && (flags & FMT_ZERO)) {
+        out_pad(out, '0', pad);
+    }
+    while (n > 0) {
+        out_char(out, tmp[--n]);
+    }
+    if (flags & FMT_LEFT) {
+        out_pad(out, ' ', pad);
     }
 }
 
-void printk(const char *fmt, ...) {
-    uint64_t *args = (uint64_t *)&fmt + 1;
-    int arg_idx = 0;
+/*
+ * 支持: %d %i %u %x %X %p %s %c %%
+ * 标志: - 0 #, 宽度 (数字或*), 字符串精度 (.N 或 .*),
+ * 长度修饰: l ll z
+ */
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    fmt_out_t out = { buf, size, 0 };
 
     while (*fmt) {
-        if (*fmt == '%') {
-            fmt++;
-            switch (*fmt) {
-                case 'd':
-                    print_num(args[arg_idx++], 10, 1);
-                    break;
-                case 'u':
-                    print_num(args[arg_idx++], 10, 0);
-                    break;
-                case 'x':
-                    print_num(args[arg_idx++], 16, 0);
-                    break;
-                case 'p':
-                    puts("0x");
-                    print_num(args[arg_idx++], 16, 0);
-                    break;
-                case 's':
-                    puts((const char *)args[arg_idx++]);
-                    break;
-                case 'c':
-                    putchar((char)args[arg_idx++]);
-                    break;
-                case '%':
-                    putchar('%');
-                    break;
-                default:
-                    putchar('%');
-                    putchar(*fmt);
-                    break;
+        if (*fmt != '%') {
+            out_char(&out, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        /* 标志 */
+        int flags = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                flags |= FMT_LEFT;
+            } else if (*fmt == '0') {
+                flags |= FMT_ZERO;
+            } else if (*fmt == '#') {
+                flags |= FMT_ALT;
+            } else {
+                break;
             }
+        }
+
+        /* 宽度 */
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(ap, int);
+            if (width < 0) {
+                flags |= FMT_LEFT;
+                width = -width;
+            }
+            fmt++;
         } else {
-            if (*fmt == '\n') {
-                putchar('\r');
+            while (*fmt >= '0' && *fmt <= '9') {
+                width = width * 10 + (*fmt++ - '0');
             }
-            putchar(*fmt);
+        }
+
+        /* 精度 (仅用于%s) */
+        int prec = -1;
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            if (*fmt == '*') {
+                prec = va_arg(ap, int);
+                fmt++;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9') {
+                    prec = prec * 10 + (*fmt++ - '0');
+                }
+            }
+        }
+
+        /* 长度修饰 */
+        int lng = 0;
+        while (*fmt == 'l') {
+            lng++;
+            fmt++;
+        }
+        if (*fmt == 'z') {
+            lng = 2;
+            fmt++;
+        }
+
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                int64_t v = (lng == 0) ? va_arg(ap, int)
+                          : (lng == 1) ? va_arg(ap, long)
+                          : va_arg(ap, long long);
+                bool neg = v < 0;
+                out_num(&out, neg ? -(uint64_t)v : (uint64_t)v, 10, false,
+                        neg, width, flags);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint64_t v = (lng == 0) ? va_arg(ap, unsigned int)
+                           : (lng == 1) ? va_arg(ap, unsigned long)
+                           : va_arg(ap, unsigned long long);
+                int base = (*fmt == 'u') ? 10 : 16;
+                out_num(&out, v, base, *fmt == 'X', false, width, flags);
+                break;
+            }
+            case 'p':
+                out_num(&out, (uintptr_t)va_arg(ap, void *), 16, false, false,
+                        width, flags | FMT_ALT);
+                break;
+            case 's':
+                out_str(&out, va_arg(ap, const char *), width, prec, flags);
+                break;
+            case 'c':
+                if (!(flags & FMT_LEFT)) {
+                    out_pad(&out, ' ', width - 1);
+                }
+                out_char(&out, (char)va_arg(ap, int));
+                if (flags & FMT_LEFT) {
+                    out_pad(&out, ' ', width - 1);
+                }
+                break;
+            case '%':
+                out_char(&out, '%');
+                break;
+            case '\0':
+                /* 格式串以单独的'%'结尾 */
+                out_char(&out, '%');
+                continue;
+            default:
+                out_char(&out, '%');
+                out_char(&out, *fmt);
+                break;
         }
         fmt++;
     }
+
+    if (size > 0) {
+        buf[(out.pos < size) ? out.pos : size - 1] = '\0';
+    }
+    return (int)out.pos;
+}
+
+int snprintf(char *buf, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return len;
 }
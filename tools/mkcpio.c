@@ -0,0 +1,138 @@
+/*
+ * mkcpio - 把主机上的目录打包成cpio newc归档 (内核的initramfs)
+ *
+ *   mkcpio dir archive
+ *
+ * 目录按名字排序遍历, 目录项在其内容之前; 时间戳和属主固定为0,
+ * 同样的目录内容总是得到同样的归档. 只打包普通文件和目录.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define CPIO_MAGIC   "070701"
+#define CPIO_TRAILER "TRAILER!!!"
+
+static FILE *out;
+static long offset;             /* 已写入的字节数, 用于4字节对齐 */
+static unsigned int next_ino = 1;
+
+static void emit(const void *data, size_t len) {
+    if (len && fwrite(data, 1, len, out) != len) {
+        perror("mkcpio: write");
+        exit(1);
+    }
+    offset += len;
+}
+
+static void pad4(void) {
+    static const char zero[4];
+    emit(zero, (4 - offset % 4) % 4);
+}
+
+/* newc头部: 6字节magic + 13个8位十六进制字段 */
+static void emit_header(const char *name, unsigned int mode, unsigned int nlink,
+                        unsigned int size) {
+    char hdr[128];
+    snprintf(hdr, sizeof(hdr),
+             "%s%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X",
+             CPIO_MAGIC, next_ino++, mode, 0, 0, nlink, 0, size,
+             0, 0, 0, 0, (unsigned int)strlen(name) + 1, 0);
+    emit(hdr, 110);
+    emit(name, strlen(name) + 1);
+    pad4();
+}
+
+static void emit_file(const char *path, const char *name, const struct stat *st) {
+    if (st->st_size > 0xFFFFFFFFL) {
+        fprintf(stderr, "mkcpio: %s is too large for newc (4GB max)\n", path);
+        exit(1);
+    }
+
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        exit(1);
+    }
+
+    emit_header(name, S_IFREG | (st->st_mode & 0777), 1, st->st_size);
+    char buf[65536];
+    size_t n;
+    long total = 0;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        emit(buf, n);
+        total += n;
+    }
+    fclose(in);
+    if (total != st->st_size) {
+        fprintf(stderr, "mkcpio: %s changed while reading\n", path);
+        exit(1);
+    }
+    pad4();
+}
+
+static int name_cmp(const struct dirent **a, const struct dirent **b) {
+    return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+/* prefix为归档中的相对路径 (根目录为空串) */
+static void walk(const char *dir, const char *prefix) {
+    struct dirent **list;
+    int n = scandir(dir, &list, NULL, name_cmp);
+    if (n < 0) {
+        perror(dir);
+        exit(1);
+    }
+
+    for (int i = 0; i < n; i++) {
+        const char *entry = list[i]->d_name;
+        if (strcmp(entry, ".") == 0 || strcmp(entry, "..") == 0) {
+            free(list[i]);
+            continue;
+        }
+
+        char path[4096], name[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry);
+        snprintf(name, sizeof(name), "%s%s%s", prefix, *prefix ? "/" : "", entry);
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            perror(path);
+            exit(1);
+        }
+        if (S_ISDIR(st.st_mode)) {
+            emit_header(name, S_IFDIR | (st.st_mode & 0777), 2, 0);
+            walk(path, name);
+        } else if (S_ISREG(st.st_mode)) {
+            emit_file(path, name, &st);
+        } else {
+            fprintf(stderr, "mkcpio: skipping %s (not a regular file)\n", path);
+        }
+        free(list[i]);
+    }
+    free(list);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: mkcpio dir archive\n");
+        return 1;
+    }
+
+    out = fopen(argv[2], "wb");
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    walk(argv[1], "");
+    emit_header(CPIO_TRAILER, 0, 1, 0);
+
+    if (fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * mkfs - 在主机上创建nosfs磁盘镜像
+ *
+ *   mkfs [-s size_mb] [-i inodes] [-j journal_blocks] [-n files] image
+ *
+ * -n N 在/files目录下预先创建N个小文件, 用于测试大目录的挂载和查找.
+ * 镜像文件不存在时按-s创建 (默认64MB); 已存在且未指定-s时保持原大小.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <kernel/nosfs.h>
+
+#define BS NOSFS_BLOCK_SIZE
+
+static uint8_t *image;
+static nosfs_super_t *sb;
+static uint64_t next_block;     /* 数据区顺序分配 */
+static uint32_t next_inode = NOSFS_ROOT_INO;
+
+static uint8_t *block(uint64_t n) {
+    return image + n * BS;
+}
+
+static void set_bit(uint64_t start, uint64_t n) {
+    block(start + n / NOSFS_BITS_PER_BLOCK)[(n % NOSFS_BITS_PER_BLOCK) / 8] |= 1 << (n % 8);
+}
+
+static uint32_t alloc_block(void) {
+    if (next_block >= sb->nr_blocks) {
+        fprintf(stderr, "mkfs: image full\n");
+        exit(1);
+    }
+    set_bit(sb->block_bitmap_start, next_block);
+    return next_block++;
+}
+
+static nosfs_inode_t *inode(uint32_t ino) {
+    return (nosfs_inode_t *)(block(sb->inode_table_start + ino / NOSFS_INODES_PER_BLOCK) +
+                             (ino % NOSFS_INODES_PER_BLOCK) * NOSFS_INODE_SIZE);
+}
+
+static uint32_t alloc_inode(uint16_t type, uint32_t parent) {
+    if (next_inode >= sb->nr_inodes) {
+        fprintf(stderr, "mkfs: out of inodes\n");
+        exit(1);
+    }
+    uint32_t ino = next_inode++;
+    set_bit(sb->inode_bitmap_start, ino);
+    nosfs_inode_t *ip = inode(ino);
+    memset(ip, 0, sizeof(*ip));
+    ip->type = type;
+    ip->nlink = 1;
+    ip->parent = parent;
+    return ino;
+}
+
+/* 文件第bn块, 需要时分配 (与内核的bmap布局一致) */
+static uint32_t bmap(nosfs_inode_t *ip, uint64_t bn) {
+    if (bn < NOSFS_NDIRECT) {
+        if (!ip->direct[bn]) {
+            ip->direct[bn] = alloc_block();
+        }
+        return ip->direct[bn];
+    }
+    bn -= NOSFS_NDIRECT;
+
+    uint32_t *ind;
+    if (bn < NOSFS_NINDIRECT) {
+        if (!ip->indirect) {
+            ip->indirect = alloc_block();
+        }
+        ind = (uint32_t *)block(ip->indirect);
+    } else {
+        bn -= NOSFS_NINDIRECT;
+        if (bn >= (uint64_t)NOSFS_NINDIRECT * NOSFS_NINDIRECT) {
+            fprintf(stderr, "mkfs: file too large\n");
+            exit(1);
+        }
+        if (!ip->dindirect) {
+            ip->dindirect = alloc_block();
+        }
+        uint32_t *dind = (uint32_t *)block(ip->dindirect);
+        if (!dind[bn / NOSFS_NINDIRECT]) {
+            dind[bn / NOSFS_NINDIRECT] = alloc_block();
+        }
+        ind = (uint32_t *)block(dind[bn / NOSFS_NINDIRECT]);
+        bn %= NOSFS_NINDIRECT;
+    }
+    if (!ind[bn]) {
+        ind[bn] = alloc_block();
+    }
+    return ind[bn];
+}
+
+static void dir_add(uint32_t dir, const char *name, uint32_t ino, uint8_t type) {
+    nosfs_inode_t *dp = inode(dir);
+    uint64_t nslots = dp->size / BS * NOSFS_DIRENTS_PER_BLOCK;
+    nosfs_dirent_t *de = NULL;
+
+    /* mkfs只追加不删除, 空位只可能在最后一块 */
+    uint64_t slot = (nslots > 0) ? nslots - NOSFS_DIRENTS_PER_BLOCK : 0;
+    for (; slot < nslots; slot++) {
+        de = (nosfs_dirent_t *)block(bmap(dp, slot / NOSFS_DIRENTS_PER_BLOCK)) +
+             slot % NOSFS_DIRENTS_PER_BLOCK;
+        if (de->ino == 0) {
+            break;
+        }
+    }
+    if (slot == nslots) {
+        bmap(dp, nslots / NOSFS_DIRENTS_PER_BLOCK);
+        dp->size += BS;
+        de = (nosfs_dirent_t *)block(bmap(dp, slot / NOSFS_DIRENTS_PER_BLOCK));
+    }
+
+    de->ino = ino;
+    de->type = type;
+    de->name_len = strlen(name);
+    strncpy(de->name, name, NOSFS_NAME_LEN - 1);
+}
+
+static void write_file(uint32_t ino, const void *data, size_t len) {
+    nosfs_inode_t *ip = inode(ino);
+    for (size_t off = 0; off < len; off += BS) {
+        size_t chunk = (len - off < BS) ? len - off : BS;
+        memcpy(block(bmap(ip, off / BS)), (const uint8_t *)data + off, chunk);
+    }
+    ip->size = len;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: mkfs [-s size_mb] [-w swap_mb] [-i inodes] [-j journal_blocks] "
+                    "[-n files] image\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    uint64_t size_mb = 0, swap_mb = 0, nr_inodes = 0, journal_blocks = 0, nr_files = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            uint64_t v = strtoull(argv[i + 1], NULL, 0);
+            switch (argv[i][1]) {
+                case 's': size_mb = v; break;
+                case 'w': swap_mb = v; break;
+                case 'i': nr_inodes = v; break;
+                case 'j': journal_blocks = v; break;
+                case 'n': nr_files = v; break;
+                default: usage();
+            }
+            i++;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (!path) {
+        usage();
+    }
+
+    if (size_mb == 0) {
+        struct stat st;
+        size_mb = (stat(path, &st) == 0 && st.st_size >= 1024 * 1024)
+                ? (uint64_t)st.st_size / (1024 * 1024) : 64;
+    }
+
+    /* 交换区跟在文件系统之后: 头部块 + 每MB 256个槽 */
+    uint64_t nr_blocks = size_mb * 1024 * 1024 / BS;
+    uint64_t swap_blocks = swap_mb ? swap_mb * 1024 * 1024 / BS + 1 : 0;
+    if (nr_inodes == 0) {
+        nr_inodes = nr_blocks;      /* 每4KB一个inode */
+    }
+    if (journal_blocks == 0) {
+        journal_blocks = 257;       /* 日志头 + 256个日志块 */
+    }
+    if (journal_blocks > NOSFS_JOURNAL_MAX + 1) {
+        journal_blocks = NOSFS_JOURNAL_MAX + 1;
+    }
+
+    image = calloc(nr_blocks + swap_blocks, BS);
+    if (!image) {
+        perror("mkfs");
+        return 1;
+    }
+
+    sb = (nosfs_super_t *)block(0);
+    sb->magic = NOSFS_MAGIC;
+    sb->version = NOSFS_VERSION;
+    sb->block_size = BS;
+    sb->nr_blocks = nr_blocks;
+    sb->nr_inodes = nr_inodes;
+    sb->journal_start = 1;
+    sb->journal_blocks = journal_blocks;
+    sb->inode_bitmap_start = sb->journal_start + journal_blocks;
+    sb->inode_bitmap_blocks = (nr_inodes + NOSFS_BITS_PER_BLOCK - 1) / NOSFS_BITS_PER_BLOCK;
+    sb->block_bitmap_start = sb->inode_bitmap_start + sb->inode_bitmap_blocks;
+    sb->block_bitmap_blocks = (nr_blocks + NOSFS_BITS_PER_BLOCK - 1) / NOSFS_BITS_PER_BLOCK;
+    sb->inode_table_start = sb->block_bitmap_start + sb->block_bitmap_blocks;
+    sb->inode_table_blocks = (nr_inodes + NOSFS_INODES_PER_BLOCK - 1) / NOSFS_INODES_PER_BLOCK;
+    sb->data_start = sb->inode_table_start + sb->inode_table_blocks;
+
+    if (sb->data_start + 16 > nr_blocks) {
+        fprintf(stderr, "mkfs: image too small\n");
+        return 1;
+    }
+
+    nosfs_journal_t *jh = (nosfs_journal_t *)block(sb->journal_start);
+    jh->magic = NOSFS_JOURNAL_MAGIC;
+
+    /* 元数据区全部标记为已用, inode 0保留 */
+    for (uint64_t b = 0; b < sb->data_start; b++) {
+        set_bit(sb->block_bitmap_start, b);
+    }
+    set_bit(sb->inode_bitmap_start, 0);
+    next_block = sb->data_start;
+
+    uint32_t root = alloc_inode(NOSFS_T_DIR, NOSFS_ROOT_INO);
+
+    if (nr_files > 0) {
+        uint32_t dir = alloc_inode(NOSFS_T_DIR, root);
+        dir_add(root, "files", dir, NOSFS_T_DIR);
+
+        char name[32], text[64];
+        for (uint64_t i = 0; i < nr_files; i++) {
+            snprintf(name, sizeof(name), "f%06llu", (unsigned long long)i);
+            int len = snprintf(text, sizeof(text), "file %llu\n", (unsigned long long)i);
+            uint32_t ino = alloc_inode(NOSFS_T_FILE, dir);
+            dir_add(dir, name, ino, NOSFS_T_FILE);
+            write_file(ino, text, len);
+        }
+    }
+
+    if (swap_blocks) {
+        nosfs_swap_t *sw = (nosfs_swap_t *)block(nr_blocks);
+        sw->magic = NOSFS_SWAP_MAGIC;
+        sw->version = 1;
+        sw->nr_slots = swap_blocks - 1;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(image, BS, nr_blocks + swap_blocks, f) != nr_blocks + swap_blocks ||
+        fclose(f) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    printf("mkfs: %s: %llu MB, %llu blocks (data from %llu), %llu inodes, journal %llu blocks",
+           path, (unsigned long long)size_mb, (unsigned long long)nr_blocks,
+           (unsigned long long)sb->data_start, (unsigned long long)nr_inodes,
+           (unsigned long long)journal_blocks);
+    if (nr_files > 0) {
+        printf(", %llu files in /files", (unsigned long long)nr_files);
+    }
+    if (swap_blocks) {
+        printf(", %llu MB swap", (unsigned long long)swap_mb);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * udpgen - 主机端UDP负载生成器, 测量NOS的UDP回显服务
+ *
+ *   udpgen [-n count] [-s size] [-w window] [-p port] [host]
+ *
+ * 保持window个报文在途, 每收到一个回显就补发一个. 每个报文带序号和发送时间,
+ * 结束后报告每秒回显的报文数和往返延迟分布. 超过200ms没有任何回显时
+ * 认为在途报文全部丢失.
+ *
+ * 默认目标为127.0.0.1:5555, 即 make run-net 中QEMU用户模式网络转发到客户机7号端口.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define TIMEOUT_MS 200
+
+typedef struct {
+    uint64_t seq;
+    uint64_t sent_ns;
+} probe_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: udpgen [-n count] [-s size] [-w window] [-p port] [host]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    long count = 100000;
+    long size = 64;
+    long window = 16;
+    int port = 5555;
+    const char *host = "127.0.0.1";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:w:p:")) != -1) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 's': size = atol(optarg); break;
+            case 'w': window = atol(optarg); break;
+            case 'p': port = atoi(optarg); break;
+            default: usage();
+        }
+    }
+    if (optind < argc) {
+        host = argv[optind];
+    }
+    if (count <= 0 || window <= 0 || size < (long)sizeof(probe_t) || size > 1472) {
+        fprintf(stderr, "udpgen: size must be %zu..1472, count and window > 0\n",
+                sizeof(probe_t));
+        return 1;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    if (fd < 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("udpgen");
+        return 1;
+    }
+
+    uint64_t *rtt = malloc(count * sizeof(uint64_t));
+    char *buf = calloc(1, size);
+    char rbuf[2048];
+    if (!rtt || !buf) {
+        perror("udpgen");
+        return 1;
+    }
+
+    long sent = 0, received = 0, lost = 0, inflight = 0, bad = 0;
+    uint64_t start = now_ns();
+
+    while (sent < count || inflight > 0) {
+        while (inflight < window && sent < count) {
+            probe_t p = { .seq = sent, .sent_ns = now_ns() };
+            memcpy(buf, &p, sizeof(p));
+            if (send(fd, buf, size, 0) != size) {
+                perror("udpgen: send");
+                return 1;
+            }
+            sent++;
+            inflight++;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int r = poll(&pfd, 1, TIMEOUT_MS);
+        if (r < 0) {
+            perror("udpgen: poll");
+            return 1;
+        }
+        if (r == 0) {
+            lost += inflight;
+            inflight = 0;
+            continue;
+        }
+
+        ssize_t n = recv(fd, rbuf, sizeof(rbuf), 0);
+        if (n < 0) {
+            /* 目标端口不可达等错误 (例如QEMU还没有启动) */
+            perror("udpgen: recv");
+            return 1;
+        }
+        probe_t p;
+        if (n != size) {
+            bad++;
+            continue;
+        }
+        memcpy(&p, rbuf, sizeof(p));
+        if (p.seq >= (uint64_t)sent) {
+            bad++;
+            continue;
+        }
+        rtt[received++] = now_ns() - p.sent_ns;
+        if (inflight > 0) {
+            inflight--;
+        }
+    }
+
+    double secs = (now_ns() - start) / 1e9;
+    printf("udpgen: %s:%d, %ld x %ldB, window %ld\n", host, port, count, size, window);
+    printf("  sent %ld, echoed %ld, lost %ld, bad %ld in %.3fs\n",
+           sent, received, lost, bad, secs);
+    printf("  %.0f packets/s, %.2f Mbit/s echoed\n",
+           received / secs, received * size * 8 / secs / 1e6);
+
+    if (received > 0) {
+        qsort(rtt, received, sizeof(uint64_t), cmp_u64);
+        printf("  RTT us: min %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+               rtt[0] / 1e3, rtt[received / 2] / 1e3,
+               rtt[received * 99 / 100] / 1e3, rtt[received - 1] / 1e3);
+    }
+
+    free(rtt);
+    free(buf);
+    close(fd);
+    return lost || bad ? 2 : 0;
+}
@@ -0,0 +1,10 @@
+/* hello: 打印参数和pid */
+#include "ulib.h"
+
+int main(int argc, char **argv) {
+    printf("Hello from user mode! pid %d\n", getpid());
+    for (int i = 0; i < argc; i++) {
+        printf("  argv[%d] = %s\n", i, argv[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * pages [n] [w]: 读 (加w时写) 一个4MB数组的前n页, 然后让出CPU.
+ * 数组在bss中, 只有碰到的页才分配; 退出时内核打印的缺页统计里
+ * zero一项就是n. 同时运行几个实例 (如 pages 8 | pages 8) 时代码页是共享的.
+ */
+#include "ulib.h"
+
+#define ARRAY_PAGES 1024
+
+static char big[ARRAY_PAGES][4096];
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 16;
+    bool write_pages = argc > 2 && strcmp(argv[2], "w") == 0;
+    long sum = 0;
+
+    if (n < 0 || n > ARRAY_PAGES) {
+        n = ARRAY_PAGES;
+    }
+    for (long i = 0; i < n; i++) {
+        if (write_pages) {
+            big[i][0] = (char)i;
+        }
+        sum += big[i][0];
+    }
+    sched_yield();
+
+    printf("pages: touched %ld of %d pages (%s), sum %ld\n",
+           n, ARRAY_PAGES, write_pages ? "write" : "read", sum);
+    return 0;
+}
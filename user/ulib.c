@@ -0,0 +1,185 @@
+/* 用户程序运行库 */
+#include "ulib.h"
+
+static inline long syscall3(long nr, long a0, long a1, long a2) {
+    register long r_a0 asm("a0") = a0;
+    register long r_a1 asm("a1") = a1;
+    register long r_a2 asm("a2") = a2;
+    register long r_a7 asm("a7") = nr;
+    asm volatile("ecall" : "+r"(r_a0) : "r"(r_a1), "r"(r_a2), "r"(r_a7) : "memory");
+    return r_a0;
+}
+
+ssize_t read(int fd, void *buf, size_t len) {
+    return syscall3(SYS_read, fd, (long)buf, len);
+}
+
+ssize_t write(int fd, const void *buf, size_t len) {
+    return syscall3(SYS_write, fd, (long)buf, len);
+}
+
+int open(const char *path, int flags) {
+    return syscall3(SYS_openat, AT_FDCWD, (long)path, flags);
+}
+
+int close(int fd) {
+    return syscall3(SYS_close, fd, 0, 0);
+}
+
+ssize_t lseek(int fd, ssize_t offset, int whence) {
+    return syscall3(SYS_lseek, fd, offset, whence);
+}
+
+void exit(int code) {
+    syscall3(SYS_exit, code, 0, 0);
+    for (;;) {
+    }
+}
+
+int sched_yield(void) {
+    return syscall3(SYS_sched_yield, 0, 0, 0);
+}
+
+int getpid(void) {
+    return syscall3(SYS_getpid, 0, 0, 0);
+}
+
+size_t strlen(const char *s) {
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    return n;
+}
+
+int strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+void *memset(void *s, int c, size_t n) {
+    unsigned char *p = s;
+    while (n--) {
+        *p++ = c;
+    }
+    return s;
+}
+
+void *memcpy(void *dst, const void *src, size_t n) {
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+long atol(const char *s) {
+    long v = 0;
+    int neg = *s == '-';
+    if (neg) {
+        s++;
+    }
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (*s++ - '0');
+    }
+    return neg ? -v : v;
+}
+
+/* ---------------- printf ---------------- */
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} out_t;
+
+static void out_char(out_t *out, char c) {
+    if (out->len + 1 < out->size) {
+        out->buf[out->len] = c;
+    }
+    out->len++;
+}
+
+static void out_num(out_t *out, unsigned long long v, int base, bool neg) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v);
+    if (neg) {
+        out_char(out, '-');
+    }
+    while (n > 0) {
+        out_char(out, tmp[--n]);
+    }
+}
+
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    out_t out = { buf, size, 0 };
+
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            out_char(&out, *fmt);
+            continue;
+        }
+        int longs = 0;
+        while (*++fmt == 'l') {
+            longs++;
+        }
+        switch (*fmt) {
+            case 'd': {
+                long long v = longs ? va_arg(ap, long long) : va_arg(ap, int);
+                out_num(&out, v < 0 ? -(unsigned long long)v : (unsigned long long)v, 10, v < 0);
+                break;
+            }
+            case 'u':
+            case 'x': {
+                unsigned long long v = longs ? va_arg(ap, unsigned long long) : va_arg(ap, unsigned);
+                out_num(&out, v, *fmt == 'u' ? 10 : 16, false);
+                break;
+            }
+            case 'p':
+                out_char(&out, '0');
+                out_char(&out, 'x');
+                out_num(&out, (unsigned long long)va_arg(ap, void *), 16, false);
+                break;
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                while (*s) {
+                    out_char(&out, *s++);
+                }
+                break;
+            }
+            case 'c':
+                out_char(&out, va_arg(ap, int));
+                break;
+            case '\0':
+                fmt--;
+                break;
+            default:
+                out_char(&out, *fmt);
+                break;
+        }
+    }
+    if (size > 0) {
+        buf[out.len < size ? out.len : size - 1] = '\0';
+    }
+    return out.len;
+}
+
+int printf(const char *fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n >= (int)sizeof(buf)) {
+        n = sizeof(buf) - 1;
+    }
+    return write(1, buf, n);
+}
@@ -0,0 +1,44 @@
+#ifndef _USER_ULIB_H
+#define _USER_ULIB_H
+
+/*
+ * 用户程序的运行库: 系统调用封装和几个字符串/格式化函数.
+ * 系统调用号与内核共用include/kernel/syscall.h.
+ */
+
+#include <kernel/types.h>
+#include <kernel/syscall.h>
+#include <kernel/stdarg.h>
+
+/* 打开标志 (与内核的file.h相同) */
+#define O_RDONLY  0x000
+#define O_WRONLY  0x001
+#define O_RDWR    0x002
+#define O_CREAT   0x040
+#define O_TRUNC   0x200
+#define O_APPEND  0x400
+
+#define AT_FDCWD  (-100)
+
+/* 系统调用 */
+ssize_t read(int fd, void *buf, size_t len);
+ssize_t write(int fd, const void *buf, size_t len);
+int open(const char *path, int flags);
+int close(int fd);
+ssize_t lseek(int fd, ssize_t offset, int whence);
+void exit(int code) __attribute__((noreturn));
+int sched_yield(void);
+int getpid(void);
+
+/* 字符串 */
+size_t strlen(const char *s);
+int strcmp(const char *a, const char *b);
+void *memset(void *s, int c, size_t n);
+void *memcpy(void *dst, const void *src, size_t n);
+long atol(const char *s);
+
+/* 格式化输出到标准输出: %d %u %x %s %c %p, 可加l/ll */
+int printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+
+#endif